@@ -0,0 +1,138 @@
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include "halley/maths/random.h"
+#include "halley/time/stopwatch.h"
+#include "halley/utils/utils.h"
+#include "halley/text/string_converter.h"
+#include "audio/audio_mixer.h"
+
+using namespace Halley;
+
+// Measures the throughput of each AudioMixer kernel on every instruction set supported by this CPU, against the scalar
+// reference, and checks that they all produce the same output within a tolerance.
+// Exits with a non-zero code if any of them doesn't.
+
+namespace {
+	constexpr size_t bufferSize = 512;
+	constexpr size_t nBuffers = 64;
+
+	struct Kernel {
+		String name;
+		float tolerance;
+		std::function<void(const AudioMixerKernels& kernels, const float* src, float* dst, size_t n, float* state)> run;
+		size_t dstScale = 1;
+	};
+
+	Vector<float> makeSignal(size_t n, uint32_t seed)
+	{
+		Random rng(seed);
+		Vector<float> result;
+		result.resize(n);
+		for (auto& s: result) {
+			s = rng.getFloat(-1.0f, 1.0f);
+		}
+		return result;
+	}
+
+	// Runs the kernel over nBuffers consecutive buffers, so any state carried between buffers is exercised too
+	Vector<float> runOver(const Kernel& kernel, const AudioMixerKernels& kernels, const Vector<float>& src, const Vector<float>& dstInit)
+	{
+		Vector<float> dst = dstInit;
+		float state[4] = {};
+		for (size_t i = 0; i < nBuffers; ++i) {
+			kernel.run(kernels, src.data() + i * bufferSize, dst.data() + i * bufferSize * kernel.dstScale, bufferSize, state);
+		}
+		return dst;
+	}
+
+	float maxError(const Vector<float>& a, const Vector<float>& b)
+	{
+		float result = 0;
+		for (size_t i = 0; i < a.size(); ++i) {
+			result = std::max(result, std::abs(a[i] - b[i]));
+		}
+		return result;
+	}
+
+	double measureSamplesPerSecond(const Kernel& kernel, const AudioMixerKernels& kernels, const Vector<float>& src, Vector<float>& dst)
+	{
+		constexpr int64_t minNanoseconds = 200'000'000;
+
+		float state[4] = {};
+		size_t iterations = 0;
+		Stopwatch stopwatch;
+		while (true) {
+			for (size_t i = 0; i < 1000; ++i) {
+				kernel.run(kernels, src.data(), dst.data(), bufferSize, state);
+			}
+			iterations += 1000;
+
+			stopwatch.pause();
+			if (stopwatch.elapsedNanoseconds() >= minNanoseconds) {
+				break;
+			}
+			stopwatch.start();
+		}
+
+		return static_cast<double>(iterations * bufferSize) * 1'000'000'000.0 / static_cast<double>(stopwatch.elapsedNanoseconds());
+	}
+}
+
+int main()
+{
+	Vector<Kernel> kernelList;
+	kernelList.push_back({ "mix", 1e-6f, [] (const AudioMixerKernels& k, const float* src, float* dst, size_t n, float*) { k.mix(src, dst, n, 0.7f, 0.7f); } });
+	kernelList.push_back({ "mixRamp", 1e-5f, [] (const AudioMixerKernels& k, const float* src, float* dst, size_t n, float*) { k.mix(src, dst, n, 0.2f, 0.9f); } });
+	kernelList.push_back({ "copyRamp", 1e-5f, [] (const AudioMixerKernels& k, const float* src, float* dst, size_t n, float*) { k.copy(src, dst, n, 0.9f, 0.2f); } });
+	kernelList.push_back({ "compressRange", 0.0f, [] (const AudioMixerKernels& k, const float* src, float* dst, size_t n, float*) { k.compressRange(dst, n, 0.5f); } });
+	kernelList.push_back({ "interleaveStereo", 0.0f, [] (const AudioMixerKernels& k, const float* src, float* dst, size_t n, float*) { k.interleaveStereo(src, src + 1, dst, n); }, 2 });
+
+	kernelList.push_back({ "biquad", 1e-4f, [] (const AudioMixerKernels& k, const float* src, float* dst, size_t n, float* state)
+	{
+		// 1kHz Butterworth low pass at 48kHz, same as AudioFilterBiquad::setLowPass
+		const float w0 = 2 * pif() * 1000.0f / 48000.0f;
+		const float alpha = std::sin(w0) / std::sqrt(2.0f);
+		const float cosw0 = std::cos(w0);
+		const float a0 = 1 + alpha;
+		const float coefficients[] = { -2 * cosw0 / a0, (1 - alpha) / a0, (1 - cosw0) / 2 / a0, (1 - cosw0) / a0, (1 - cosw0) / 2 / a0 };
+		k.biquad(dst, n, coefficients, state);
+	} });
+
+	const auto src = makeSignal(bufferSize * nBuffers + 1, 1);
+	const auto dstInit = makeSignal(bufferSize * nBuffers * 2, 2);
+	const auto& scalar = *AudioMixer::getKernels(AudioMixerInstructionSet::Scalar);
+
+	std::cout << "Best instruction set: " << toString(AudioMixer::getBestInstructionSet()) << "\n\n";
+	std::cout << std::left << std::setw(18) << "kernel" << std::setw(8) << "isa" << std::right << std::setw(14) << "Msamples/s" << std::setw(10) << "speedup" << std::setw(14) << "max error" << "\n";
+
+	bool ok = true;
+	for (const auto& kernel: kernelList) {
+		const auto reference = runOver(kernel, scalar, src, dstInit);
+		double scalarRate = 0;
+
+		for (const auto set: { AudioMixerInstructionSet::Scalar, AudioMixerInstructionSet::SSE, AudioMixerInstructionSet::AVX2, AudioMixerInstructionSet::NEON }) {
+			const auto* kernels = AudioMixer::getKernels(set);
+			if (!kernels) {
+				continue;
+			}
+
+			const float error = maxError(reference, runOver(kernel, *kernels, src, dstInit));
+			auto dst = dstInit;
+			const double rate = measureSamplesPerSecond(kernel, *kernels, src, dst);
+			if (set == AudioMixerInstructionSet::Scalar) {
+				scalarRate = rate;
+			}
+
+			const bool pass = error <= kernel.tolerance;
+			ok = ok && pass;
+			std::cout << std::left << std::setw(18) << kernel.name << std::setw(8) << toString(set) << std::right << std::fixed
+				<< std::setw(14) << std::setprecision(1) << (rate / 1'000'000.0)
+				<< std::setw(9) << std::setprecision(2) << (rate / scalarRate) << "x"
+				<< std::setw(14) << std::scientific << std::setprecision(2) << error
+				<< (pass ? "" : "  FAILED") << "\n";
+		}
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <thread>
+#include "halley/audio/audio_clip.h"
+#include "halley/data_structures/config_node.h"
+#include "halley/maths/random.h"
+#include "halley/properties/audio_properties.h"
+#include "halley/text/string_converter.h"
+#include "halley/utils/utils.h"
+#include "audio/audio_mixer.h"
+#include "audio/audio_offline_renderer.h"
+
+using namespace Halley;
+
+// Renders a scripted scene (emitters orbiting the listener with looping tones, plus a steady stream of one-shots)
+// without an audio device, and reports how fast the engine got through it.
+// The scene is rendered once on the audio thread alone and once with render threads, and the two must match exactly.
+//
+// Usage: halley-audio-render-benchmark [seconds] [emitters] [renderThreads] [out.wav]
+// Exits with a non-zero code if the renders differ.
+
+namespace {
+	class ToneClip final : public IAudioClip {
+	public:
+		ToneClip(float frequency, size_t length)
+		{
+			const float step = 2 * pif() * frequency / 48000.0f;
+			samples.resize(length);
+			for (size_t i = 0; i < length; ++i) {
+				samples[i] = std::sin(static_cast<float>(i) * step) * 0.2f;
+			}
+		}
+
+		size_t copyChannelData(size_t channelN, size_t pos, size_t len, float gain0, float gain1, AudioSamples dst) const override
+		{
+			AudioMixer::copy(dst, AudioSamples(samples).subspan(pos, len), gain0, gain1);
+			return len;
+		}
+
+		uint8_t getNumberOfChannels() const override { return 1; }
+		size_t getLength() const override { return samples.size(); }
+
+	private:
+		mutable Vector<AudioSample> samples;
+	};
+
+	AudioProperties makeAudioProperties(int maxVoices)
+	{
+		ConfigNode::MapType bus;
+		bus["id"] = "master";
+		ConfigNode::MapType props;
+		props["buses"] = ConfigNode::SequenceType{ ConfigNode(std::move(bus)) };
+		props["maxVoices"] = maxVoices;
+		return AudioProperties(ConfigNode(std::move(props)));
+	}
+
+	AudioRenderScript makeScript(double duration, size_t nEmitters)
+	{
+		constexpr double moveInterval = 0.05;
+		constexpr double oneShotInterval = 0.02;
+
+		AudioRenderScript script;
+		Random rng(1234u);
+		AudioEventId nextEventId = 1;
+
+		script.setListener(0, AudioListenerData(Vector3f(), Vector3f(), 100.0f));
+
+		for (size_t i = 0; i < nEmitters; ++i) {
+			const auto emitterId = static_cast<AudioEmitterId>(i + 1);
+			const float radius = rng.getFloat(20.0f, 400.0f);
+			const float speed = rng.getFloat(-2.0f, 2.0f);
+			const float phase = rng.getFloat(0.0f, 2 * pif());
+			auto positionAt = [=] (double time)
+			{
+				const float angle = phase + speed * static_cast<float>(time);
+				return AudioPosition::makePositional(Vector2f(std::cos(angle), std::sin(angle)) * radius, AudioAttenuation(50.0f, 500.0f));
+			};
+
+			script.createEmitter(0, emitterId, positionAt(0));
+			script.play(0, nextEventId++, std::make_shared<ToneClip>(rng.getFloat(100.0f, 2000.0f), 48000), emitterId, 1.0f, true);
+			for (double t = moveInterval; t < duration; t += moveInterval) {
+				script.setEmitterPosition(t, emitterId, positionAt(t));
+			}
+		}
+
+		const auto oneShot = std::make_shared<ToneClip>(3000.0f, 4800);
+		for (double t = 0; t < duration; t += oneShotInterval) {
+			script.play(t, nextEventId++, oneShot, 0, 0.5f);
+		}
+
+		return script;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const double duration = argc > 1 ? String(argv[1]).toFloat() : 20.0;
+	const size_t nEmitters = argc > 2 ? static_cast<size_t>(String(argv[2]).toInteger()) : 96;
+	const size_t nThreads = argc > 3 ? static_cast<size_t>(String(argv[3]).toInteger()) : std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	const String wavPath = argc > 4 ? String(argv[4]) : String();
+
+	const auto properties = makeAudioProperties(64);
+	const auto script = makeScript(duration, nEmitters);
+
+	bool ok = true;
+	Bytes reference;
+	for (const size_t threads: { size_t(0), nThreads }) {
+		AudioOfflineRenderer renderer(properties);
+		renderer.setRenderThreads(threads);
+		const auto stats = renderer.render(script, duration);
+
+		std::cout << threads << " render threads: " << stats.toString() << "\n";
+
+		if (threads == 0) {
+			reference = renderer.getOutput();
+			if (!wavPath.isEmpty()) {
+				renderer.writeWAV(Path(wavPath));
+			}
+		} else if (renderer.getOutput() != reference) {
+			std::cout << "  FAILED: output differs from the single threaded render\n";
+			ok = false;
+		}
+	}
+
+	return ok ? 0 : 1;
+}
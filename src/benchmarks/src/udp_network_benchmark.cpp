@@ -0,0 +1,132 @@
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "halley/net/connection/network_packet.h"
+#include "halley/text/string_converter.h"
+#include "asio_udp_network_service.h"
+
+using namespace Halley;
+
+// Simulates a dedicated server with many peers over loopback: every peer sends a burst of small packets each tick, and the server
+// echoes each one back. Reports the server's packet throughput and how many socket syscalls it made per packet, with one syscall
+// per packet and with batched I/O.
+// Clients run in the same process, so the absolute numbers include their cost too.
+//
+// Usage: halley-udp-network-benchmark [peers] [seconds] [port]
+// Exits with a non-zero code if the peers fail to connect.
+
+namespace {
+	constexpr size_t burstSize = 8;
+	constexpr size_t packetSize = 96;
+
+	using Clock = std::chrono::steady_clock;
+
+	double secondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	struct Result {
+		double seconds = 0;
+		size_t serverPackets = 0;
+		size_t serverSyscalls = 0;
+		size_t echoesReceived = 0;
+	};
+
+	std::optional<Result> run(size_t nPeers, double duration, int port, bool batched)
+	{
+		AsioUDPNetworkService server(port, IPVersion::IPv4, batched);
+		Vector<std::shared_ptr<IConnection>> serverConnections;
+		server.startListening([&] (NetworkService::Acceptor& acceptor)
+		{
+			serverConnections.push_back(acceptor.accept());
+		});
+
+		Vector<std::unique_ptr<AsioUDPNetworkService>> clients;
+		Vector<std::shared_ptr<IConnection>> clientConnections;
+		for (size_t i = 0; i < nPeers; ++i) {
+			clients.push_back(std::make_unique<AsioUDPNetworkService>(0, IPVersion::IPv4, batched));
+			clientConnections.push_back(clients.back()->connect("127.0.0.1:" + toString(port)));
+		}
+
+		auto updateClients = [&] ()
+		{
+			for (auto& client: clients) {
+				client->update(0);
+			}
+		};
+
+		// Handshakes
+		const auto handshakeStart = Clock::now();
+		while (serverConnections.size() < nPeers || std::any_of(clientConnections.begin(), clientConnections.end(), [] (const auto& c) { return c->getStatus() != ConnectionStatus::Connected; })) {
+			updateClients();
+			server.update(0);
+			if (secondsSince(handshakeStart) > 5.0) {
+				std::cout << "Only " << serverConnections.size() << " of " << nPeers << " peers connected\n";
+				return std::nullopt;
+			}
+		}
+
+		const auto statsBefore = server.getIOStats();
+		std::array<gsl::byte, packetSize> payload = {};
+		InboundNetworkPacket packet;
+		Result result;
+
+		const auto start = Clock::now();
+		while (secondsSince(start) < duration) {
+			for (auto& conn: clientConnections) {
+				for (size_t i = 0; i < burstSize; ++i) {
+					conn->send(IConnection::TransmissionType::Unreliable, OutboundNetworkPacket(payload));
+				}
+			}
+			updateClients();
+
+			server.update(0);
+			for (auto& conn: serverConnections) {
+				while (conn->receive(packet)) {
+					conn->send(IConnection::TransmissionType::Unreliable, OutboundNetworkPacket(packet.getBytes()));
+				}
+			}
+			server.update(0);
+
+			updateClients();
+			for (auto& conn: clientConnections) {
+				while (conn->receive(packet)) {
+					++result.echoesReceived;
+				}
+			}
+		}
+		result.seconds = secondsSince(start);
+
+		const auto& statsAfter = server.getIOStats();
+		result.serverPackets = (statsAfter.packetsReceived - statsBefore.packetsReceived) + (statsAfter.packetsSent - statsBefore.packetsSent);
+		result.serverSyscalls = (statsAfter.receiveCalls - statsBefore.receiveCalls) + (statsAfter.sendCalls - statsBefore.sendCalls);
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const size_t nPeers = argc > 1 ? static_cast<size_t>(String(argv[1]).toInteger()) : 64;
+	const double duration = argc > 2 ? String(argv[2]).toFloat() : 3.0;
+	const int port = argc > 3 ? String(argv[3]).toInteger() : 47810;
+
+	std::cout << nPeers << " peers, bursts of " << burstSize << " packets of " << packetSize << " bytes\n";
+	if (!UDPBatchIO::isSupported()) {
+		std::cout << "Batched I/O is not supported on this platform, both runs use one syscall per packet\n";
+	}
+
+	for (const bool batched: { false, true }) {
+		const auto result = run(nPeers, duration, batched ? port + 1 : port, batched);
+		if (!result) {
+			return 1;
+		}
+
+		std::cout << std::setw(9) << (batched ? "batched" : "unbatched") << ": "
+			<< std::fixed << std::setprecision(0) << (result->serverPackets / result->seconds) << " server packets/s, "
+			<< std::setprecision(3) << (static_cast<double>(result->serverSyscalls) / std::max(result->serverPackets, size_t(1))) << " syscalls/packet, "
+			<< std::setprecision(0) << (result->echoesReceived / result->seconds) << " echoes/s\n";
+	}
+
+	return 0;
+}
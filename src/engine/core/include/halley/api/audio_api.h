@@ -245,6 +245,7 @@ namespace Halley
 			uint32_t paused = 0;
 			uint8_t dstChannels = 0;
 			bool playing = true;
+			bool isVirtual = false;
 			std::array<float, 8> channelMix;
 		};
 
@@ -317,5 +318,8 @@ namespace Halley
 		virtual void setBufferSizeController(std::shared_ptr<IAudioBufferSizeController> controller) = 0;
 
 		virtual void setDebugListener(IAudioDebugDataListener* listener) {}
+
+		// Number of extra threads used to render voices in parallel with the audio thread. 0 renders everything on the audio thread.
+		virtual void setRenderThreads(size_t nThreads) {}
 	};
 }
@@ -15,6 +15,7 @@ namespace Halley
 	{
 	public:
 		virtual ~NetworkAPI() {}
-		virtual std::unique_ptr<NetworkService> createService(NetworkProtocol protocol, int port = 0) = 0;
+		// batchedIO is a hint for UDP services with many peers (e.g. dedicated servers), and may be ignored
+		virtual std::unique_ptr<NetworkService> createService(NetworkProtocol protocol, int port = 0, bool batchedIO = false) = 0;
 	};
 }
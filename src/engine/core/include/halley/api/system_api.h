@@ -6,6 +6,7 @@
 #include "halley/concurrency/concurrent.h"
 #include "halley/data_structures/maybe.h"
 #include "halley/input/input_keys.h"
+#include "halley/support/profiler.h"
 
 namespace Halley
 {
@@ -60,6 +61,7 @@ namespace Halley
 		{
 			return std::thread([=] () {
 				setThreadName(name);
+				ProfilerCapture::get().setThreadName(name);
 				setThreadPriority(priority);
 				runnable();
 			});
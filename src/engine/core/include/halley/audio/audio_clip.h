@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 #include "halley/resources/resource.h"
 #include "halley/resources/resource_data.h"
 #include "halley/api/audio_api.h"
@@ -18,10 +19,13 @@ namespace Halley
 
 		virtual String getName() const { return ""; }
 		virtual size_t copyChannelData(size_t channelN, size_t pos, size_t len, float gain0, float gain1, AudioSamples dst) const = 0;
+		virtual void skipChannelData(size_t channelN, size_t pos, size_t len) const {} // Only needed if reading has side effects
 		virtual uint8_t getNumberOfChannels() const = 0;
 		virtual size_t getLength() const = 0; // in samples
 		virtual size_t getLoopPoint() const { return 0; } // in samples
 		virtual bool isLoaded() const { return true; }
+		// Clips with playback state shared by every voice playing them; the engine renders such voices on the same thread
+		virtual bool hasSharedPlaybackState() const { return false; }
 	};
 
 	class AudioClip final : public AsyncResource, public IAudioClip
@@ -41,6 +45,10 @@ namespace Halley
 		size_t getLength() const override; // in samples
 		size_t getLoopPoint() const override; // in samples
 		bool isLoaded() const override;
+		bool hasSharedPlaybackState() const override;
+
+		// Sizes the calling thread's scratch for decoding streamed clips, so that rendering them doesn't allocate
+		static void prepareRenderThread();
 
 		ResourceMemoryUsage getMemoryUsage() const override;
 
@@ -58,7 +66,7 @@ namespace Halley
 		std::array<std::unique_ptr<VorbisData>, 2> vorbisData;
 
 		mutable Vector<Vector<AudioSample>> samples;
-		mutable Vector<Vector<AudioSample>> buffer;
+		mutable std::mutex streamMutex;
 
 		VorbisData* getVorbisData(size_t targetPos) const;
 	};
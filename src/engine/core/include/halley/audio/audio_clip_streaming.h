@@ -18,10 +18,12 @@ namespace Halley
 
 		String getName() const override;
 		size_t copyChannelData(size_t channelN, size_t pos, size_t len, float gain0, float gain1, AudioSamples dst) const override;
+		void skipChannelData(size_t channelN, size_t pos, size_t len) const override;
 		uint8_t getNumberOfChannels() const override;
 		size_t getLength() const override;
 		size_t getSamplesLeft() const;
 		bool isLoaded() const override;
+		bool hasSharedPlaybackState() const override { return true; }
 
 		void setLatencyTarget(size_t samples);
 		size_t getLatencyTarget() const;
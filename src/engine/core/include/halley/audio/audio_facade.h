@@ -15,6 +15,8 @@ namespace Halley {
 	class AudioHandleImpl;
 	class AudioEmitterHandleImpl;
 	class IAudioClip;
+	class AudioCommandQueue;
+	struct AudioCommand;
 
     class AudioFacade final : public AudioAPIInternal
     {
@@ -76,6 +78,7 @@ namespace Halley {
 		void setBufferSizeController(std::shared_ptr<IAudioBufferSizeController> controller) override;
 
 		void setDebugListener(IAudioDebugDataListener* listener) override;
+		void setRenderThreads(size_t nThreads) override;
 
 	private:
 		Resources* resources = nullptr;
@@ -89,13 +92,12 @@ namespace Halley {
 	    AudioSpec audioSpec;
 		int lastDeviceNumber = 0;
 
-		RingBuffer<Vector<std::function<void()>>> commandQueue;
-		Vector<std::function<void()>> outbox;
-		Vector<std::function<void()>> inbox;
+		std::unique_ptr<AudioCommandQueue> commandQueue;
     	
 		RingBuffer<String> exceptions;
 		Vector<uint32_t> playingSounds;
-		RingBuffer<Vector<uint32_t>> finishedSoundsQueue;
+		RingBuffer<AudioEventId> finishedSoundsQueue;
+		Vector<AudioEventId> finishedSounds;
 
 		std::map<int, AudioHandle> musicTracks;
 
@@ -107,6 +109,7 @@ namespace Halley {
 
 		RingBuffer<AudioDebugData> audioDebugData;
 		IAudioDebugDataListener* debugListener = nullptr;
+		size_t renderThreads = 0; // Only accessed from the game thread
 
 		HashMap<AudioRegionId, String> regionNames;
 
@@ -117,6 +120,10 @@ namespace Halley {
 	    void run();
 	    void stepAudio();
 	    void enqueue(std::function<void()> action);
+		void enqueue(const AudioCommand& command, std::shared_ptr<const void> resource = {});
+		void enqueueCreateEmitter(AudioEmitterId emitterId, const AudioPosition& position, bool temporary);
+		void enqueueSetPosition(AudioEmitterId emitterId, const AudioPosition& position);
+		void applyRenderThreads(size_t nThreads);
 		
 		void stopMusic(AudioHandle& handle, float fade);
 
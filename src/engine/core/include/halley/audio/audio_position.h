@@ -24,6 +24,15 @@ namespace Halley
 			AudioAttenuation attenuation;
 		};
 
+		// Trivially copyable form of a position with at most one source, used to send it to the audio thread without allocating
+		struct Compact {
+			SpatialSource source;
+			float pan = 0;
+			bool isUI = true;
+			bool isPannable = false;
+			bool hasSource = false;
+		};
+
 		AudioPosition();
 
 		static AudioPosition makeUI(float pan = 0.0f); // -1.0f = left, 1.0f = right
@@ -40,6 +49,9 @@ namespace Halley
 
 		float getDopplerShift(const AudioListenerData& listener) const;
 
+		bool toCompact(Compact& result) const; // Returns false if there are too many sources to fit
+		void setFromCompact(const Compact& compact);
+
 	private:
 		Vector<SpatialSource> sources;
 		float pan = 0;
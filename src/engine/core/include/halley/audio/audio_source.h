@@ -3,9 +3,12 @@
 #include <gsl/span>
 #include <array>
 #include "halley/api/audio_api.h"
+#include "halley/data_structures/vector.h"
 
 namespace Halley
 {
+	class IAudioClip;
+
 	class AudioSource {
 	public:
 		virtual ~AudioSource() {}
@@ -15,6 +18,10 @@ namespace Halley
 		virtual size_t getSamplesLeft() const = 0;
 		virtual bool isReady() const { return true; }
 		virtual bool getAudioData(size_t numSamples, AudioMultiChannelSamples dst) = 0;
+		// Advances playback as if getAudioData had been called, but without generating any samples
+		virtual bool skipAudioData(size_t numSamples) = 0;
 		virtual void restart() = 0;
+		// Adds the clips currently played by this source whose playback state is shared (see IAudioClip::hasSharedPlaybackState)
+		virtual void collectSharedClips(Vector<const IAudioClip*>& dst) const {}
 	};
 }
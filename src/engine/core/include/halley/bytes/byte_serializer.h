@@ -39,6 +39,64 @@ namespace Halley {
 
 	class SerializerState {};
 
+	namespace SerializerDetail {
+		// Types whose serialized form is the same as their in-memory representation, so contiguous arrays of them can be copied in one go.
+		// eligible is checked at compile time (so memcpy is never instantiated for anything else), and canCopy for the given options.
+		template <typename T>
+		struct BulkCopy {
+			constexpr static bool eligible = [] ()
+			{
+				if constexpr (std::is_enum_v<T>) {
+					return BulkCopy<std::underlying_type_t<T>>::eligible;
+				} else {
+					return std::is_same_v<T, float> || std::is_same_v<T, double> || (std::is_integral_v<T> && !std::is_same_v<T, bool>);
+				}
+			}();
+
+			static bool canCopy(const SerializerOptions& options)
+			{
+				if constexpr (std::is_enum_v<T>) {
+					return BulkCopy<std::underlying_type_t<T>>::canCopy(options);
+				} else if constexpr (std::is_integral_v<T>) {
+					// Integers are variable-length from version 1 onwards
+					return options.version == 0;
+				} else {
+					return true;
+				}
+			}
+		};
+
+		template <typename T, typename U>
+		struct BulkCopy<Vector2D<T, U>> {
+			constexpr static bool eligible = sizeof(Vector2D<T, U>) == 2 * sizeof(T) && BulkCopy<T>::eligible;
+
+			static bool canCopy(const SerializerOptions& options)
+			{
+				return BulkCopy<T>::canCopy(options);
+			}
+		};
+
+		template <typename T, int Alignment>
+		struct BulkCopy<Vector4D<T, Alignment>> {
+			constexpr static bool eligible = sizeof(Vector4D<T, Alignment>) == 4 * sizeof(T) && BulkCopy<T>::eligible;
+
+			static bool canCopy(const SerializerOptions& options)
+			{
+				return BulkCopy<T>::canCopy(options);
+			}
+		};
+
+		template <typename T>
+		struct BulkCopy<Colour4<T>> {
+			constexpr static bool eligible = sizeof(Colour4<T>) == 4 * sizeof(T) && BulkCopy<T>::eligible;
+
+			static bool canCopy(const SerializerOptions& options)
+			{
+				return BulkCopy<T>::canCopy(options);
+			}
+		};
+	}
+
 	class ByteSerializationBase {
 	public:
 		ByteSerializationBase(SerializerOptions options)
@@ -69,14 +127,14 @@ namespace Halley {
 	public:
 		Serializer(SerializerOptions options);
 		explicit Serializer(gsl::span<gsl::byte> dst, SerializerOptions options);
+		// Clears dst (keeping its capacity) and grows it as data is written
+		explicit Serializer(Bytes& dst, SerializerOptions options);
 
 		template <typename T, typename std::enable_if<std::is_convertible<T, std::function<void(Serializer&)>>::value, int>::type = 0>
 		static Bytes toBytes(const T& f, SerializerOptions options = {})
 		{
-			auto dry = Serializer(options);
-			f(dry);
-			Bytes result(dry.getSize());
-			auto s = Serializer(gsl::as_writable_bytes(gsl::span<Halley::Byte>(result)), options);
+			Bytes result;
+			auto s = Serializer(result, std::move(options));
 			f(s);
 			return result;
 		}
@@ -127,34 +185,19 @@ namespace Halley {
 		template <typename T>
 		Serializer& operator<<(const Vector<T>& val)
 		{
-			uint32_t sz = static_cast<uint32_t>(val.size());
-			*this << sz;
-			for (uint32_t i = 0; i < sz; i++) {
-				*this << val[i];
-			}
-			return *this;
+			return serializeArray(val.data(), val.size());
 		}
 		
 		template <typename T>
 		Serializer& operator<<(gsl::span<T> val)
 		{
-			uint32_t sz = static_cast<uint32_t>(val.size());
-			*this << sz;
-			for (uint32_t i = 0; i < sz; i++) {
-				*this << val[i];
-			}
-			return *this;
+			return serializeArray(val.data(), val.size());
 		}
 		
 		template <typename T>
 		Serializer& operator<<(gsl::span<const T> val)
 		{
-			uint32_t sz = static_cast<uint32_t>(val.size());
-			*this << sz;
-			for (uint32_t i = 0; i < sz; i++) {
-				*this << val[i];
-			}
-			return *this;
+			return serializeArray(val.data(), val.size());
 		}
 		
 		template <typename T>
@@ -282,6 +325,7 @@ namespace Halley {
 	private:
 		size_t size = 0;
 		gsl::span<gsl::byte> dst;
+		Bytes* buffer = nullptr;
 		bool dryRun;
 
 		template <typename T>
@@ -291,6 +335,23 @@ namespace Halley {
 			return *this;
 		}
 
+		template <typename T>
+		Serializer& serializeArray(const T* data, size_t n)
+		{
+			const uint32_t sz = static_cast<uint32_t>(n);
+			*this << sz;
+			if constexpr (SerializerDetail::BulkCopy<T>::eligible) {
+				if (SerializerDetail::BulkCopy<T>::canCopy(options)) {
+					copyBytes(data, n * sizeof(T));
+					return *this;
+				}
+			}
+			for (uint32_t i = 0; i < sz; i++) {
+				*this << data[i];
+			}
+			return *this;
+		}
+
 		template <typename T>
 		Serializer& serializeInteger(T val)
 		{
@@ -376,6 +437,16 @@ namespace Halley {
 			ensureSufficientBytesRemaining(sz); // Expect at least one byte per vector entry
 
 			val.clear();
+			if constexpr (SerializerDetail::BulkCopy<T>::eligible) {
+				if (SerializerDetail::BulkCopy<T>::canCopy(options)) {
+					const size_t nBytes = size_t(sz) * sizeof(T);
+					ensureSufficientBytesRemaining(nBytes);
+					val.resize(sz);
+					memcpy(val.data(), src.data() + pos, nBytes);
+					pos += nBytes;
+					return *this;
+				}
+			}
 			val.reserve(sz);
 			for (uint32_t i = 0; i < sz; i++) {
 				val.push_back(T());
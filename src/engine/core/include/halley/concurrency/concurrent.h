@@ -4,6 +4,7 @@
 #include <halley/text/halleystring.h>
 #include "executor.h"
 #include "future.h"
+#include "parallel_for.h"
 #include "task.h"
 
 #define HAS_THREADS 1
@@ -44,27 +45,11 @@ namespace Halley
 		}
 
 		template <typename T, typename F>
-		void foreach(ExecutionQueue& e, T begin, T end, F f)
+		void foreach(ExecutionQueue& e, T begin, T end, F f, size_t grainSize = 0)
 		{
-			const size_t n = end - begin;
-			constexpr size_t maxThreads = 8;
-			size_t nThreads = std::max(size_t(1), std::min(maxThreads, e.threadCount()));
-			std::array<Future<void>, maxThreads> futures;
-
-			size_t prevEnd = 0;
-			for (size_t j = 0; j < nThreads; ++j) {
-				size_t curStart = prevEnd;
-				size_t curEnd = n * (j + 1) / nThreads;
-				prevEnd = curEnd;
-
-				futures[j] = execute([begin, f, curStart, curEnd]() {
-					for (auto i = begin + curStart; i < begin + curEnd; ++i) {
-						f(*i);
-					}
-				});
-			}
-
-			whenAll(futures.data(), futures.data() + nThreads).wait();
+			parallelFor(e, static_cast<size_t>(end - begin), grainSize, [&] (size_t i) {
+				f(*(begin + i));
+			});
 		}
 
 		template <typename T, typename F>
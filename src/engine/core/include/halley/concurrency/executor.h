@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <deque>
 #include <thread>
 #include <mutex>
@@ -7,15 +8,22 @@
 #include <atomic>
 #include "halley/data_structures/vector.h"
 #include "halley/text/halleystring.h"
+#include "task_base.h"
+#include "work_stealing.h"
 
 namespace Halley
 {
-	using TaskBase = std::function<void()>;
-
+	// Tasks queued from a thread running an Executor of this queue go on that thread's own deque, which other executors steal from.
+	// Tasks queued from anywhere else go on a shared lock-free FIFO ring (spilling into a locked deque if the ring is ever full).
+	//
+	// Ordering: tasks are always taken in the order they were queued on queues with at most one worker thread (e.g. SingleThreadExecutor),
+	// as everything goes through the ring there. With several workers, tasks queued from the same thread still start in order, but
+	// a worker runs the tasks it queued itself before older ones queued from other threads.
 	class ExecutionQueue
 	{
 	public:
 		ExecutionQueue();
+		~ExecutionQueue();
 		void addToQueue(TaskBase task);
 
 		TaskBase getNext();
@@ -29,18 +37,43 @@ namespace Halley
 
 		void setImmediate(bool immediate);
 
+		void attachWorkerThread();
+		void detachWorkerThread();
+
 		static ExecutionQueue& getDefault();
 
 	private:
-		std::deque<TaskBase> queue;
-		std::mutex mutex;
+		constexpr static size_t maxWorkers = 64;
+
+		struct Worker {
+			TaskDeque deque;
+			std::atomic<bool> inUse = false;
+		};
+
+		TaskNodePool nodes;
+		TaskRing ring;
+		std::array<std::unique_ptr<Worker>, maxWorkers> workers;
+		std::atomic<size_t> nWorkers;
+		std::atomic<size_t> nActiveWorkers;
+		std::mutex workersMutex;
+
+		std::deque<TaskNodePool::Index> overflow;
+		std::mutex overflowMutex;
+		std::atomic<size_t> overflowSize;
+
+		std::atomic<int64_t> pending;
+		std::atomic<int> sleepers;
+		std::mutex sleepMutex;
 		std::condition_variable condition;
 
 		std::atomic<int> attachedCount;
-		std::atomic<bool> hasTasks;
 		std::atomic<bool> aborted;
 
 		bool immediate = false;
+
+		Worker* getCurrentWorker() const;
+		void inject(TaskNodePool::Index idx);
+		bool tryPop(TaskNodePool::Index& idx);
 	};
 
 	class Executors
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace Halley
+{
+	class ExecutionQueue;
+
+	// Shared state of a single parallel for. Each worker owns a range of indices, from which it pops grains off the front.
+	// Once a worker runs out, it steals the back half of another worker's range. Ranges are packed into a single 64-bit
+	// atomic, so both popping and stealing are a single CAS.
+	class ParallelForState
+	{
+	public:
+		using RunFunction = void (*)(void* context, size_t begin, size_t end);
+
+		ParallelForState(size_t n, size_t nWorkers, size_t grainSize, void* context, RunFunction run);
+
+		void runWorker(size_t workerIdx);
+		bool tryRunHelper();
+		void finish();
+
+	private:
+		struct alignas(64) Range {
+			std::atomic<uint64_t> value;
+		};
+
+		std::unique_ptr<Range[]> ranges;
+		size_t nWorkers;
+		uint32_t grainSize;
+		void* context;
+		RunFunction run;
+
+		std::atomic<size_t> nextWorker;
+		std::atomic<int> activeHelpers;
+		std::atomic<bool> finished;
+
+		std::mutex exceptionMutex;
+		std::exception_ptr exception;
+
+		bool next(size_t workerIdx, size_t& begin, size_t& end);
+		bool steal(size_t workerIdx);
+	};
+
+	namespace Concurrent
+	{
+		void parallelForImpl(ExecutionQueue& queue, size_t n, size_t grainSize, void* context, ParallelForState::RunFunction run);
+
+		// Calls f(i) for every i in [0, n), spread over the threads of queue, plus the calling thread.
+		// A grainSize of 0 picks one based on n and the number of threads.
+		// Blocks until done, and rethrows the first exception thrown by f. Safe to call from within a task running on queue.
+		template <typename F>
+		void parallelFor(ExecutionQueue& queue, size_t n, size_t grainSize, F f)
+		{
+			parallelForImpl(queue, n, grainSize, &f, [] (void* context, size_t begin, size_t end)
+			{
+				auto& func = *static_cast<F*>(context);
+				for (size_t i = begin; i < end; ++i) {
+					func(i);
+				}
+			});
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Halley
+{
+	// Move-only void() callable used for tasks on an ExecutionQueue.
+	// Callables of up to inlineSize bytes are stored inline, so enqueueing typical lambdas doesn't allocate.
+	class TaskBase
+	{
+	public:
+		constexpr static size_t inlineSize = 48;
+
+		TaskBase() = default;
+
+		template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, TaskBase>>>
+		TaskBase(F&& f)
+		{
+			using T = std::decay_t<F>;
+			if constexpr (fitsInline<T>()) {
+				::new (storage) T(std::forward<F>(f));
+				vtable = &inlineVTable<T>;
+			} else {
+				*reinterpret_cast<T**>(storage) = new T(std::forward<F>(f));
+				vtable = &heapVTable<T>;
+			}
+		}
+
+		TaskBase(TaskBase&& other) noexcept
+		{
+			moveFrom(other);
+		}
+
+		TaskBase& operator=(TaskBase&& other) noexcept
+		{
+			if (this != &other) {
+				reset();
+				moveFrom(other);
+			}
+			return *this;
+		}
+
+		TaskBase(const TaskBase& other) = delete;
+		TaskBase& operator=(const TaskBase& other) = delete;
+
+		~TaskBase()
+		{
+			reset();
+		}
+
+		void operator()()
+		{
+			vtable->invoke(storage);
+		}
+
+		explicit operator bool() const
+		{
+			return vtable != nullptr;
+		}
+
+		void reset()
+		{
+			if (vtable) {
+				vtable->destroy(storage);
+				vtable = nullptr;
+			}
+		}
+
+	private:
+		struct VTable {
+			void (*invoke)(void* storage);
+			void (*move)(void* dst, void* src);
+			void (*destroy)(void* storage);
+		};
+
+		alignas(std::max_align_t) std::byte storage[inlineSize];
+		const VTable* vtable = nullptr;
+
+		template <typename T>
+		constexpr static bool fitsInline()
+		{
+			return sizeof(T) <= inlineSize && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<T>;
+		}
+
+		template <typename T>
+		constexpr static VTable inlineVTable = {
+			[] (void* s) { (*std::launder(static_cast<T*>(s)))(); },
+			[] (void* dst, void* src) { auto* t = std::launder(static_cast<T*>(src)); ::new (dst) T(std::move(*t)); t->~T(); },
+			[] (void* s) { std::launder(static_cast<T*>(s))->~T(); }
+		};
+
+		template <typename T>
+		constexpr static VTable heapVTable = {
+			[] (void* s) { (**static_cast<T**>(s))(); },
+			[] (void* dst, void* src) { *static_cast<T**>(dst) = *static_cast<T**>(src); },
+			[] (void* s) { delete *static_cast<T**>(s); }
+		};
+
+		void moveFrom(TaskBase& other) noexcept
+		{
+			if (other.vtable) {
+				other.vtable->move(storage, other.storage);
+				vtable = other.vtable;
+				other.vtable = nullptr;
+			}
+		}
+	};
+}
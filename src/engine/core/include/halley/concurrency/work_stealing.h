@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "task_base.h"
+
+namespace Halley
+{
+	// Fixed storage for queued tasks, so the queues themselves only need to move 32-bit indices around.
+	// Free nodes are kept on a lock-free stack; blocks are only ever added, never freed, until the pool is destroyed.
+	class TaskNodePool
+	{
+	public:
+		using Index = uint32_t;
+
+		TaskNodePool();
+		~TaskNodePool();
+
+		TaskNodePool(const TaskNodePool& other) = delete;
+		TaskNodePool& operator=(const TaskNodePool& other) = delete;
+
+		Index alloc(TaskBase task);
+		TaskBase release(Index idx);
+
+	private:
+		constexpr static size_t blockShift = 10;
+		constexpr static size_t blockSize = size_t(1) << blockShift;
+		constexpr static size_t maxBlocks = 4096;
+
+		struct Node {
+			TaskBase task;
+			std::atomic<uint32_t> next; // Index + 1 of next free node, 0 for none
+		};
+
+		std::array<std::atomic<Node*>, maxBlocks> blocks;
+		std::atomic<size_t> nBlocks;
+		std::atomic<uint64_t> freeHead; // ABA tag in the high 32 bits, index + 1 in the low 32 bits
+		std::mutex growMutex;
+
+		Node& getNode(Index idx) const;
+		void push(Index first, Index last);
+		void grow();
+	};
+
+	// Chase-Lev deque of fixed capacity. Only the owner thread may push and pop; any thread may steal.
+	class TaskDeque
+	{
+	public:
+		constexpr static size_t capacity = 4096;
+
+		TaskDeque();
+
+		bool push(uint32_t value);
+		bool pop(uint32_t& value);
+		bool steal(uint32_t& value);
+
+	private:
+		alignas(64) std::atomic<int64_t> top;
+		alignas(64) std::atomic<int64_t> bottom;
+		std::unique_ptr<std::atomic<uint32_t>[]> buffer;
+	};
+
+	// Bounded multi-producer, multi-consumer FIFO queue.
+	class TaskRing
+	{
+	public:
+		constexpr static size_t capacity = 16384;
+
+		TaskRing();
+
+		bool push(uint32_t value);
+		bool pop(uint32_t& value);
+
+	private:
+		struct Cell {
+			std::atomic<size_t> sequence;
+			uint32_t value;
+		};
+
+		alignas(64) std::atomic<size_t> pushPos;
+		alignas(64) std::atomic<size_t> popPos;
+		std::unique_ptr<Cell[]> cells;
+	};
+}
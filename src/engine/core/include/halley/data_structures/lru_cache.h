@@ -0,0 +1,93 @@
+#pragma once
+
+#include <list>
+#include "hash_map.h"
+
+namespace Halley {
+	// Keeps up to capacity values, evicting the least recently used one when full
+	template <typename K, typename V>
+	class LRUCache {
+	public:
+		explicit LRUCache(size_t capacity = 0)
+			: capacity(capacity)
+		{}
+
+		LRUCache(const LRUCache& other)
+			: capacity(other.capacity)
+		{
+			for (const auto& entry: other.entries) {
+				entries.push_back(entry);
+				index[entry.first] = std::prev(entries.end());
+			}
+		}
+
+		LRUCache& operator=(const LRUCache& other)
+		{
+			if (this != &other) {
+				*this = LRUCache(other);
+			}
+			return *this;
+		}
+
+		LRUCache(LRUCache&& other) = default;
+		LRUCache& operator=(LRUCache&& other) = default;
+
+		V* tryGet(const K& key)
+		{
+			const auto iter = index.find(key);
+			if (iter == index.end()) {
+				return nullptr;
+			}
+			entries.splice(entries.begin(), entries, iter->second);
+			return &iter->second->second;
+		}
+
+		void put(const K& key, V value)
+		{
+			if (capacity == 0) {
+				return;
+			}
+
+			if (const auto iter = index.find(key); iter != index.end()) {
+				iter->second->second = std::move(value);
+				entries.splice(entries.begin(), entries, iter->second);
+				return;
+			}
+
+			entries.emplace_front(key, std::move(value));
+			index[key] = entries.begin();
+			evict();
+		}
+
+		void clear()
+		{
+			entries.clear();
+			index.clear();
+		}
+
+		void setCapacity(size_t c)
+		{
+			capacity = c;
+			evict();
+		}
+
+		size_t getCapacity() const { return capacity; }
+		size_t size() const { return entries.size(); }
+		bool empty() const { return entries.empty(); }
+
+	private:
+		using Entry = std::pair<K, V>;
+
+		size_t capacity;
+		std::list<Entry> entries;
+		HashMap<K, typename std::list<Entry>::iterator> index;
+
+		void evict()
+		{
+			while (entries.size() > capacity) {
+				index.erase(entries.back().first);
+				entries.pop_back();
+			}
+		}
+	};
+}
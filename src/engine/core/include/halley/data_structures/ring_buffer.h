@@ -139,6 +139,17 @@ namespace Halley {
             numEntries.fetch_sub(numToRead);
     	}
 
+    	void skip(size_t numToSkip)
+    	{
+            Expects(canRead(numToSkip));
+            for (size_t i = 0; i < numToSkip; ++i) {
+            	entries[(readPos + i) % entries.size()] = T();
+            }
+
+            readPos = (readPos + numToSkip) % entries.size();
+            numEntries.fetch_sub(numToSkip);
+    	}
+
     private:
         size_t readPos = 0;
         size_t writePos = 0;
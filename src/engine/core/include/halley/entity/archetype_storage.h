@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <gsl/span>
+#include "family_mask.h"
+#include "entity_id.h"
+#include "halley/data_structures/hash_map.h"
+#include "halley/data_structures/vector.h"
+#include "halley/support/exception.h"
+
+namespace Halley {
+	class Entity;
+	class ComponentDeleterTable;
+	class TypeDeleterBase;
+
+	// A set of entities sharing exactly the same components (and enabled state).
+	// Each component type is stored in its own column, split into fixed-size chunks, so every chunk is a contiguous array of that component.
+	// Chunk i of every column holds the same range of entities.
+	class Archetype {
+		friend class ArchetypeStorage;
+
+	public:
+		constexpr static size_t chunkBytes = 16 * 1024;
+
+		class Column {
+		public:
+			Column(int componentId, TypeDeleterBase& type, size_t elemsPerChunk);
+			~Column();
+
+			Column(const Column& other) = delete;
+			Column(Column&& other) noexcept;
+			Column& operator=(const Column& other) = delete;
+			Column& operator=(Column&& other) = delete;
+
+			int getComponentId() const { return componentId; }
+			TypeDeleterBase& getType() const { return *type; }
+
+			void* get(size_t idx) const
+			{
+				return chunks[idx / elemsPerChunk] + (idx % elemsPerChunk) * elemSize;
+			}
+
+			void* getChunk(size_t chunkIdx) const
+			{
+				return chunks[chunkIdx];
+			}
+
+			void reserve(size_t n);
+
+		private:
+			int componentId;
+			TypeDeleterBase* type;
+			size_t elemSize;
+			size_t alignment;
+			size_t elemsPerChunk;
+			Vector<char*> chunks;
+		};
+
+		Archetype(const FamilyMask::RealType& components, bool enabled, ComponentDeleterTable& table);
+
+		const FamilyMask::RealType& getComponents() const { return components; }
+		bool isEnabled() const { return enabled; }
+		bool hasColumns() const { return !columns.empty(); }
+
+		size_t size() const { return entities.size(); }
+		size_t getNumChunks() const { return (entities.size() + elemsPerChunk - 1) / elemsPerChunk; }
+		size_t getChunkSize(size_t chunkIdx) const { return std::min(elemsPerChunk, entities.size() - chunkIdx * elemsPerChunk); }
+
+		const Column* tryGetColumn(int componentId) const;
+		gsl::span<Entity* const> getEntities() const { return entities; }
+
+	private:
+		FamilyMask::RealType components;
+		bool enabled;
+		size_t elemsPerChunk = 1;
+		Vector<Column> columns;
+		Vector<Entity*> entities;
+	};
+
+	// Alternative component storage, see World::setArchetypeStorage().
+	// Components start their life on the heap (see Component::doNew) and are moved into archetype chunks when their entity is refreshed.
+	// Component addresses are therefore only stable between refreshes; use EntityId as the stable handle.
+	class ArchetypeStorage {
+	public:
+		explicit ArchetypeStorage(ComponentDeleterTable& table);
+		~ArchetypeStorage();
+
+		ArchetypeStorage(const ArchetypeStorage& other) = delete;
+		ArchetypeStorage& operator=(const ArchetypeStorage& other) = delete;
+
+		// All of these append to "relocated" every entity whose components moved in memory, so the caller can rebind them
+		void place(Entity& entity, Vector<Entity*>& relocated);
+		void remove(Entity& entity, Vector<Entity*>& relocated);
+		void evict(Entity& entity, Vector<Entity*>& relocated);
+
+		// Destroys any removed component that still lives in a chunk. Must be called before Entity::refresh().
+		void releaseDeadComponents(Entity& entity);
+
+		// Calls f(gsl::span<Cs>...) for each chunk of each enabled archetype containing all components in "inclusion"
+		template <typename... Cs, typename F>
+		void forEachChunk(const FamilyMask::RealType& inclusion, F f) const
+		{
+			for (const auto& archetype: archetypes) {
+				if (!archetype->isEnabled() || archetype->size() == 0 || (archetype->getComponents() & inclusion) != inclusion) {
+					continue;
+				}
+
+				std::array<const Archetype::Column*, sizeof...(Cs)> columns = { getColumnFor<Cs>(*archetype)... };
+				const size_t nChunks = archetype->getNumChunks();
+				for (size_t i = 0; i < nChunks; ++i) {
+					invokeChunk<Cs...>(f, columns, i, archetype->getChunkSize(i), std::index_sequence_for<Cs...>());
+				}
+			}
+		}
+
+	private:
+		struct Location {
+			Archetype* archetype = nullptr;
+			uint32_t slot = 0;
+		};
+
+		ComponentDeleterTable& table;
+		Vector<std::unique_ptr<Archetype>> archetypes;
+		std::array<HashMap<FamilyMask::RealType, Archetype*>, 2> archetypeLookup;
+		Vector<Location> locations;
+
+		Archetype* getArchetype(const FamilyMask::RealType& components, bool enabled);
+		Location& getLocation(const Entity& entity);
+		bool isOwned(const Location& location, int componentId, const void* component) const;
+		void releaseSlot(Location& location, Vector<Entity*>& relocated);
+
+		template <typename C>
+		static const Archetype::Column* getColumnFor(const Archetype& archetype)
+		{
+			const auto* column = archetype.tryGetColumn(FamilyMask::RetrieveComponentIndex<std::remove_const_t<C>>::componentIndex);
+			if (!column) {
+				throw Exception(String("Component ") + typeid(C).name() + " is not stored in archetype chunks.", HalleyExceptions::Entity);
+			}
+			return column;
+		}
+
+		template <typename... Cs, typename F, size_t... Is>
+		static void invokeChunk(F& f, const std::array<const Archetype::Column*, sizeof...(Cs)>& columns, size_t chunkIdx, size_t count, std::index_sequence<Is...>)
+		{
+			f(gsl::span<Cs>(static_cast<Cs*>(columns[Is]->getChunk(chunkIdx)), count)...);
+		}
+	};
+}
@@ -44,6 +44,7 @@ namespace Halley {
 	class Entity
 	{
 		friend class World;
+		friend class ArchetypeStorage;
 		friend class System;
 		friend class EntityRef;
 		friend class ConstEntityRef;
@@ -188,6 +189,7 @@ namespace Halley {
 		uint8_t componentRevision = 0;
 
 		FamilyMaskType mask;
+		uint32_t worldIndex = 0; // Index in World::entities, lives in what would otherwise be padding
 		Entity* parent = nullptr;
 		EntityId entityId;
 		Vector<Entity*> children; // Cacheline 1 starts 16 bytes into this
@@ -233,14 +235,14 @@ namespace Halley {
 		ComponentDeleterTable& getComponentDeleterTable(World& world);
 
 		Entity* getParent() const { return parent; }
-		void setParent(Entity* parent, bool propagate = true, size_t childIdx = -1);
+		void setParent(World& world, Entity* parent, bool propagate = true, size_t childIdx = -1);
 		const Vector<Entity*>& getChildren() const { return children; }
-		void addChild(Entity& child);
-		void detachChildren();
+		void addChild(World& world, Entity& child);
+		void detachChildren(World& world);
 		void markHierarchyDirty();
 		void propagateChildrenChange();
 		void propagateChildWorldPartition(WorldPartitionId newWorldPartition);
-		void propagateEnabled(bool enabled, bool parentEnabled);
+		void propagateEnabled(World& world, bool enabled, bool parentEnabled);
 
 		DataInterpolatorSet& setupNetwork(EntityRef& ref, uint8_t peerId);
 		std::optional<uint8_t> getOwnerPeerId() const;
@@ -675,13 +677,13 @@ namespace Halley {
 		void setParent(const EntityRef& parent, size_t childIdx = -1)
 		{
 			validate();
-			entity->setParent(parent.entity, true, childIdx);
+			entity->setParent(*world, parent.entity, true, childIdx);
 		}
 
 		void setParent()
 		{
 			validate();
-			entity->setParent(nullptr);
+			entity->setParent(*world, nullptr);
 		}
 
 		const Vector<Entity*>& getRawChildren() const
@@ -718,13 +720,13 @@ namespace Halley {
 		void addChild(EntityRef& child)
 		{
 			validate();
-			entity->addChild(*child.entity);
+			entity->addChild(*world, *child.entity);
 		}
 
 		void detachChildren()
 		{
 			validate();
-			entity->detachChildren();
+			entity->detachChildren(*world);
 		}
 
 		uint8_t getHierarchyRevision() const
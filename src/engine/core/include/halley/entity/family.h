@@ -6,6 +6,7 @@
 #include "family_mask.h"
 #include "entity_id.h"
 #include "halley/data_structures/nullable_reference.h"
+#include "halley/data_structures/hash_map.h"
 #include "halley/support/exception.h"
 #include "halley/support/debug.h"
 #include "halley/utils/utils.h"
@@ -31,6 +32,11 @@ namespace Halley {
 			return static_cast<char*>(elems) + (n * elemSize);
 		}
 
+		const FamilyMaskType& getInclusionMask() const
+		{
+			return inclusionMask;
+		}
+
 		void addOnEntitiesAdded(FamilyBindingBase* bind);
 		void removeOnEntityAdded(FamilyBindingBase* bind);
 		void addOnEntitiesRemoved(FamilyBindingBase* bind);
@@ -116,6 +122,7 @@ namespace Halley {
 	protected:
 		void addEntity(Entity& entity) override
 		{
+			indices[entity.getEntityId()] = static_cast<uint32_t>(entities.size());
 			auto& e = entities.emplace_back();
 			e.entityId = entity.getEntityId();
 			T::Type::loadComponents(entity, &e.data[0]);
@@ -125,11 +132,9 @@ namespace Halley {
 		
 		void refreshEntity(Entity& entity) override
 		{
-			for (auto& e: entities) {
-				if (e.entityId == entity.getEntityId()) {
-					T::Type::loadComponents(entity, &e.data[0]);
-					break;
-				}
+			const auto iter = indices.find(entity.getEntityId());
+			if (iter != indices.end()) {
+				T::Type::loadComponents(entity, &entities[iter->second].data[0]);
 			}
 		}
 
@@ -153,9 +158,11 @@ namespace Halley {
 				// Notify reloads
 				HALLEY_DEBUG_TRACE();
 				Vector<StorageType*> reloadedEntities;
-				for (auto& entity : entities) {
-					if (std::find(toReload.begin(), toReload.end(), entity.entityId) != toReload.end()) {
-						reloadedEntities.push_back(&entity);
+				reloadedEntities.reserve(toReload.size());
+				for (const auto& id: toReload) {
+					const auto iter = indices.find(id);
+					if (iter != indices.end()) {
+						reloadedEntities.push_back(&entities[iter->second]);
 					}
 				}
 				notifyReload(reloadedEntities.data(), reloadedEntities.size());
@@ -170,11 +177,13 @@ namespace Halley {
 		{
 			notifyRemove(entities.data(), entities.size());
 			entities.clear();
+			indices.clear();
 			updateElems();
 		}
 
 	private:
 		Vector<StorageType> entities;
+		HashMap<EntityId, uint32_t> indices;
 		bool dirty = false;
 
 		void updateElems()
@@ -187,50 +196,33 @@ namespace Halley {
 		void removeDeadEntities()
 		{
 			// Performance-critical code
-			// Benchmarks suggest that using a Vector is faster than std::set and std::unordered_set
 			if (!toRemove.empty()) {
 				HALLEY_DEBUG_TRACE();
-				size_t removeCount = toRemove.size();
-				Expects(removeCount > 0);
+				const size_t removeCount = toRemove.size();
 				Expects(removeCount <= entities.size());
-				std::sort(toRemove.begin(), toRemove.end());
 
-				for (size_t i = 1; i < toRemove.size(); ++i) {
-					Expects(toRemove[i - 1] != toRemove[i]);
-				}
-
-				// Move all entities to be removed to the back of the vector
-				{
-					int n = int(entities.size());
-					// Note: it's important to scan it forward. Scanning backwards would improve performance for short-lived entities,
-					// but it causes an issue where an entity is removed and added to the same family in one frame.
-					for (int i = 0; i < n; i++) {
-						EntityId id = entities[i].entityId;
-						auto iter = std::lower_bound(toRemove.begin(), toRemove.end(), id);
-						if (iter != toRemove.end() && id == *iter) {
-							toRemove.erase(iter);
-							if (i != n - 1) {
-								std::swap(entities[i], entities[n - 1]);
-								i--;
-							}
-							n--;
-							if (toRemove.empty()) {
-								break;
-							}
-						}
+				// Move all entities to be removed to the back of the vector, looking each one up in the index
+				size_t n = entities.size();
+				for (const auto& id: toRemove) {
+					const auto iter = indices.find(id);
+					Expects(iter != indices.end());
+					const uint32_t idx = iter->second;
+					Expects(idx < n);
+					--n;
+					if (idx != n) {
+						std::swap(entities[idx], entities[n]);
+						indices[entities[idx].entityId] = idx;
 					}
-					Ensures(size_t(n) + removeCount == entities.size());
+					indices.erase(iter);
 				}
-
-				Expects(toRemove.empty());
+				toRemove.clear();
+				Ensures(n + removeCount == entities.size());
 
 				// Notify removal
-				size_t newSize = entities.size() - removeCount;
-				Ensures(newSize < entities.size());
-				notifyRemove(entities.data() + newSize, removeCount);
+				notifyRemove(entities.data() + n, removeCount);
 
 				// Remove them
-				entities.resize(newSize);
+				entities.resize(n);
 				updateElems();
 			}
 			Ensures(toRemove.empty());
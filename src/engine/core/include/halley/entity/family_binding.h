@@ -2,6 +2,7 @@
 
 #include "family_mask.h"
 #include "world.h"
+#include "archetype_storage.h"
 #include <halley/support/exception.h>
 #include <functional>
 
@@ -22,7 +23,10 @@ namespace Halley {
 		void doInit(FamilyMaskType readMask, FamilyMaskType writeMask) noexcept;
 		
 		void* getElement(size_t index) const noexcept { return family->getElement(index); }
-		void setFamily(Family* family) noexcept;
+		void setFamily(Family* family, World& world) noexcept;
+
+		ArchetypeStorage& getArchetypeStorage() const;
+		const FamilyMask::RealType& getInclusionMask() const;
 
 		void setOnEntitiesAdded(std::function<void(void*, size_t)> callback);
 		void setOnEntitiesRemoved(std::function<void(void*, size_t)> callback);
@@ -39,6 +43,7 @@ namespace Halley {
 		friend class Family;
 
 		Family* family = nullptr;
+		World* world = nullptr;
 		FamilyMaskType readMask;
 		FamilyMaskType writeMask;
 		std::function<void(void*, size_t)> addedCallback;
@@ -232,6 +237,14 @@ namespace Halley {
 			return gsl::span<const T>(getFamilyElement(0), count());
 		}
 
+		// Calls f(gsl::span<Cs>...) for each contiguous chunk of components of the entities in this family.
+		// Only available when the world uses archetype storage (see World::setArchetypeStorage).
+		template <typename... Cs, typename F>
+		void forEachChunk(F f) const
+		{
+			getArchetypeStorage().template forEachChunk<Cs...>(getInclusionMask(), f);
+		}
+
 	private:
 		void init(MaskStorage& storage) noexcept
 		{
@@ -248,7 +261,7 @@ namespace Halley {
 		{
 			auto& self = static_cast<FamilyBinding&>(obj);
 			self.init(world.getMaskStorage());
-			self.setFamily(&world.getFamily<T>());
+			self.setFamily(&world.getFamily<T>(), world);
 		}
 	};
 }
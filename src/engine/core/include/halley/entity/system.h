@@ -27,6 +27,18 @@ namespace Halley {
 		template<class T, typename F> using OnEntitiesReloadedMember = decltype(std::declval<T>().onEntitiesReloaded(std::declval<Span<F*>>()));
 	}
 	
+	struct SystemAccessInfo {
+		Vector<int> componentsRead;
+		Vector<int> componentsWritten;
+		Vector<String> services;
+		Vector<int> messagesSent;
+		Vector<int> messagesReceived;
+		bool usesAPI = false;
+		bool exclusive = true; // Exclusive systems never run alongside any other system
+
+		bool conflictsWith(const SystemAccessInfo& other) const;
+	};
+
 	class SystemMessageBridge {
 	public:
 		SystemMessageBridge() = default;
@@ -65,6 +77,12 @@ namespace Halley {
 		void sendEntityMessageConfig(EntityId target, const String& messageType, const ConfigNode& data);
 		void sendSystemMessageConfig(const String& targetSystem, const String& messageType, const ConfigNode& data);
 
+		virtual SystemAccessInfo getAccessInfo() const { return {}; }
+
+		// Number of entities each task of a "Parallel" strategy system processes at a time. 0 picks one automatically.
+		void setParallelGrainSize(size_t grainSize) { parallelGrainSize = grainSize; }
+		size_t getParallelGrainSize() const { return parallelGrainSize; }
+
 	protected:
 		const HalleyAPI& doGetAPI() const { return *api; }
 		World& doGetWorld() const { return *world; }
@@ -90,10 +108,10 @@ namespace Halley {
 		}
 
 		template <typename F, typename V>
-		static void invokeParallel(F&& f, V& fam)
+		void invokeParallel(F&& f, V& fam)
 		{
-			Concurrent::foreach(std::begin(fam), std::end(fam), [&] (auto& e) {
-				f(e);
+			Concurrent::parallelFor(ExecutionQueue::getDefault(), fam.count(), parallelGrainSize, [&] (size_t i) {
+				f(fam[i]);
 			});
 		}
 
@@ -188,11 +206,13 @@ namespace Halley {
 
 	private:
 		friend class World;
+		friend class SystemScheduler;
 
 		Vector<FamilyBindingBase*> families;
 		Vector<int> messageTypesReceived;
 		Vector<int> messageTypesSentThisUpdate;
 		Vector<std::pair<MessageEntry, EntityId>> outbox;
+		Vector<std::pair<MessageEntry, EntityId>> remoteOutbox;
 		Vector<const SystemMessageContext*> systemMessageInbox;
 		Vector<const SystemMessageContext*> systemMessages;
 
@@ -201,9 +221,13 @@ namespace Halley {
 		Resources* resources = nullptr;
 		String name;
 		int systemId = -1;
+		size_t parallelGrainSize = 0;
 		bool initialised = false;
+		bool runningConcurrently = false;
 
 		void doUpdate(Time time);
+		void doMainUpdate(Time time);
+		void doPostUpdate();
 		void doRender(RenderContext& rc);
 		void onAddedToWorld(World& world, int id);
 
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <halley/data_structures/vector.h>
+#include <halley/time/halleytime.h>
+#include "halley/data_structures/temp_allocator.h"
+
+namespace Halley {
+	class System;
+	class ExecutionQueue;
+
+	// Groups the systems of a timeline into batches of systems that don't conflict with each other (see SystemAccessInfo),
+	// and runs each batch concurrently on the CPU executors. Systems that conflict always run in their original relative order.
+	// The World is responsible for the sync points between batches (spawning entities, dispatching messages).
+	class SystemScheduler {
+	public:
+		using Batch = Vector<System*>;
+
+		SystemScheduler();
+		~SystemScheduler();
+
+		void invalidate();
+		const Vector<Batch>& getSchedule(TimeLine timeline, const Vector<std::unique_ptr<System>>& systems);
+
+		void runBatch(const Batch& batch, Time elapsed, ExecutionQueue& queue);
+
+		static TempMemoryPool* getCurrentMemoryPool();
+
+	private:
+		std::array<std::optional<Vector<Batch>>, static_cast<int>(TimeLine::NUMBER_OF_TIMELINES)> schedules;
+		Vector<std::unique_ptr<TempMemoryPool>> memoryPools;
+
+		static Vector<Batch> buildSchedule(const Vector<std::unique_ptr<System>>& systems);
+	};
+}
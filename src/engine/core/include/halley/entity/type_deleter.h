@@ -1,6 +1,8 @@
 #pragma once
 
 #include <halley/data_structures/vector.h>
+#include <new>
+#include <type_traits>
 
 namespace Halley {
 	class TypeDeleterBase
@@ -8,8 +10,14 @@ namespace Halley {
 	public:
 		virtual ~TypeDeleterBase() {}
 		virtual size_t getSize() = 0;
+		virtual size_t getAlignment() = 0;
 		virtual void callDestructor(void* ptr) = 0;
 		virtual void destroy(void* ptr) = 0;
+
+		// Used by ArchetypeStorage to move components in and out of its chunks
+		virtual bool isRelocatable() = 0;
+		virtual void moveConstruct(void* dst, void* src) = 0;
+		virtual void* moveToHeap(void* src) = 0;
 	};
 
 	class ComponentDeleterTable
@@ -63,6 +71,11 @@ namespace Halley {
 			return sizeof(T);
 		}
 
+		size_t getAlignment() override
+		{
+			return alignof(T);
+		}
+
 		void callDestructor(void* ptr) override
 		{
 #ifdef _MSC_VER
@@ -75,5 +88,26 @@ namespace Halley {
 		{
 			delete static_cast<T*>(ptr);
 		}
+
+		bool isRelocatable() override
+		{
+			return std::is_move_constructible_v<T>;
+		}
+
+		void moveConstruct(void* dst, void* src) override
+		{
+			if constexpr (std::is_move_constructible_v<T>) {
+				::new (dst) T(std::move(*static_cast<T*>(src)));
+			}
+		}
+
+		void* moveToHeap(void* src) override
+		{
+			if constexpr (std::is_move_constructible_v<T>) {
+				return new T(std::move(*static_cast<T*>(src)));
+			} else {
+				return nullptr;
+			}
+		}
 	};
 }
@@ -31,6 +31,8 @@ namespace Halley {
 	class RenderContext;
 	class Entity;
 	class System;
+	class SystemScheduler;
+	class ArchetypeStorage;
 	class Painter;
 	class HalleyAPI;
 
@@ -124,9 +126,9 @@ namespace Halley {
 
 		void spawnPending(); // Warning: use with care, will invalidate entities
 
-		void onEntityDirty();
+		void onEntityDirty(Entity& entity);
 
-		void setEntityReloaded();
+		void setEntityReloaded(Entity& entity);
 
 		template <typename T>
 		Family& getFamily() noexcept
@@ -217,6 +219,15 @@ namespace Halley {
 		bool isHeadless() const;
 		void setHeadless(bool headless);
 
+		// When enabled, systems on the same timeline that don't conflict with each other will update concurrently on the CPU executors
+		void setParallelSystemUpdate(bool enabled);
+		bool isParallelSystemUpdate() const;
+
+		// When enabled, components are moved into contiguous per-archetype chunks, which FamilyBinding::forEachChunk() can iterate.
+		// Component pointers are then only stable between entity refreshes (e.g. spawnPending()); hold on to EntityId instead.
+		void setArchetypeStorage(bool enabled);
+		ArchetypeStorage* getArchetypeStorage() const;
+
 		TempMemoryPool& getUpdateMemoryPool() const;
 		TempMemoryPool& getRenderMemoryPool() const;
 
@@ -229,8 +240,6 @@ namespace Halley {
 		Resources& resources;
 		std::array<Vector<std::unique_ptr<System>>, static_cast<int>(TimeLine::NUMBER_OF_TIMELINES)> systems;
 		std::shared_ptr<WorldReflection> reflection;
-		bool entityDirty = false;
-		bool entityReloaded = false;
 		bool editor = false;
 		bool devMode = false;
 		bool terminating = false;
@@ -239,6 +248,10 @@ namespace Halley {
 		
 		Vector<Entity*> entities;
 		Vector<Entity*> entitiesPendingCreation;
+		Vector<Entity*> dirtyEntities;
+		Vector<Entity*> reloadedEntities;
+		Vector<Entity*> dirtyEntitiesScratch;
+		Vector<Entity*> reloadedEntitiesScratch;
 		std::shared_ptr<MappedPool<Entity*>> entityMap;
 		HashMap<UUID, Entity*> uuidMap;
 
@@ -264,6 +277,9 @@ namespace Halley {
 
 		HashMap<int, Vector<std::pair<MessageEntry, EntityId>>> entityMessageInbox;
 
+		std::unique_ptr<SystemScheduler> systemScheduler;
+		std::unique_ptr<ArchetypeStorage> archetypeStorage;
+
 		struct StagingWorldTag{};
 		World(World& world, StagingWorldTag tag);
 
@@ -274,8 +290,10 @@ namespace Halley {
 		void doDestroyEntity(EntityId id);
 		void doDestroyEntity(Entity* entity);
 		void deleteEntity(Entity* entity);
+		void onEntitiesRelocated(gsl::span<Entity* const> relocated);
 
 		void updateSystems(TimeLine timeline, Time elapsed);
+		void updateSystemsParallel(TimeLine timeline, Time elapsed);
 		void renderSystems(RenderContext& rc) const;
 
 		NOINLINE Family& addFamily(std::unique_ptr<Family> family) noexcept;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <gsl/gsl>
+#include "path.h"
+
+namespace Halley
+{
+	// Read-only mapping of a whole file, paged in (and out) by the OS on demand.
+	// Only available on POSIX platforms; elsewhere, or if the file can't be mapped, isOpen() returns false.
+	// The file must not be truncated or rewritten in place while it's mapped.
+	class MemoryMappedFile
+	{
+	public:
+		static bool isSupported();
+
+		explicit MemoryMappedFile(const Path& path);
+		~MemoryMappedFile();
+
+		MemoryMappedFile(const MemoryMappedFile& other) = delete;
+		MemoryMappedFile& operator=(const MemoryMappedFile& other) = delete;
+
+		bool isOpen() const;
+		size_t size() const;
+		gsl::span<const gsl::byte> getSpan() const;
+
+		// Copies with pread, without faulting in the mapping. Safe to call from any number of threads.
+		size_t readAt(size_t pos, gsl::span<gsl::byte> dst) const;
+
+	private:
+		int fd = -1;
+		const gsl::byte* data = nullptr;
+		size_t fileSize = 0;
+	};
+}
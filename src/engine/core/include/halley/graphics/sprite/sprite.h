@@ -66,6 +66,11 @@ namespace Halley
 		static void draw(gsl::span<const Sprite> sprites, Painter& painter);
 		static void drawMixedMaterials(const Sprite* sprites, size_t n, Painter& painter);
 
+		// Sprites without slicing or clipping can have their vertex data gathered and sent to Painter::drawSprites in bulk
+		constexpr static size_t vertexDataSize = sizeof(SpriteVertexAttrib) + sizeof(Vector4f);
+		bool canBeBatched() const { return !sliced && !hasClip; }
+		void copyVertexData(char* dst) const;
+
 		Sprite& setMaterial(Resources& resources, String materialName = "");
 		Sprite& setMaterial(std::shared_ptr<const Material> material);
 		Sprite& setMaterial(std::shared_ptr<const MaterialDefinition> definition);
@@ -39,6 +39,7 @@ namespace Halley
 		SpritePainterEntry(SpritePainterEntryType type, size_t spriteIdx, size_t count, int mask, int layer, float tieBreaker, size_t insertOrder, std::optional<Rect4f> clip);
 
 		bool operator<(const SpritePainterEntry& o) const;
+		uint64_t getSortKey() const;
 		SpritePainterEntryType getType() const;
 		gsl::span<const Sprite> getSprites(const Vector<Sprite>& cached) const;
 		gsl::span<const TextRenderer> getTexts(const Vector<TextRenderer>& cached) const;
@@ -111,19 +112,46 @@ namespace Halley
 		SpritePainterMaterialParamUpdater& getParamUpdater();
 
 	private:
+		enum class DrawMode : uint8_t {
+			Skip,
+			Batched,
+			Individual,
+			Entry
+		};
+
+		struct DrawItem {
+			const Sprite* sprite; // nullptr for text and callback entries
+			uint32_t entryIdx;
+			uint32_t vertexIdx;
+			DrawMode mode;
+		};
+
 		Vector<SpritePainterEntry> sprites;
+		Vector<Rect4f> entryBounds;
 		Vector<Sprite> cachedSprites;
 		Vector<TextRenderer> cachedText;
 		Vector<SpritePainterEntry::Callback> callbacks;
 		Vector<Rect4f> extraBounds;
 		bool dirty = false;
+		bool boundsDirty = false;
 		bool forceCopy = false;
 		bool waitForSpriteLoad = true;
 		SpritePainterMaterialParamUpdater paramUpdater;
 
 		mutable TempMemoryPool memoryPool;
 
-		void draw(gsl::span<const Sprite> sprite, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const;
+		Vector<std::pair<uint64_t, uint32_t>> sortKeys;
+		Vector<std::pair<uint64_t, uint32_t>> sortKeysScratch;
+		Vector<SpritePainterEntry> sortedEntries;
+		Vector<DrawItem> drawItems;
+		Vector<char> batchVertexData;
+
+		void sortEntries();
+		void updateBounds();
+		void drawEntries(gsl::span<const uint32_t> order, Painter& painter, Rect4f view);
+		DrawMode getDrawMode(const Sprite& sprite, const SpritePainterEntry& entry, Rect4f view) const;
+
+		void draw(const Sprite& sprite, Painter& painter, const std::optional<Rect4f>& clip) const;
 		void draw(gsl::span<const TextRenderer> text, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const;
 		void draw(const SpritePainterEntry::Callback& callback, Painter& painter, const std::optional<Rect4f>& clip) const;
 
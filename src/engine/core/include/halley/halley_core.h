@@ -68,6 +68,8 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 
 #include "halley/resources/asset_database.h"
 #include "halley/resources/asset_pack.h"
+#include "halley/resources/asset_pack_index.h"
+#include "halley/resources/asset_pack_writer.h"
 #include "halley/resources/resources.h"
 #include "halley/resources/resource_locator.h"
 #include "halley/resources/resource_reference.h"
@@ -20,6 +20,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "data_structures/config_node.h"
 #include "data_structures/dynamic_grid.h"
 #include "data_structures/hash_map.h"
+#include "data_structures/lru_cache.h"
 #include "data_structures/mapped_pool.h"
 #include "data_structures/maybe.h"
 #include "data_structures/maybe_ref.h"
@@ -37,6 +38,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "data_structures/vector.h"
 
 #include "file/directory_monitor.h"
+#include "file/memory_mapped_file.h"
 #include "file/path.h"
 
 #include "file_formats/binary_file.h"
@@ -80,10 +82,13 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 
 #include "navigation/navmesh.h"
 #include "navigation/navmesh_generator.h"
+#include "navigation/navmesh_search_state.h"
 #include "navigation/navmesh_set.h"
 #include "navigation/navigation_query.h"
+#include "navigation/navigation_flow_field.h"
 #include "navigation/navigation_path.h"
 #include "navigation/navigation_path_follower.h"
+#include "navigation/navigation_service.h"
 #include "navigation/world_position.h"
 
 #include "plugin/plugin.h"
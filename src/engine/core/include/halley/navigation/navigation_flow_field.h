@@ -0,0 +1,87 @@
+#pragma once
+
+#include <queue>
+#include "world_position.h"
+#include "halley/data_structures/vector.h"
+
+namespace Halley {
+	class NavmeshSet;
+
+	// A Dijkstra map over every polygon of a NavmeshSet, leading towards a single destination.
+	// It's built once and then shared by any number of agents, each of which only has to sample it, instead of running its own search.
+	// Moving the destination within the same polygon is free; moving it anywhere else rebuilds the field over a number of update() calls,
+	// while samples keep using the previous field until the new one is complete.
+	// The NavmeshSet must outlive the field, and rebuild() must be called after it's relinked.
+	class NavigationFlowField {
+	public:
+		struct Sample {
+			Vector2f direction;
+			WorldPosition target;
+			float distance = 0; // Approximate, measured between polygon centres
+		};
+
+		// Remembers which polygon an agent was in, so that sampling again as it moves doesn't have to search the whole navmesh set
+		struct Cursor {
+			uint16_t navmeshId = std::numeric_limits<uint16_t>::max();
+			uint16_t nodeId = 0;
+		};
+
+		NavigationFlowField(const NavmeshSet& navmeshSet, WorldPosition destination);
+
+		NavigationFlowField(const NavigationFlowField& other) = delete;
+		NavigationFlowField& operator=(const NavigationFlowField& other) = delete;
+
+		void setDestination(WorldPosition destination);
+		void rebuild();
+
+		// Expands up to maxNodes polygons of a pending rebuild, returns true once the field is up to date
+		bool update(size_t maxNodes = std::numeric_limits<size_t>::max());
+		bool isUpToDate() const;
+
+		WorldPosition getDestination() const;
+
+		std::optional<Sample> sample(WorldPosition pos) const;
+		std::optional<Sample> sample(WorldPosition pos, Cursor& cursor) const;
+
+	private:
+		constexpr static uint16_t noEdge = std::numeric_limits<uint16_t>::max();
+		constexpr static uint32_t noNode = std::numeric_limits<uint32_t>::max();
+
+		struct Cell {
+			float distance = std::numeric_limits<float>::infinity();
+			uint16_t exitEdge = noEdge;
+		};
+
+		struct Field {
+			WorldPosition destination;
+			uint32_t destinationNode = noNode;
+			Vector<Cell> cells;
+		};
+
+		// Crossing from "from" (through its edge "edge") into the polygon these are listed under, for every portal between navmeshes
+		struct PortalLink {
+			uint32_t from;
+			uint16_t edge;
+			float cost;
+		};
+
+		using QueueEntry = std::pair<float, uint32_t>;
+
+		const NavmeshSet& navmeshSet;
+
+		Vector<uint32_t> firstNode; // Per navmesh, its first node in the combined numbering of every polygon
+		Vector<uint16_t> nodeNavmesh;
+		Vector<uint32_t> portalLinkStart; // Per node, into portalLinks
+		Vector<PortalLink> portalLinks;
+
+		Field current;
+		Field pending;
+		bool updating = false;
+		std::priority_queue<QueueEntry, Vector<QueueEntry>, std::greater<>> openSet;
+
+		void buildGraph();
+		void startField(WorldPosition destination);
+		uint32_t findNode(WorldPosition pos) const;
+		uint32_t findNode(WorldPosition pos, Cursor& cursor) const;
+	};
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+#include "navigation_flow_field.h"
 #include "navigation_path.h"
 #include "world_position.h"
 
@@ -18,10 +20,16 @@ namespace Halley {
 		const std::optional<NavigationPath>& getPath() const;
 		gsl::span<const NavigationPath::Point> getNextPathPoints() const;
 
+		// Steers using a flow field shared with other agents, instead of a path of its own, until within threshold of its destination
+		// Flow fields are not serialized
+		void setFlowField(std::shared_ptr<const NavigationFlowField> field);
+		const std::shared_ptr<const NavigationFlowField>& getFlowField() const;
+
 		void update(WorldPosition curPos, const NavmeshSet& navmeshSet, float threshold);
 		
 		WorldPosition getNextPosition() const;
 		WorldPosition getPointAtIdx(size_t idx) const;
+		Vector2f getSteeringDirection() const;
 
 		size_t getNextPathIdx() const;
 		bool isFollowingPath() const;
@@ -39,9 +47,14 @@ namespace Halley {
 		bool computingPath = false;
 		ConfigNode params;
 
+		std::shared_ptr<const NavigationFlowField> flowField;
+		NavigationFlowField::Cursor flowCursor;
+		std::optional<NavigationFlowField::Sample> flowSample;
+
 		void nextSubPath();
 		void doSetPath(std::optional<NavigationPath> p);
 		void reEvaluatePath(const NavmeshSet& navmeshSet);
+		void updateFlowField(float threshold);
 	};
 
 	template<>
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include "navigation_path.h"
+#include "navigation_query.h"
+#include "halley/concurrency/future.h"
+#include "halley/data_structures/vector.h"
+#include "halley/time/halleytime.h"
+
+namespace Halley {
+	class ExecutionQueue;
+	class NavmeshSet;
+	class NavmeshSearchScratch;
+
+	// Runs pathfinding queries against a NavmeshSet on worker threads, a batch at a time.
+	// update() never blocks: it hands out the results of the previous batch (through futures and/or callbacks, on the calling thread)
+	// and starts the next one. Each batch stops picking up new queries once it has spent its time budget; the rest wait for the next one.
+	// The NavmeshSet must not be modified while a batch is running, call waitForIdle() before doing so.
+	class NavigationService {
+	public:
+		using Result = std::optional<NavigationPath>;
+		using Callback = std::function<void(Result)>;
+
+		struct Stats {
+			size_t queued = 0;
+			size_t lastBatchSize = 0;
+			Time lastBatchSearchTime = 0;
+		};
+
+		NavigationService(const NavmeshSet& navmeshSet, size_t nWorkers = 0);
+		NavigationService(const NavmeshSet& navmeshSet, ExecutionQueue& queue, size_t nWorkers = 0);
+		~NavigationService();
+
+		NavigationService(const NavigationService& other) = delete;
+		NavigationService& operator=(const NavigationService& other) = delete;
+
+		Future<Result> pathfind(NavigationQuery query, float anisotropy = 1.0f, float nudge = 0.1f);
+		void pathfind(NavigationQuery query, Callback callback, float anisotropy = 1.0f, float nudge = 0.1f);
+
+		// budget is the total search time, summed over all workers, that the next batch can spend
+		void update(Time budget);
+		void waitForIdle();
+
+		bool isIdle() const;
+		Stats getStats() const;
+
+	private:
+		struct Request {
+			NavigationQuery query;
+			float anisotropy = 1.0f;
+			float nudge = 0.1f;
+			std::optional<Promise<Result>> promise;
+			Callback callback;
+			Result result;
+		};
+
+		const NavmeshSet& navmeshSet;
+		ExecutionQueue& executionQueue;
+
+		Vector<Request> queued;
+		Vector<Request> batch;
+		Vector<std::unique_ptr<NavmeshSearchScratch>> scratch;
+		Vector<Future<void>> workers;
+		Stats stats;
+
+		std::atomic<size_t> nextInBatch;
+		std::atomic<int64_t> batchTimeSpent;
+		int64_t batchBudget = 0;
+
+		void startBatch(Time budget);
+		void finishBatch();
+		void runWorker(NavmeshSearchScratch& workerScratch);
+	};
+}
@@ -7,6 +7,7 @@
 
 namespace Halley {
 	class NavmeshSet;
+	class NavmeshSearchScratch;
 	class Random;
 
 	struct NavmeshBounds {
@@ -116,8 +117,10 @@ namespace Halley {
 		void setId(uint16_t id);
 
 		[[nodiscard]] std::optional<Vector<NodeAndConn>> pathfindNodes(const NavigationQuery& query) const;
+		[[nodiscard]] std::optional<Vector<NodeAndConn>> pathfindNodes(const NavigationQuery& query, NavmeshSearchScratch& scratch) const;
 		[[nodiscard]] std::optional<NavigationPath> makePath(const NavigationQuery& query, const Vector<NodeAndConn>& nodePath) const;
 		[[nodiscard]] std::optional<NavigationPath> pathfind(const NavigationQuery& query) const;
+		[[nodiscard]] std::optional<NavigationPath> pathfind(const NavigationQuery& query, NavmeshSearchScratch& scratch) const;
 
 		[[nodiscard]] const Vector<Node>& getNodes() const { return nodes; }
 		[[nodiscard]] const Vector<Polygon>& getPolygons() const { return polygons; }
@@ -150,27 +153,6 @@ namespace Halley {
 		Base2D getNormalisedCoordinatesBase() const { return normalisedCoordinatesBase; }
 
 	private:
-		struct State {
-			float gScore = std::numeric_limits<float>::infinity();
-			float fScore = std::numeric_limits<float>::infinity();
-			NodeAndConn cameFrom;
-			bool inOpenSet = false;
-			bool inClosedSet = false;
-		};
-
-		class NodeComparator {
-		public:
-			NodeComparator(const Vector<State>& state) : state(state) {}
-			
-			bool operator()(Navmesh::NodeId a, Navmesh::NodeId b) const
-			{
-				return state[a].fScore > state[b].fScore;
-			}
-
-		private:
-			const Vector<State>& state;
-		};
-
 		uint16_t id;
 
 		Vector<Node> nodes;
@@ -193,8 +175,7 @@ namespace Halley {
 		float totalArea = 0;
 		Circle boundingCircle;
 
-		std::optional<Vector<NodeAndConn>> pathfind(int fromId, int toId) const;
-		Vector<NodeAndConn> makeResult(const Vector<State>& state, int startId, int endId) const;
+		std::optional<Vector<NodeAndConn>> pathfind(int fromId, int toId, NavmeshSearchScratch& scratch) const;
 
 		void processPolygons();
 		void addPolygonsToGrid();
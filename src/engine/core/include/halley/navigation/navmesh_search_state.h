@@ -0,0 +1,91 @@
+#pragma once
+
+#include <limits>
+#include "navmesh.h"
+#include "halley/data_structures/priority_queue.h"
+
+namespace Halley {
+	// Per-node A* state that can be reused from one search to the next without clearing it.
+	// Every entry remembers which search last wrote to it, and entries from older searches read as untouched.
+	template <typename CameFrom>
+	class NavmeshSearchState {
+	public:
+		using NodeId = uint16_t;
+
+		struct Node {
+			float gScore = std::numeric_limits<float>::infinity();
+			float fScore = std::numeric_limits<float>::infinity();
+			CameFrom cameFrom;
+			uint32_t generation = 0;
+			bool inOpenSet = false;
+			bool inClosedSet = false;
+		};
+
+		class NodeComparator {
+		public:
+			NodeComparator(const Vector<Node>& nodes) : nodes(nodes) {}
+
+			bool operator()(NodeId a, NodeId b) const
+			{
+				// Everything in the open set was written by the current search
+				return nodes[a].fScore > nodes[b].fScore;
+			}
+
+		private:
+			const Vector<Node>& nodes;
+		};
+
+		NavmeshSearchState()
+			: openSet(NodeComparator(nodes))
+		{}
+
+		NavmeshSearchState(const NavmeshSearchState& other) = delete;
+		NavmeshSearchState(NavmeshSearchState&& other) = delete;
+		NavmeshSearchState& operator=(const NavmeshSearchState& other) = delete;
+		NavmeshSearchState& operator=(NavmeshSearchState&& other) = delete;
+
+		void begin(size_t nNodes)
+		{
+			if (nodes.size() < nNodes) {
+				nodes.resize(nNodes);
+			}
+			if (++generation == 0) {
+				for (auto& node: nodes) {
+					node.generation = 0;
+				}
+				generation = 1;
+			}
+			openSet.clear();
+		}
+
+		Node& operator[](size_t idx)
+		{
+			auto& node = nodes[idx];
+			if (node.generation != generation) {
+				node = Node();
+				node.generation = generation;
+			}
+			return node;
+		}
+
+		PriorityQueue<NodeId, NodeComparator>& getOpenSet()
+		{
+			return openSet;
+		}
+
+	private:
+		Vector<Node> nodes;
+		uint32_t generation = 0;
+		PriorityQueue<NodeId, NodeComparator> openSet;
+	};
+
+	// Everything a NavmeshSet query needs to search, kept around between queries so they don't allocate.
+	// Not thread-safe: use one per thread.
+	class NavmeshSearchScratch {
+	public:
+		NavmeshSearchState<Navmesh::NodeAndConn> polygons;
+		NavmeshSearchState<uint16_t> portals;
+
+		static NavmeshSearchScratch& getThreadLocal();
+	};
+}
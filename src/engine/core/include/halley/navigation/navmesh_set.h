@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include "navmesh.h"
+#include "navmesh_search_state.h"
 #include "navigation_query.h"
 #include "navigation_path.h"
+#include "halley/data_structures/lru_cache.h"
 
 namespace Halley {
 	class NavmeshSet : public Resource {
@@ -31,8 +35,17 @@ namespace Halley {
 		void reportUnlinkedPortals(std::function<String(Vector2i)> getChunkName) const;
 		void setMaxDistancesToNavmesh(float startDistance, float endDistance);
 
+		// Optional speed-ups for queries that cross many regions, both off by default and both rebuilt by linkNavmeshes().
+		// Landmarks give the search over portals a much tighter heuristic (ALT), costing two floats per portal per landmark.
+		// The route cache remembers the region sequence of recent (fromRegion, toRegion) pairs, so repeated queries skip the portal search entirely.
+		// Cached routes are shared by every pair of points in those two regions, so they might not be the very shortest for each of them.
+		void setRegionLandmarks(size_t count);
+		void setRegionRouteCacheSize(size_t size);
+
 		std::optional<NavigationPath> pathfind(const NavigationQuery& query, String* errorOut = nullptr, float anisotropy = 1.0f, float nudge = 0.1f) const;
+		std::optional<NavigationPath> pathfind(const NavigationQuery& query, NavmeshSearchScratch& scratch, String* errorOut = nullptr, float anisotropy = 1.0f, float nudge = 0.1f) const;
 		std::optional<NavigationPath> pathfindInRegion(const NavigationQuery& query, uint16_t regionId) const;
+		std::optional<NavigationPath> pathfindInRegion(const NavigationQuery& query, uint16_t regionId, NavmeshSearchScratch& scratch) const;
 
 		gsl::span<const Navmesh> getNavmeshes() const { return navmeshes; }
 		const Navmesh* getNavMeshAt(WorldPosition pos) const;
@@ -87,39 +100,55 @@ namespace Halley {
 			NodeAndConn(uint16_t regionNodeId = 0, uint16_t exitEdgeId = std::numeric_limits<uint16_t>::max()) : regionNodeId(regionNodeId), exitEdgeId(exitEdgeId) {}
 		};
 
-		using NodeId = uint16_t;
-
-		struct State {
-			float gScore = std::numeric_limits<float>::infinity();
-			float fScore = std::numeric_limits<float>::infinity();
-			NodeId cameFrom;
-			bool inOpenSet = false;
-			bool inClosedSet = false;
+		struct RegionHeuristics {
+			size_t nLandmarks = 0;
+			Vector<float> distFromLandmark; // [landmark * nPortals + portal]
+			Vector<float> distToLandmark;
+			Vector<float> regionMinDistFromLandmark; // [landmark * nRegions + region], over the portals leading into that region
+			Vector<float> regionMaxDistToLandmark;
 		};
 
-		class NodeComparator {
+		// Safe to use from multiple threads; copies start out empty
+		class RegionRouteCache {
 		public:
-			NodeComparator(const Vector<State>& state) : state(state) {}
-			
-			bool operator()(NodeId a, NodeId b) const
-			{
-				return state[a].fScore > state[b].fScore;
-			}
+			RegionRouteCache() = default;
+			RegionRouteCache(const RegionRouteCache& other);
+			RegionRouteCache& operator=(const RegionRouteCache& other);
+
+			void setCapacity(size_t capacity);
+			void clear();
+			bool isEnabled() const; // Doesn't lock, so lookups can skip the cache entirely when it has no capacity
+
+			std::optional<Vector<NodeAndConn>> get(uint16_t fromRegion, uint16_t toRegion) const;
+			void put(uint16_t fromRegion, uint16_t toRegion, Vector<NodeAndConn> route) const;
 
 		private:
-			const Vector<State>& state;
+			mutable std::mutex mutex;
+			mutable LRUCache<uint32_t, Vector<NodeAndConn>> routes;
+			std::atomic<bool> enabled = false;
 		};
 
+		using NodeId = uint16_t;
+
 		Vector<Navmesh> navmeshes;
 		Vector<PortalNode> portalNodes;
 		Vector<RegionNode> regionNodes;
 		float maxStartDistanceToNavMesh = 10.0f;
 		float maxEndDistanceToNavMesh = 1.0f;
 
+		size_t nRegionLandmarks = 0;
+		RegionHeuristics regionHeuristics;
+		RegionRouteCache regionRouteCache;
+
 		void tryLinkNavMeshes(uint16_t idxA, uint16_t idxB);
 
-		NavigationPath extendToFullPath(const NavigationQuery& query, const Vector<NodeAndConn>& path) const;
-		Vector<NodeAndConn> findRegionPath(Vector2f startPos, Vector2f endPos, uint16_t fromRegionId, uint16_t toRegionId) const;
+		NavigationPath extendToFullPath(const NavigationQuery& query, const Vector<NodeAndConn>& path, NavmeshSearchScratch& scratch) const;
+		Vector<NodeAndConn> findRegionPath(Vector2f startPos, Vector2f endPos, uint16_t fromRegionId, uint16_t toRegionId, NavmeshSearchScratch& scratch) const;
+		Vector<NodeAndConn> searchRegionPath(Vector2f startPos, Vector2f endPos, uint16_t fromRegionId, uint16_t toRegionId, NavmeshSearchScratch& scratch) const;
+		float getLandmarkHeuristic(uint16_t portalId, uint16_t toRegionId) const;
+
+		void buildRegionHeuristics();
+		void invalidateRegionCaches();
 
 		void postProcessPath(NavigationPath& path) const;
 		void simplifyPath(Vector<NavigationPath::Point>& points, NavigationQuery::PostProcessingType type) const;
@@ -31,10 +31,11 @@ namespace Halley
 		virtual void onPacketReceived(uint16_t sequence, size_t size, bool resend) = 0;
 	};
 
+	// Doesn't own its data, which must stay alive until it's passed to AckUnreliableConnection::sendTagged()
 	class AckUnreliableSubPacket
 	{
 	public:
-		Vector<gsl::byte> data;
+		gsl::span<const gsl::byte> data;
 		int tag = -1;
 		//bool reliable = false;
 		bool resends = false;
@@ -44,14 +45,12 @@ namespace Halley
 		AckUnreliableSubPacket()
 		{}
 
-		AckUnreliableSubPacket(AckUnreliableSubPacket&& other) = default;
-
-		AckUnreliableSubPacket(Vector<gsl::byte>&& data)
+		AckUnreliableSubPacket(gsl::span<const gsl::byte> data)
 			: data(data)
 			, resends(false)
 		{}
 
-		AckUnreliableSubPacket(Vector<gsl::byte>&& data, uint16_t resendSeq)
+		AckUnreliableSubPacket(gsl::span<const gsl::byte> data, uint16_t resendSeq)
 			: data(data)
 			, resends(true)
 			, resendSeq(resendSeq)
@@ -28,13 +28,20 @@ namespace Halley
 			uint8_t channel = 0;
 		};
 
+		struct SentMessage {
+			uint16_t seq = 0;
+			uint8_t channel = 0;
+		};
+
 		struct PendingPacket
 		{
-			Vector<Outbound> msgs;
+			OutboundNetworkPacket data; // Serialized once, and re-sent as is
+			Vector<SentMessage> msgs;
 			std::chrono::steady_clock::time_point timeSent;
-			size_t size = 0;
 			uint16_t seq = 0;
 			bool reliable = false;
+
+			PendingPacket(OutboundNetworkPacket data);
 		};
 
 		struct Channel
@@ -71,6 +78,7 @@ namespace Halley
 		Vector<Channel> channels;
 
 		std::list<Outbound> outboundQueued;
+		std::list<Outbound> outboundPacking;
 		std::map<int, PendingPacket> pendingPackets;
 		int nextPacketId = 0;
 
@@ -78,8 +86,8 @@ namespace Halley
 		void checkReSend(Vector<AckUnreliableSubPacket>& collect);
 
 		AckUnreliableSubPacket createPacket();
-		AckUnreliableSubPacket makeTaggedPacket(Vector<Outbound>& msgs, size_t size, bool resends = false, uint16_t resendSeq = 0);
-		Vector<gsl::byte> serializeMessages(const Vector<Outbound>& msgs, size_t size) const;
+		AckUnreliableSubPacket makeTaggedPacket(PendingPacket pending, bool resends = false, uint16_t resendSeq = 0);
+		size_t serializeMessages(const std::list<Outbound>& msgs, gsl::span<gsl::byte> dst) const;
 
 		void receiveMessages();
 	};
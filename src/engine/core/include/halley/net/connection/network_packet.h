@@ -5,9 +5,19 @@
 
 namespace Halley
 {
+	// Recycles packet storage (per thread), so that steady traffic doesn't keep going back to the heap
+	class NetworkPacketPool
+	{
+	public:
+		static Vector<gsl::byte> acquire(size_t size);
+		static void release(Vector<gsl::byte>& buffer);
+	};
+
 	class NetworkPacketBase
 	{
 	public:
+		~NetworkPacketBase();
+
 		size_t copyTo(gsl::span<gsl::byte> dst) const;
 		size_t getSize() const;
 		gsl::span<const gsl::byte> getBytes() const;
@@ -30,6 +40,12 @@ namespace Halley
 		OutboundNetworkPacket(OutboundNetworkPacket&& other) noexcept;
 		explicit OutboundNetworkPacket(gsl::span<const gsl::byte> data);
 		explicit OutboundNetworkPacket(const Bytes& data);
+
+		// Uninitialised payload of the given size, to be written in place through getWritableBytes()
+		explicit OutboundNetworkPacket(size_t size);
+
+		gsl::span<gsl::byte> getWritableBytes();
+		void resize(size_t size);
 		
 		void addHeader(gsl::span<const gsl::byte> src);
 
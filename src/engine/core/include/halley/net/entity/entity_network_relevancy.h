@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <gsl/span>
+
+#include "halley/data_structures/hash_map.h"
+#include "halley/data_structures/vector.h"
+#include "halley/entity/entity.h"
+#include "halley/maths/rect.h"
+#include "halley/time/halleytime.h"
+#include "../session/network_session.h"
+
+namespace Halley {
+	class EntityNetworkSession;
+	class EntityNetworkRemotePeer;
+	class EntityClientSharedData;
+	struct EntityNetworkUpdateInfo;
+
+	struct EntityNetworkRelevancy {
+		uint32_t idx = 0; // Index into the entity list given to the filter
+		float priority = 1.0f; // Rate at which the entity gains priority for bandwidth-limited updates
+		Time minSendInterval = 0; // Minimum time between updates
+	};
+
+	// Decides which entities are replicated to each peer, and how often. Entities that stop being relevant are destroyed on that peer.
+	class IEntityNetworkRelevancyFilter {
+	public:
+		virtual ~IEntityNetworkRelevancyFilter() = default;
+
+		// Called once per network tick, before any calls to getRelevantEntities
+		virtual void update(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds) {}
+
+		// Fills result with the entities relevant to peer, in ascending idx order.
+		// Called from multiple threads at once, one per peer, so it must not modify shared state.
+		virtual void getRelevantEntities(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityNetworkRemotePeer& peer, const EntityClientSharedData& clientData, Vector<EntityNetworkRelevancy>& result) = 0;
+	};
+
+	// Sends everything that the session listener reports as in view, at the session's minimum send interval
+	class EntityNetworkViewRelevancyFilter : public IEntityNetworkRelevancyFilter {
+	public:
+		void getRelevantEntities(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityNetworkRemotePeer& peer, const EntityClientSharedData& clientData, Vector<EntityNetworkRelevancy>& result) override;
+	};
+
+	// Buckets entities into a spatial grid every tick, and only looks at the cells around each peer's view.
+	// Entities are created on a peer once within createMargin of its view, and kept until they're further than keepMargin.
+	// Outside the view, update rate and priority fall off with distance. Entities without a position are always relevant.
+	class EntityNetworkGridRelevancyFilter : public IEntityNetworkRelevancyFilter {
+	public:
+		using PositionGetter = std::function<std::optional<Vector2f>(EntityRef)>;
+
+		struct Config {
+			float cellSize = 512.0f;
+			float createMargin = 256.0f;
+			float keepMargin = 512.0f;
+			Time maxSendInterval = 0.5;
+			float minPriority = 0.25f;
+		};
+
+		EntityNetworkGridRelevancyFilter(PositionGetter getPosition, Config config);
+
+		void update(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds) override;
+		void getRelevantEntities(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityNetworkRemotePeer& peer, const EntityClientSharedData& clientData, Vector<EntityNetworkRelevancy>& result) override;
+
+	private:
+		PositionGetter getPosition;
+		Config config;
+
+		Vector<Vector2f> positions;
+		HashMap<Vector2i, Vector<uint32_t>> cells;
+		Vector<uint32_t> unpositioned;
+
+		Vector2i getCell(Vector2f pos) const;
+	};
+}
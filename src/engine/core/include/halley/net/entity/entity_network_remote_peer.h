@@ -1,6 +1,8 @@
 #pragma once
 
+#include <mutex>
 #include "entity_network_message.h"
+#include "entity_network_relevancy.h"
 #include "halley/data_structures/hash_map.h"
 #include "halley/entity/entity.h"
 #include "../session/network_session.h"
@@ -18,13 +20,44 @@ namespace Halley {
 		uint8_t ownerId;
 	};
 
+    // Entities serialized for the current network tick, shared between all peers, so that each entity is only serialized once
+    // per tick no matter how many peers it's sent to. Peers that last received the same data for an entity also share the delta.
+    class EntityNetworkUpdateCache {
+    public:
+        void reset(size_t nEntities);
+        void request(size_t idx);
+        void serialize(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds);
+
+        const std::shared_ptr<const EntityData>& getData(size_t idx) const;
+        const Bytes* getDelta(size_t idx, const std::shared_ptr<const EntityData>& from, EntityRef entity, EntityNetworkSession& session); // nullptr if unchanged
+
+    private:
+        struct Delta {
+            std::shared_ptr<const EntityData> from;
+            bool hasChange = false;
+            Bytes bytes;
+        };
+
+        struct Entry {
+            bool requested = false;
+            std::shared_ptr<const EntityData> data;
+            std::mutex mutex;
+            Vector<std::unique_ptr<Delta>> deltas;
+        };
+
+        Vector<std::unique_ptr<Entry>> entries;
+        size_t nEntries = 0;
+    };
+
     class EntityNetworkRemotePeer {
         constexpr static Time maxSendInterval = 1.0;
+        constexpr static float maxBurstTime = 0.5f;
     	
     public:
         EntityNetworkRemotePeer(EntityNetworkSession& parent, NetworkSession::PeerId peerId);
 
         NetworkSession::PeerId getPeerId() const;
+        bool hasSentEntity(EntityId id) const;
 
     	bool isAlive() const;
     	void destroy();
@@ -36,7 +69,11 @@ namespace Halley {
         void sendLobbyInfo(ConfigNode data);
         void setLobbyInfo(ConfigNode info);
 
-    	void sendEntities(Time t, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityClientSharedData& clientData);
+    	// Sending is split in three steps: prepareEntities works out what needs sending, requestEntities flags those entities in the
+    	// shared cache, and sendEntities sends them once the cache has serialized them. Different peers can run each step in parallel.
+    	void prepareEntities(Time t, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityClientSharedData& clientData);
+    	void requestEntities(EntityNetworkUpdateCache& cache) const;
+    	void sendEntities(gsl::span<const EntityNetworkUpdateInfo> entityIds, EntityNetworkUpdateCache& cache);
         void receiveNetworkMessage(NetworkSession::PeerId fromPeerId, EntityNetworkMessage msg);
 
     private:
@@ -44,8 +81,9 @@ namespace Halley {
         public:
             bool alive = true;
             Time timeSinceSend = 0;
+            float priority = 0; // Accumulated while waiting to be sent
             EntityNetworkId networkId = 0;
-            EntityData data;
+            std::shared_ptr<const EntityData> data;
         };
 
         class InboundEntity {
@@ -68,9 +106,15 @@ namespace Halley {
 
         Time timeSinceSend = 0;
 
+        bool pendingSend = false;
+        float sendBudget = 0; // Bytes, when the session has a bandwidth limit
+        Vector<EntityNetworkRelevancy> relevantEntities;
+        Vector<uint32_t> pendingCreate;
+        Vector<std::pair<uint32_t, OutboundEntity*>> pendingUpdate;
+
         uint16_t assignId();
-        void sendCreateEntity(EntityRef entity);
-        void sendUpdateEntity(Time t, OutboundEntity& remote, EntityRef entity);
+        void sendCreateEntity(EntityRef entity, std::shared_ptr<const EntityData> data);
+        void sendUpdateEntity(OutboundEntity& remote, EntityRef entity, size_t idx, EntityNetworkUpdateCache& cache);
         void sendDestroyEntity(OutboundEntity& remote);
         void sendKeepAlive();
         void send(EntityNetworkMessage message);
@@ -69,6 +69,13 @@ namespace Halley {
 
 		Time getMinSendInterval() const;
 
+		void setRelevancyFilter(std::unique_ptr<IEntityNetworkRelevancyFilter> filter);
+		IEntityNetworkRelevancyFilter& getRelevancyFilter() const;
+
+		// Maximum bytes per second of entity updates sent to each peer, 0 for unlimited. Entity creation is never held back.
+		void setPeerBandwidthLimit(size_t bytesPerSecond);
+		size_t getPeerBandwidthLimit() const;
+
 		void onRemoteEntityCreated(EntityRef entity, NetworkSession::PeerId peerId);
 		void requestSetupInterpolators(DataInterpolatorSet& interpolatorSet, EntityRef entity, bool remote);
 		void setupOutboundInterpolators(EntityRef entity);
@@ -124,6 +131,9 @@ namespace Halley {
 
 		std::shared_ptr<NetworkSession> session;
 		Vector<EntityNetworkRemotePeer> peers;
+		EntityNetworkUpdateCache updateCache;
+		std::unique_ptr<IEntityNetworkRelevancyFilter> relevancyFilter;
+		size_t peerBandwidthLimit = 0;
 
 		Vector<QueuedMessage> queuedPackets;
 
@@ -61,12 +61,15 @@ namespace Halley {
 		void setId(String value);
 		gsl::span<const AudioBusProperties> getChildren() const;
 		gsl::span<AudioBusProperties> getChildren();
+		int getMaxVoices() const;
+		void setMaxVoices(int value);
 
 		void collectBusIds(Vector<String>& output) const;
 
 	private:
 		String id;
 		Vector<AudioBusProperties> children;
+		int maxVoices = 0;
 	};
 
 	class AudioProperties {
@@ -85,6 +88,8 @@ namespace Halley {
 		gsl::span<AudioVariableProperties> getVariables();
 		gsl::span<const AudioBusProperties> getBuses() const;
 		gsl::span<AudioBusProperties> getBuses();
+		int getMaxVoices() const;
+		void setMaxVoices(int value);
 
 		Vector<String> getSwitchIds() const;
 		Vector<String> getVariableIds() const;
@@ -97,6 +102,7 @@ namespace Halley {
 		Vector<AudioSwitchProperties> switches;
 		Vector<AudioVariableProperties> variables;
 		Vector<AudioBusProperties> buses;
+		int maxVoices = 0;
 
 		void getBusIds(Vector<String>& result) const;
 	};
@@ -12,11 +12,33 @@ namespace Halley
 	class AssetDatabase
 	{
 	public:
+		// Where an asset is stored in a pack that encodes each entry on its own (pack format 2 onwards)
+		struct PackLocation
+		{
+			enum Flags : uint8_t {
+				Encrypted = 1, // AES-CTR, with the nonce below
+				LZ4Compressed = 2, // In independent chunks, see AssetPack
+				Deleted = 4 // No data; hides the asset in packs of lower priority (used by patch packs)
+			};
+
+			uint64_t offset = 0;
+			uint64_t storedSize = 0;
+			uint64_t size = 0; // Once decrypted and decompressed
+			uint64_t nonce = 0;
+			uint8_t flags = 0;
+
+			bool hasFlag(Flags flag) const { return (flags & flag) != 0; }
+
+			void serialize(Serializer& s) const;
+			void deserialize(Deserializer& s);
+		};
+
 		class Entry
 		{
 		public:
 			String path;
 			Metadata meta;
+			PackLocation packLocation; // Only serialized from version 1 of the serializer, which packs from format 2 onwards use
 
 			Entry();
 			Entry(const String& path, const Metadata& meta);
@@ -52,6 +74,9 @@ namespace Halley
 
 		void addAsset(const String& name, AssetType type, Entry&& entry);
 		const TypedDB& getDatabase(AssetType type) const;
+		// Unlike getDatabase, never modifies the database, so it's safe to call from several threads
+		const Entry* tryGet(const String& name, AssetType type) const;
+		const TreeMap<int, TypedDB>& getDatabases() const;
 		bool hasDatabase(AssetType type) const;
 		Vector<String> getAssets() const;
 
@@ -4,72 +4,137 @@
 #include <memory>
 #include <gsl/span>
 #include "halley/resources/resource_data.h"
+#include "halley/resources/asset_database.h"
+#include "halley/resources/asset_pack_index.h"
 #include "halley/utils/encrypt.h"
 
 namespace Halley {
 	enum class AssetType;
 	class Deserializer;
 	class Serializer;
-	class AssetDatabase;
 	class ResourceData;
 	class ResourceDataReader;
+	class MemoryMappedFile;
 
 	struct AssetPackHeader {
+		// 1: entries stored as they are, and the whole data section is encrypted with AES-CBC
+		// 2: each entry is compressed and encrypted on its own, see AssetDatabase::PackLocation
+		// 3: uncompressed binary index instead of a serialized AssetDatabase, see AssetPackIndex
+		constexpr static int latestVersion = 3;
+
 		std::array<char, 8> identifier;
 		std::array<uint8_t, 16> iv;
 		uint64_t assetDbStartPos;
 		uint64_t dataStartPos;
 
-		void init(size_t assetDbSize);
+		void init(size_t assetDbSize, int version = latestVersion);
+		std::optional<int> getVersion() const;
 	};
 
     class AssetPack {
     public:
+		// LZ4 compressed entries are split into chunks of this size, which can be decompressed independently
+		constexpr static size_t lz4ChunkSize = 64 * 1024;
+
 		AssetPack();
 		AssetPack(const AssetPack& other) = delete;
 		AssetPack(AssetPack&& other) noexcept;
 		AssetPack(std::unique_ptr<ResourceDataReader> reader, std::optional<Encrypt::AESKey> encryptionKey, bool preLoad = false);
+
+		// Static data is returned as views into the mapping (which they keep alive), and streams read from the file concurrently.
+		// Packs encrypted as a whole still have to be decrypted into memory.
+		AssetPack(std::shared_ptr<MemoryMappedFile> file, std::optional<Encrypt::AESKey> encryptionKey);
 		~AssetPack();
 
 		AssetPack& operator=(const AssetPack& other) = delete;
 		AssetPack& operator=(AssetPack&& other) noexcept;
 
-		AssetDatabase& getAssetDatabase();
+		// Packs with an index build the database on first use, which is slow on large packs; prefer the methods below. Thread safe.
 		const AssetDatabase& getAssetDatabase() const;
+
+		Vector<String> getAssetIds() const;
+		Vector<String> getDeletedAssetIds() const;
+		Vector<String> enumerate(AssetType type) const;
+		const Metadata* getMetadata(const String& asset, AssetType type);
 		Bytes& getData();
 		const Bytes& getData() const;
+		int getVersion() const;
 
-		Bytes writeOut() const;
+		// Returns the entry as it's stored, and fills in everything in location except for the offset. Thread safe.
+		static Bytes encodeEntry(gsl::span<const gsl::byte> data, std::optional<Encrypt::AESKey> key, bool compress, AssetDatabase::PackLocation& location);
 
 		std::unique_ptr<ResourceData> getData(const String& asset, AssetType type, bool stream);
 
 		void readToMemory();
 		void encrypt(Encrypt::AESKey key);
 		void decrypt(Encrypt::AESKey key);
-	    
+
     	void readData(size_t pos, gsl::span<gsl::byte> dst);
 
+		// Reads the stored bytes of an entry, starting at pos, and decrypts them if needed (but doesn't decompress them)
+		void readEntryData(const AssetDatabase::PackLocation& location, size_t pos, gsl::span<gsl::byte> dst);
+
 		std::unique_ptr<ResourceDataReader> extractReader();
 
 		std::shared_ptr<bool> getAliveToken() const;
 
 		size_t getMemoryUsage() const;
+		bool isMemoryMapped() const;
 
     private:
-		std::unique_ptr<AssetDatabase> assetDb;
+		mutable std::unique_ptr<AssetDatabase> assetDb;
+		mutable std::mutex assetDbMutex;
+		AssetPackIndex index;
+		Bytes indexData;
+		bool hasIndex = false;
+		HashMap<const AssetPackIndex::Entry*, std::unique_ptr<Metadata>> metadataCache;
+		std::mutex metadataMutex;
+		std::shared_ptr<MemoryMappedFile> mappedFile;
 		std::unique_ptr<ResourceDataReader> reader;
 		std::atomic<bool> hasReader;
 		std::mutex readerMutex;
 		size_t dataOffset = 0;
 		Bytes data;
+		int version = AssetPackHeader::latestVersion;
 		std::array<uint8_t, 16> iv;
+		std::optional<std::array<uint8_t, 16>> key;
 		mutable std::shared_ptr<bool> aliveToken;
+
+		void setEncryptionKey(std::optional<Encrypt::AESKey> key);
+		void readHeader(const AssetPackHeader& header, size_t totalSize);
+		void readAssetDatabase(gsl::span<const gsl::byte> assetDbBytes);
+		bool needsDecrypting(const std::optional<Encrypt::AESKey>& encryptionKey) const;
+		std::optional<AssetDatabase::PackLocation> tryGetLocation(const String& asset, AssetType type) const;
+		Vector<String> collectAssetIds(bool deleted) const;
+		std::unique_ptr<ResourceDataStatic> decodeEntry(const String& asset, const AssetDatabase::PackLocation& location);
     };
 
 
+	// Builds a pack in the latest format in memory. See AssetPackWriter for large packs, which it writes straight to a file.
+	class AssetPackBuilder {
+	public:
+		explicit AssetPackBuilder(std::optional<Encrypt::AESKey> encryptionKey = {});
+
+		// Entries are encrypted as they're added, if there's a key
+		void addAsset(const String& name, AssetType type, gsl::span<const gsl::byte> data, const Metadata& meta, bool compress = true);
+		void addTombstone(const String& name, AssetType type);
+
+		const AssetDatabase& getAssetDatabase() const;
+		size_t getDataSize() const;
+
+		Bytes writeOut() const;
+
+	private:
+		std::optional<std::array<uint8_t, 16>> key;
+		AssetDatabase assetDb;
+		Bytes data;
+	};
+
+
 	class PackDataReader final : public ResourceDataReader {
 	public:
 		PackDataReader(AssetPack& pack, size_t startPos, size_t fileSize);
+		PackDataReader(AssetPack& pack, const AssetDatabase::PackLocation& location);
 
 		size_t size() const override;
 		int read(gsl::span<gsl::byte> dst) override;
@@ -80,10 +145,17 @@ namespace Halley {
 
 	private:
 		AssetPack& pack;
-		const size_t startPos;
-		const size_t fileSize;
+		const AssetDatabase::PackLocation location;
 		size_t curPos = 0;
 		mutable std::mutex mutex;
 		std::shared_ptr<bool> aliveToken;
+
+		// Decompression state, for LZ4 compressed entries
+		Vector<uint64_t> chunkOffsets;
+		Bytes compressedChunk;
+		Bytes chunk;
+		size_t curChunk = std::numeric_limits<size_t>::max();
+
+		void readCompressed(gsl::span<gsl::byte> dst);
 	};
 }
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "halley/resources/asset_database.h"
+#include "halley/data_structures/vector.h"
+#include <gsl/span>
+
+namespace Halley
+{
+	enum class AssetType;
+
+	// Binary index of the assets in a pack (pack format 3 onwards). It's used in place, without deserializing it,
+	// so it can be read straight from a memory mapped pack.
+	//
+	// Layout, all little endian:
+	//   Header
+	//   TypeRange[nTypes], sorted by type
+	//   Entry[nEntries], sorted by name hash within each type
+	//   Names, not null terminated
+	//   Metadata, serialized, only read when requested
+	class AssetPackIndex
+	{
+	public:
+		struct Header
+		{
+			std::array<char, 4> identifier;
+			uint32_t nTypes;
+			uint32_t nEntries;
+			uint32_t namesSize;
+			uint64_t namesPos;
+			uint64_t metadataPos;
+		};
+
+		struct TypeRange
+		{
+			int32_t type;
+			uint32_t firstEntry;
+			uint32_t nEntries;
+			uint32_t padding;
+		};
+
+		struct Entry
+		{
+			uint64_t nameHash;
+			uint64_t offset;
+			uint64_t storedSize;
+			uint64_t size;
+			uint64_t nonce;
+			uint32_t namePos;
+			uint32_t nameLength;
+			uint64_t metadataPos;
+			uint32_t metadataSize;
+			uint8_t flags;
+			std::array<uint8_t, 3> padding;
+		};
+
+		static uint64_t hashName(std::string_view name);
+
+		// Entries must have their packLocation set
+		static Bytes build(const AssetDatabase& db);
+
+		AssetPackIndex() = default;
+		// Doesn't copy the data, so it must outlive the index
+		explicit AssetPackIndex(gsl::span<const gsl::byte> data);
+
+		bool isEmpty() const;
+		size_t getEntryCount() const;
+
+		const Entry* tryGet(AssetType type, std::string_view name) const;
+		gsl::span<const Entry> getEntries(AssetType type) const;
+		Vector<AssetType> getTypes() const;
+
+		std::string_view getName(const Entry& entry) const;
+		Metadata getMetadata(const Entry& entry) const;
+		static AssetDatabase::PackLocation getLocation(const Entry& entry);
+
+		// Fully deserialized, for tools and for code that needs AssetDatabase
+		std::unique_ptr<AssetDatabase> makeDatabase() const;
+
+	private:
+		gsl::span<const gsl::byte> data;
+		gsl::span<const TypeRange> types;
+		gsl::span<const Entry> entries;
+		std::string_view names;
+	};
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "halley/resources/asset_database.h"
+#include "halley/file/path.h"
+#include "halley/utils/encrypt.h"
+#include <fstream>
+
+namespace Halley
+{
+	enum class AssetType;
+
+	// Writes a pack in the latest format straight to a file, one entry at a time, so the pack never has to be held in memory.
+	// Every entry must be declared before begin(), so that the index can be reserved ahead of the data; entries that are
+	// declared but never written are left out.
+	// Large entries are aligned, so they can be memory mapped or read with direct I/O, and identical payloads are only stored once.
+	class AssetPackWriter
+	{
+	public:
+		constexpr static size_t defaultAlignment = 4096;
+
+		struct EncodedAsset
+		{
+			Bytes data;
+			AssetDatabase::PackLocation location;
+			uint64_t contentHash = 0;
+		};
+
+		AssetPackWriter(Path path, std::optional<Encrypt::AESKey> encryptionKey, size_t alignment = defaultAlignment);
+		~AssetPackWriter();
+
+		void declare(const String& name, AssetType type, const Metadata& meta);
+		void begin();
+
+		// Thread safe, so entries can be encoded in parallel and then written in order
+		EncodedAsset encode(gsl::span<const gsl::byte> data, bool compress = true) const;
+		void write(const String& name, AssetType type, EncodedAsset asset);
+		void writeTombstone(const String& name, AssetType type);
+
+		// Writes the header and index, and closes the file
+		void finish();
+
+		size_t getDataSize() const;
+		size_t getDeduplicatedCount() const;
+
+	private:
+		Path path;
+		std::optional<std::array<uint8_t, 16>> key;
+		size_t alignment;
+
+		AssetDatabase declared;
+		AssetDatabase written;
+		std::ofstream file;
+		size_t dataStartPos = 0;
+		size_t dataSize = 0;
+		size_t nDeduplicated = 0;
+		HashMap<std::pair<uint64_t, uint64_t>, AssetDatabase::PackLocation> contents;
+
+		const AssetDatabase::Entry& getDeclared(const String& name, AssetType type) const;
+		void writeBytes(gsl::span<const gsl::byte> bytes);
+		void writePadding(size_t size);
+	};
+}
@@ -75,8 +75,10 @@ namespace Halley {
 	public:
 		ResourceDataStatic(String path);
 		ResourceDataStatic(const void* data, size_t size, String path, bool owning = true);
+		ResourceDataStatic(std::shared_ptr<const char> data, size_t size, String path);
 
 		void set(const void* data, size_t size, bool owning = true);
+		void set(std::shared_ptr<const char> data, size_t size);
 		bool isLoaded() const;
 
 		const void* getData() const;
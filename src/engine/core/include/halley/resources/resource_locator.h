@@ -41,6 +41,12 @@ namespace Halley {
 		virtual ~IResourceLocatorProvider() {}
 		virtual std::unique_ptr<ResourceData> getData(const String& path, AssetType type, bool stream) = 0;
 		virtual const AssetDatabase& getAssetDatabase() = 0;
+		// Default to getAssetDatabase(); override where there's a cheaper way
+		virtual Vector<String> getAssetIds();
+		// Assets that this provider hides in providers of lower priority
+		virtual Vector<String> getDeletedAssetIds() { return {}; }
+		virtual Vector<String> enumerate(AssetType type);
+		virtual const Metadata* getMetadata(const String& asset, AssetType type);
 		virtual int getPriority() const { return 0; }
 		virtual void purgeAll(SystemAPI& system) = 0;
 		virtual bool purgeIfAffected(SystemAPI& system, gsl::span<const String> assetIds, gsl::span<const String> packIds) = 0;
@@ -53,7 +59,10 @@ namespace Halley {
 	public:
 		explicit ResourceLocator(SystemAPI& system);
 		void addFileSystem(const Path& path, IFileSystemCache* cache = nullptr);
+		// Patch packs (see AssetPacker::generatePatch) should be added with a higher priority than the packs they patch
 		void addPack(const Path& path, std::optional<Encrypt::AESKey> encryptionKey = std::nullopt, bool preLoad = false, bool allowFailure = false, std::optional<int> priority = {});
+		// Memory maps the pack where supported (falling back to addPack otherwise). The file must not be rewritten in place while it's in use.
+		void addMappedPack(const Path& path, std::optional<Encrypt::AESKey> encryptionKey = std::nullopt, bool allowFailure = false, std::optional<int> priority = {});
 		Vector<String> getAssetsFromPack(const Path& path, std::optional<Encrypt::AESKey> encryptionKey = std::nullopt) const;
 		void removePack(const Path& path);
 
@@ -76,6 +85,7 @@ namespace Halley {
 		SystemAPI& system;
 		HashMap<String, IResourceLocatorProvider*> locatorPaths;
 		HashMap<String, IResourceLocatorProvider*> assetToLocator;
+		HashMap<String, int> deletedAssets; // Highest priority of the providers that deleted each asset
 		Vector<std::unique_ptr<IResourceLocatorProvider>> locators;
 		static const Metadata dummyMetadata;
 
@@ -83,5 +93,6 @@ namespace Halley {
 
 		std::unique_ptr<ResourceData> getResource(const String& asset, AssetType type, bool stream, bool throwOnFail) const;
 		void loadLocatorData(IResourceLocatorProvider& locator);
+		void reloadAllLocatorData();
 	};
 }
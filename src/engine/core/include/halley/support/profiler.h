@@ -4,6 +4,7 @@
 #include <thread>
 #include <gsl/span>
 #include <atomic>
+#include <mutex>
 
 #include "halley/data_structures/hash_map.h"
 #include "halley/time/halleytime.h"
@@ -49,6 +50,42 @@ namespace Halley {
         UserDefined
     };	
 
+	template <>
+	struct EnumNames<ProfilerEventType> {
+		constexpr std::array<const char*, 28> operator()() const {
+			return{{
+				"CorePumpEvents",
+				"CoreDevConClient",
+				"CorePumpAudio",
+				"CoreFixedUpdate",
+				"CoreVariableUpdate",
+				"CoreUpdateSystem",
+				"CoreUpdatePlatform",
+				"CoreUpdate",
+				"CoreStartRender",
+				"CoreRender",
+				"CoreVSync",
+				"PainterDrawCall",
+				"PainterEndRender",
+				"PainterUpdateProjection",
+				"WorldVariableUpdate",
+				"WorldFixedUpdate",
+				"WorldRender",
+				"WorldSystemUpdate",
+				"WorldSystemRender",
+				"WorldSystemMessages",
+				"ScriptUpdate",
+				"AudioGenerateBuffer",
+				"GPU",
+				"DiskIO",
+				"StatsView",
+				"Game",
+				"ExternalCode",
+				"UserDefined"
+			}};
+		}
+	};
+
     class ProfilerData {
     public:
         using TimePoint = std::chrono::steady_clock::time_point;
@@ -88,7 +125,7 @@ namespace Halley {
     	};
 
     	ProfilerData() = default;
-    	ProfilerData(TimePoint frameStartTime, TimePoint frameEndTime, Vector<Event> events);
+    	ProfilerData(TimePoint frameStartTime, TimePoint frameEndTime, Vector<Event> events, HashMap<std::thread::id, String> threadNames = {}, Vector<TimePoint> frameStartTimes = {});
 
     	TimePoint getStartTime() const;
     	TimePoint getEndTime() const;
@@ -99,21 +136,35 @@ namespace Halley {
 
     	gsl::span<const ThreadInfo> getThreads() const;
 
+    	// Chrome trace event JSON, which can be loaded in chrome://tracing or ui.perfetto.dev
+    	String toChromeTrace() const;
+
     private:
     	TimePoint frameStartTime;
     	TimePoint frameEndTime;
     	Vector<Event> events;
+    	HashMap<std::thread::id, String> threadNames;
+    	Vector<TimePoint> frameStartTimes;
 
     	Vector<ThreadInfo> threads;
 
     	void processEvents();
     };
 	
+    class ProfilerThreadBuffer;
+
+    // Each thread records into its own ring buffer, so recording an event doesn't take any locks or touch any shared
+    // cache lines. Names are interned, and only turned back into strings when a capture is requested.
     class ProfilerCapture {
     public:
         using EventId = uint64_t;
+    	using NameId = uint32_t;
     	
-        ProfilerCapture(size_t maxEvents = 16384);
+        ProfilerCapture(size_t maxEventsPerThread = 16384);
+    	~ProfilerCapture();
+
+    	ProfilerCapture(const ProfilerCapture& other) = delete;
+    	ProfilerCapture& operator=(const ProfilerCapture& other) = delete;
     	
     	[[nodiscard]] static ProfilerCapture& get();
 
@@ -130,6 +181,17 @@ namespace Halley {
 
     	Time getFrameTime() const;
 
+    	// Keeps recording every frame, and remembers the last nFrames, so they can be retrieved at any time with getContinuousCapture.
+    	// Frames older than what fits in the per-thread buffers are lost. Set to 0 to disable.
+    	void setContinuousCapture(size_t nFrames);
+    	size_t getContinuousCaptureFrames() const;
+    	ProfilerData getContinuousCapture();
+
+    	void setThreadName(const String& name);
+
+    	[[nodiscard]] NameId getNameId(std::string_view name);
+    	const String& getName(NameId id) const;
+
     private:
     	enum class State {
     		Idle,
@@ -137,16 +199,29 @@ namespace Halley {
     		FrameEnded
     	};
 
+    	constexpr static size_t maxThreads = 256;
+
+    	const size_t bufferSize;
     	std::atomic<bool> recording;
-    	std::atomic<uint64_t> curId;
-    	uint64_t startId;
-    	std::atomic<uint64_t> endId;
         State state = State::Idle;
     	
     	std::chrono::steady_clock::time_point frameStartTime;
     	std::chrono::steady_clock::time_point frameEndTime;
 
-    	Vector<ProfilerData::Event> events;
+    	size_t continuousFrames = 0;
+    	Vector<std::pair<ProfilerData::TimePoint, ProfilerData::TimePoint>> frameHistory;
+
+    	mutable std::mutex buffersMutex;
+    	std::array<std::atomic<ProfilerThreadBuffer*>, maxThreads> buffers;
+    	Vector<std::unique_ptr<ProfilerThreadBuffer>> ownedBuffers;
+
+    	mutable std::mutex namesMutex;
+    	HashMap<std::string_view, NameId> nameIds;
+    	Vector<std::unique_ptr<String>> names;
+
+    	ProfilerThreadBuffer* getThreadBuffer();
+    	ProfilerThreadBuffer* getBuffer(EventId id) const;
+    	ProfilerData makeCapture(ProfilerData::TimePoint start, ProfilerData::TimePoint end, Vector<ProfilerData::TimePoint> frameStartTimes);
     };
 
 	class ProfilerEvent {
@@ -160,6 +235,6 @@ namespace Halley {
 		ProfilerEvent& operator=(ProfilerEvent&& other) = delete;
 
 	private:
-		ProfilerCapture::EventId id;
+		ProfilerCapture::EventId id = 0;
 	};
 }
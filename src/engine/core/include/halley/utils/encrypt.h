@@ -12,5 +12,9 @@ namespace Halley {
 
 		static Bytes encryptAES(AESIV iv, AESKey key, const Bytes& data);
 		static Bytes decryptAES(AESIV iv, AESKey key, const Bytes& data);
+
+		// AES in counter mode, in place, for data that starts at the given offset of a stream. Encrypting and decrypting are the same operation.
+		// The counter block is the nonce followed by the block index, so any part of the stream can be processed independently.
+		static void xcryptAESCTR(AESKey key, uint64_t nonce, uint64_t offset, gsl::span<gsl::byte> data);
 	};
 }
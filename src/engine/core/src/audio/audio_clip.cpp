@@ -9,6 +9,13 @@
 
 using namespace Halley;
 
+namespace {
+	// Streamed data is decoded when channel 0 is read, and the remaining channels are then read from here.
+	// This is per thread, so that voices playing different clips can be rendered concurrently.
+	constexpr size_t streamBufferSamples = 4096;
+	thread_local std::array<Vector<AudioSample>, AudioConfig::maxChannels> streamBuffer;
+}
+
 AudioClip::AudioClip(uint8_t numChannels)
 	: numChannels(numChannels)
 {
@@ -90,22 +97,25 @@ size_t AudioClip::copyChannelData(size_t channelN, size_t pos, size_t len, float
 
 	if (streaming) {
 		// NB: this assumes the channels will be read in order.
+		auto& buffer = streamBuffer;
 		if (channelN == 0) {
-			if (buffer.size() != numChannels) {
-				buffer.resize(numChannels);
-			}
-			for (auto& b: buffer) {
-				if (b.size() <= len) {
-					b.resize(len);
+			AudioMultiChannelSamples channels;
+			for (size_t i = 0; i < numChannels; ++i) {
+				if (buffer[i].size() < len) {
+					buffer[i].resize(len); // Only if the thread wasn't prepared, or for unusually large reads
 				}
+				channels[i] = AudioSamples(buffer[i]).subspan(0, len); // The decoder reads as many samples as fit here
 			}
 
+			// Voices sharing this clip are rendered on the same thread, so this is normally uncontended. It only guards against
+			// a voice starting this clip mid-render (e.g. the next track of a sequence) while another thread plays it.
+			std::unique_lock<std::mutex> lock(streamMutex);
 			auto* vorbis = getVorbisData(pos);
 			if (vorbis) {
-				vorbis->read(buffer);
+				vorbis->read(channels, numChannels);
 			} else {
-				for (auto& b : buffer) {
-					AudioMixer::zero(b);
+				for (size_t i = 0; i < numChannels; ++i) {
+					AudioMixer::zero(channels[i]);
 				}
 			}
 			streamPos = pos + len;
@@ -118,6 +128,20 @@ size_t AudioClip::copyChannelData(size_t channelN, size_t pos, size_t len, float
 	return len;
 }
 
+bool AudioClip::hasSharedPlaybackState() const
+{
+	return streaming;
+}
+
+void AudioClip::prepareRenderThread()
+{
+	for (auto& b: streamBuffer) {
+		if (b.size() < streamBufferSamples) {
+			b.resize(streamBufferSamples);
+		}
+	}
+}
+
 VorbisData* AudioClip::getVorbisData(size_t targetPos) const
 {
 	// This chooses which of the two vorbis data readers to use. This allows two simultaneous reads of the stream without insane seeking, needed for self-overlapping music loops.
@@ -181,9 +205,6 @@ ResourceMemoryUsage AudioClip::getMemoryUsage() const
 	for (auto& s: samples) {
 		result.ramUsage += s.byte_span().size();
 	}
-	for (auto& b: buffer) {
-		result.ramUsage += b.byte_span().size();
-	}
 	result.ramUsage += sizeof(*this);
 
 	return result;
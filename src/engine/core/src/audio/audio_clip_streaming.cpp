@@ -120,6 +120,24 @@ size_t AudioClipStreaming::copyChannelData(size_t channelN, size_t pos, size_t l
 	return len;
 }
 
+void AudioClipStreaming::skipChannelData(size_t channelN, size_t pos, size_t len) const
+{
+	if (paused) {
+		return;
+	}
+
+	auto& buffer = buffers[channelN];
+
+	std::unique_lock<std::mutex> lock(mutex);
+	const size_t toSkip = std::min(len, buffer.availableToRead());
+	if (channelN == 0) {
+		samplesLeft -= toSkip;
+	}
+	lock.unlock();
+
+	buffer.skip(toSkip);
+}
+
 uint8_t AudioClipStreaming::getNumberOfChannels() const
 {
 	return numChannels;
@@ -0,0 +1,84 @@
+#include "audio_command_queue.h"
+
+#include <gsl/assert>
+
+using namespace Halley;
+
+static_assert(std::is_trivially_copyable_v<AudioCommand>);
+
+AudioCommandQueue::AudioCommandQueue(size_t capacity)
+	: slots(std::make_unique<Slot[]>(capacity))
+	, mask(capacity - 1)
+	, readPos(0)
+	, publishedPos(0)
+{
+	Expects(capacity > 0 && (capacity & (capacity - 1)) == 0);
+}
+
+void AudioCommandQueue::push(const AudioCommand& command, std::shared_ptr<const void> resource)
+{
+	Expects(command.type != AudioCommandType::Callback);
+	write(Slot{ command, std::move(resource), {} });
+}
+
+void AudioCommandQueue::push(std::function<void()> callback)
+{
+	write(Slot{ AudioCommand(), {}, std::move(callback) });
+}
+
+bool AudioCommandQueue::publish()
+{
+	releaseConsumed();
+
+	const size_t capacity = mask + 1;
+	while (overflowStart < overflow.size() && writePos - releasedPos < capacity) {
+		slots[writePos & mask] = std::move(overflow[overflowStart++]);
+		++writePos;
+	}
+	if (overflowStart == overflow.size()) {
+		overflow.clear();
+		overflowStart = 0;
+	}
+
+	publishedPos.store(writePos, std::memory_order_release);
+	return overflow.empty();
+}
+
+void AudioCommandQueue::clear()
+{
+	for (size_t i = 0; i <= mask; ++i) {
+		slots[i] = Slot();
+	}
+	overflow.clear();
+	overflowStart = 0;
+	writePos = 0;
+	releasedPos = 0;
+	readPos.store(0);
+	publishedPos.store(0);
+}
+
+void AudioCommandQueue::write(Slot slot)
+{
+	const size_t capacity = mask + 1;
+	if (writePos - releasedPos >= capacity) {
+		releaseConsumed();
+	}
+	if (overflow.empty() && writePos - releasedPos < capacity) {
+		slots[writePos & mask] = std::move(slot);
+		++writePos;
+	} else {
+		overflow.push_back(std::move(slot));
+	}
+}
+
+void AudioCommandQueue::releaseConsumed()
+{
+	// Drop whatever the consumed commands were holding on to, so it's freed here rather than on the audio thread.
+	// Slots are only reused once released, so this never touches anything the consumer hasn't seen yet.
+	const size_t consumed = readPos.load(std::memory_order_acquire);
+	for (; releasedPos < consumed; ++releasedPos) {
+		auto& slot = slots[releasedPos & mask];
+		slot.resource.reset();
+		slot.callback = {};
+	}
+}
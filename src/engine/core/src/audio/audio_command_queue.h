@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "halley/api/audio_api.h"
+#include "halley/audio/audio_fade.h"
+#include "halley/audio/audio_position.h"
+
+namespace Halley {
+	enum class AudioCommandType : uint8_t {
+		Callback,
+		CreateEmitter,
+		DestroyEmitter,
+		DetachEmitter,
+		SetEmitterPosition,
+		SetEmitterGain,
+		SetEmitterRegion,
+		PostEvent,
+		PlayClip,
+		PlayObject,
+		SetVoicesGain,
+		PlayVoices,
+		StopVoices,
+		PauseVoices,
+		ResumeVoices,
+		CreateRegion,
+		DestroyRegion,
+		SetMasterGain
+	};
+
+	// A single command for the audio thread. Which fields are used depends on the type.
+	// Anything that needs ownership (clips, objects, events) goes in the resource that's queued alongside it.
+	struct AudioCommand {
+		AudioCommandType type = AudioCommandType::Callback;
+		bool flag = false;
+		AudioEmitterId emitterId = 0;
+		AudioEventId eventId = 0;
+		AudioRegionId regionId = 0;
+		float gain = 1.0f;
+		AudioFade fade;
+		AudioPosition::Compact position;
+		const void* pointer = nullptr;
+	};
+
+	// Single producer, single consumer queue of commands from the game thread to the audio thread.
+	// Commands are written to fixed slots and only become visible to the audio thread on publish(). Payloads that don't
+	// fit a command can still be sent as a std::function, at the cost of an allocation.
+	// Slots are only ever cleared by the producer, so the audio thread never frees anything a command holds.
+	class AudioCommandQueue {
+	public:
+		explicit AudioCommandQueue(size_t capacity);
+
+		void push(const AudioCommand& command, std::shared_ptr<const void> resource = {});
+		void push(std::function<void()> callback);
+
+		// Makes everything pushed so far visible to the consumer. Returns false if some of it didn't fit yet.
+		bool publish();
+
+		// Only safe when the consumer isn't running
+		void clear();
+
+		template <typename F>
+		void consume(F f)
+		{
+			const size_t end = publishedPos.load(std::memory_order_acquire);
+			for (size_t pos = readPos.load(std::memory_order_relaxed); pos != end; ++pos) {
+				auto& slot = slots[pos & mask];
+				try {
+					if (slot.command.type == AudioCommandType::Callback) {
+						slot.callback();
+					} else {
+						f(slot.command, slot.resource);
+					}
+				} catch (...) {
+					readPos.store(pos + 1, std::memory_order_release);
+					throw;
+				}
+			}
+			readPos.store(end, std::memory_order_release);
+		}
+
+	private:
+		struct Slot {
+			AudioCommand command;
+			std::shared_ptr<const void> resource;
+			std::function<void()> callback;
+		};
+
+		std::unique_ptr<Slot[]> slots;
+		size_t mask;
+
+		alignas(64) std::atomic<size_t> readPos;
+		alignas(64) std::atomic<size_t> publishedPos;
+
+		alignas(64) size_t writePos = 0;
+		size_t releasedPos = 0;
+		Vector<Slot> overflow;
+		size_t overflowStart = 0;
+
+		void write(Slot slot);
+		void releaseConsumed();
+	};
+}
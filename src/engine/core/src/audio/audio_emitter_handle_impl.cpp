@@ -1,5 +1,6 @@
 #include "audio_emitter_handle_impl.h"
 
+#include "audio_command_queue.h"
 #include "audio_engine.h"
 #include "halley/audio/audio_facade.h"
 
@@ -15,22 +16,11 @@ AudioEmitterHandleImpl::AudioEmitterHandleImpl(AudioFacade& facade, AudioEmitter
 
 AudioEmitterHandleImpl::~AudioEmitterHandleImpl()
 {
-	AudioEngine* engine = facade.engine.get();
-	const auto emId = id;
-	const bool isDetached = detached;
-
 	if (owning) {
-		facade.enqueue([=] ()
-		{
-			if (isDetached) {
-				auto* e = engine->getEmitter(emId);
-				if (e) {
-					e->makeTemporary();
-				}
-			} else {
-				engine->destroyEmitter(emId);
-			}
-		});
+		AudioCommand command;
+		command.type = detached ? AudioCommandType::DetachEmitter : AudioCommandType::DestroyEmitter;
+		command.emitterId = id;
+		facade.enqueue(command);
 	}
 }
 
@@ -74,49 +64,26 @@ void AudioEmitterHandleImpl::setVariable(String variableId, float value)
 
 void AudioEmitterHandleImpl::setPosition(AudioPosition position)
 {
-	AudioEngine* engine = facade.engine.get();
-	const auto emId = id;
-
 	this->position = position;
-
-	facade.enqueue([=] ()
-	{
-		auto* em = engine->getEmitter(emId);
-		if (em) {
-			em->setPosition(position);
-		}
-	});
+	facade.enqueueSetPosition(id, position);
 }
 
 void AudioEmitterHandleImpl::setGain(float gain)
 {
-	AudioEngine* engine = facade.engine.get();
-	const auto emId = id;
-
-	facade.enqueue([=] ()
-	{
-		auto* em = engine->getEmitter(emId);
-		if (em) {
-			em->forVoices(0, [&] (AudioVoice& voice)
-			{
-				voice.setUserGain(gain);
-			});
-		}
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::SetEmitterGain;
+	command.emitterId = id;
+	command.gain = gain;
+	facade.enqueue(command);
 }
 
 void AudioEmitterHandleImpl::setRegion(AudioRegionId regionId)
 {
-	AudioEngine* engine = facade.engine.get();
-	const auto emId = id;
-
-	facade.enqueue([=] ()
-	{
-		auto* em = engine->getEmitter(emId);
-		if (em) {
-			em->setRegion(regionId);
-		}
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::SetEmitterRegion;
+	command.emitterId = id;
+	command.regionId = regionId;
+	facade.enqueue(command);
 }
 
 AudioPosition AudioEmitterHandleImpl::getPosition() const
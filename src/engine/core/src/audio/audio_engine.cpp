@@ -6,6 +6,7 @@
 #include "audio_filter_resample.h"
 #include "halley/support/debug.h"
 #include "halley/resources/resources.h"
+#include "halley/audio/audio_clip.h"
 #include "halley/audio/audio_event.h"
 #include "halley/support/logger.h"
 #include "halley/api/audio_api.h"
@@ -17,6 +18,12 @@
 
 using namespace Halley;
 
+namespace {
+	// Set while a voice is being rendered, so that sources get that voice's RNG and the pool belonging to the current thread
+	thread_local AudioBufferPool* threadPool = nullptr;
+	thread_local AudioVoice* threadVoice = nullptr;
+}
+
 AudioEngine::AudioEngine()
 	: pool(std::make_unique<AudioBufferPool>())
 	, audioOutputBuffer(4096 * 8)
@@ -31,6 +38,7 @@ AudioEngine::AudioEngine()
 
 AudioEngine::~AudioEngine()
 {
+	renderWorkers.reset();
 }
 
 void AudioEngine::createEmitter(AudioEmitterId id, AudioPosition position, bool temporary)
@@ -169,9 +177,111 @@ AudioRegion* AudioEngine::getRegion(AudioRegionId id)
 	return iter->second.get();
 }
 
-Vector<AudioEventId> AudioEngine::getFinishedSounds()
+gsl::span<const AudioEventId> AudioEngine::getFinishedSounds() const
+{
+	return finishedSounds;
+}
+
+void AudioEngine::consumeFinishedSounds(size_t n)
 {
-	return std::move(finishedSounds);
+	finishedSounds.erase(finishedSounds.begin(), finishedSounds.begin() + n);
+}
+
+void AudioEngine::runCommand(const AudioCommand& command, const std::shared_ptr<const void>& resource)
+{
+	auto forEventVoices = [&] (auto f)
+	{
+		if (auto* emitter = getEmitter(command.emitterId)) {
+			for (auto& v: emitter->getVoices()) {
+				if (v->getEventId() == command.eventId) {
+					f(*v);
+				}
+			}
+		}
+	};
+
+	switch (command.type) {
+	case AudioCommandType::CreateEmitter:
+		commandPosition.setFromCompact(command.position);
+		createEmitter(command.emitterId, commandPosition, command.flag);
+		break;
+
+	case AudioCommandType::DestroyEmitter:
+		destroyEmitter(command.emitterId);
+		break;
+
+	case AudioCommandType::DetachEmitter:
+		if (auto* emitter = getEmitter(command.emitterId)) {
+			emitter->makeTemporary();
+		}
+		break;
+
+	case AudioCommandType::SetEmitterPosition:
+		if (auto* emitter = getEmitter(command.emitterId)) {
+			commandPosition.setFromCompact(command.position);
+			emitter->setPosition(commandPosition);
+		}
+		break;
+
+	case AudioCommandType::SetEmitterGain:
+		if (auto* emitter = getEmitter(command.emitterId)) {
+			emitter->forVoices(0, [&] (AudioVoice& v) { v.setUserGain(command.gain); });
+		}
+		break;
+
+	case AudioCommandType::SetEmitterRegion:
+		if (auto* emitter = getEmitter(command.emitterId)) {
+			emitter->setRegion(command.regionId);
+		}
+		break;
+
+	case AudioCommandType::PostEvent:
+		postEvent(command.eventId, *static_cast<const AudioEvent*>(command.pointer), command.emitterId);
+		break;
+
+	case AudioCommandType::PlayClip:
+		play(command.eventId, std::static_pointer_cast<const IAudioClip>(resource), command.emitterId, command.gain, command.flag, command.fade);
+		break;
+
+	case AudioCommandType::PlayObject:
+		play(command.eventId, std::static_pointer_cast<const AudioObject>(resource), command.emitterId, command.gain, command.fade);
+		break;
+
+	case AudioCommandType::SetVoicesGain:
+		forEventVoices([&] (AudioVoice& v) { v.setUserGain(command.gain); });
+		break;
+
+	case AudioCommandType::PlayVoices:
+		forEventVoices([&] (AudioVoice& v) { v.play(command.fade); });
+		break;
+
+	case AudioCommandType::StopVoices:
+		forEventVoices([&] (AudioVoice& v) { v.stop(command.fade); });
+		break;
+
+	case AudioCommandType::PauseVoices:
+		forEventVoices([&] (AudioVoice& v) { v.pause(command.fade); });
+		break;
+
+	case AudioCommandType::ResumeVoices:
+		forEventVoices([&] (AudioVoice& v) { v.resume(command.fade); });
+		break;
+
+	case AudioCommandType::CreateRegion:
+		createRegion(command.regionId);
+		break;
+
+	case AudioCommandType::DestroyRegion:
+		destroyRegion(command.regionId);
+		break;
+
+	case AudioCommandType::SetMasterGain:
+		setMasterGain(command.gain);
+		break;
+
+	default:
+		throw Exception("Unknown audio command type", HalleyExceptions::AudioEngine);
+	}
 }
 
 void AudioEngine::start(AudioSpec s, AudioOutputAPI& o, const AudioProperties& audioProperties)
@@ -220,6 +330,7 @@ void AudioEngine::generateBuffer()
 
 	updateRegions();
 	updateBusGains();
+	AudioClip::prepareRenderThread(); // Only does anything the first time, as this thread also renders voices
 
 	const size_t targetSamples = bufferSizeController ? bufferSizeController->getTargetSamples() : spec.bufferSize;
 	const size_t samplesToRead = alignDown(targetSamples * 48000 / spec.sampleRate, static_cast<size_t>(16));
@@ -337,12 +448,17 @@ bool AudioEngine::needsMoreAudio()
 
 Random& AudioEngine::getRNG()
 {
-	return rng;
+	return threadVoice ? threadVoice->getRNG() : rng;
+}
+
+void AudioEngine::setRandomSeed(uint32_t seed)
+{
+	rng.setSeed(seed);
 }
 
 AudioBufferPool& AudioEngine::getPool() const
 {
-	return *pool;
+	return threadPool ? *threadPool : *pool;
 }
 
 void AudioEngine::setMasterGain(float gain)
@@ -364,14 +480,17 @@ void AudioEngine::mixVoices(size_t numSamples, size_t nChannels, AudioBuffersRef
 			if (!v->isPlaying() && !v->isDone() && v->isReady()) {
 				v->start();
 			}
-			// Render
 			if (v->isPlaying()) {
 				v->update(channels, e.second->getPosition(), listener, masterGain * getCompositeBusGain(v->getBus()));
-				v->render(numSamples, *pool);
 			}
 		}
 	}
 
+	// Decide which voices are worth rendering
+	updateVirtualVoices();
+
+	renderVoices(numSamples);
+
 	// Mix every region
 	for (auto& listenerRegion: listener.regions) {
 		auto& region = *regions.at(listenerRegion.regionId);
@@ -391,6 +510,237 @@ void AudioEngine::mixVoices(size_t numSamples, size_t nChannels, AudioBuffersRef
 	}
 }
 
+void AudioEngine::renderVoices(size_t numSamples)
+{
+	renderQueue.clear();
+	for (auto& e: emitters) {
+		for (auto& v: e.second->getVoices()) {
+			if (v->isPlaying()) {
+				renderQueue.push_back(v.get());
+			}
+		}
+	}
+	renderNumSamples = numSamples;
+
+	// Voices only touch their own state while rendering, and mixing happens afterwards in a fixed order, so the result doesn't depend on which thread rendered what
+	if (renderWorkers && renderQueue.size() > 1) {
+		groupRenderQueue();
+		renderWorkers->run(renderGroups.size(), *pool);
+	} else {
+		for (size_t i = 0; i < renderQueue.size(); ++i) {
+			renderVoice(i, *pool);
+		}
+	}
+}
+
+void AudioEngine::renderVoice(size_t idx, AudioBufferPool& voicePool)
+{
+	auto& voice = *renderQueue[idx];
+
+	threadPool = &voicePool;
+	threadVoice = &voice;
+	voice.render(renderNumSamples, voicePool);
+	threadPool = nullptr;
+	threadVoice = nullptr;
+}
+
+void AudioEngine::renderGroup(size_t idx, AudioBufferPool& voicePool)
+{
+	const auto [start, end] = renderGroups[idx];
+	for (size_t i = start; i < end; ++i) {
+		renderVoice(i, voicePool);
+	}
+}
+
+void AudioEngine::groupRenderQueue()
+{
+	// Voices playing the same streamed clip share its decoder, so they go in the same group instead of contending for it.
+	// All the vectors used here keep their capacity between buffers.
+	const auto n = static_cast<uint32_t>(renderQueue.size());
+	sharedClipVoices.clear();
+	for (uint32_t i = 0; i < n; ++i) {
+		sharedClips.clear();
+		renderQueue[i]->collectSharedClips(sharedClips);
+		for (const auto* clip: sharedClips) {
+			sharedClipVoices.emplace_back(clip, i);
+		}
+	}
+
+	renderGroups.clear();
+	if (sharedClipVoices.empty()) {
+		for (uint32_t i = 0; i < n; ++i) {
+			renderGroups.emplace_back(i, i + 1);
+		}
+		return;
+	}
+
+	// Union-find over voices, joining every pair of voices that share a clip
+	renderGroupRoots.resize(n);
+	for (uint32_t i = 0; i < n; ++i) {
+		renderGroupRoots[i] = i;
+	}
+	auto findRoot = [&] (uint32_t i)
+	{
+		while (renderGroupRoots[i] != i) {
+			renderGroupRoots[i] = renderGroupRoots[renderGroupRoots[i]];
+			i = renderGroupRoots[i];
+		}
+		return i;
+	};
+
+	std::sort(sharedClipVoices.begin(), sharedClipVoices.end(), [] (const auto& a, const auto& b)
+	{
+		return std::less<const IAudioClip*>()(a.first, b.first) || (a.first == b.first && a.second < b.second);
+	});
+	for (size_t i = 1; i < sharedClipVoices.size(); ++i) {
+		if (sharedClipVoices[i].first == sharedClipVoices[i - 1].first) {
+			const auto a = findRoot(sharedClipVoices[i - 1].second);
+			const auto b = findRoot(sharedClipVoices[i].second);
+			renderGroupRoots[std::max(a, b)] = std::min(a, b);
+		}
+	}
+
+	renderOrder.clear();
+	for (uint32_t i = 0; i < n; ++i) {
+		renderOrder.emplace_back(findRoot(i), renderQueue[i]);
+	}
+	std::stable_sort(renderOrder.begin(), renderOrder.end(), [] (const auto& a, const auto& b) { return a.first < b.first; });
+
+	for (uint32_t i = 0; i < n; ++i) {
+		renderQueue[i] = renderOrder[i].second;
+		if (i == 0 || renderOrder[i].first != renderOrder[i - 1].first) {
+			renderGroups.emplace_back(i, i + 1);
+		} else {
+			renderGroups.back().second = i + 1;
+		}
+	}
+}
+
+void AudioEngine::setRenderThreads(size_t nThreads, const AudioRenderWorkers::ThreadFactory& threadFactory)
+{
+	renderWorkers.reset();
+	if (nThreads > 0) {
+		renderWorkers = std::make_unique<AudioRenderWorkers>(nThreads, [this] (size_t idx, AudioBufferPool& voicePool)
+		{
+			renderGroup(idx, voicePool);
+		}, [] ()
+		{
+			AudioClip::prepareRenderThread();
+		}, threadFactory);
+	}
+}
+
+void AudioEngine::updateVirtualVoices()
+{
+	constexpr float minAudibility = 0.0001f;
+	constexpr float realVoiceBias = 1.25f; // Avoids voices of similar loudness from constantly swapping places
+
+	updateRegionAudibility();
+
+	voiceCandidates.clear();
+	for (auto& e: emitters) {
+		const float regionGain = getRegionAudibility(e.second->getRegion());
+		for (auto& v: e.second->getVoices()) {
+			if (!v->isPlaying()) {
+				continue;
+			}
+
+			const float audibility = v->getAudibility() * regionGain;
+			if (audibility < minAudibility) {
+				v->setVirtual(true);
+			} else if (!hasVoiceLimits) {
+				v->setVirtual(false);
+			} else {
+				voiceCandidates.push_back(VoiceCandidate{ v.get(), v->isVirtual() ? audibility : audibility * realVoiceBias, v->getPriority() });
+			}
+		}
+	}
+
+	if (voiceCandidates.empty()) {
+		return;
+	}
+
+	// Highest priority first, then loudest. Ties are broken by event id, so the choice is stable between buffers.
+	std::sort(voiceCandidates.begin(), voiceCandidates.end(), [] (const VoiceCandidate& a, const VoiceCandidate& b)
+	{
+		if (a.priority != b.priority) {
+			return a.priority > b.priority;
+		}
+		if (a.audibility != b.audibility) {
+			return a.audibility > b.audibility;
+		}
+		return a.voice->getEventId() < b.voice->getEventId();
+	});
+
+	for (auto& bus: buses) {
+		bus.voicesLeft = bus.maxVoices > 0 ? bus.maxVoices : std::numeric_limits<int>::max();
+	}
+
+	size_t nReal = 0;
+	for (auto& candidate: voiceCandidates) {
+		const bool real = (maxVoices == 0 || nReal < maxVoices) && tryAllocateBusVoice(candidate.voice->getBus());
+		candidate.voice->setVirtual(!real);
+		if (real) {
+			++nReal;
+		}
+	}
+}
+
+bool AudioEngine::tryAllocateBusVoice(uint8_t bus)
+{
+	// A voice counts towards the limit of its bus and of every ancestor
+	for (OptionalLite<uint8_t> cur = bus; cur && cur.value() < buses.size(); cur = buses[cur.value()].parent) {
+		if (buses[cur.value()].voicesLeft <= 0) {
+			return false;
+		}
+	}
+	for (OptionalLite<uint8_t> cur = bus; cur && cur.value() < buses.size(); cur = buses[cur.value()].parent) {
+		--buses[cur.value()].voicesLeft;
+	}
+	return true;
+}
+
+void AudioEngine::updateRegionAudibility()
+{
+	regionAudibility.clear();
+
+	auto addRegion = [&] (AudioRegionId id, float gain)
+	{
+		for (auto& r: regionAudibility) {
+			if (r.first == id) {
+				r.second = std::max(r.second, gain);
+				return;
+			}
+		}
+		regionAudibility.emplace_back(id, gain);
+	};
+
+	for (auto& listenerRegion: listener.regions) {
+		const auto iter = regions.find(listenerRegion.regionId);
+		if (iter == regions.end()) {
+			continue;
+		}
+
+		// Consider the previous gain too, as the mix will ramp from it
+		const auto& region = *iter->second;
+		const float gain = std::max(listenerRegion.presence, region.getPrevGain());
+		addRegion(region.getId(), gain);
+		for (auto& neighbour: region.getNeighbours()) {
+			addRegion(neighbour.props.id, gain * neighbour.props.attenuation);
+		}
+	}
+}
+
+float AudioEngine::getRegionAudibility(AudioRegionId regionId) const
+{
+	for (auto& r: regionAudibility) {
+		if (r.first == regionId) {
+			return r.second;
+		}
+	}
+	return 0.0f;
+}
+
 void AudioEngine::mixMainRegion(size_t numSamples, size_t nChannels, AudioRegion& region, AudioBuffersRef& outputBuffers, float prevGain, float gain)
 {
 	mixRegion(region, outputBuffers, prevGain, gain);
@@ -534,6 +884,9 @@ void AudioEngine::loadBuses()
 	buses.clear();
 	buses.reserve(countBuses(audioProperties->getBuses()));
 
+	maxVoices = static_cast<size_t>(std::max(audioProperties->getMaxVoices(), 0));
+	hasVoiceLimits = maxVoices > 0;
+
 	for (const auto& bus: audioProperties->getBuses()) {
 		loadBus(bus, OptionalLite<uint8_t>{});
 	}
@@ -550,6 +903,8 @@ uint8_t AudioEngine::loadBus(const AudioBusProperties& bus, OptionalLite<uint8_t
 {
 	const auto id = static_cast<uint8_t>(buses.size());
 	buses.push_back(BusData{ bus.getId(), 1.0f, 1.0f, parent });
+	buses[id].maxVoices = bus.getMaxVoices();
+	hasVoiceLimits = hasVoiceLimits || bus.getMaxVoices() > 0;
 	for (const auto& child: bus.getChildren()) {
 		buses[id].children.push_back(loadBus(child, id));
 	}
@@ -570,6 +925,22 @@ int64_t AudioEngine::getLastTimeElapsed()
 	return lastTimeElapsed.exchange(0);
 }
 
+AudioEngine::VoiceCounts AudioEngine::getVoiceCounts() const
+{
+	VoiceCounts result;
+	for (auto& e: emitters) {
+		for (auto& v: e.second->getVoices()) {
+			if (v->isPlaying()) {
+				++result.playing;
+				if (v->isVirtual()) {
+					++result.virtualised;
+				}
+			}
+		}
+	}
+	return result;
+}
+
 void AudioEngine::setBufferSizeController(std::shared_ptr<IAudioBufferSizeController> controller)
 {
 	bufferSizeController = std::move(controller);
@@ -635,6 +1006,7 @@ std::unique_ptr<AudioVoice> AudioEngine::makeObjectVoice(const AudioObject& obje
 
 	voice->setIds(uniqueId, object.getAudioObjectId());
 	voice->setAttenuationOverride(object.getAttenuationOverride());
+	voice->setPriority(object.getPriority());
 
 	return voice;
 }
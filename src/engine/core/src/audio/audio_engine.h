@@ -10,6 +10,8 @@
 #include "halley/data_structures/vector.h"
 
 #include "audio_voice.h"
+#include "audio_command_queue.h"
+#include "audio_render_workers.h"
 #include "halley/audio/audio_event.h"
 #include "halley/audio/resampler.h"
 #include "halley/data_structures/hash_map.h"
@@ -29,6 +31,11 @@ namespace Halley {
     {
     public:
 		using VoiceCallback = std::function<void(AudioVoice&)>;
+
+		struct VoiceCounts {
+			size_t playing = 0;
+			size_t virtualised = 0;
+		};
     	
 	    AudioEngine();
 		~AudioEngine();
@@ -51,7 +58,10 @@ namespace Halley {
 
 		AudioEmitter* getEmitter(AudioEmitterId id);
 		AudioRegion* getRegion(AudioRegionId id);
-		Vector<AudioEventId> getFinishedSounds();
+		gsl::span<const AudioEventId> getFinishedSounds() const;
+		void consumeFinishedSounds(size_t n);
+
+		void runCommand(const AudioCommand& command, const std::shared_ptr<const void>& resource);
 
 		void run();
 		void start(AudioSpec spec, AudioOutputAPI& out, const AudioProperties& audioProperties);
@@ -63,6 +73,7 @@ namespace Halley {
 		void generateBuffer();
 	    
     	Random& getRNG() override;
+		void setRandomSeed(uint32_t seed);
 		AudioBufferPool& getPool() const override;
 
 		void setMasterGain(float gain);
@@ -72,9 +83,13 @@ namespace Halley {
 		void getBusIds(const String& busName, Vector<int>& busIds);
 
 		int64_t getLastTimeElapsed();
+		VoiceCounts getVoiceCounts() const;
 
     	void setBufferSizeController(std::shared_ptr<IAudioBufferSizeController> controller);
 
+		// Renders voices on nThreads additional threads. The output is identical to rendering them all on the audio thread.
+		void setRenderThreads(size_t nThreads, const AudioRenderWorkers::ThreadFactory& threadFactory);
+
     	void setGenerateDebugData(bool enabled);
 		std::optional<AudioDebugData> getDebugData() const;
 
@@ -87,6 +102,14 @@ namespace Halley {
 			float compositeGain = 1;
 			OptionalLite<uint8_t> parent;
 			Vector<uint8_t> children;
+			int maxVoices = 0;
+			int voicesLeft = 0;
+		};
+
+		struct VoiceCandidate {
+			AudioVoice* voice;
+			float audibility;
+			int priority;
 		};
 
 		struct PlayingObjectData {
@@ -121,12 +144,35 @@ namespace Halley {
 
     	Vector<uint32_t> finishedSounds;
 		Vector<PlayingObjectData> playingObjectData;
+		AudioPosition commandPosition;
+
+		size_t maxVoices = 0;
+		bool hasVoiceLimits = false;
+		Vector<VoiceCandidate> voiceCandidates;
+		Vector<std::pair<AudioRegionId, float>> regionAudibility;
+
+		std::unique_ptr<AudioRenderWorkers> renderWorkers;
+		Vector<AudioVoice*> renderQueue;
+		Vector<std::pair<uint32_t, uint32_t>> renderGroups; // Ranges of renderQueue, each rendered in one go by a single thread
+		Vector<std::pair<const IAudioClip*, uint32_t>> sharedClipVoices;
+		Vector<const IAudioClip*> sharedClips;
+		Vector<uint32_t> renderGroupRoots;
+		Vector<std::pair<uint32_t, AudioVoice*>> renderOrder;
+		size_t renderNumSamples = 0;
 
 		std::shared_ptr<IAudioBufferSizeController> bufferSizeController;
 
 		bool debugDataEnabled = false;
 
 		void mixVoices(size_t numSamples, size_t channels, AudioBuffersRef& buffers);
+		void renderVoices(size_t numSamples);
+		void renderVoice(size_t idx, AudioBufferPool& voicePool);
+		void renderGroup(size_t idx, AudioBufferPool& voicePool);
+		void groupRenderQueue();
+		void updateVirtualVoices();
+		void updateRegionAudibility();
+		float getRegionAudibility(AudioRegionId regionId) const;
+		bool tryAllocateBusVoice(uint8_t bus);
 		void mixMainRegion(size_t numSamples, size_t nChannels, AudioRegion& region, AudioBuffersRef& outputBuffers, float prevGain, float gain);
 		void mixRegion(const AudioRegion& region, AudioBuffersRef& buffers, float prevGain, float gain);
 
@@ -1,5 +1,6 @@
 #include "halley/audio/audio_facade.h"
 
+#include "audio_command_queue.h"
 #include "audio_emitter_handle_impl.h"
 #include "audio_engine.h"
 #include "audio_handle_impl.h"
@@ -14,14 +15,13 @@ using namespace Halley;
 
 namespace {
 	// The command queue is filled every update, and only drained when the audio thread runs.
-	// Therefore its size must be > (logicFPS / audioFPS).
-	// Because audio can run as low as 10 fps (for a >4096 sample buffer), and logic could conceivably be over 1000 fps,
-	// this should be at least 100. Here I choose 256 as a safe number.
-	constexpr size_t commandQueueSize = 256;
+	// Audio can run as low as 10 fps (for a >4096 sample buffer), so this has to hold several frames' worth of commands.
+	// If it does fill up, commands are held back on the game thread until there's space, rather than dropped.
+	constexpr size_t commandQueueSize = 8192;
 
 	// These, on the other hand, flow the other direction, so they can be much more relaxed
 	constexpr size_t exceptionQueueSize = 16;
-	constexpr size_t finishedSoundsQueueSize = 16;
+	constexpr size_t finishedSoundsQueueSize = 1024;
 	constexpr size_t debugInfoQueueSize = 16;
 }
 
@@ -30,7 +30,7 @@ AudioFacade::AudioFacade(AudioOutputAPI& o, SystemAPI& system)
 	, system(system)
 	, running(false)
 	, started(false)
-	, commandQueue(commandQueueSize)
+	, commandQueue(std::make_unique<AudioCommandQueue>(commandQueueSize))
 	, exceptions(exceptionQueueSize)
 	, finishedSoundsQueue(finishedSoundsQueueSize)
 	, ownAudioThread(o.needsAudioThread())
@@ -121,6 +121,7 @@ void AudioFacade::stopPlayback()
 		pausePlayback();
 		musicTracks.clear();
 		engine.reset();
+		commandQueue->clear();
 		output.closeAudioDevice();
 		started = false;
 	}
@@ -134,6 +135,7 @@ void AudioFacade::resumePlayback()
 		}
 
 		engine->start(audioSpec, output, getAudioProperties());
+		applyRenderThreads(renderThreads);
 		running = true;
 
 		if (ownAudioThread) {
@@ -195,14 +197,27 @@ void AudioFacade::setDebugListener(IAudioDebugDataListener* listener)
 	});
 }
 
+void AudioFacade::setRenderThreads(size_t nThreads)
+{
+	renderThreads = nThreads;
+	enqueue([this, nThreads]() {
+		applyRenderThreads(nThreads);
+	});
+}
+
+void AudioFacade::applyRenderThreads(size_t nThreads)
+{
+	engine->setRenderThreads(nThreads, [this] (const String& name, std::function<void()> runnable)
+	{
+		return system.createThread(name, ThreadPriority::VeryHigh, std::move(runnable));
+	});
+}
 
 AudioEmitterHandle AudioFacade::createEmitter(AudioPosition position)
 {
 	const auto emitterId = curEmitterId++;
 
-	enqueue([=]() {
-		engine->createEmitter(emitterId, position, false);
-	});
+	enqueueCreateEmitter(emitterId, position, false);
 
 	return std::make_shared<AudioEmitterHandleImpl>(*this, emitterId, position, true);
 }
@@ -216,9 +231,10 @@ AudioRegionHandle AudioFacade::createRegion(const String& name)
 {
 	const auto regionId = curRegionId++;
 
-	enqueue([=]() {
-		engine->createRegion(regionId);
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::CreateRegion;
+	command.regionId = regionId;
+	enqueue(command);
 
 	regionNames[regionId] = name;
 
@@ -265,9 +281,12 @@ AudioHandle AudioFacade::doPostEvent(const AudioEvent& event, AudioEmitterId emi
 {
 	const auto id = curEventId++;
 
-	enqueue([=, &event]() {
-		engine->postEvent(id, event, emitterId);
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::PostEvent;
+	command.eventId = id;
+	command.emitterId = emitterId;
+	command.pointer = &event;
+	enqueue(command);
 	playingSounds.push_back(id);
 
 	return std::make_shared<AudioHandleImpl>(*this, id, emitterId);
@@ -290,9 +309,14 @@ AudioHandle AudioFacade::play(std::shared_ptr<const IAudioClip> clip, AudioEmitt
 	uint32_t id = curEventId++;
 	const auto emitterId = emitter ? emitter->getId() : 0;
 
-	enqueue([=] () {
-		engine->play(id, clip, emitterId, volume, loop, fade);
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::PlayClip;
+	command.eventId = id;
+	command.emitterId = emitterId;
+	command.gain = volume;
+	command.flag = loop;
+	command.fade = fade;
+	enqueue(command, std::move(clip));
 	playingSounds.push_back(id);
 
 	return std::make_shared<AudioHandleImpl>(*this, id, emitterId);
@@ -303,9 +327,13 @@ AudioHandle AudioFacade::play(std::shared_ptr<const AudioObject> audioObject, Au
 	uint32_t id = curEventId++;
 	const auto emitterId = emitter ? emitter->getId() : 0;
 
-	enqueue([=] () {
-		engine->play(id, audioObject, emitterId, volume, fade);
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::PlayObject;
+	command.eventId = id;
+	command.emitterId = emitterId;
+	command.gain = volume;
+	command.fade = fade;
+	enqueue(command, std::move(audioObject));
 	playingSounds.push_back(id);
 
 	return std::make_shared<AudioHandleImpl>(*this, id, emitterId);
@@ -317,11 +345,15 @@ AudioHandle AudioFacade::postEvent(const String& name, AudioPosition position)
 	const auto emitterId = curEmitterId++;
 
 	if (resources->exists<AudioEvent>(name)) {
-		const auto event = resources->get<AudioEvent>(name);
-		enqueue([=]() {
-			engine->createEmitter(emitterId, position, true);
-			engine->postEvent(id, *event, emitterId);
-		});
+		auto event = resources->get<AudioEvent>(name);
+		enqueueCreateEmitter(emitterId, position, true);
+
+		AudioCommand command;
+		command.type = AudioCommandType::PostEvent;
+		command.eventId = id;
+		command.emitterId = emitterId;
+		command.pointer = event.get();
+		enqueue(command, std::move(event));
 	} else {
 		Logger::logError("Unknown audio event: \"" + name + "\"");
 	}
@@ -335,10 +367,15 @@ AudioHandle AudioFacade::play(std::shared_ptr<const IAudioClip> clip, AudioPosit
 	uint32_t id = curEventId++;
 	const auto emitterId = curEmitterId++;
 
-	enqueue([=] () {
-		engine->createEmitter(emitterId, position, true);
-		engine->play(id, clip, emitterId, volume, loop, {});
-	});
+	enqueueCreateEmitter(emitterId, position, true);
+
+	AudioCommand command;
+	command.type = AudioCommandType::PlayClip;
+	command.eventId = id;
+	command.emitterId = emitterId;
+	command.gain = volume;
+	command.flag = loop;
+	enqueue(command, std::move(clip));
 	playingSounds.push_back(id);
 	return std::make_shared<AudioHandleImpl>(*this, id, emitterId);
 }
@@ -383,9 +420,10 @@ void AudioFacade::stopAllMusic(float fadeOutTime)
 
 void AudioFacade::setMasterVolume(float volume)
 {
-	enqueue([=] () {
-		engine->setMasterGain(volumeToGain(volume));
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::SetMasterGain;
+	command.gain = volumeToGain(volume);
+	enqueue(command);
 }
 
 void AudioFacade::setBusVolume(const String& busName, float volume)
@@ -454,11 +492,12 @@ void AudioFacade::stepAudio()
 			if (!running) {
 				return;
 			}
-			if (finishedSoundsQueue.canWrite(1)) {
-				auto finishedSounds = engine->getFinishedSounds();
-				if (!finishedSounds.empty()) {
-					finishedSoundsQueue.writeOne(std::move(finishedSounds));
-				}
+			// Anything that doesn't fit stays in the engine until the next step
+			const auto finished = engine->getFinishedSounds();
+			const size_t nFinished = std::min(size_t(finished.size()), finishedSoundsQueue.availableToWrite());
+			if (nFinished > 0) {
+				finishedSoundsQueue.write(finished.subspan(0, nFinished));
+				engine->consumeFinishedSounds(nFinished);
 			}
 
 			if (auto debugData = engine->getDebugData()) {
@@ -468,13 +507,10 @@ void AudioFacade::stepAudio()
 			}
 		}
 
-		while (commandQueue.canRead(1)) {
-			commandQueue.read(gsl::span<Vector<std::function<void()>>>(&inbox, 1));
-			for (auto& action: inbox) {
-				action();
-			}
-			inbox.clear();
-		}
+		commandQueue->consume([&] (const AudioCommand& command, const std::shared_ptr<const void>& resource)
+		{
+			engine->runCommand(command, resource);
+		});
 
 		if (ownAudioThread) {
 			engine->run();
@@ -489,7 +525,45 @@ void AudioFacade::stepAudio()
 void AudioFacade::enqueue(std::function<void()> action)
 {
 	if (running) {
-		outbox.push_back(std::move(action));
+		commandQueue->push(std::move(action));
+	}
+}
+
+void AudioFacade::enqueue(const AudioCommand& command, std::shared_ptr<const void> resource)
+{
+	if (running) {
+		commandQueue->push(command, std::move(resource));
+	}
+}
+
+void AudioFacade::enqueueCreateEmitter(AudioEmitterId emitterId, const AudioPosition& position, bool temporary)
+{
+	AudioCommand command;
+	if (position.toCompact(command.position)) {
+		command.type = AudioCommandType::CreateEmitter;
+		command.emitterId = emitterId;
+		command.flag = temporary;
+		enqueue(command);
+	} else {
+		enqueue([=] () {
+			engine->createEmitter(emitterId, position, temporary);
+		});
+	}
+}
+
+void AudioFacade::enqueueSetPosition(AudioEmitterId emitterId, const AudioPosition& position)
+{
+	AudioCommand command;
+	if (position.toCompact(command.position)) {
+		command.type = AudioCommandType::SetEmitterPosition;
+		command.emitterId = emitterId;
+		enqueue(command);
+	} else {
+		enqueue([=] () {
+			if (auto* emitter = engine->getEmitter(emitterId)) {
+				emitter->setPosition(position);
+			}
+		});
 	}
 }
 
@@ -506,17 +580,13 @@ void AudioFacade::pump()
 	}
 
 	if (running) {
-		if (!outbox.empty()) {
-			if (commandQueue.canWrite(1)) {
-				commandQueue.writeOne(std::move(outbox));
-				outbox.clear();
-			} else {
-				Logger::logError("Out of space on audio command queue.");
-			}
+		if (!commandQueue->publish()) {
+			Logger::logError("Out of space on audio command queue.");
 		}
 
-		while (finishedSoundsQueue.canRead(1)) {
-			auto finishedSounds = finishedSoundsQueue.readOne();
+		if (const size_t nFinished = finishedSoundsQueue.availableToRead(); nFinished > 0) {
+			finishedSounds.resize(nFinished);
+			finishedSoundsQueue.read(finishedSounds);
 			playingSounds.erase(std::remove_if(playingSounds.begin(), playingSounds.end(), [&] (uint32_t id) -> bool
 			{
 				return std::find(finishedSounds.begin(), finishedSounds.end(), id) != finishedSounds.end();
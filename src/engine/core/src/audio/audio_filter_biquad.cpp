@@ -1,6 +1,7 @@
 #include "halley/audio/audio_filter_biquad.h"
 
 #include "halley/audio/audio_buffer.h"
+#include "audio_mixer.h"
 
 using namespace Halley;
 
@@ -56,9 +57,16 @@ void AudioFilterBiquad::processSamples(AudioBuffersRef& buffers)
 
 void AudioFilterBiquad::processSamples(AudioBuffer& buffer, size_t channelNumber)
 {
-	for (auto& sample: buffer.samples.span()) {
-		sample = processSample(sample, channelNumber);
-	}
+	auto& cn = channels[channelNumber];
+	const float coefficients[] = { a1, a2, b0, b1, b2 };
+	float history[] = { cn.x1, cn.x2, cn.y1, cn.y2 };
+
+	AudioMixer::getKernels().biquad(buffer.samples.data(), buffer.samples.size(), coefficients, history);
+
+	cn.x1 = history[0];
+	cn.x2 = history[1];
+	cn.y1 = history[2];
+	cn.y2 = history[3];
 }
 
 void AudioFilterBiquad::clearHistory()
@@ -3,8 +3,8 @@
 
 using namespace Halley;
 
-AudioFilterResample::AudioFilterResample(std::shared_ptr<AudioSource> source, float fromHz, float toHz, AudioBufferPool& pool)
-	: pool(pool)
+AudioFilterResample::AudioFilterResample(std::shared_ptr<AudioSource> source, float fromHz, float toHz, AudioEnv& env)
+	: env(env)
 	, source(std::move(source))
 	, fromHz(fromHz)
 	, toHz(toHz)
@@ -36,6 +36,7 @@ bool AudioFilterResample::getAudioData(size_t numSamples, AudioMultiChannelSampl
 	}
 
 	// Read upstream data
+	auto& pool = env.getPool();
 	auto srcBuffers = pool.getBuffers(nChannels, numSamplesSrc);
 	auto srcs = srcBuffers.getSampleSpans();
 	bool playing = source->getAudioData(numSamplesSrc, srcs);
@@ -71,6 +72,21 @@ bool AudioFilterResample::getAudioData(size_t numSamples, AudioMultiChannelSampl
 	return playing;
 }
 
+bool AudioFilterResample::skipAudioData(size_t numSamples)
+{
+	const size_t nLeftOver = leftoverSamples[0].n;
+	const size_t samplesToSkip = numSamples >= nLeftOver ? numSamples - nLeftOver : 0;
+	const size_t numSamplesSrc = lroundl(samplesToSkip * fromHz / toHz);
+
+	// The resampler history no longer matches the source, so start over when rendering resumes
+	for (auto& leftOver: leftoverSamples) {
+		leftOver.n = 0;
+	}
+	resamplers.clear();
+
+	return source->skipAudioData(numSamplesSrc);
+}
+
 size_t AudioFilterResample::getSamplesLeft() const
 {
 	return lroundl(source->getSamplesLeft() * toHz / fromHz);
@@ -82,6 +98,11 @@ void AudioFilterResample::restart()
 	resamplers.clear();
 }
 
+void AudioFilterResample::collectSharedClips(Vector<const IAudioClip*>& dst) const
+{
+	source->collectSharedClips(dst);
+}
+
 void AudioFilterResample::setFromHz(float fromHz)
 {
 	this->fromHz = fromHz;
@@ -2,24 +2,27 @@
 #include "halley/audio/audio_source.h"
 #include "halley/audio/resampler.h"
 #include "halley/audio/audio_buffer.h"
+#include "halley/audio/audio_env.h"
 
 namespace Halley
 {
 	class AudioFilterResample final : public AudioSource
 	{
 	public:
-		AudioFilterResample(std::shared_ptr<AudioSource> source, float fromHz, float toHz, AudioBufferPool& pool);
+		AudioFilterResample(std::shared_ptr<AudioSource> source, float fromHz, float toHz, AudioEnv& env);
 
 		uint8_t getNumberOfChannels() const override;
 		bool isReady() const override;
 		bool getAudioData(size_t numSamples, AudioMultiChannelSamples dst) override;
+		bool skipAudioData(size_t numSamples) override;
 		size_t getSamplesLeft() const override;
 		void restart() override;
+		void collectSharedClips(Vector<const IAudioClip*>& dst) const override;
 
 		void setFromHz(float fromHz);
 
 	private:
-		AudioBufferPool& pool;
+		AudioEnv& env;
 		std::shared_ptr<AudioSource> source;
 		Vector<std::unique_ptr<AudioResampler>> resamplers;
 		float fromHz;
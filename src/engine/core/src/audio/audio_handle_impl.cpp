@@ -1,5 +1,6 @@
 #include "audio_handle_impl.h"
 #include "halley/audio/audio_facade.h"
+#include "audio_command_queue.h"
 #include "audio_engine.h"
 #include <algorithm>
 
@@ -16,10 +17,10 @@ void AudioHandleImpl::setGain(float gain)
 {
 	if (std::abs(gain - this->gain) > 0.00001f) {
 		this->gain = gain;
-		enqueueForVoices([gain] (AudioVoice& src)
-		{
-			src.setUserGain(gain);
-		});
+		AudioCommand command;
+		command.type = AudioCommandType::SetVoicesGain;
+		command.gain = gain;
+		enqueueForVoices(command);
 	}
 }
 
@@ -30,50 +31,44 @@ void AudioHandleImpl::setVolume(float volume)
 
 void AudioHandleImpl::setPosition(AudioPosition pos)
 {
-	enqueue([pos] (AudioEmitter& src)
-	{
-		src.setPosition(pos);
-	});
+	facade.enqueueSetPosition(emitterId, pos);
 }
 
 void AudioHandleImpl::setPan(float pan)
 {
-	enqueue([pan] (AudioEmitter& src)
-	{
-		src.setPosition(AudioPosition::makeUI(pan));
-	});
+	facade.enqueueSetPosition(emitterId, AudioPosition::makeUI(pan));
 }
 
 void AudioHandleImpl::play(const AudioFade& audioFade)
 {
-	enqueueForVoices([fade = audioFade](AudioVoice& src)
-	{
-		src.play(fade);
-	});	
+	AudioCommand command;
+	command.type = AudioCommandType::PlayVoices;
+	command.fade = audioFade;
+	enqueueForVoices(command);	
 }
 
 void AudioHandleImpl::stop(const AudioFade& audioFade)
 {
-	enqueueForVoices([fade = audioFade](AudioVoice& src)
-	{
-		src.stop(fade);
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::StopVoices;
+	command.fade = audioFade;
+	enqueueForVoices(command);
 }
 
 void AudioHandleImpl::pause(const AudioFade& audioFade)
 {
-	enqueueForVoices([fade = audioFade](AudioVoice& src)
-	{
-		src.pause(fade);
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::PauseVoices;
+	command.fade = audioFade;
+	enqueueForVoices(command);
 }
 
 void AudioHandleImpl::resume(const AudioFade& audioFade)
 {
-	enqueueForVoices([fade = audioFade](AudioVoice& src)
-	{
-		src.resume(fade);
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::ResumeVoices;
+	command.fade = audioFade;
+	enqueueForVoices(command);
 }
 
 void AudioHandleImpl::stop(float fadeTime)
@@ -109,31 +104,9 @@ bool AudioHandleImpl::isPlaying() const
 }
 
 
-void AudioHandleImpl::enqueue(std::function<void(AudioEmitter& src)> f)
-{
-	auto id = emitterId;
-	AudioEngine* engine = facade.engine.get();
-	facade.enqueue([id, engine, f = std::move(f)] () {
-		auto* emitter = engine->getEmitter(id);
-		if (emitter) {
-			f(*emitter);
-		}
-	});
-}
-
-void AudioHandleImpl::enqueueForVoices(std::function<void(AudioVoice& src)> f)
+void AudioHandleImpl::enqueueForVoices(AudioCommand command)
 {
-	auto id = emitterId;
-	auto evId = eventId;
-	AudioEngine* engine = facade.engine.get();
-	facade.enqueue([id, evId, engine, f = std::move(f)] () {
-		auto* emitter = engine->getEmitter(id);
-		if (emitter) {
-			for (auto& v: emitter->getVoices()) {
-				if (v->getEventId() == evId) {
-					f(*v);
-				}
-			}
-		}
-	});
+	command.emitterId = emitterId;
+	command.eventId = eventId;
+	facade.enqueue(command);
 }
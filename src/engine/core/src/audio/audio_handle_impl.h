@@ -1,12 +1,10 @@
 #pragma once
 #include "halley/api/audio_api.h"
-#include <functional>
 
 namespace Halley
 {
 	class AudioFacade;
-	class AudioEmitter;
-	class AudioVoice;
+	struct AudioCommand;
 
 	class AudioHandleImpl final : public IAudioHandle
 	{
@@ -32,7 +30,6 @@ namespace Halley
 		AudioEmitterId emitterId;
 		float gain = 1.0f;
 
-		void enqueue(std::function<void(AudioEmitter& src)> f);
-		void enqueueForVoices(std::function<void(AudioVoice& src)> f);
+		void enqueueForVoices(AudioCommand command);
 	};
 }
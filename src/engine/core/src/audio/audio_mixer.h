@@ -2,9 +2,23 @@
 #include <gsl/span>
 #include "halley/api/audio_api.h"
 #include "halley/audio/audio_buffer.h"
+#include "halley/text/enum_names.h"
+#include "audio_mixer_kernels.h"
 
 namespace Halley
 {
+	template <>
+	struct EnumNames<AudioMixerInstructionSet> {
+		constexpr std::array<const char*, 4> operator()() const {
+			return{{
+				"scalar",
+				"sse",
+				"avx2",
+				"neon"
+			}};
+		}
+	};
+
 	class AudioMixer
 	{
 	public:
@@ -22,5 +36,10 @@ namespace Halley
 		static void copy(AudioMultiChannelSamples dst, AudioMultiChannelSamples src, size_t nChannels = 8);
 		static void copy(AudioSamples dst, AudioSamples src);
 		static void copy(AudioSamples dst, AudioSamples src, float gainStart, float gainEnd);
+
+		static const AudioMixerKernels& getKernels();
+		static const AudioMixerKernels* getKernels(AudioMixerInstructionSet instructionSet); // nullptr if not supported on this CPU
+		static AudioMixerInstructionSet getBestInstructionSet();
+		static bool setInstructionSet(AudioMixerInstructionSet instructionSet);
 	};
 }
@@ -0,0 +1,22 @@
+// This file is built with AVX2 and FMA enabled, and must only be called into after checking that the CPU supports them.
+// Keep its includes down to the kernels, so nothing else gets compiled with those instructions.
+#include "audio_mixer_kernels.h"
+
+using namespace Halley;
+
+#ifdef __AVX2__
+
+const AudioMixerKernels* Halley::getAudioMixerKernelsAVX2()
+{
+	static constexpr AudioMixerKernels kernels = makeAudioMixerKernels<AudioSimdAVX2>(AudioMixerInstructionSet::AVX2);
+	return &kernels;
+}
+
+#else
+
+const AudioMixerKernels* Halley::getAudioMixerKernelsAVX2()
+{
+	return nullptr;
+}
+
+#endif
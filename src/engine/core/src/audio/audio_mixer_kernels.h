@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstddef>
+#include "audio_simd.h"
+
+namespace Halley {
+	enum class AudioMixerInstructionSet {
+		Scalar,
+		SSE,
+		AVX2,
+		NEON
+	};
+
+	// One set of these exists per instruction set, and AudioMixer picks the best one supported by the CPU at runtime
+	struct AudioMixerKernels {
+		AudioMixerInstructionSet instructionSet;
+		void (*mix)(const float* src, float* dst, size_t n, float gain0, float gain1);
+		void (*copy)(const float* src, float* dst, size_t n, float gain0, float gain1);
+		void (*compressRange)(float* samples, size_t n, float limit);
+		void (*interleaveStereo)(const float* left, const float* right, float* dst, size_t n);
+		void (*biquad)(float* samples, size_t n, const float* coefficients, float* history); // a1, a2, b0, b1, b2; x1, x2, y1, y2
+	};
+
+	// Defined in audio_mixer_avx.cpp, which is the only file built with AVX2 enabled. Returns nullptr if it wasn't.
+	const AudioMixerKernels* getAudioMixerKernelsAVX2();
+
+	namespace {
+		inline float lerpGain(float gain0, float gain1, float t)
+		{
+			return gain0 * (1 - t) + gain1 * t;
+		}
+
+		template <typename V, bool accumulate>
+		void applyGainKernel(const float* src, float* dst, size_t n, float gain0, float gain1)
+		{
+			constexpr size_t w = V::width;
+			const size_t nVec = n - n % w;
+			size_t i = 0;
+
+			if (gain0 == gain1) {
+				const auto gain = V::set1(gain0);
+				for (; i < nVec; i += w) {
+					if constexpr (accumulate) {
+						V::store(dst + i, V::madd(V::load(src + i), gain, V::load(dst + i)));
+					} else {
+						V::store(dst + i, V::mul(V::load(src + i), gain));
+					}
+				}
+				for (; i < n; ++i) {
+					dst[i] = (accumulate ? dst[i] : 0.0f) + src[i] * gain0;
+				}
+			} else {
+				// Same as lerp(gain0, gain1, i / n), with the sample indices kept in a register
+				const float scale = 1.0f / n;
+				const auto g0 = V::set1(gain0);
+				const auto g1 = V::set1(gain1);
+				const auto one = V::set1(1.0f);
+				const auto step = V::set1(static_cast<float>(w));
+				const auto sc = V::set1(scale);
+				auto idx = V::iota();
+				for (; i < nVec; i += w) {
+					const auto t = V::mul(idx, sc);
+					const auto gain = V::madd(g1, t, V::mul(g0, V::sub(one, t)));
+					if constexpr (accumulate) {
+						V::store(dst + i, V::madd(V::load(src + i), gain, V::load(dst + i)));
+					} else {
+						V::store(dst + i, V::mul(V::load(src + i), gain));
+					}
+					idx = V::add(idx, step);
+				}
+				for (; i < n; ++i) {
+					dst[i] = (accumulate ? dst[i] : 0.0f) + src[i] * lerpGain(gain0, gain1, i * scale);
+				}
+			}
+		}
+
+		template <typename V>
+		void compressRangeKernel(float* samples, size_t n, float limit)
+		{
+			constexpr size_t w = V::width;
+			const size_t nVec = n - n % w;
+			const auto maxVal = V::set1(limit);
+			const auto minVal = V::set1(-limit);
+
+			size_t i = 0;
+			for (; i < nVec; i += w) {
+				V::store(samples + i, V::max(minVal, V::min(V::load(samples + i), maxVal)));
+			}
+			for (; i < n; ++i) {
+				samples[i] = AudioSimdScalar::max(-limit, AudioSimdScalar::min(samples[i], limit));
+			}
+		}
+
+		template <typename V>
+		void interleaveStereoKernel(const float* left, const float* right, float* dst, size_t n)
+		{
+			constexpr size_t w = V::width;
+			const size_t nVec = n - n % w;
+
+			size_t i = 0;
+			for (; i < nVec; i += w) {
+				typename V::Reg lo;
+				typename V::Reg hi;
+				V::interleave(V::load(left + i), V::load(right + i), lo, hi);
+				V::store(dst + 2 * i, lo);
+				V::store(dst + 2 * i + w, hi);
+			}
+			for (; i < n; ++i) {
+				dst[2 * i] = left[i];
+				dst[2 * i + 1] = right[i];
+			}
+		}
+
+		inline void biquadDirect(float* samples, size_t n, const float* c, float& x1, float& x2, float& y1, float& y2)
+		{
+			for (size_t i = 0; i < n; ++i) {
+				const float x = samples[i];
+				const float y = c[2] * x + c[3] * x1 + c[4] * x2 - c[0] * y1 - c[1] * y2;
+				x2 = x1;
+				x1 = x;
+				y2 = y1;
+				y1 = y;
+				samples[i] = y;
+			}
+		}
+
+		template <typename V>
+		void biquadKernel(float* samples, size_t n, const float* c, float* history)
+		{
+			constexpr size_t w = V::width;
+			float x1 = history[0];
+			float x2 = history[1];
+			float y1 = history[2];
+			float y2 = history[3];
+
+			if constexpr (w == 1) {
+				biquadDirect(samples, n, c, x1, x2, y1, y2);
+			} else {
+				// Every output in a block of w samples is a linear combination of that block's inputs and of the history
+				// going into it, so work out those weights once, and then each block costs w + 4 multiply-adds.
+				// The columns are the block's inputs, followed by x1, x2, y1 and y2.
+				constexpr size_t nColumns = w + 4;
+				alignas(32) float weights[nColumns][w];
+				for (size_t j = 0; j < nColumns; ++j) {
+					float x[w + 2] = {};
+					float y[w + 2] = {};
+					if (j < w) {
+						x[j + 2] = 1;
+					} else if (j == w) {
+						x[1] = 1;
+					} else if (j == w + 1) {
+						x[0] = 1;
+					} else if (j == w + 2) {
+						y[1] = 1;
+					} else {
+						y[0] = 1;
+					}
+					for (size_t k = 0; k < w; ++k) {
+						y[k + 2] = c[2] * x[k + 2] + c[3] * x[k + 1] + c[4] * x[k] - c[0] * y[k + 1] - c[1] * y[k];
+						weights[j][k] = y[k + 2];
+					}
+				}
+
+				const size_t nVec = n - n % w;
+				for (size_t i = 0; i < nVec; i += w) {
+					// Only the last two terms depend on the previous block's output, so leave them for last
+					float* block = samples + i;
+					auto acc = V::mul(V::load(weights[w]), V::set1(x1));
+					acc = V::madd(V::load(weights[w + 1]), V::set1(x2), acc);
+					for (size_t j = 0; j < w; ++j) {
+						acc = V::madd(V::load(weights[j]), V::set1(block[j]), acc);
+					}
+					acc = V::madd(V::load(weights[w + 3]), V::set1(y2), acc);
+					acc = V::madd(V::load(weights[w + 2]), V::set1(y1), acc);
+
+					x2 = block[w - 2];
+					x1 = block[w - 1];
+					V::store(block, acc);
+					y2 = block[w - 2];
+					y1 = block[w - 1];
+				}
+
+				biquadDirect(samples + nVec, n - nVec, c, x1, x2, y1, y2);
+			}
+
+			history[0] = x1;
+			history[1] = x2;
+			history[2] = y1;
+			history[3] = y2;
+		}
+
+		template <typename V>
+		constexpr AudioMixerKernels makeAudioMixerKernels(AudioMixerInstructionSet instructionSet)
+		{
+			return AudioMixerKernels{
+				instructionSet,
+				&applyGainKernel<V, true>,
+				&applyGainKernel<V, false>,
+				&compressRangeKernel<V>,
+				&interleaveStereoKernel<V>,
+				&biquadKernel<V>
+			};
+		}
+	}
+}
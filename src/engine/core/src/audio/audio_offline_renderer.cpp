@@ -0,0 +1,256 @@
+#include "audio_offline_renderer.h"
+#include "audio_engine.h"
+#include "halley/audio/audio_event.h"
+#include "halley/audio/audio_object.h"
+#include "halley/support/exception.h"
+#include "halley/text/string_converter.h"
+#include "halley/time/stopwatch.h"
+
+using namespace Halley;
+
+AudioRenderScript& AudioRenderScript::add(double time, Action action)
+{
+	// Keep entries sorted by time, with ties in the order they were added
+	const auto iter = std::upper_bound(entries.begin(), entries.end(), time, [] (double t, const Entry& e) { return t < e.time; });
+	entries.insert(iter, Entry{ time, std::move(action) });
+	return *this;
+}
+
+AudioRenderScript& AudioRenderScript::createEmitter(double time, AudioEmitterId id, AudioPosition position)
+{
+	return add(time, [=] (AudioEngine& engine) { engine.createEmitter(id, position, false); });
+}
+
+AudioRenderScript& AudioRenderScript::destroyEmitter(double time, AudioEmitterId id)
+{
+	return add(time, [=] (AudioEngine& engine) { engine.destroyEmitter(id); });
+}
+
+AudioRenderScript& AudioRenderScript::setEmitterPosition(double time, AudioEmitterId id, AudioPosition position)
+{
+	return add(time, [=] (AudioEngine& engine)
+	{
+		if (auto* emitter = engine.getEmitter(id)) {
+			emitter->setPosition(position);
+		}
+	});
+}
+
+AudioRenderScript& AudioRenderScript::setListener(double time, AudioListenerData listener)
+{
+	return add(time, [=] (AudioEngine& engine) { engine.setListener(listener); });
+}
+
+AudioRenderScript& AudioRenderScript::postEvent(double time, AudioEventId id, std::shared_ptr<const AudioEvent> event, AudioEmitterId emitterId)
+{
+	return add(time, [=] (AudioEngine& engine) { engine.postEvent(id, *event, emitterId); });
+}
+
+AudioRenderScript& AudioRenderScript::play(double time, AudioEventId id, std::shared_ptr<const IAudioClip> clip, AudioEmitterId emitterId, float gain, bool loop)
+{
+	return add(time, [=] (AudioEngine& engine) { engine.play(id, clip, emitterId, gain, loop, AudioFade()); });
+}
+
+AudioRenderScript& AudioRenderScript::play(double time, AudioEventId id, std::shared_ptr<const AudioObject> object, AudioEmitterId emitterId, float gain)
+{
+	return add(time, [=] (AudioEngine& engine) { engine.play(id, object, emitterId, gain, AudioFade()); });
+}
+
+AudioRenderScript& AudioRenderScript::stop(double time, AudioEventId id, AudioEmitterId emitterId, AudioFade fade)
+{
+	return add(time, [=] (AudioEngine& engine)
+	{
+		if (auto* emitter = engine.getEmitter(emitterId)) {
+			for (auto& v: emitter->getVoices()) {
+				if (v->getEventId() == id) {
+					v->stop(fade);
+				}
+			}
+		}
+	});
+}
+
+gsl::span<const AudioRenderScript::Entry> AudioRenderScript::getEntries() const
+{
+	return entries;
+}
+
+double AudioRenderScript::getEndTime() const
+{
+	return entries.empty() ? 0.0 : entries.back().time;
+}
+
+
+String AudioRenderStats::toString() const
+{
+	return Halley::toString(numBuffers) + " buffers, " + Halley::toString(audioSeconds, 2) + "s of audio in " + Halley::toString(renderSeconds, 3) + "s"
+		+ " (" + Halley::toString(realTimeFactor, 1) + "x real time)"
+		+ ", worst buffer " + Halley::toString(worstBufferNanoseconds / 1000) + " us (" + Halley::toString(worstBufferLoad * 100.0, 1) + "% of its duration)"
+		+ ", voices: " + Halley::toString(averageVoices, 1) + " average, " + Halley::toString(peakVoices) + " peak (" + Halley::toString(peakRealVoices) + " real, " + Halley::toString(peakVirtualVoices) + " virtual)";
+}
+
+
+class AudioOfflineRenderer::Output final : public AudioOutputAPI {
+public:
+	bool capture = true;
+	size_t bytesOutput = 0;
+	Bytes captured;
+
+	Vector<std::unique_ptr<const AudioDevice>> getAudioDevices() override { return {}; }
+	AudioSpec openAudioDevice(const AudioSpec& requestedFormat, const AudioDevice* device, AudioCallback prepareAudioCallback) override { return requestedFormat; }
+	void closeAudioDevice() override {}
+	void startPlayback() override {}
+	void stopPlayback() override {}
+	bool needsMoreAudio() override { return true; }
+	bool needsAudioThread() const override { return false; }
+
+	void onAudioAvailable() override
+	{
+		auto& src = getAudioOutputInterface();
+		const size_t n = src.getAvailable();
+		auto& dst = capture ? captured : scratch;
+		const size_t start = capture ? captured.size() : 0;
+		dst.resize(start + n);
+		src.output(gsl::as_writable_bytes(gsl::span<Byte>(dst).subspan(start, n)), false);
+		bytesOutput += n;
+	}
+
+private:
+	Bytes scratch;
+};
+
+
+AudioOfflineRenderer::AudioOfflineRenderer(const AudioProperties& audioProperties, AudioSpec spec, uint32_t seed)
+	: spec(spec)
+	, output(std::make_unique<Output>())
+	, engine(std::make_unique<AudioEngine>())
+{
+	engine->setRandomSeed(seed);
+	engine->start(spec, *output, audioProperties);
+	engine->setListener(AudioListenerData());
+}
+
+AudioOfflineRenderer::~AudioOfflineRenderer()
+{
+	engine.reset();
+}
+
+void AudioOfflineRenderer::setRenderThreads(size_t nThreads)
+{
+	engine->setRenderThreads(nThreads, [] (const String& name, std::function<void()> runnable)
+	{
+		return std::thread(std::move(runnable));
+	});
+}
+
+void AudioOfflineRenderer::setCaptureOutput(bool capture)
+{
+	output->capture = capture;
+}
+
+AudioRenderStats AudioOfflineRenderer::render(const AudioRenderScript& script, double duration)
+{
+	const auto entries = script.getEntries();
+	const size_t frameSize = static_cast<size_t>(spec.numChannels) * (spec.format == AudioSampleFormat::Int16 ? 2 : 4);
+
+	AudioRenderStats stats;
+	size_t nextEntry = 0;
+	size_t totalVoices = 0;
+	double time = 0;
+	Stopwatch total;
+
+	while (time < duration) {
+		for (; nextEntry < entries.size() && entries[nextEntry].time <= time; ++nextEntry) {
+			entries[nextEntry].action(*engine);
+		}
+
+		const size_t bytesBefore = output->bytesOutput;
+		Stopwatch timer;
+		engine->generateBuffer();
+		timer.pause();
+
+		const size_t frames = (output->bytesOutput - bytesBefore) / frameSize;
+		if (frames == 0) {
+			throw Exception("Audio engine didn't generate any samples.", HalleyExceptions::AudioEngine);
+		}
+		const double bufferSeconds = static_cast<double>(frames) / spec.sampleRate;
+		time += bufferSeconds;
+
+		// Nobody is listening for these, so they'd otherwise pile up
+		engine->consumeFinishedSounds(engine->getFinishedSounds().size());
+
+		const auto voices = engine->getVoiceCounts();
+		const int64_t bufferNs = timer.elapsedNanoseconds();
+		++stats.numBuffers;
+		stats.worstBufferNanoseconds = std::max(stats.worstBufferNanoseconds, bufferNs);
+		stats.worstBufferLoad = std::max(stats.worstBufferLoad, static_cast<double>(bufferNs) / (bufferSeconds * 1'000'000'000.0));
+		stats.peakVoices = std::max(stats.peakVoices, voices.playing);
+		stats.peakRealVoices = std::max(stats.peakRealVoices, voices.playing - voices.virtualised);
+		stats.peakVirtualVoices = std::max(stats.peakVirtualVoices, voices.virtualised);
+		totalVoices += voices.playing;
+	}
+
+	total.pause();
+	engine->getLastTimeElapsed(); // Reset, as nothing else reads it here
+
+	stats.audioSeconds = time;
+	stats.renderSeconds = total.elapsedSeconds();
+	stats.realTimeFactor = stats.renderSeconds > 0 ? stats.audioSeconds / stats.renderSeconds : 0;
+	stats.averageVoices = stats.numBuffers > 0 ? static_cast<double>(totalVoices) / stats.numBuffers : 0;
+	return stats;
+}
+
+const AudioSpec& AudioOfflineRenderer::getSpec() const
+{
+	return spec;
+}
+
+AudioEngine& AudioOfflineRenderer::getEngine()
+{
+	return *engine;
+}
+
+const Bytes& AudioOfflineRenderer::getOutput() const
+{
+	return output->captured;
+}
+
+Bytes AudioOfflineRenderer::makeWAV() const
+{
+	const auto& data = output->captured;
+	const bool isFloat = spec.format == AudioSampleFormat::Float;
+	const uint16_t bitsPerSample = spec.format == AudioSampleFormat::Int16 ? 16 : 32;
+	const uint16_t blockAlign = static_cast<uint16_t>(spec.numChannels * bitsPerSample / 8);
+
+	Bytes result;
+	result.reserve(44 + data.size());
+	auto writeTag = [&] (const char* tag) { result.insert(result.end(), tag, tag + 4); };
+	auto writeInt = [&] (uint32_t value, size_t nBytes)
+	{
+		for (size_t i = 0; i < nBytes; ++i) {
+			result.push_back(static_cast<Byte>(value >> (8 * i)));
+		}
+	};
+
+	writeTag("RIFF");
+	writeInt(static_cast<uint32_t>(36 + data.size()), 4);
+	writeTag("WAVE");
+	writeTag("fmt ");
+	writeInt(16, 4);
+	writeInt(isFloat ? 3 : 1, 2);
+	writeInt(spec.numChannels, 2);
+	writeInt(spec.sampleRate, 4);
+	writeInt(spec.sampleRate * blockAlign, 4);
+	writeInt(blockAlign, 2);
+	writeInt(bitsPerSample, 2);
+	writeTag("data");
+	writeInt(static_cast<uint32_t>(data.size()), 4);
+	result.insert(result.end(), data.begin(), data.end());
+
+	return result;
+}
+
+bool AudioOfflineRenderer::writeWAV(const Path& path) const
+{
+	return Path::writeFile(path, makeWAV());
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include "halley/api/audio_api.h"
+#include "halley/audio/audio_fade.h"
+#include "halley/audio/audio_position.h"
+#include "halley/data_structures/vector.h"
+#include "halley/file/path.h"
+
+namespace Halley {
+	class AudioEngine;
+	class AudioEvent;
+	class AudioObject;
+	class AudioProperties;
+	class IAudioClip;
+
+	// A timeline of things to do to the AudioEngine while rendering offline.
+	// Each action runs right before the first buffer that starts at or after its time, in the order they were added.
+	class AudioRenderScript {
+	public:
+		using Action = std::function<void(AudioEngine&)>;
+
+		struct Entry {
+			double time = 0;
+			Action action;
+		};
+
+		AudioRenderScript& add(double time, Action action);
+
+		AudioRenderScript& createEmitter(double time, AudioEmitterId id, AudioPosition position);
+		AudioRenderScript& destroyEmitter(double time, AudioEmitterId id);
+		AudioRenderScript& setEmitterPosition(double time, AudioEmitterId id, AudioPosition position);
+		AudioRenderScript& setListener(double time, AudioListenerData listener);
+
+		AudioRenderScript& postEvent(double time, AudioEventId id, std::shared_ptr<const AudioEvent> event, AudioEmitterId emitterId = 0);
+		AudioRenderScript& play(double time, AudioEventId id, std::shared_ptr<const IAudioClip> clip, AudioEmitterId emitterId = 0, float gain = 1.0f, bool loop = false);
+		AudioRenderScript& play(double time, AudioEventId id, std::shared_ptr<const AudioObject> object, AudioEmitterId emitterId = 0, float gain = 1.0f);
+		AudioRenderScript& stop(double time, AudioEventId id, AudioEmitterId emitterId = 0, AudioFade fade = {});
+
+		gsl::span<const Entry> getEntries() const;
+		double getEndTime() const;
+
+	private:
+		Vector<Entry> entries;
+	};
+
+	struct AudioRenderStats {
+		size_t numBuffers = 0;
+		double audioSeconds = 0;
+		double renderSeconds = 0;
+		double realTimeFactor = 0; // Seconds of audio rendered per second of wall time
+		int64_t worstBufferNanoseconds = 0;
+		double worstBufferLoad = 0; // Worst buffer render time, as a fraction of that buffer's duration
+		size_t peakVoices = 0;
+		size_t peakRealVoices = 0;
+		size_t peakVirtualVoices = 0;
+		double averageVoices = 0;
+
+		String toString() const;
+	};
+
+	// Drives an AudioEngine as fast as it can without an audio device, capturing the output in memory.
+	// Given the same seed, script and spec, the output is identical between runs (and between any number of render threads).
+	// Script times are relative to the start of each render() call. audioProperties must outlive the renderer.
+	class AudioOfflineRenderer {
+	public:
+		AudioOfflineRenderer(const AudioProperties& audioProperties, AudioSpec spec = AudioSpec(48000, 2, 512, AudioSampleFormat::Float), uint32_t seed = 1);
+		~AudioOfflineRenderer();
+
+		void setRenderThreads(size_t nThreads);
+		void setCaptureOutput(bool capture);
+
+		AudioRenderStats render(const AudioRenderScript& script, double duration);
+
+		const AudioSpec& getSpec() const;
+		AudioEngine& getEngine();
+
+		const Bytes& getOutput() const;
+		Bytes makeWAV() const;
+		bool writeWAV(const Path& path) const;
+
+	private:
+		class Output;
+
+		AudioSpec spec;
+		std::unique_ptr<Output> output;
+		std::unique_ptr<AudioEngine> engine;
+	};
+}
@@ -97,6 +97,35 @@ AudioPosition AudioPosition::makeFixed()
 	return result;
 }
 
+bool AudioPosition::toCompact(Compact& result) const
+{
+	if (sources.size() > 1) {
+		return false;
+	}
+
+	result.pan = pan;
+	result.isUI = isUI;
+	result.isPannable = isPannable;
+	result.hasSource = !sources.empty();
+	if (result.hasSource) {
+		result.source = sources[0];
+	}
+	return true;
+}
+
+void AudioPosition::setFromCompact(const Compact& compact)
+{
+	pan = compact.pan;
+	isUI = compact.isUI;
+	isPannable = compact.isPannable;
+	if (compact.hasSource) {
+		sources.resize(1);
+		sources[0] = compact.source;
+	} else {
+		sources.clear();
+	}
+}
+
 void AudioPosition::setPosition(Vector3f position)
 {
 	if (!sources.empty()) {
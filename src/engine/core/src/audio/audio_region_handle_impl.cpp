@@ -1,5 +1,6 @@
 #include "audio_region_handle_impl.h"
 
+#include "audio_command_queue.h"
 #include "audio_engine.h"
 #include "halley/audio/audio_facade.h"
 
@@ -14,12 +15,11 @@ AudioRegionHandleImpl::AudioRegionHandleImpl(AudioFacade& facade, AudioRegionId
 AudioRegionHandleImpl::~AudioRegionHandleImpl()
 {
 	facade.regionNames.erase(id);
-	AudioEngine* engine = facade.engine.get();
 
-	facade.enqueue([regId = id, engine] ()
-	{
-		engine->destroyRegion(regId);
-	});
+	AudioCommand command;
+	command.type = AudioCommandType::DestroyRegion;
+	command.regionId = id;
+	facade.enqueue(command);
 }
 
 AudioRegionId AudioRegionHandleImpl::getId() const
@@ -0,0 +1,138 @@
+#include "audio_render_workers.h"
+
+#include "halley/audio/audio_buffer.h"
+#include "halley/text/string_converter.h"
+
+using namespace Halley;
+
+namespace {
+	uint64_t packCursor(uint64_t idx, uint64_t n)
+	{
+		return (n << 32) | idx;
+	}
+}
+
+AudioRenderWorkers::AudioRenderWorkers(size_t nThreads, RenderFunction render, InitFunction initThread, const ThreadFactory& threadFactory)
+	: render(std::move(render))
+	, initThread(std::move(initThread))
+	, cursor(0)
+	, nDone(0)
+	, running(true)
+	, nParked(0)
+{
+	pools.reserve(nThreads);
+	threads.reserve(nThreads);
+	for (size_t i = 0; i < nThreads; ++i) {
+		pools.push_back(std::make_unique<AudioBufferPool>());
+	}
+	for (size_t i = 0; i < nThreads; ++i) {
+		threads.push_back(threadFactory("AudioRender" + toString(i), [this, i] () { runWorker(i); }));
+	}
+}
+
+AudioRenderWorkers::~AudioRenderWorkers()
+{
+	running = false;
+	{
+		std::unique_lock<std::mutex> lock(parkMutex);
+		parkCondition.notify_all();
+	}
+	for (auto& t: threads) {
+		if (t.joinable()) {
+			t.join();
+		}
+	}
+}
+
+size_t AudioRenderWorkers::getNumThreads() const
+{
+	return threads.size();
+}
+
+void AudioRenderWorkers::run(size_t n, AudioBufferPool& callerPool)
+{
+	Expects(n <= 0xFFFFFFFFull);
+	if (n == 0) {
+		return;
+	}
+
+	// Nobody can be holding on to the previous job at this point, as all of its indices were claimed and completed
+	nDone.store(0, std::memory_order_relaxed);
+	cursor.store(packCursor(0, n), std::memory_order_seq_cst);
+
+	// A worker about to park either sees the job above, or is counted here. Taking the lock means it's either
+	// still before its final check, or already waiting, so the notification can't be lost.
+	if (nParked.load(std::memory_order_seq_cst) > 0) {
+		std::unique_lock<std::mutex> lock(parkMutex);
+		parkCondition.notify_all();
+	}
+
+	while (tryRenderOne(callerPool)) {}
+
+	while (nDone.load(std::memory_order_acquire) < n) {
+		std::this_thread::yield();
+	}
+
+	if (exception) {
+		auto e = exception;
+		exception = {};
+		std::rethrow_exception(e);
+	}
+}
+
+void AudioRenderWorkers::runWorker(size_t idx)
+{
+	constexpr int spinsBeforeParking = 4096;
+
+	if (initThread) {
+		initThread();
+	}
+
+	auto& pool = *pools[idx];
+	int spins = 0;
+	while (running) {
+		if (tryRenderOne(pool)) {
+			spins = 0;
+		} else if (++spins < spinsBeforeParking) {
+			std::this_thread::yield();
+		} else {
+			std::unique_lock<std::mutex> lock(parkMutex);
+			nParked.fetch_add(1, std::memory_order_seq_cst);
+			parkCondition.wait(lock, [&] () { return !running || hasWork(); });
+			nParked.fetch_sub(1, std::memory_order_relaxed);
+			spins = 0;
+		}
+	}
+}
+
+bool AudioRenderWorkers::hasWork() const
+{
+	const uint64_t cur = cursor.load(std::memory_order_seq_cst);
+	return (cur & 0xFFFFFFFFull) < (cur >> 32);
+}
+
+bool AudioRenderWorkers::tryRenderOne(AudioBufferPool& pool)
+{
+	uint64_t cur = cursor.load(std::memory_order_acquire);
+	while (true) {
+		const uint64_t idx = cur & 0xFFFFFFFFull;
+		const uint64_t n = cur >> 32;
+		if (idx >= n) {
+			return false;
+		}
+
+		// If this succeeds, the job can't finish until we're done with this index, so its data is safe to use
+		if (cursor.compare_exchange_weak(cur, packCursor(idx + 1, n), std::memory_order_acq_rel, std::memory_order_acquire)) {
+			try {
+				render(static_cast<size_t>(idx), pool);
+			} catch (...) {
+				std::unique_lock<std::mutex> lock(exceptionMutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+			}
+			nDone.fetch_add(1, std::memory_order_release);
+			return true;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "halley/data_structures/vector.h"
+#include "halley/text/halleystring.h"
+
+namespace Halley {
+	class AudioBufferPool;
+
+	// Fixed set of threads that help the audio thread render voices.
+	// Jobs are handed off through a single atomic cursor, so rendering never takes a lock. Workers that run out of work spin
+	// for a moment and then park until the next job; posting a job only takes the park lock if a worker is parked.
+	// Each thread has its own buffer pool, since AudioBufferPool isn't thread safe.
+	class AudioRenderWorkers {
+	public:
+		using ThreadFactory = std::function<std::thread(const String& name, std::function<void()> runnable)>;
+		using RenderFunction = std::function<void(size_t idx, AudioBufferPool& pool)>;
+		using InitFunction = std::function<void()>;
+
+		// initThread is called on each worker as it starts, to set up any per-thread state ahead of rendering
+		AudioRenderWorkers(size_t nThreads, RenderFunction render, InitFunction initThread, const ThreadFactory& threadFactory);
+		~AudioRenderWorkers();
+
+		AudioRenderWorkers(const AudioRenderWorkers& other) = delete;
+		AudioRenderWorkers& operator=(const AudioRenderWorkers& other) = delete;
+
+		size_t getNumThreads() const;
+
+		// Renders every index in [0, n) using the workers and the calling thread, and blocks until they're all done
+		void run(size_t n, AudioBufferPool& callerPool);
+
+	private:
+		RenderFunction render;
+		InitFunction initThread;
+		Vector<std::thread> threads;
+		Vector<std::unique_ptr<AudioBufferPool>> pools;
+
+		alignas(64) std::atomic<uint64_t> cursor; // Next index in the low 32 bits, job size in the high 32 bits
+		alignas(64) std::atomic<size_t> nDone;
+		std::atomic<bool> running;
+
+		std::atomic<int> nParked;
+		std::mutex parkMutex;
+		std::condition_variable parkCondition;
+
+		std::mutex exceptionMutex;
+		std::exception_ptr exception;
+
+		void runWorker(size_t idx);
+		bool tryRenderOne(AudioBufferPool& pool);
+		bool hasWork() const;
+	};
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386)
+	#ifndef HAS_SSE
+		#define HAS_SSE
+	#endif
+	#include <xmmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+	#ifndef HAS_NEON
+		#define HAS_NEON
+	#endif
+	#include <arm_neon.h>
+#endif
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#endif
+
+namespace Halley {
+	// Everything here has internal linkage on purpose. These are compiled into translation units with different
+	// instruction set flags, and we can't let the linker pick an AVX2 copy of a function for use on the SSE path.
+	namespace {
+		// Thin wrappers over the vector registers of each instruction set, so that the audio kernels can be written once.
+		struct AudioSimdScalar {
+			using Reg = float;
+			constexpr static size_t width = 1;
+
+			static Reg load(const float* src) { return *src; }
+			static void store(float* dst, Reg v) { *dst = v; }
+			static Reg set1(float v) { return v; }
+			static Reg iota() { return 0.0f; }
+			static Reg add(Reg a, Reg b) { return a + b; }
+			static Reg sub(Reg a, Reg b) { return a - b; }
+			static Reg mul(Reg a, Reg b) { return a * b; }
+			static Reg madd(Reg a, Reg b, Reg c) { return a * b + c; }
+			static Reg min(Reg a, Reg b) { return a < b ? a : b; }
+			static Reg max(Reg a, Reg b) { return a > b ? a : b; }
+			static void interleave(Reg a, Reg b, Reg& lo, Reg& hi) { lo = a; hi = b; }
+		};
+
+#ifdef HAS_SSE
+		struct AudioSimdSSE {
+			using Reg = __m128;
+			constexpr static size_t width = 4;
+
+			static Reg load(const float* src) { return _mm_loadu_ps(src); }
+			static void store(float* dst, Reg v) { _mm_storeu_ps(dst, v); }
+			static Reg set1(float v) { return _mm_set1_ps(v); }
+			static Reg iota() { return _mm_setr_ps(0, 1, 2, 3); }
+			static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+			static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+			static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+			static Reg madd(Reg a, Reg b, Reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+			static Reg min(Reg a, Reg b) { return _mm_min_ps(a, b); }
+			static Reg max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+
+			static void interleave(Reg a, Reg b, Reg& lo, Reg& hi)
+			{
+				lo = _mm_unpacklo_ps(a, b);
+				hi = _mm_unpackhi_ps(a, b);
+			}
+		};
+#endif
+
+#ifdef __AVX2__
+		struct AudioSimdAVX2 {
+			using Reg = __m256;
+			constexpr static size_t width = 8;
+
+			static Reg load(const float* src) { return _mm256_loadu_ps(src); }
+			static void store(float* dst, Reg v) { _mm256_storeu_ps(dst, v); }
+			static Reg set1(float v) { return _mm256_set1_ps(v); }
+			static Reg iota() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+			static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+			static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+			static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+			static Reg madd(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+			static Reg min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+			static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+
+			static void interleave(Reg a, Reg b, Reg& lo, Reg& hi)
+			{
+				// Unpack works within each 128-bit lane, so the halves need to be put back in order afterwards
+				const auto l = _mm256_unpacklo_ps(a, b);
+				const auto h = _mm256_unpackhi_ps(a, b);
+				lo = _mm256_permute2f128_ps(l, h, 0x20);
+				hi = _mm256_permute2f128_ps(l, h, 0x31);
+			}
+		};
+#endif
+
+#ifdef HAS_NEON
+		struct AudioSimdNEON {
+			using Reg = float32x4_t;
+			constexpr static size_t width = 4;
+
+			static Reg load(const float* src) { return vld1q_f32(src); }
+			static void store(float* dst, Reg v) { vst1q_f32(dst, v); }
+			static Reg set1(float v) { return vdupq_n_f32(v); }
+			static Reg iota() { const float v[4] = { 0, 1, 2, 3 }; return vld1q_f32(v); }
+			static Reg add(Reg a, Reg b) { return vaddq_f32(a, b); }
+			static Reg sub(Reg a, Reg b) { return vsubq_f32(a, b); }
+			static Reg mul(Reg a, Reg b) { return vmulq_f32(a, b); }
+			static Reg madd(Reg a, Reg b, Reg c) { return vmlaq_f32(c, a, b); }
+			static Reg min(Reg a, Reg b) { return vminq_f32(a, b); }
+			static Reg max(Reg a, Reg b) { return vmaxq_f32(a, b); }
+
+			static void interleave(Reg a, Reg b, Reg& lo, Reg& hi)
+			{
+				const auto r = vzipq_f32(a, b);
+				lo = r.val[0];
+				hi = r.val[1];
+			}
+		};
+#endif
+	}
+}
@@ -47,7 +47,24 @@ void AudioSourceClip::restart()
 	initialised = false;
 }
 
+void AudioSourceClip::collectSharedClips(Vector<const IAudioClip*>& dst) const
+{
+	if (clip->hasSharedPlaybackState()) {
+		dst.push_back(clip.get());
+	}
+}
+
 bool AudioSourceClip::getAudioData(size_t samplesRequested, AudioMultiChannelSamples dstChannels)
+{
+	return readAudioData(samplesRequested, &dstChannels);
+}
+
+bool AudioSourceClip::skipAudioData(size_t samplesRequested)
+{
+	return readAudioData(samplesRequested, nullptr);
+}
+
+bool AudioSourceClip::readAudioData(size_t samplesRequested, AudioMultiChannelSamples* dstChannels)
 {
 	Expects(isReady());
 
@@ -117,9 +134,13 @@ bool AudioSourceClip::getAudioData(size_t samplesRequested, AudioMultiChannelSam
 
 			for (auto& stream: streams) {
 				if (stream.active) {
-					if (first) {
+					if (!dstChannels) {
 						for (size_t ch = 0; ch < nChannels; ++ch) {
-							auto dst = dstChannels[ch].subspan(samplesWritten, samplesToRead);
+							clip->skipChannelData(ch, stream.playbackPos, samplesToRead);
+						}
+					} else if (first) {
+						for (size_t ch = 0; ch < nChannels; ++ch) {
+							auto dst = (*dstChannels)[ch].subspan(samplesWritten, samplesToRead);
 							const size_t nCopied = clip->copyChannelData(ch, stream.playbackPos, samplesToRead, prevGain, gain, dst);
 							assert(nCopied <= samplesRequested * sizeof(AudioSample));
 						}
@@ -127,7 +148,7 @@ bool AudioSourceClip::getAudioData(size_t samplesRequested, AudioMultiChannelSam
 					} else {
 						auto buffer = engine.getPool().getBuffer(samplesToRead);
 						for (size_t ch = 0; ch < nChannels; ++ch) {
-							auto dst = dstChannels[ch].subspan(samplesWritten, samplesToRead);
+							auto dst = (*dstChannels)[ch].subspan(samplesWritten, samplesToRead);
 							const size_t nCopied = clip->copyChannelData(ch, stream.playbackPos, samplesToRead, prevGain, gain, buffer.getSpan());
 							AudioMixer::mixAudio(buffer.getSpan(), dst, 1, 1);
 							assert(nCopied <= samplesRequested * sizeof(AudioSample));
@@ -141,7 +162,9 @@ bool AudioSourceClip::getAudioData(size_t samplesRequested, AudioMultiChannelSam
 			samplesWritten += samplesToRead;
 		} else {
 			// Reached end of playback, pad with zeroes
-			AudioMixer::zeroRange(dstChannels, nChannels, samplesWritten, samplesRemaining);
+			if (dstChannels) {
+				AudioMixer::zeroRange(*dstChannels, nChannels, samplesWritten, samplesRemaining);
+			}
 			samplesWritten += samplesRemaining;
 		}
 	}
@@ -12,9 +12,11 @@ namespace Halley
 		String getName() const override;
 		uint8_t getNumberOfChannels() const override;
 		bool getAudioData(size_t numSamples, AudioMultiChannelSamples dst) override;
+		bool skipAudioData(size_t numSamples) override;
 		bool isReady() const override;
 		size_t getSamplesLeft() const override;
 		void restart() override;
+		void collectSharedClips(Vector<const IAudioClip*>& dst) const override;
 
 	private:
 		AudioEngine& engine;
@@ -37,5 +39,7 @@ namespace Halley
 		bool initialised = false;
 		bool looping = false;
 		bool randomiseStart = false;
+
+		bool readAudioData(size_t numSamples, AudioMultiChannelSamples* dst);
 	};
 }
@@ -35,6 +35,18 @@ bool AudioSourceDelay::getAudioData(size_t numSamples, AudioMultiChannelSamples
 	}
 }
 
+bool AudioSourceDelay::skipAudioData(size_t numSamples)
+{
+	if (numSamples < curDelay) {
+		curDelay -= numSamples;
+		return true;
+	} else {
+		const auto playing = src->skipAudioData(numSamples - curDelay);
+		curDelay = 0;
+		return playing;
+	}
+}
+
 bool AudioSourceDelay::isReady() const
 {
 	return src->isReady();
@@ -51,6 +63,11 @@ void AudioSourceDelay::restart()
 	src->restart();
 }
 
+void AudioSourceDelay::collectSharedClips(Vector<const IAudioClip*>& dst) const
+{
+	src->collectSharedClips(dst);
+}
+
 void AudioSourceDelay::setInitialDelay(size_t delay)
 {
 	initialDelay = delay;
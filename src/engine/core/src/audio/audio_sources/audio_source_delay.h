@@ -10,9 +10,11 @@ namespace Halley
 
 		uint8_t getNumberOfChannels() const override;
 		bool getAudioData(size_t numSamples, AudioMultiChannelSamples dst) override;
+		bool skipAudioData(size_t numSamples) override;
 		bool isReady() const override;
 		size_t getSamplesLeft() const override;
         void restart() override;
+        void collectSharedClips(Vector<const IAudioClip*>& dst) const override;
 		void setInitialDelay(size_t delay);
 
 	private:
@@ -74,6 +74,28 @@ bool AudioSourceLayers::getAudioData(size_t numSamples, AudioMultiChannelSamples
 	return ok;
 }
 
+bool AudioSourceLayers::skipAudioData(size_t numSamples)
+{
+	if (!initialized) {
+		for (auto& layer : layers) {
+			layer.restart(layerConfig, emitter);
+		}
+		initialized = true;
+	}
+
+	const float deltaTime = static_cast<float>(numSamples) / static_cast<float>(AudioConfig::sampleRate);
+
+	bool ok = true;
+	for (auto& layer: layers) {
+		layer.update(deltaTime, layerConfig, emitter, fadeConfig);
+		if (layer.playing || layer.synchronised || layer.fader.isFading()) {
+			ok = layer.source->skipAudioData(numSamples) && ok;
+		}
+	}
+
+	return ok;
+}
+
 bool AudioSourceLayers::isReady() const
 {
 	return std::all_of(layers.begin(), layers.end(), [=] (const auto& ls) { return ls.source->isReady(); });
@@ -96,6 +118,13 @@ void AudioSourceLayers::restart()
 	}
 }
 
+void AudioSourceLayers::collectSharedClips(Vector<const IAudioClip*>& dst) const
+{
+	for (const auto& layer: layers) {
+		layer.source->collectSharedClips(dst);
+	}
+}
+
 AudioSourceLayers::Layer::Layer(std::unique_ptr<AudioSource> source, size_t idx)
 	: source(std::move(source))
 	, idx(idx)
@@ -19,9 +19,21 @@ uint8_t AudioSourceSequence::getNumberOfChannels() const
 }
 
 bool AudioSourceSequence::getAudioData(size_t samplesRequested, AudioMultiChannelSamples dst)
+{
+	return readAudioData(samplesRequested, &dst);
+}
+
+bool AudioSourceSequence::skipAudioData(size_t samplesRequested)
+{
+	return readAudioData(samplesRequested, nullptr);
+}
+
+bool AudioSourceSequence::readAudioData(size_t samplesRequested, AudioMultiChannelSamples* dst)
 {
 	if (playingTracks.empty()) {
-		AudioMixer::zero(dst);
+		if (dst) {
+			AudioMixer::zero(*dst);
+		}
 		return false;
 	}
 
@@ -37,7 +49,9 @@ bool AudioSourceSequence::getAudioData(size_t samplesRequested, AudioMultiChanne
 
 	while (samplePos < samplesRequested) {
 		if (playingTracks.empty()) {
-			AudioMixer::zeroRange(dst, nChannels, samplePos);
+			if (dst) {
+				AudioMixer::zeroRange(*dst, nChannels, samplePos);
+			}
 			return false;
 		}
 
@@ -72,9 +86,13 @@ bool AudioSourceSequence::getAudioData(size_t samplesRequested, AudioMultiChanne
 		}
 
 		// Read samples
-		if (nPlaying == 1 && samplePos == 0 && samplesToRead == samplesRequested && playingTracks.front().fader.getCurrentValue() == 1 && playingTracks.front().prevGain == 1) {
+		if (!dst) {
+			for (auto& p: playingTracks) {
+				p.source->skipAudioData(samplesToRead);
+			}
+		} else if (nPlaying == 1 && samplePos == 0 && samplesToRead == samplesRequested && playingTracks.front().fader.getCurrentValue() == 1 && playingTracks.front().prevGain == 1) {
 			// Passthrough!
-			playingTracks.front().source->getAudioData(samplesRequested, dst);
+			playingTracks.front().source->getAudioData(samplesRequested, *dst);
 		} else {
 			// Mix tracks
 			auto buffer = engine.getPool().getBuffers(nChannels, samplesRequested);
@@ -85,12 +103,12 @@ bool AudioSourceSequence::getAudioData(size_t samplesRequested, AudioMultiChanne
 
 				if (first) {
 					for (size_t i = 0; i < nChannels; ++i) {
-						AudioMixer::copy(dst[i].subspan(samplePos), buffer.getSampleSpans()[i], p.prevGain, gain);
+						AudioMixer::copy((*dst)[i].subspan(samplePos), buffer.getSampleSpans()[i], p.prevGain, gain);
 					}
 					first = false;
 				} else {
 					for (size_t i = 0; i < nChannels; ++i) {
-						AudioMixer::mixAudio(buffer.getSampleSpans()[i], dst[i].subspan(samplePos), p.prevGain, gain);
+						AudioMixer::mixAudio(buffer.getSampleSpans()[i], (*dst)[i].subspan(samplePos), p.prevGain, gain);
 					}
 				}
 			}
@@ -137,6 +155,13 @@ void AudioSourceSequence::restart()
 	initialize();
 }
 
+void AudioSourceSequence::collectSharedClips(Vector<const IAudioClip*>& dst) const
+{
+	for (const auto& track: playingTracks) {
+		track.source->collectSharedClips(dst);
+	}
+}
+
 size_t AudioSourceSequence::PlayingTrack::getSamplesBeforeNextEvent(size_t fadeLen) const
 {
 	const auto left = source->getSamplesLeft();
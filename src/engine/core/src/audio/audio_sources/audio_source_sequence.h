@@ -12,9 +12,11 @@ namespace Halley
 
 		uint8_t getNumberOfChannels() const override;
 		bool getAudioData(size_t samplesRequested, AudioMultiChannelSamples dst) override;
+		bool skipAudioData(size_t samplesRequested) override;
 		bool isReady() const override;
 		size_t getSamplesLeft() const override;
 		void restart() override;
+		void collectSharedClips(Vector<const IAudioClip*>& dst) const override;
 
 	private:
 		enum class TrackState {
@@ -54,6 +56,7 @@ namespace Halley
 
 		Vector<PlayingTrack> playingTracks;
 
+		bool readAudioData(size_t samplesRequested, AudioMultiChannelSamples* dst);
 		void initialize();
 		void nextTrack();
 		void loadCurrentTrack();
@@ -6,6 +6,7 @@
 #include "audio_mixer.h"
 #include "halley/audio/audio_source.h"
 #include "halley/support/logger.h"
+#include "halley/maths/random.h"
 
 using namespace Halley;
 
@@ -15,6 +16,10 @@ AudioVoice::AudioVoice(AudioEngine& engine, std::shared_ptr<AudioSource> src, fl
 	, playing(false)
 	, done(false)
 	, isFirstUpdate(true)
+	, virtualised(false)
+	, fadingToVirtual(false)
+	, rendered(false)
+	, rng(std::make_unique<Random>(engine.getRNG().getRawInt()))
 	, baseGain(gain)
 	, userGain(1.0f)
 	, basePitch(pitch)
@@ -135,6 +140,58 @@ uint8_t AudioVoice::getBus() const
 	return bus;
 }
 
+Random& AudioVoice::getRNG()
+{
+	// Each voice gets its own sequence, so the result doesn't depend on the order in which voices are rendered.
+	// Created along with the voice, so render threads never allocate it.
+	return *rng;
+}
+
+void AudioVoice::collectSharedClips(Vector<const IAudioClip*>& dst) const
+{
+	if (source) {
+		source->collectSharedClips(dst);
+	}
+}
+
+void AudioVoice::setPriority(int value)
+{
+	priority = value;
+}
+
+int AudioVoice::getPriority() const
+{
+	return priority;
+}
+
+void AudioVoice::setVirtual(bool value)
+{
+	if (value == virtualised) {
+		return;
+	}
+
+	virtualised = value;
+	if (value) {
+		// If it was audible, render one last buffer ramping down to silence
+		fadingToVirtual = rendered;
+		channelMix.fill(0);
+	} else {
+		// Ramp up from silence
+		fadingToVirtual = false;
+		prevChannelMix.fill(0);
+	}
+}
+
+bool AudioVoice::isVirtual() const
+{
+	return virtualised;
+}
+
+float AudioVoice::getAudibility() const
+{
+	return audibility;
+}
+
 void AudioVoice::setBaseGain(float gain)
 {
 	baseGain = gain;
@@ -165,7 +222,7 @@ void AudioVoice::setPitch(float pitch)
 			resample->setFromHz(freq);
 		} else {
 			if (source) {
-				resample = std::make_shared<AudioFilterResample>(source, freq, static_cast<float>(AudioConfig::sampleRate), engine.getPool());
+				resample = std::make_shared<AudioFilterResample>(source, freq, static_cast<float>(AudioConfig::sampleRate), engine);
 				source = resample;
 			}
 		}
@@ -211,6 +268,12 @@ void AudioVoice::update(gsl::span<const AudioChannelData> channels, const AudioP
 		isFirstUpdate = false;
 	}
 
+	audibility = 0;
+	const size_t nMixes = std::min(nChannels * channels.size(), channelMix.size());
+	for (size_t i = 0; i < nMixes; ++i) {
+		audibility += channelMix[i];
+	}
+
 	elapsedTime = 0;
 }
 
@@ -221,6 +284,7 @@ void AudioVoice::render(size_t numSamplesRequested, AudioBufferPool& pool)
 	mixAmount = 0;
 
 	if (paused || !source) {
+		rendered = false;
 		return;
 	}
 
@@ -236,9 +300,16 @@ void AudioVoice::render(size_t numSamplesRequested, AudioBufferPool& pool)
 
 	// Get sample data
 	bool isPlaying = true;
+	rendered = !virtualised || fadingToVirtual;
+	fadingToVirtual = false;
 	if (numSamples > 0) {
-		audioData = pool.getBuffers(getNumberOfChannels(), numSamples);
-		isPlaying = source->getAudioData(numSamples, audioData.getSampleSpans());
+		if (rendered) {
+			audioData = pool.getBuffers(getNumberOfChannels(), numSamples);
+			isPlaying = source->getAudioData(numSamples, audioData.getSampleSpans());
+		} else {
+			isPlaying = source->skipAudioData(numSamples);
+			numSamplesRendered = 0;
+		}
 	}
 
 	// Advance playback state
@@ -321,6 +392,7 @@ AudioDebugData::VoiceData AudioVoice::getDebugData() const
 
 	result.gain = lastGain;
 	result.playing = playing;
+	result.isVirtual = virtualised;
 	result.paused = paused;
 	result.objectId = audioObjectId;
 	result.dstChannels = lastDstChannels;
@@ -12,6 +12,8 @@ namespace Halley {
 	class AudioMixer;
 	class AudioVoiceBehaviour;
 	class AudioSource;
+	class Random;
+	class IAudioClip;
 
 	class AudioVoice {
     public:
@@ -29,6 +31,11 @@ namespace Halley {
 		bool isReady() const;
 		bool isDone() const;
 
+		// Virtual voices keep advancing playback, but don't decode or mix anything
+		void setVirtual(bool isVirtual);
+		bool isVirtual() const;
+		float getAudibility() const;
+
 		void setBaseGain(float gain);
 		float getBaseGain() const;
 		void setUserGain(float gain);
@@ -40,6 +47,7 @@ namespace Halley {
 
 		void update(gsl::span<const AudioChannelData> channels, const AudioPosition& sourcePos, const AudioListenerData& listener, float busGain);
 		void render(size_t numSamples, AudioBufferPool& pool);
+		void collectSharedClips(Vector<const IAudioClip*>& dst) const;
 		void mixTo(gsl::span<AudioBuffer*> dst, float prevGain, float gain);
 		void clearBuffers();
 		
@@ -49,6 +57,9 @@ namespace Halley {
 		void setAttenuationOverride(std::optional<AudioAttenuation> attenuation);
 		
 		uint8_t getBus() const;
+		Random& getRNG();
+		void setPriority(int priority);
+		int getPriority() const;
 
 		AudioDebugData::VoiceData getDebugData() const;
 
@@ -68,6 +79,11 @@ namespace Halley {
 		bool playing : 1;
 		bool done : 1;
 		bool isFirstUpdate : 1;
+		bool virtualised : 1;
+		bool fadingToVirtual : 1;
+		bool rendered : 1;
+		int priority = 0;
+		std::unique_ptr<Random> rng;
     	float baseGain = 1.0f;
 		float userGain = 1.0f;
 		float basePitch = 1.0f;
@@ -88,6 +104,7 @@ namespace Halley {
 		float lastGain = 0;
 		float lastPostGain = 0;
 		float lastPitch = 1;
+		float audibility = 0;
 		uint8_t lastDstChannels = 0;
 
 		AudioBuffersRef audioData;
@@ -24,6 +24,14 @@ Serializer::Serializer(gsl::span<gsl::byte> dst, SerializerOptions options)
 	, dryRun(false)
 {}
 
+Serializer::Serializer(Bytes& dst, SerializerOptions options)
+	: ByteSerializationBase(std::move(options))
+	, buffer(&dst)
+	, dryRun(false)
+{
+	dst.clear();
+}
+
 Serializer& Serializer::operator<<(const std::string& str)
 {
 	return *this << String(str);
@@ -145,7 +153,14 @@ void Serializer::serializeVariableInteger(uint64_t val, std::optional<bool> sign
 
 void Serializer::copyBytes(const void* src, size_t srcSize)
 {
-	if (!dryRun) {
+	if (buffer) {
+		const size_t newSize = size + srcSize;
+		if (newSize > buffer->size()) {
+			buffer->reserve(newSize); // Grows geometrically
+			buffer->resize_no_init(newSize);
+		}
+		memcpy(buffer->data() + size, src, srcSize);
+	} else if (!dryRun) {
 		if (dst.size() - size < srcSize) {
 			throw Exception("Insufficient bytes to serialize data.", HalleyExceptions::Utils);
 		}
@@ -1,6 +1,7 @@
 #include <halley/concurrency/concurrent.h>
 #include <halley/concurrency/executor.h>
 #include <halley/support/exception.h>
+#include <limits>
 
 #include "halley/game/game_platform.h"
 #include "halley/text/string_converter.h"
@@ -10,67 +11,175 @@ using namespace Halley;
 
 Executors* Executors::instance = nullptr;
 
+namespace {
+	struct WorkerThreadInfo {
+		const ExecutionQueue* queue = nullptr;
+		void* worker = nullptr;
+		size_t stealCounter = 0;
+	};
+	thread_local WorkerThreadInfo workerThreadInfo;
+}
+
 ExecutionQueue::ExecutionQueue()
-	: aborted(false)
+	: nWorkers(0)
+	, nActiveWorkers(0)
+	, overflowSize(0)
+	, pending(0)
+	, sleepers(0)
+	, attachedCount(0)
+	, aborted(false)
 {
-	hasTasks.store(false);
 }
 
+ExecutionQueue::~ExecutionQueue() = default;
+
 TaskBase ExecutionQueue::getNext()
 {
-	std::unique_lock<std::mutex> lock(mutex);
-	while (queue.empty()) {
-		if (!aborted) {
-			condition.wait(lock);
+	while (true) {
+		TaskNodePool::Index idx;
+		if (tryPop(idx)) {
+			return nodes.release(idx);
 		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
 		if (aborted) {
-			queue.clear();
 			return TaskBase([] () {});
 		}
+		++sleepers;
+		condition.wait(lock, [&] () { return pending.load() > 0 || aborted; });
+		--sleepers;
 	}
-
-	TaskBase value = queue.front();
-	queue.pop_front();
-	return value;
 }
 
 Vector<TaskBase> ExecutionQueue::getUpTo(size_t n)
 {
-	std::unique_lock<std::mutex> lock(mutex);
-	if (queue.size() <= n) {
-		hasTasks.store(false);
-		Vector<TaskBase> tasks(queue.begin(), queue.end());
-		queue.clear();
-		return tasks;
-	} else {
-		Vector<TaskBase> tasks(queue.begin(), queue.begin() + n);
-		queue.erase(queue.begin(), queue.begin() + n);
-		return tasks;
+	Vector<TaskBase> tasks;
+	TaskNodePool::Index idx;
+	while (tasks.size() < n && tryPop(idx)) {
+		tasks.push_back(nodes.release(idx));
 	}
+	return tasks;
 }
 
 Vector<TaskBase> ExecutionQueue::getAll()
 {
-	std::unique_lock<std::mutex> lock(mutex);
-	hasTasks.store(false);
-	Vector<TaskBase> tasks(queue.begin(), queue.end());
-	queue.clear();
-	return tasks;
+	return getUpTo(std::numeric_limits<size_t>::max());
 }
 
 void ExecutionQueue::addToQueue(TaskBase task)
 {
 	if (immediate) {
 		task();
-	} else {
-		std::unique_lock<std::mutex> lock(mutex);
-		queue.emplace_back(task);
-		hasTasks.store(true);
+		return;
+	}
+
+	const auto idx = nodes.alloc(std::move(task));
 
+	// Count it before it's visible, so a sleeping worker never misses it. At worst a worker spins for a moment until it shows up.
+	++pending;
+	// With a single worker there's no one to steal from it, and the ring keeps everything in order
+	auto* worker = nActiveWorkers.load() > 1 ? getCurrentWorker() : nullptr;
+	if (!worker || !worker->deque.push(idx)) {
+		inject(idx);
+	}
+
+	if (sleepers.load() > 0) {
+		std::unique_lock<std::mutex> lock(sleepMutex);
 		condition.notify_one();
 	}
 }
 
+void ExecutionQueue::inject(TaskNodePool::Index idx)
+{
+	// Once anything spills into the overflow, keep using it until it drains, to preserve ordering
+	if (overflowSize.load() == 0 && ring.push(idx)) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(overflowMutex);
+	overflow.push_back(idx);
+	++overflowSize;
+}
+
+bool ExecutionQueue::tryPop(TaskNodePool::Index& idx)
+{
+	bool found = false;
+
+	if (auto* worker = getCurrentWorker()) {
+		// Taken from the same end as thieves do, so the worker's own tasks also run in the order they were queued
+		found = worker->deque.steal(idx);
+	}
+
+	if (!found) {
+		found = ring.pop(idx);
+	}
+
+	if (!found && overflowSize.load() > 0) {
+		std::unique_lock<std::mutex> lock(overflowMutex);
+		if (!overflow.empty()) {
+			idx = overflow.front();
+			overflow.pop_front();
+			--overflowSize;
+			found = true;
+		}
+	}
+
+	if (!found) {
+		const size_t n = nWorkers.load(std::memory_order_acquire);
+		const size_t start = workerThreadInfo.stealCounter++;
+		for (size_t i = 0; i < n && !found; ++i) {
+			found = workers[(start + i) % n]->deque.steal(idx);
+		}
+	}
+
+	if (found) {
+		--pending;
+	}
+	return found;
+}
+
+ExecutionQueue::Worker* ExecutionQueue::getCurrentWorker() const
+{
+	return workerThreadInfo.queue == this ? static_cast<Worker*>(workerThreadInfo.worker) : nullptr;
+}
+
+void ExecutionQueue::attachWorkerThread()
+{
+	std::unique_lock<std::mutex> lock(workersMutex);
+
+	// Reuse the deque of a detached worker if possible, any tasks left on it will just be picked up by this thread
+	Worker* worker = nullptr;
+	const size_t n = nWorkers.load();
+	for (size_t i = 0; i < n && !worker; ++i) {
+		if (!workers[i]->inUse) {
+			worker = workers[i].get();
+		}
+	}
+	if (!worker && n < maxWorkers) {
+		workers[n] = std::make_unique<Worker>();
+		worker = workers[n].get();
+		nWorkers.store(n + 1, std::memory_order_release);
+	}
+
+	if (worker) {
+		worker->inUse = true;
+		++nActiveWorkers;
+		workerThreadInfo.queue = this;
+		workerThreadInfo.worker = worker;
+	}
+}
+
+void ExecutionQueue::detachWorkerThread()
+{
+	if (auto* worker = getCurrentWorker()) {
+		std::unique_lock<std::mutex> lock(workersMutex);
+		worker->inUse = false;
+		--nActiveWorkers;
+		workerThreadInfo.queue = nullptr;
+		workerThreadInfo.worker = nullptr;
+	}
+}
+
 Executors::Executors()
 {
 	immediate.setImmediate(true);
@@ -107,7 +216,7 @@ void ExecutionQueue::onDetached()
 void ExecutionQueue::abort()
 {
 	{
-		std::unique_lock<std::mutex> lock(mutex);
+		std::unique_lock<std::mutex> lock(sleepMutex);
 		if (aborted) {
 			return;
 		}
@@ -164,6 +273,7 @@ void Executor::runPending()
 
 void Executor::runForever()
 {
+	queue.attachWorkerThread();
 	while (running)	{
 		auto next = queue.getNext();
 		try {
@@ -174,6 +284,7 @@ void Executor::runForever()
 			Logger::logError("Unknown exception in executor.");
 		}
 	}
+	queue.detachWorkerThread();
 }
 
 void Executor::stop()
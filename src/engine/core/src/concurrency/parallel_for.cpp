@@ -0,0 +1,171 @@
+#include "halley/concurrency/parallel_for.h"
+
+#include <algorithm>
+#include <thread>
+#include <gsl/assert>
+#include "halley/concurrency/executor.h"
+
+using namespace Halley;
+
+namespace {
+	uint64_t packRange(uint64_t begin, uint64_t end)
+	{
+		return (end << 32) | begin;
+	}
+
+	uint32_t getRangeBegin(uint64_t range)
+	{
+		return static_cast<uint32_t>(range & 0xFFFFFFFFull);
+	}
+
+	uint32_t getRangeEnd(uint64_t range)
+	{
+		return static_cast<uint32_t>(range >> 32);
+	}
+}
+
+ParallelForState::ParallelForState(size_t n, size_t nWorkers, size_t grainSize, void* context, RunFunction run)
+	: ranges(std::make_unique<Range[]>(nWorkers))
+	, nWorkers(nWorkers)
+	, grainSize(static_cast<uint32_t>(grainSize))
+	, context(context)
+	, run(run)
+	, nextWorker(1)
+	, activeHelpers(0)
+	, finished(false)
+{
+	Expects(n <= 0xFFFFFFFFull);
+	Expects(grainSize > 0 && grainSize <= 0xFFFFFFFFull);
+
+	for (size_t i = 0; i < nWorkers; ++i) {
+		ranges[i].value.store(packRange(n * i / nWorkers, n * (i + 1) / nWorkers));
+	}
+}
+
+void ParallelForState::runWorker(size_t workerIdx)
+{
+	size_t begin;
+	size_t end;
+	while (next(workerIdx, begin, end)) {
+		try {
+			run(context, begin, end);
+		} catch (...) {
+			std::unique_lock<std::mutex> lock(exceptionMutex);
+			if (!exception) {
+				exception = std::current_exception();
+			}
+		}
+	}
+}
+
+bool ParallelForState::tryRunHelper()
+{
+	// The caller doesn't wait for helpers that never got to start, so it's not safe to touch the context after it's finished
+	++activeHelpers;
+	if (finished) {
+		--activeHelpers;
+		return false;
+	}
+
+	const size_t workerIdx = nextWorker++;
+	Expects(workerIdx < nWorkers);
+	runWorker(workerIdx);
+
+	--activeHelpers;
+	return true;
+}
+
+void ParallelForState::finish()
+{
+	// At this point every range is empty, but helpers might still be running their last grain
+	finished = true;
+	while (activeHelpers > 0) {
+		std::this_thread::yield();
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+bool ParallelForState::next(size_t workerIdx, size_t& begin, size_t& end)
+{
+	auto& range = ranges[workerIdx].value;
+	uint64_t cur = range.load();
+
+	while (true) {
+		const uint32_t curBegin = getRangeBegin(cur);
+		const uint32_t curEnd = getRangeEnd(cur);
+
+		if (curBegin >= curEnd) {
+			if (!steal(workerIdx)) {
+				return false;
+			}
+			cur = range.load();
+			continue;
+		}
+
+		const uint64_t newBegin = std::min(static_cast<uint64_t>(curEnd), static_cast<uint64_t>(curBegin) + grainSize);
+		if (range.compare_exchange_weak(cur, packRange(newBegin, curEnd))) {
+			begin = curBegin;
+			end = static_cast<size_t>(newBegin);
+			return true;
+		}
+	}
+}
+
+bool ParallelForState::steal(size_t workerIdx)
+{
+	for (size_t i = 1; i < nWorkers; ++i) {
+		auto& victim = ranges[(workerIdx + i) % nWorkers].value;
+		uint64_t cur = victim.load();
+
+		while (true) {
+			const uint32_t curBegin = getRangeBegin(cur);
+			const uint32_t curEnd = getRangeEnd(cur);
+			if (curBegin >= curEnd) {
+				break;
+			}
+
+			// Take the back half, or everything if it's down to a single grain
+			const uint32_t size = curEnd - curBegin;
+			const uint32_t mid = size > grainSize ? curBegin + size / 2 : curBegin;
+			if (victim.compare_exchange_weak(cur, packRange(curBegin, mid))) {
+				// Nobody else writes to an empty range, so this doesn't need to be a CAS
+				ranges[workerIdx].value.store(packRange(mid, curEnd));
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void Concurrent::parallelForImpl(ExecutionQueue& queue, size_t n, size_t grainSize, void* context, ParallelForState::RunFunction run)
+{
+	if (n == 0) {
+		return;
+	}
+
+	const size_t nThreads = queue.threadCount() + 1;
+	if (grainSize == 0) {
+		grainSize = std::max(size_t(1), n / (nThreads * 8));
+	}
+
+	const size_t nWorkers = std::min(nThreads, (n + grainSize - 1) / grainSize);
+	if (nWorkers <= 1) {
+		run(context, 0, n);
+		return;
+	}
+
+	auto state = std::make_shared<ParallelForState>(n, nWorkers, grainSize, context, run);
+	for (size_t i = 1; i < nWorkers; ++i) {
+		queue.addToQueue([state] ()
+		{
+			state->tryRunHelper();
+		});
+	}
+
+	state->runWorker(0);
+	state->finish();
+}
@@ -0,0 +1,206 @@
+#include "halley/concurrency/work_stealing.h"
+
+#include "halley/support/exception.h"
+
+using namespace Halley;
+
+TaskNodePool::TaskNodePool()
+	: nBlocks(0)
+	, freeHead(0)
+{
+	for (auto& block: blocks) {
+		block.store(nullptr);
+	}
+}
+
+TaskNodePool::~TaskNodePool()
+{
+	for (size_t i = 0; i < nBlocks; ++i) {
+		delete[] blocks[i].load();
+	}
+}
+
+TaskNodePool::Index TaskNodePool::alloc(TaskBase task)
+{
+	uint64_t head = freeHead.load(std::memory_order_acquire);
+	while (true) {
+		const uint32_t idxPlusOne = static_cast<uint32_t>(head & 0xFFFFFFFFull);
+		if (idxPlusOne == 0) {
+			grow();
+			head = freeHead.load(std::memory_order_acquire);
+			continue;
+		}
+
+		// The node might be popped and reused by someone else in the meantime, but then the tag won't match
+		auto& node = getNode(idxPlusOne - 1);
+		const uint64_t newHead = (((head >> 32) + 1) << 32) | node.next.load(std::memory_order_relaxed);
+		if (freeHead.compare_exchange_weak(head, newHead, std::memory_order_acq_rel, std::memory_order_acquire)) {
+			node.task = std::move(task);
+			return idxPlusOne - 1;
+		}
+	}
+}
+
+TaskBase TaskNodePool::release(Index idx)
+{
+	TaskBase result = std::move(getNode(idx).task);
+	push(idx, idx);
+	return result;
+}
+
+TaskNodePool::Node& TaskNodePool::getNode(Index idx) const
+{
+	return blocks[idx >> blockShift].load(std::memory_order_acquire)[idx & (blockSize - 1)];
+}
+
+void TaskNodePool::push(Index first, Index last)
+{
+	auto& lastNode = getNode(last);
+	uint64_t head = freeHead.load(std::memory_order_relaxed);
+	uint64_t newHead;
+	do {
+		lastNode.next.store(static_cast<uint32_t>(head & 0xFFFFFFFFull), std::memory_order_relaxed);
+		newHead = (((head >> 32) + 1) << 32) | (first + 1);
+	} while (!freeHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void TaskNodePool::grow()
+{
+	std::unique_lock<std::mutex> lock(growMutex);
+	if ((freeHead.load() & 0xFFFFFFFFull) != 0) {
+		// Someone else grew it while we waited
+		return;
+	}
+
+	const size_t blockIdx = nBlocks.load();
+	if (blockIdx >= maxBlocks) {
+		throw Exception("Too many tasks queued", HalleyExceptions::Concurrency);
+	}
+
+	auto* block = new Node[blockSize];
+	const auto firstIdx = static_cast<Index>(blockIdx << blockShift);
+	for (size_t i = 0; i < blockSize - 1; ++i) {
+		block[i].next.store(firstIdx + static_cast<Index>(i) + 2, std::memory_order_relaxed);
+	}
+	blocks[blockIdx].store(block, std::memory_order_release);
+	nBlocks.store(blockIdx + 1);
+
+	push(firstIdx, firstIdx + static_cast<Index>(blockSize) - 1);
+}
+
+
+TaskDeque::TaskDeque()
+	: top(0)
+	, bottom(0)
+	, buffer(std::make_unique<std::atomic<uint32_t>[]>(capacity))
+{
+}
+
+bool TaskDeque::push(uint32_t value)
+{
+	const int64_t b = bottom.load(std::memory_order_relaxed);
+	const int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= static_cast<int64_t>(capacity)) {
+		return false;
+	}
+
+	buffer[b & (capacity - 1)].store(value, std::memory_order_relaxed);
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+bool TaskDeque::pop(uint32_t& value)
+{
+	const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_seq_cst);
+
+	if (t > b) {
+		// Empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	value = buffer[b & (capacity - 1)].load(std::memory_order_relaxed);
+	if (t == b) {
+		// Last element, race against thieves for it
+		const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+bool TaskDeque::steal(uint32_t& value)
+{
+	int64_t t = top.load(std::memory_order_seq_cst);
+	const int64_t b = bottom.load(std::memory_order_seq_cst);
+	if (t >= b) {
+		return false;
+	}
+
+	// The owner can't overwrite this slot until top moves past it, so if the CAS succeeds, the value read is good
+	value = buffer[t & (capacity - 1)].load(std::memory_order_acquire);
+	return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+
+TaskRing::TaskRing()
+	: pushPos(0)
+	, popPos(0)
+	, cells(std::make_unique<Cell[]>(capacity))
+{
+	for (size_t i = 0; i < capacity; ++i) {
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+bool TaskRing::push(uint32_t value)
+{
+	size_t pos = pushPos.load(std::memory_order_relaxed);
+	Cell* cell;
+	while (true) {
+		cell = &cells[pos & (capacity - 1)];
+		const size_t seq = cell->sequence.load(std::memory_order_acquire);
+		const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+		if (diff == 0) {
+			if (pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// Full
+			return false;
+		} else {
+			pos = pushPos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->value = value;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+bool TaskRing::pop(uint32_t& value)
+{
+	size_t pos = popPos.load(std::memory_order_relaxed);
+	Cell* cell;
+	while (true) {
+		cell = &cells[pos & (capacity - 1)];
+		const size_t seq = cell->sequence.load(std::memory_order_acquire);
+		const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+		if (diff == 0) {
+			if (popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// Empty
+			return false;
+		} else {
+			pos = popPos.load(std::memory_order_relaxed);
+		}
+	}
+
+	value = cell->value;
+	cell->sequence.store(pos + capacity, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,261 @@
+#include "halley/entity/archetype_storage.h"
+
+#include <new>
+#include "halley/entity/entity.h"
+#include "halley/entity/type_deleter.h"
+
+using namespace Halley;
+
+Archetype::Column::Column(int componentId, TypeDeleterBase& type, size_t elemsPerChunk)
+	: componentId(componentId)
+	, type(&type)
+	, elemSize(type.getSize())
+	, alignment(type.getAlignment())
+	, elemsPerChunk(elemsPerChunk)
+{
+}
+
+Archetype::Column::~Column()
+{
+	for (auto* chunk: chunks) {
+		::operator delete(chunk, std::align_val_t(alignment));
+	}
+}
+
+Archetype::Column::Column(Column&& other) noexcept
+	: componentId(other.componentId)
+	, type(other.type)
+	, elemSize(other.elemSize)
+	, alignment(other.alignment)
+	, elemsPerChunk(other.elemsPerChunk)
+	, chunks(std::move(other.chunks))
+{
+	other.chunks.clear();
+}
+
+void Archetype::Column::reserve(size_t n)
+{
+	while (chunks.size() * elemsPerChunk < n) {
+		chunks.push_back(static_cast<char*>(::operator new(elemsPerChunk * elemSize, std::align_val_t(alignment))));
+	}
+}
+
+Archetype::Archetype(const FamilyMask::RealType& components, bool enabled, ComponentDeleterTable& table)
+	: components(components)
+	, enabled(enabled)
+{
+	size_t largest = 0;
+	for (int i = 0; i < static_cast<int>(components.size()); ++i) {
+		if (components[i] && table.get(i)->isRelocatable()) {
+			largest = std::max(largest, table.get(i)->getSize());
+		}
+	}
+	elemsPerChunk = std::max(size_t(1), chunkBytes / std::max(largest, size_t(1)));
+
+	for (int i = 0; i < static_cast<int>(components.size()); ++i) {
+		if (components[i] && table.get(i)->isRelocatable()) {
+			columns.emplace_back(i, *table.get(i), elemsPerChunk);
+		}
+	}
+}
+
+const Archetype::Column* Archetype::tryGetColumn(int componentId) const
+{
+	for (const auto& column: columns) {
+		if (column.getComponentId() == componentId) {
+			return &column;
+		}
+	}
+	return nullptr;
+}
+
+ArchetypeStorage::ArchetypeStorage(ComponentDeleterTable& table)
+	: table(table)
+{
+}
+
+ArchetypeStorage::~ArchetypeStorage() = default;
+
+void ArchetypeStorage::place(Entity& entity, Vector<Entity*>& relocated)
+{
+	auto& location = getLocation(entity);
+
+	FamilyMask::RealType key;
+	for (uint8_t i = 0; i < entity.liveComponents; ++i) {
+		FamilyMask::setBit(key, entity.components[i].first);
+	}
+	auto* archetype = getArchetype(key, entity.enabled && entity.parentEnabled);
+
+	if (location.archetype == archetype) {
+		// Same archetype, but a component might have been removed and re-added, in which case the new one is on the heap
+		bool moved = false;
+		for (uint8_t i = 0; i < entity.liveComponents; ++i) {
+			auto& [id, component] = entity.components[i];
+			if (const auto* column = archetype->tryGetColumn(id)) {
+				void* dst = column->get(location.slot);
+				if (component != dst) {
+					column->getType().moveConstruct(dst, component);
+					column->getType().destroy(component);
+					component = static_cast<Component*>(dst);
+					moved = true;
+				}
+			}
+		}
+		if (moved) {
+			relocated.push_back(&entity);
+		}
+		return;
+	}
+
+	const auto slot = static_cast<uint32_t>(archetype->entities.size());
+	archetype->entities.push_back(&entity);
+	for (auto& column: archetype->columns) {
+		column.reserve(archetype->entities.size());
+	}
+
+	for (uint8_t i = 0; i < entity.liveComponents; ++i) {
+		auto& [id, component] = entity.components[i];
+		if (const auto* column = archetype->tryGetColumn(id)) {
+			void* dst = column->get(slot);
+			column->getType().moveConstruct(dst, component);
+			if (isOwned(location, id, component)) {
+				column->getType().callDestructor(component);
+			} else {
+				column->getType().destroy(component);
+			}
+			component = static_cast<Component*>(dst);
+		}
+	}
+	relocated.push_back(&entity);
+
+	if (location.archetype) {
+		releaseSlot(location, relocated);
+	}
+	location.archetype = archetype;
+	location.slot = slot;
+}
+
+void ArchetypeStorage::remove(Entity& entity, Vector<Entity*>& relocated)
+{
+	auto& location = getLocation(entity);
+	if (!location.archetype) {
+		return;
+	}
+
+	size_t nLive = entity.liveComponents;
+	for (size_t i = 0; i < entity.components.size(); ) {
+		const auto [id, component] = entity.components[i];
+		if (isOwned(location, id, component)) {
+			table.get(id)->callDestructor(component);
+			entity.components.erase(entity.components.begin() + i);
+			if (i < nLive) {
+				--nLive;
+			}
+		} else {
+			++i;
+		}
+	}
+	entity.liveComponents = static_cast<uint8_t>(nLive);
+
+	releaseSlot(location, relocated);
+}
+
+void ArchetypeStorage::evict(Entity& entity, Vector<Entity*>& relocated)
+{
+	auto& location = getLocation(entity);
+	if (!location.archetype) {
+		return;
+	}
+
+	for (auto& [id, component]: entity.components) {
+		if (isOwned(location, id, component)) {
+			auto& type = *table.get(id);
+			auto* heapComponent = static_cast<Component*>(type.moveToHeap(component));
+			type.callDestructor(component);
+			component = heapComponent;
+		}
+	}
+	relocated.push_back(&entity);
+
+	releaseSlot(location, relocated);
+}
+
+void ArchetypeStorage::releaseDeadComponents(Entity& entity)
+{
+	auto& location = getLocation(entity);
+	if (!location.archetype) {
+		return;
+	}
+
+	for (size_t i = entity.liveComponents; i < entity.components.size(); ) {
+		const auto [id, component] = entity.components[i];
+		if (isOwned(location, id, component)) {
+			table.get(id)->callDestructor(component);
+			entity.components.erase(entity.components.begin() + i);
+		} else {
+			++i;
+		}
+	}
+}
+
+Archetype* ArchetypeStorage::getArchetype(const FamilyMask::RealType& components, bool enabled)
+{
+	auto& lookup = archetypeLookup[enabled ? 1 : 0];
+	const auto iter = lookup.find(components);
+	if (iter != lookup.end()) {
+		return iter->second;
+	}
+
+	auto* archetype = archetypes.emplace_back(std::make_unique<Archetype>(components, enabled, table)).get();
+	lookup[components] = archetype;
+	return archetype;
+}
+
+ArchetypeStorage::Location& ArchetypeStorage::getLocation(const Entity& entity)
+{
+	const auto idx = static_cast<size_t>(entity.getEntityId().value & 0xFFFFFFFFll);
+	if (idx >= locations.size()) {
+		locations.resize(idx + 1);
+	}
+	return locations[idx];
+}
+
+bool ArchetypeStorage::isOwned(const Location& location, int componentId, const void* component) const
+{
+	if (!location.archetype) {
+		return false;
+	}
+	const auto* column = location.archetype->tryGetColumn(componentId);
+	return column && column->get(location.slot) == component;
+}
+
+void ArchetypeStorage::releaseSlot(Location& location, Vector<Entity*>& relocated)
+{
+	auto& archetype = *location.archetype;
+	const size_t slot = location.slot;
+	const size_t last = archetype.entities.size() - 1;
+
+	// Swap the last entity of the archetype into the now empty slot
+	if (slot != last) {
+		auto* moved = archetype.entities[last];
+		for (auto& column: archetype.columns) {
+			void* src = column.get(last);
+			void* dst = column.get(slot);
+			for (auto& [id, component]: moved->components) {
+				if (id == column.getComponentId() && component == src) {
+					column.getType().moveConstruct(dst, src);
+					column.getType().callDestructor(src);
+					component = static_cast<Component*>(dst);
+					break;
+				}
+			}
+		}
+		archetype.entities[slot] = moved;
+		getLocation(*moved).slot = static_cast<uint32_t>(slot);
+		relocated.push_back(moved);
+	}
+
+	archetype.entities.pop_back();
+	location.archetype = nullptr;
+	location.slot = 0;
+}
@@ -118,7 +118,7 @@ void Entity::markDirty(World& world)
 {
 	if (!dirty) {
 		dirty = true;
-		world.onEntityDirty();
+		world.onEntityDirty(*this);
 	}
 	++componentRevision;
 }
@@ -128,7 +128,7 @@ ComponentDeleterTable& Entity::getComponentDeleterTable(World& world)
 	return world.getComponentDeleterTable();
 }
 
-void Entity::setParent(Entity* newParent, bool propagate, size_t childIdx)
+void Entity::setParent(World& world, Entity* newParent, bool propagate, size_t childIdx)
 {
 	Expects(newParent != this);
 	if (newParent) {
@@ -153,7 +153,7 @@ void Entity::setParent(Entity* newParent, bool propagate, size_t childIdx)
 			if (worldPartition != newParent->worldPartition) {
 				propagateChildWorldPartition(newParent->worldPartition);
 			}
-			propagateEnabled(enabled, newParent->enabled && newParent->parentEnabled);
+			propagateEnabled(world, enabled, newParent->enabled && newParent->parentEnabled);
 			if (childIdx >= parent->children.size()) {
 				parent->children.push_back(this);
 			} else {
@@ -161,7 +161,7 @@ void Entity::setParent(Entity* newParent, bool propagate, size_t childIdx)
 			}
 			parent->propagateChildrenChange();
 		} else {
-			propagateEnabled(enabled, true);
+			propagateEnabled(world, enabled, true);
 		}
 
 		if (propagate) {
@@ -170,16 +170,16 @@ void Entity::setParent(Entity* newParent, bool propagate, size_t childIdx)
 	}
 }
 
-void Entity::addChild(Entity& child)
+void Entity::addChild(World& world, Entity& child)
 {
-	child.setParent(this);
+	child.setParent(world, this);
 }
 
-void Entity::detachChildren()
+void Entity::detachChildren(World& world)
 {
 	auto childrenCopy = std::move(children);
 	for (auto& child : childrenCopy) {
-		child->setParent(nullptr);
+		child->setParent(world, nullptr);
 	}
 	children.clear();
 }
@@ -215,7 +215,7 @@ void Entity::propagateChildWorldPartition(WorldPartitionId newWorldPartition)
 	}
 }
 
-void Entity::propagateEnabled(bool enabledStatus, bool parentStatus)
+void Entity::propagateEnabled(World& world, bool enabledStatus, bool parentStatus)
 {
 	const bool oldStatus = enabled && parentEnabled;
 	enabled = enabledStatus;
@@ -224,9 +224,12 @@ void Entity::propagateEnabled(bool enabledStatus, bool parentStatus)
 
 	if (oldStatus != newStatus) {
 		for (auto& child: children) {
-			child->propagateEnabled(child->enabled, newStatus);
+			child->propagateEnabled(world, child->enabled, newStatus);
+		}
+		if (!dirty) {
+			dirty = true;
+			world.onEntityDirty(*this);
 		}
-		dirty = true;
 		++componentRevision;
 		markHierarchyDirty();
 	}
@@ -235,8 +238,7 @@ void Entity::propagateEnabled(bool enabledStatus, bool parentStatus)
 void Entity::setEnabled(World& world, bool enabled)
 {
 	if (enabled != this->enabled) {
-		propagateEnabled(enabled, parentEnabled);
-		world.onEntityDirty();
+		propagateEnabled(world, enabled, parentEnabled);
 	}
 }
 
@@ -418,7 +420,7 @@ void Entity::doDestroy(World& world, bool updateParenting)
 	}
 	
 	if (updateParenting) {
-		setParent(nullptr, false);
+		setParent(world, nullptr, false);
 	}
 
 	for (auto& c: children) {
@@ -429,7 +431,10 @@ void Entity::doDestroy(World& world, bool updateParenting)
 	world.onEntityDestroyed(getInstanceUUID());
 	
 	alive = false;
-	dirty = true;
+	if (!dirty) {
+		dirty = true;
+		world.onEntityDirty(*this);
+	}
 }
 
 bool Entity::hasBit(const World& world, int index) const
@@ -445,7 +450,5 @@ bool Entity::hasAnyBit(const World& world, gsl::span<const int> indices) const
 void EntityRef::setReloaded()
 {
 	Expects(entity);
-	entity->reloaded = true;
-
-	world->setEntityReloaded();
+	world->setEntityReloaded(*entity);
 }
@@ -33,8 +33,23 @@ void FamilyBindingBase::onEntitiesReloaded(void* entity, size_t count)
 	reloadedCallback(entity, count);
 }
 
-void FamilyBindingBase::setFamily(Family* f) noexcept {
+void FamilyBindingBase::setFamily(Family* f, World& w) noexcept {
 	family = f;
+	world = &w;
+}
+
+ArchetypeStorage& FamilyBindingBase::getArchetypeStorage() const
+{
+	auto* storage = world ? world->getArchetypeStorage() : nullptr;
+	if (!storage) {
+		throw Exception("World does not use archetype storage.", HalleyExceptions::Entity);
+	}
+	return *storage;
+}
+
+const FamilyMask::RealType& FamilyBindingBase::getInclusionMask() const
+{
+	return family->getInclusionMask().getRealValue(world->getMaskStorage());
 }
 
 void FamilyBindingBase::setOnEntitiesAdded(std::function<void(void*, size_t)> callback)
@@ -7,6 +7,33 @@
 
 using namespace Halley;
 
+bool SystemAccessInfo::conflictsWith(const SystemAccessInfo& other) const
+{
+	if (exclusive || other.exclusive) {
+		return true;
+	}
+	if (usesAPI && other.usesAPI) {
+		return true;
+	}
+
+	const auto intersects = [] (const auto& a, const auto& b)
+	{
+		for (const auto& v: a) {
+			if (std_ex::contains(b, v)) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	return intersects(componentsWritten, other.componentsWritten)
+		|| intersects(componentsWritten, other.componentsRead)
+		|| intersects(componentsRead, other.componentsWritten)
+		|| intersects(services, other.services)
+		|| intersects(messagesSent, other.messagesReceived)
+		|| intersects(messagesReceived, other.messagesSent);
+}
+
 SystemMessageBridge::SystemMessageBridge(System& system)
 	: system(&system)
 {
@@ -117,7 +144,12 @@ void System::doSendMessage(EntityId entityId, std::unique_ptr<Message> msg, int
 	}
 
 	if (world->isEntityNetworkRemote(e)) {
-		world->sendNetworkMessage(entityId, id, std::move(msg));
+		if (runningConcurrently) {
+			// The network interface is not thread-safe, so defer these until the system's messages are dispatched
+			remoteOutbox.emplace_back(std::make_pair(MessageEntry(std::move(msg), id, systemId), entityId));
+		} else {
+			world->sendNetworkMessage(entityId, id, std::move(msg));
+		}
 	} else {
 		outbox.emplace_back(std::make_pair(MessageEntry(std::move(msg), id, systemId), entityId));
 	}
@@ -125,6 +157,13 @@ void System::doSendMessage(EntityId entityId, std::unique_ptr<Message> msg, int
 
 void System::dispatchMessages()
 {
+	if (!remoteOutbox.empty()) {
+		for (auto& o: remoteOutbox) {
+			world->sendNetworkMessage(o.second, o.first.type, std::move(o.first.msg));
+		}
+		remoteOutbox.clear();
+	}
+
 	if (!outbox.empty()) {
 		for (auto& o: outbox) {
 			const int type = o.first.type;
@@ -212,19 +251,29 @@ void System::sendSystemMessageConfig(const String& targetSystem, const String& m
 
 void System::doUpdate(Time time) {
 	HALLEY_DEBUG_TRACE_COMMENT(name.c_str());
+	doMainUpdate(time);
+	doPostUpdate();
+	HALLEY_DEBUG_TRACE_COMMENT(name.c_str());
+}
+
+void System::doMainUpdate(Time time)
+{
 	ProfilerEvent event(ProfilerEventType::WorldSystemUpdate, name);
 
 	if (!messageTypesReceived.empty()) {
 		processMessages();
 	}
+	updateBase(time);
+}
+
+void System::doPostUpdate()
+{
+	// Both of these touch the world's shared message inboxes, so they must not run concurrently with other systems
 	if (!messageTypesSentThisUpdate.empty()) {
 		world->purgeMessages(systemId, messageTypesSentThisUpdate);
 		messageTypesSentThisUpdate.clear();
 	}
-	
-	updateBase(time);
 	dispatchMessages();
-	HALLEY_DEBUG_TRACE_COMMENT(name.c_str());
 }
 
 void System::doRender(RenderContext& rc) {
@@ -0,0 +1,109 @@
+#include "halley/entity/system_scheduler.h"
+
+#include <exception>
+#include <mutex>
+#include "halley/concurrency/concurrent.h"
+#include "halley/entity/system.h"
+
+using namespace Halley;
+
+namespace {
+	thread_local TempMemoryPool* threadMemoryPool = nullptr;
+}
+
+SystemScheduler::SystemScheduler() = default;
+
+SystemScheduler::~SystemScheduler() = default;
+
+void SystemScheduler::invalidate()
+{
+	for (auto& schedule: schedules) {
+		schedule.reset();
+	}
+}
+
+const Vector<SystemScheduler::Batch>& SystemScheduler::getSchedule(TimeLine timeline, const Vector<std::unique_ptr<System>>& systems)
+{
+	auto& schedule = schedules[static_cast<int>(timeline)];
+	if (!schedule) {
+		schedule = buildSchedule(systems);
+	}
+	return *schedule;
+}
+
+Vector<SystemScheduler::Batch> SystemScheduler::buildSchedule(const Vector<std::unique_ptr<System>>& systems)
+{
+	const size_t n = systems.size();
+
+	Vector<SystemAccessInfo> accessInfo;
+	accessInfo.reserve(n);
+	for (const auto& system: systems) {
+		accessInfo.push_back(system->getAccessInfo());
+	}
+
+	// Each system goes on the batch right after the last batch containing a system that it conflicts with.
+	// This keeps conflicting systems in their original order, while letting independent ones run earlier.
+	Vector<size_t> batchIdx(n, 0);
+	Vector<Batch> result;
+	for (size_t i = 0; i < n; ++i) {
+		size_t idx = 0;
+		for (size_t j = 0; j < i; ++j) {
+			if (batchIdx[j] + 1 > idx && accessInfo[i].conflictsWith(accessInfo[j])) {
+				idx = batchIdx[j] + 1;
+			}
+		}
+		batchIdx[i] = idx;
+
+		if (idx >= result.size()) {
+			result.resize(idx + 1);
+		}
+		result[idx].push_back(systems[i].get());
+	}
+
+	return result;
+}
+
+void SystemScheduler::runBatch(const Batch& batch, Time elapsed, ExecutionQueue& queue)
+{
+	const size_t n = batch.size();
+	while (memoryPools.size() < n) {
+		memoryPools.push_back(std::make_unique<TempMemoryPool>(256 * 1024));
+	}
+
+	for (auto* system: batch) {
+		system->runningConcurrently = true;
+	}
+
+	std::mutex exceptionMutex;
+	std::exception_ptr exception;
+
+	// Helpers that only start once the batch is done find nothing left to do, and aren't waited on
+	Concurrent::parallelFor(queue, n, 1, [&] (size_t i)
+	{
+		auto& pool = *memoryPools[i];
+		threadMemoryPool = &pool;
+		try {
+			batch[i]->doMainUpdate(elapsed);
+		} catch (...) {
+			std::unique_lock<std::mutex> lock(exceptionMutex);
+			if (!exception) {
+				exception = std::current_exception();
+			}
+		}
+		threadMemoryPool = nullptr;
+		pool.reset();
+	});
+
+	for (auto* system: batch) {
+		system->runningConcurrently = false;
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+TempMemoryPool* SystemScheduler::getCurrentMemoryPool()
+{
+	return threadMemoryPool;
+}
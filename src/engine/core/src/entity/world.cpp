@@ -7,6 +7,8 @@
 #include <cassert>
 
 #include "halley/entity/system.h"
+#include "halley/entity/system_scheduler.h"
+#include "halley/entity/archetype_storage.h"
 #include "halley/entity/family.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/text/string_converter.h"
@@ -132,6 +134,9 @@ System& World::addSystem(std::unique_ptr<System> system, TimeLine timelineType)
 	auto& timeline = getSystems(timelineType);
 	timeline.emplace_back(std::move(system));
 	ref.onAddedToWorld(*this, int(timeline.size()));
+	if (systemScheduler) {
+		systemScheduler->invalidate();
+	}
 	return ref;
 }
 
@@ -141,6 +146,9 @@ void World::removeSystem(System& system)
 		for (size_t i = 0; i < sys.size(); i++) {
 			if (sys[i].get() == &system) {
 				sys.erase(sys.begin() + i);
+				if (systemScheduler) {
+					systemScheduler->invalidate();
+				}
 				return;
 			}
 		}
@@ -270,7 +278,10 @@ void World::moveEntitiesFrom(World& other, std::optional<WorldPartitionId> world
 		if (!worldPartition || e->worldPartition == worldPartition) {
 			entitiesToMove.push_back(e);
 			e->alive = false;
-			e->dirty = true;
+			if (!e->dirty) {
+				e->dirty = true;
+				other.onEntityDirty(*e);
+			}
 			other.uuidMap.erase(e->getInstanceUUID());
 		}
 	}
@@ -278,7 +289,6 @@ void World::moveEntitiesFrom(World& other, std::optional<WorldPartitionId> world
 	// Update other world
 	// We tell it not to delete entities - we want them to "leak" since we're stealing them
 	// It'll still remove it from families and whatnot
-	other.entityDirty = true;
 	other.canDeleteEntities = false;
 	other.spawnPending();
 	other.canDeleteEntities = true;
@@ -288,6 +298,7 @@ void World::moveEntitiesFrom(World& other, std::optional<WorldPartitionId> world
 	for (auto* e: entitiesToMove) {
 		e->dirty = true;
 		e->alive = true;
+		onEntityDirty(*e);
 		e->mask = FamilyMask::Handle();
 
 		auto entityRef = EntityRef(*e, *this);
@@ -351,7 +362,6 @@ void World::doDestroyEntity(EntityId id)
 void World::doDestroyEntity(Entity* e)
 {
 	e->destroy(*this);
-	entityDirty = true;
 }
 
 EntityRef World::getEntity(EntityId id)
@@ -472,15 +482,17 @@ gsl::span<Entity*> World::getRawEntities()
 	return entities.span();
 }
 
-void World::onEntityDirty()
+void World::onEntityDirty(Entity& entity)
 {
-	entityDirty = true;
+	dirtyEntities.push_back(&entity);
 }
 
-void World::setEntityReloaded()
+void World::setEntityReloaded(Entity& entity)
 {
-	entityReloaded = true;
-	entityDirty = true;
+	if (!entity.reloaded && entity.isAlive()) {
+		entity.reloaded = true;
+		reloadedEntities.push_back(&entity);
+	}
 }
 
 const WorldReflection& World::getReflection() const
@@ -611,8 +623,57 @@ void World::setHeadless(bool headless)
 	this->headless = headless;
 }
 
+void World::setParallelSystemUpdate(bool enabled)
+{
+	if (enabled && !systemScheduler) {
+		systemScheduler = std::make_unique<SystemScheduler>();
+	} else if (!enabled) {
+		systemScheduler.reset();
+	}
+}
+
+bool World::isParallelSystemUpdate() const
+{
+	return !!systemScheduler;
+}
+
+void World::setArchetypeStorage(bool enabled)
+{
+	if (enabled == !!archetypeStorage) {
+		return;
+	}
+	if (!maskStorage) {
+		throw Exception("Archetype storage is not supported on staging worlds", HalleyExceptions::Entity);
+	}
+
+	spawnPending();
+
+	Vector<Entity*> relocated;
+	if (enabled) {
+		archetypeStorage = std::make_unique<ArchetypeStorage>(*componentDeleterTable);
+		for (auto* entity: entities) {
+			archetypeStorage->place(*entity, relocated);
+		}
+	} else {
+		for (auto* entity: entities) {
+			archetypeStorage->evict(*entity, relocated);
+		}
+		archetypeStorage.reset();
+	}
+	onEntitiesRelocated(relocated);
+}
+
+ArchetypeStorage* World::getArchetypeStorage() const
+{
+	return archetypeStorage.get();
+}
+
 TempMemoryPool& World::getUpdateMemoryPool() const
 {
+	// Systems running concurrently each get their own pool
+	if (auto* pool = SystemScheduler::getCurrentMemoryPool()) {
+		return *pool;
+	}
 	return *updateMemoryPool;
 }
 
@@ -624,12 +685,40 @@ TempMemoryPool& World::getRenderMemoryPool() const
 void World::deleteEntity(Entity* entity)
 {
 	Expects (entity);
+	if (archetypeStorage) {
+		Vector<Entity*> relocated;
+		archetypeStorage->remove(*entity, relocated);
+	}
 	entityMap->freeId(entity->getEntityId().value);
 	entity->destroyComponents(*componentDeleterTable);
 	entity->~Entity();
 	entityPool->free(entity);
 }
 
+void World::onEntitiesRelocated(gsl::span<Entity* const> relocated)
+{
+	// Component addresses changed, so update everything that caches them
+	Vector<Entity*> entities(relocated.begin(), relocated.end());
+	std::sort(entities.begin(), entities.end());
+	entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+
+	for (auto* entity: entities) {
+		if (!entity->isAlive()) {
+			continue;
+		}
+
+		for (auto* family: getFamiliesFor(entity->getMask())) {
+			family->refreshEntity(*entity);
+		}
+
+		auto entityRef = EntityRef(*entity, *this);
+		for (uint8_t i = 0; i < entity->liveComponents; ++i) {
+			const auto& [id, component] = entity->components[i];
+			reflection->getComponentReflector(id).rebindComponent(*component, entityRef);
+		}
+	}
+}
+
 bool World::hasSystemsOnTimeLine(TimeLine timeline) const
 {
 	return !getSystems(timeline).empty();
@@ -668,9 +757,12 @@ void World::spawnPending()
 		for (auto& e : entitiesPendingCreation) {
 			e->onReady();
 		}
-		std::move(entitiesPendingCreation.begin(), entitiesPendingCreation.end(), std::insert_iterator<decltype(entities)>(entities, entities.end()));
+		entities.reserve(entities.size() + entitiesPendingCreation.size());
+		for (auto* e: entitiesPendingCreation) {
+			e->worldIndex = static_cast<uint32_t>(entities.size());
+			entities.push_back(e);
+		}
 		entitiesPendingCreation.clear();
-		entityDirty = true;
 		HALLEY_DEBUG_TRACE();
 	}
 
@@ -679,98 +771,93 @@ void World::spawnPending()
 
 void World::updateEntities()
 {
-	if (!entityDirty) {
+	if (dirtyEntities.empty() && reloadedEntities.empty()) {
 		return;
 	}
 
-	entityDirty = false;
+	// Entities can be marked dirty again by family callbacks below, so work on a copy of the lists
+	std::swap(dirtyEntities, dirtyEntitiesScratch);
+	std::swap(reloadedEntities, reloadedEntitiesScratch);
+	dirtyEntities.clear();
+	reloadedEntities.clear();
 
 	HALLEY_DEBUG_TRACE();
-	size_t nEntities = entities.size();
+	const size_t nEntities = dirtyEntitiesScratch.size();
 
-	Vector<size_t> entitiesRemoved;
+	Vector<Entity*> entitiesRemoved;
+	Vector<Entity*> entitiesRefreshed;
 
-	struct FamilyTodo {
-		Vector<std::pair<FamilyMaskType, Entity*>> toAdd;
-		Vector<std::pair<FamilyMaskType, Entity*>> toRemove;
-		Vector<std::pair<FamilyMaskType, Entity*>> toReload;
+	struct MaskChange {
+		Entity* entity;
+		FamilyMaskType oldMask;
+		FamilyMaskType newMask;
 	};
-	std::map<FamilyMaskType, FamilyTodo> pending;
+	Vector<MaskChange> changes;
 
-	// Update all entities
+	// Update all dirty entities
 	// This loop should be as fast as reasonably possible
 	for (size_t i = 0; i < nEntities; i++) {
-		auto& entity = *entities[i];
+		auto& entity = *dirtyEntitiesScratch[i];
 		if (i + 20 < nEntities) { // Watch out for sign! Don't subtract!
-			prefetchL2(entities[i + 20]);
+			prefetchL2(dirtyEntitiesScratch[i + 20]);
 		}
 
-		// Check if it needs any sort of updating
-		if (entity.needsRefresh()) {
-			// First of all, let's check if it's dead
-			if (!entity.isAlive()) {
-				// Remove from systems
-				pending[entity.getMask()].toRemove.emplace_back(FamilyMaskType(), &entity);
-				entitiesRemoved.push_back(i);
-			} else {
-				// It's alive, so check old and new system inclusions
-				FamilyMaskType oldMask = entity.getMask();
-				entity.refresh(maskStorage.get(), *componentDeleterTable);
-				FamilyMaskType newMask = entity.getMask();
-
-				// Did it change?
-				if (oldMask != newMask) {
-					pending[oldMask].toRemove.emplace_back(newMask, &entity);
-					pending[newMask].toAdd.emplace_back(oldMask, &entity);
-				}
-			}
+		if (!entity.needsRefresh()) {
+			continue;
 		}
-	}
 
-	if (entityReloaded) {
-		for (size_t i = 0; i < nEntities; i++) {
-			auto& entity = *entities[i];
-			if (entity.reloaded && entity.isAlive()) {
-				pending[entity.getMask()].toReload.emplace_back(entity.getMask(), &entity);
-				entity.reloaded = false;
+		// First of all, let's check if it's dead
+		if (!entity.isAlive()) {
+			// Remove from systems
+			changes.push_back({ &entity, entity.getMask(), FamilyMaskType() });
+			entitiesRemoved.push_back(&entity);
+		} else {
+			// It's alive, so check old and new system inclusions
+			FamilyMaskType oldMask = entity.getMask();
+			if (archetypeStorage) {
+				archetypeStorage->releaseDeadComponents(entity);
+				entitiesRefreshed.push_back(&entity);
+			}
+			entity.refresh(maskStorage.get(), *componentDeleterTable);
+			FamilyMaskType newMask = entity.getMask();
+
+			// Did it change?
+			if (oldMask != newMask) {
+				changes.push_back({ &entity, oldMask, newMask });
 			}
 		}
 	}
 
-	entityReloaded = false;
-
 	HALLEY_DEBUG_TRACE();
 	// Go through every family adding/removing entities as needed
 	if (maskStorage) {
-		for (auto& todo: pending) {
-			for (auto* fam: getFamiliesFor(todo.first)) {
-				const auto& famMask = fam->inclusionMask;
-				const auto& optFamMask = fam->optionalMask;
-				auto& ms = *maskStorage;
-				
-				for (auto& e: todo.second.toRemove) {
-					// Only remove if the entity is not about to be re-added
-					const auto& newMask = e.first;
-					if (!newMask.contains(famMask, ms)) {
-						fam->removeEntity(*e.second);
-					}
+		auto& ms = *maskStorage;
+
+		for (const auto& change: changes) {
+			for (auto* fam: getFamiliesFor(change.oldMask)) {
+				// Only remove if the entity is not about to be re-added
+				if (!change.newMask.contains(fam->inclusionMask, ms)) {
+					fam->removeEntity(*change.entity);
 				}
-				for (auto& e: todo.second.toAdd) {
-					// Only add if the entity was not already in this
-					const auto& oldMask = e.first;
-					const auto& newMask = todo.first;
-					if (!oldMask.contains(famMask, ms)) {
-						fam->addEntity(*e.second);
-					} else if (optFamMask.unionChangedBetween(oldMask, newMask, ms)) {
-						// Needs refreshing of optional references
-						fam->refreshEntity(*e.second);
-					}
+			}
+			for (auto* fam: getFamiliesFor(change.newMask)) {
+				// Only add if the entity was not already in this
+				if (!change.oldMask.contains(fam->inclusionMask, ms)) {
+					fam->addEntity(*change.entity);
+				} else if (fam->optionalMask.unionChangedBetween(change.oldMask, change.newMask, ms)) {
+					// Needs refreshing of optional references
+					fam->refreshEntity(*change.entity);
 				}
+			}
+		}
 
-				for (auto& e : todo.second.toReload) {
-					fam->reloadEntity(*e.second);
+		for (auto* entity: reloadedEntitiesScratch) {
+			if (entity->reloaded && entity->isAlive()) {
+				for (auto* fam: getFamiliesFor(entity->getMask())) {
+					fam->reloadEntity(*entity);
 				}
 			}
+			entity->reloaded = false;
 		}
 	}
 
@@ -781,22 +868,35 @@ void World::updateEntities()
 	}
 	
 	HALLEY_DEBUG_TRACE();
-	// Actually remove dead entities
-	if (!entitiesRemoved.empty()) {
-		size_t livingEntityCount = entities.size();
-		for (int i = int(entitiesRemoved.size()); --i >= 0; ) {
-			size_t idx = entitiesRemoved[i];
-			auto& entity = *entities[idx];
-
-			// Remove
+	// Move components into their archetype chunks. Families have already let go of removed entities at this point.
+	if (archetypeStorage) {
+		Vector<Entity*> relocated;
+		for (auto* entity: entitiesRemoved) {
 			if (canDeleteEntities) {
-				deleteEntity(&entity);
+				archetypeStorage->remove(*entity, relocated);
+			} else {
+				archetypeStorage->evict(*entity, relocated);
 			}
+		}
+		for (auto* entity: entitiesRefreshed) {
+			archetypeStorage->place(*entity, relocated);
+		}
+		onEntitiesRelocated(relocated);
+	}
 
-			// Put it at the back of the array, so it's removed when the array gets resized
-			std::swap(entities[idx], entities[--livingEntityCount]);
+	HALLEY_DEBUG_TRACE();
+	// Actually remove dead entities
+	for (auto* entity: entitiesRemoved) {
+		// Swap it with the last entity, so it can be popped
+		const auto idx = entity->worldIndex;
+		Expects(idx < entities.size() && entities[idx] == entity);
+		entities[idx] = entities.back();
+		entities[idx]->worldIndex = idx;
+		entities.pop_back();
+
+		if (canDeleteEntities) {
+			deleteEntity(entity);
 		}
-		entities.resize(livingEntityCount);
 	}
 
 	HALLEY_DEBUG_TRACE();
@@ -817,6 +917,11 @@ void World::initSystems(gsl::span<const TimeLine> timelines)
 
 void World::updateSystems(TimeLine timeline, Time elapsed)
 {
+	if (systemScheduler) {
+		updateSystemsParallel(timeline, elapsed);
+		return;
+	}
+
 	for (auto& system : getSystems(timeline)) {
 		updateMemoryPool->reset();
 		system->doUpdate(elapsed);
@@ -825,6 +930,31 @@ void World::updateSystems(TimeLine timeline, Time elapsed)
 	}
 }
 
+void World::updateSystemsParallel(TimeLine timeline, Time elapsed)
+{
+	auto& queue = Executors::getCPU();
+
+	for (const auto& batch: systemScheduler->getSchedule(timeline, getSystems(timeline))) {
+		if (batch.size() == 1 || queue.threadCount() == 0) {
+			for (auto* system: batch) {
+				updateMemoryPool->reset();
+				system->doUpdate(elapsed);
+				spawnPending();
+				updateMemoryPool->reset();
+			}
+		} else {
+			// Sync point: messages are dispatched in the original system order, and entities spawned only after the whole batch is done
+			updateMemoryPool->reset();
+			systemScheduler->runBatch(batch, elapsed, queue);
+			for (auto* system: batch) {
+				system->doPostUpdate();
+			}
+			spawnPending();
+			updateMemoryPool->reset();
+		}
+	}
+}
+
 void World::renderSystems(RenderContext& rc) const
 {
 	for (auto& system : getSystems(TimeLine::Render)) {
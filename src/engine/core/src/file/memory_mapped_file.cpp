@@ -0,0 +1,113 @@
+#include "halley/file/memory_mapped_file.h"
+#include "halley/support/exception.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#define HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace Halley;
+
+bool MemoryMappedFile::isSupported()
+{
+#ifdef HAS_MMAP
+	return true;
+#else
+	return false;
+#endif
+}
+
+#ifdef HAS_MMAP
+
+MemoryMappedFile::MemoryMappedFile(const Path& path)
+{
+	fd = open(path.getNativeString().c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		fd = -1;
+		return;
+	}
+
+	const auto size = static_cast<size_t>(st.st_size);
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (mapped == MAP_FAILED) {
+		::close(fd);
+		fd = -1;
+		return;
+	}
+
+	data = static_cast<const gsl::byte*>(mapped);
+	fileSize = size;
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	if (data) {
+		munmap(const_cast<gsl::byte*>(data), fileSize);
+	}
+	if (fd >= 0) {
+		::close(fd);
+	}
+}
+
+size_t MemoryMappedFile::readAt(size_t pos, gsl::span<gsl::byte> dst) const
+{
+	if (!data || pos >= fileSize) {
+		return 0;
+	}
+
+	const size_t toRead = std::min(size_t(dst.size()), fileSize - pos);
+	size_t nRead = 0;
+	while (nRead < toRead) {
+		const auto n = pread(fd, dst.data() + nRead, toRead - nRead, static_cast<off_t>(pos + nRead));
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			throw Exception("Unable to read from memory mapped file.", HalleyExceptions::File);
+		}
+		nRead += static_cast<size_t>(n);
+	}
+	return nRead;
+}
+
+#else
+
+MemoryMappedFile::MemoryMappedFile(const Path& path)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+}
+
+size_t MemoryMappedFile::readAt(size_t pos, gsl::span<gsl::byte> dst) const
+{
+	return 0;
+}
+
+#endif
+
+bool MemoryMappedFile::isOpen() const
+{
+	return data != nullptr;
+}
+
+size_t MemoryMappedFile::size() const
+{
+	return fileSize;
+}
+
+gsl::span<const gsl::byte> MemoryMappedFile::getSpan() const
+{
+	return gsl::span<const gsl::byte>(data, fileSize);
+}
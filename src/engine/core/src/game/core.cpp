@@ -139,6 +139,7 @@ void Core::onReloaded()
 	if (api->system) {
 		api->system->setThreadName("main");
 	}
+	ProfilerCapture::get().setThreadName("main");
 
 	if (api->systemInternal) {
 		api->systemInternal->onResume();
@@ -210,6 +211,7 @@ void Core::init()
 	if (api->system) {
 		api->system->setThreadName("main");
 	}
+	ProfilerCapture::get().setThreadName("main");
 
 	// Resources
 	initResources();
@@ -712,6 +712,11 @@ const void* Sprite::getVertexAttrib() const
 	return reinterpret_cast<const char*>(&vertexAttrib) - sizeof(Vector4f);
 }
 
+void Sprite::copyVertexData(char* dst) const
+{
+	memcpy(dst, getVertexAttrib(), vertexDataSize);
+}
+
 Vector2f Sprite::getUncroppedSize() const
 {
 	return getSize() + Vector2f(outerBorder.xy() + outerBorder.zw());
@@ -2,14 +2,27 @@
 #include "halley/graphics/sprite/sprite.h"
 #include "halley/graphics/painter.h"
 #include <gsl/gsl>
+#include <array>
+#include <cstring>
 
 #include "halley/graphics/material/material.h"
 #include "halley/graphics/material/material_definition.h"
 #include "halley/graphics/text/text_renderer.h"
 #include "halley/utils/algorithm.h"
+#include "halley/concurrency/executor.h"
+#include "halley/concurrency/parallel_for.h"
 
 using namespace Halley;
 
+namespace {
+	constexpr size_t parallelGrainSize = 1024;
+
+	bool isSpriteEntry(SpritePainterEntryType type)
+	{
+		return type == SpritePainterEntryType::SpriteRef || type == SpritePainterEntryType::SpriteCached;
+	}
+}
+
 SpritePainterEntry::SpritePainterEntry(gsl::span<const Sprite> sprites, int mask, int layer, float tieBreaker, size_t insertOrder, std::optional<Rect4f> clip)
 	: ptr(sprites.empty() ? nullptr : &sprites[0])
 	, count(uint32_t(sprites.size()))
@@ -55,6 +68,20 @@ bool SpritePainterEntry::operator<(const SpritePainterEntry& o) const
 	}
 }
 
+uint64_t SpritePainterEntry::getSortKey() const
+{
+	// Maps (layer, tieBreaker) to an unsigned integer with the same order as operator<
+	// Ties are resolved by insertOrder, which a stable sort preserves as long as entries are appended in order
+	const uint32_t layerKey = static_cast<uint32_t>(layer) ^ 0x80000000u;
+
+	const float tie = tieBreaker == 0 ? 0.0f : tieBreaker; // Don't sort -0 before 0
+	uint32_t tieBits;
+	memcpy(&tieBits, &tie, sizeof(tieBits));
+	const uint32_t tieKey = (tieBits & 0x80000000u) != 0 ? ~tieBits : (tieBits | 0x80000000u);
+
+	return (static_cast<uint64_t>(layerKey) << 32) | tieKey;
+}
+
 SpritePainterEntryType SpritePainterEntry::getType() const
 {
 	return type;
@@ -265,6 +292,7 @@ void SpritePainter::startRender(bool waitForSpriteLoad, bool depthQueriesEnabled
 void SpritePainter::clear()
 {
 	sprites.clear();
+	boundsDirty = true;
 	cachedSprites.clear();
 	cachedText.clear();
 	memoryPool.reset();
@@ -367,27 +395,201 @@ void SpritePainter::add(Rect4f bounds)
 void SpritePainter::draw(SpriteMaskBase mask, Painter& painter)
 {
 	if (dirty) {
-		std::sort(sprites.begin(), sprites.end());
+		sortEntries();
 		dirty = false;
+		boundsDirty = true;
+	}
+	if (boundsDirty) {
+		updateBounds();
+		boundsDirty = false;
 	}
 
 	// View
 	const Rect4f view = painter.getCurrentCamera().getClippingRectangle();
 
 	// Draw!
-	for (auto spriteIdx: getSpriteDrawOrder(mask, view, true)) {
-		auto& s = sprites[spriteIdx];
+	const auto order = getSpriteDrawOrder(mask, view, true);
+	drawEntries(order, painter, view);
+	painter.flush();
+}
+
+void SpritePainter::sortEntries()
+{
+	const auto n = sprites.size();
+	if (n < 256) {
+		std::sort(sprites.begin(), sprites.end());
+		return;
+	}
+
+	// LSD radix sort, one byte at a time, skipping bytes that are the same for every key
+	std::array<std::array<uint32_t, 256>, 8> histograms = {};
+	sortKeys.resize(n);
+	sortKeysScratch.resize(n);
+	for (size_t i = 0; i < n; ++i) {
+		const auto key = sprites[i].getSortKey();
+		sortKeys[i] = { key, static_cast<uint32_t>(i) };
+		for (size_t pass = 0; pass < 8; ++pass) {
+			++histograms[pass][(key >> (pass * 8)) & 0xFF];
+		}
+	}
+
+	auto* src = sortKeys.data();
+	auto* dst = sortKeysScratch.data();
+	for (size_t pass = 0; pass < 8; ++pass) {
+		const auto shift = pass * 8;
+		auto& histogram = histograms[pass];
+		if (histogram[(src[0].first >> shift) & 0xFF] == n) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (auto& count: histogram) {
+			const auto c = count;
+			count = offset;
+			offset += c;
+		}
+		for (size_t i = 0; i < n; ++i) {
+			dst[histogram[(src[i].first >> shift) & 0xFF]++] = src[i];
+		}
+		std::swap(src, dst);
+	}
+
+	sortedEntries.clear();
+	sortedEntries.reserve(n);
+	for (size_t i = 0; i < n; ++i) {
+		sortedEntries.push_back(sprites[src[i].second]);
+	}
+	std::swap(sprites, sortedEntries);
+}
+
+void SpritePainter::updateBounds()
+{
+	const auto n = sprites.size();
+	entryBounds.resize(n);
+
+	Concurrent::parallelFor(Executors::getCPU(), n, parallelGrainSize, [&] (size_t i)
+	{
+		const auto& s = sprites[i];
+		if (isSpriteEntry(s.getType())) {
+			entryBounds[i] = s.getBounds(Rect4f(), cachedSprites, cachedText);
+		}
+	});
+
+	// Text layout is generated lazily, so it's not safe to do it from other threads
+	for (size_t i = 0; i < n; ++i) {
+		const auto& s = sprites[i];
 		const auto type = s.getType();
-		
-		if (type == SpritePainterEntryType::SpriteRef || type == SpritePainterEntryType::SpriteCached) {
-			draw(s.getSprites(cachedSprites), painter, view, s.getClip());
-		} else if (type == SpritePainterEntryType::TextRef || type == SpritePainterEntryType::TextCached) {
-			draw(s.getTexts(cachedText), painter, view, s.getClip());
-		} else if (type == SpritePainterEntryType::Callback) {
-			draw(callbacks.at(s.getIndex()), painter, s.getClip());
+		if (type == SpritePainterEntryType::TextRef || type == SpritePainterEntryType::TextCached) {
+			entryBounds[i] = s.getBounds(Rect4f(), cachedSprites, cachedText);
 		}
 	}
-	painter.flush();
+}
+
+void SpritePainter::drawEntries(gsl::span<const uint32_t> order, Painter& painter, Rect4f view)
+{
+	// One item per sprite, plus one for each text or callback entry
+	drawItems.clear();
+	for (const auto entryIdx: order) {
+		const auto& s = sprites[entryIdx];
+		if (isSpriteEntry(s.getType())) {
+			for (const auto& sprite: s.getSprites(cachedSprites)) {
+				drawItems.push_back(DrawItem{ &sprite, entryIdx, 0, DrawMode::Skip });
+			}
+		} else {
+			drawItems.push_back(DrawItem{ nullptr, entryIdx, 0, DrawMode::Entry });
+		}
+	}
+
+	auto& queue = Executors::getCPU();
+	Concurrent::parallelFor(queue, drawItems.size(), parallelGrainSize, [&] (size_t i)
+	{
+		auto& item = drawItems[i];
+		if (item.sprite) {
+			item.mode = getDrawMode(*item.sprite, sprites[item.entryIdx], view);
+		}
+	});
+
+	// Vertex data is laid out in draw order, so the result doesn't depend on how the work was split between threads
+	uint32_t nBatched = 0;
+	for (auto& item: drawItems) {
+		if (item.mode == DrawMode::Batched) {
+			item.vertexIdx = nBatched++;
+		}
+	}
+	batchVertexData.resize(size_t(nBatched) * Sprite::vertexDataSize);
+
+	Concurrent::parallelFor(queue, drawItems.size(), parallelGrainSize, [&] (size_t i)
+	{
+		const auto& item = drawItems[i];
+		if (item.mode == DrawMode::Batched) {
+			item.sprite->copyVertexData(batchVertexData.data() + size_t(item.vertexIdx) * Sprite::vertexDataSize);
+		}
+	});
+
+	// Submit, merging runs of batched sprites that share a material
+	const std::shared_ptr<const Material>* batchMaterial = nullptr;
+	uint32_t batchStart = 0;
+	uint32_t batchCount = 0;
+
+	auto flushBatch = [&] ()
+	{
+		if (batchCount > 0) {
+			Expects((*batchMaterial)->getDefinition().getVertexStride() == Sprite::vertexDataSize);
+			painter.drawSprites(*batchMaterial, batchCount, batchVertexData.data() + size_t(batchStart) * Sprite::vertexDataSize);
+			batchCount = 0;
+		}
+	};
+
+	for (const auto& item: drawItems) {
+		switch (item.mode) {
+		case DrawMode::Skip:
+			break;
+
+		case DrawMode::Batched:
+			if (batchCount > 0 && item.sprite->getMaterialPtr() != *batchMaterial) {
+				flushBatch();
+			}
+			if (batchCount == 0) {
+				batchMaterial = &item.sprite->getMaterialPtr();
+				batchStart = item.vertexIdx;
+			}
+			++batchCount;
+			break;
+
+		case DrawMode::Individual:
+			flushBatch();
+			draw(*item.sprite, painter, sprites[item.entryIdx].getClip());
+			break;
+
+		case DrawMode::Entry:
+			{
+				flushBatch();
+				const auto& s = sprites[item.entryIdx];
+				const auto type = s.getType();
+				if (type == SpritePainterEntryType::TextRef || type == SpritePainterEntryType::TextCached) {
+					draw(s.getTexts(cachedText), painter, view, s.getClip());
+				} else if (type == SpritePainterEntryType::Callback) {
+					draw(callbacks.at(s.getIndex()), painter, s.getClip());
+				}
+			}
+			break;
+		}
+	}
+	flushBatch();
+}
+
+SpritePainter::DrawMode SpritePainter::getDrawMode(const Sprite& sprite, const SpritePainterEntry& entry, Rect4f view) const
+{
+	// The logic is a bit confusing here - if we're waiting, just go ahead, as the code will eventually wait
+	// If we're not waiting, skip this sprite if it's not loaded
+	if (!sprite.hasMaterial() || !sprite.isInView(view) || !(waitForSpriteLoad || sprite.isLoaded())) {
+		return DrawMode::Skip;
+	}
+
+	if (sprite.canBeBatched() && !entry.getClip() && !paramUpdater.needsToPreProcessessMaterial(sprite)) {
+		return DrawMode::Batched;
+	}
+	return DrawMode::Individual;
 }
 
 Vector<uint32_t> SpritePainter::getSpriteDrawOrder(int mask, Rect4f view, bool reorder) const
@@ -421,18 +623,25 @@ Vector<uint32_t> SpritePainter::getSpriteDrawOrderReordered(int mask, Rect4f vie
 		{}
 	};
 
+	Expects(entryBounds.size() == sprites.size());
+
 	auto entries = VectorTemp<Entry>(memoryPool);
 	auto skipped = VectorTemp<Rect4f>(memoryPool);
 	skipped.reserve(64);
 	constexpr int maxSkipsInARow = 16;
 
-	// Generate filtered sprite draw order, and sprite bounds
+	// Generate filtered sprite draw order, culling sprites out of view
 	const auto nTotal = static_cast<uint32_t>(sprites.size());
 	for (uint32_t i = 0; i < nTotal; ++i) {
 		auto& s = sprites[i];
 
 		if ((s.getMask() & mask) != 0) {
-			entries.emplace_back(i, s.getBounds(view, cachedSprites, cachedText));
+			const auto type = s.getType();
+			if (type == SpritePainterEntryType::Callback) {
+				entries.emplace_back(i, view);
+			} else if (!isSpriteEntry(type) || entryBounds[i].overlaps(view)) {
+				entries.emplace_back(i, entryBounds[i]);
+			}
 		}
 	}
 	const auto n = static_cast<uint32_t>(entries.size());
@@ -546,22 +755,14 @@ SpritePainterMaterialParamUpdater& SpritePainter::getParamUpdater()
 	return paramUpdater;
 }
 
-void SpritePainter::draw(gsl::span<const Sprite> sprites, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const
+void SpritePainter::draw(const Sprite& sprite, Painter& painter, const std::optional<Rect4f>& clip) const
 {
-	for (const auto& sprite: sprites) {
-		if (sprite.isInView(view)) {
-			// The logic is a bit confusing here - if we're waiting, just go ahead, as the code will eventually wait
-			// If we're not waiting, skip this sprite if it's not loaded
-			if (waitForSpriteLoad || sprite.isLoaded()) {
-				if (paramUpdater.needsToPreProcessessMaterial(sprite)) {
-					auto s2 = sprite;
-					paramUpdater.preProcessMaterial(s2);
-					s2.draw(painter, clip);
-				} else {
-					sprite.draw(painter, clip);
-				}
-			}
-		}
+	if (paramUpdater.needsToPreProcessessMaterial(sprite)) {
+		auto s2 = sprite;
+		paramUpdater.preProcessMaterial(s2);
+		s2.draw(painter, clip);
+	} else {
+		sprite.draw(painter, clip);
 	}
 }
 
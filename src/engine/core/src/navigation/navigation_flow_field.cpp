@@ -0,0 +1,284 @@
+#include "halley/navigation/navigation_flow_field.h"
+
+#include "halley/navigation/navmesh_set.h"
+using namespace Halley;
+
+NavigationFlowField::NavigationFlowField(const NavmeshSet& navmeshSet, WorldPosition destination)
+	: navmeshSet(navmeshSet)
+{
+	current.destination = destination;
+	rebuild();
+}
+
+void NavigationFlowField::setDestination(WorldPosition destination)
+{
+	const auto node = findNode(destination);
+
+	// Distances are measured between polygon centres, so they don't change if the destination stays in the same polygon
+	if (!updating && node != noNode && node == current.destinationNode) {
+		current.destination = destination;
+		return;
+	}
+	if (updating && node == pending.destinationNode) {
+		pending.destination = destination;
+		return;
+	}
+
+	startField(destination);
+}
+
+void NavigationFlowField::rebuild()
+{
+	// The old field's numbering doesn't match the new graph, so this one can't be incremental
+	buildGraph();
+	startField(updating ? pending.destination : current.destination);
+	current = Field();
+	update();
+}
+
+bool NavigationFlowField::update(size_t maxNodes)
+{
+	if (!updating) {
+		return true;
+	}
+
+	const auto navmeshes = navmeshSet.getNavmeshes();
+	auto& cells = pending.cells;
+
+	auto relax = [&] (uint32_t nodeIdx, uint16_t exitEdge, float distance)
+	{
+		auto& cell = cells[nodeIdx];
+		if (distance < cell.distance) {
+			cell.distance = distance;
+			cell.exitEdge = exitEdge;
+			openSet.emplace(distance, nodeIdx);
+		}
+	};
+
+	for (size_t nExpanded = 0; nExpanded < maxNodes && !openSet.empty();) {
+		const auto [distance, nodeIdx] = openSet.top();
+		openSet.pop();
+		if (distance > cells[nodeIdx].distance) {
+			// Stale entry
+			continue;
+		}
+		++nExpanded;
+
+		// Everything that leads into this polygon gets to exit through the edge that does so
+		const auto navmeshIdx = nodeNavmesh[nodeIdx];
+		const auto localIdx = static_cast<Navmesh::NodeId>(nodeIdx - firstNode[navmeshIdx]);
+		const auto& nodes = navmeshes[navmeshIdx].getNodes();
+		const auto& node = nodes[localIdx];
+		for (size_t i = 0; i < node.nConnections; ++i) {
+			if (!node.connections[i]) {
+				continue;
+			}
+			const auto neighIdx = node.connections[i].value();
+			const auto& neigh = nodes[neighIdx];
+			for (size_t j = 0; j < neigh.nConnections; ++j) {
+				if (neigh.connections[j] && neigh.connections[j].value() == localIdx) {
+					relax(firstNode[navmeshIdx] + neighIdx, static_cast<uint16_t>(j), distance + neigh.costs[j]);
+					break;
+				}
+			}
+		}
+
+		for (uint32_t i = portalLinkStart[nodeIdx]; i < portalLinkStart[nodeIdx + 1]; ++i) {
+			const auto& link = portalLinks[i];
+			relax(link.from, link.edge, distance + link.cost);
+		}
+	}
+
+	if (openSet.empty()) {
+		current = std::move(pending);
+		pending = Field();
+		updating = false;
+		return true;
+	}
+	return false;
+}
+
+bool NavigationFlowField::isUpToDate() const
+{
+	return !updating;
+}
+
+WorldPosition NavigationFlowField::getDestination() const
+{
+	return updating ? pending.destination : current.destination;
+}
+
+std::optional<NavigationFlowField::Sample> NavigationFlowField::sample(WorldPosition pos) const
+{
+	Cursor cursor;
+	return sample(pos, cursor);
+}
+
+std::optional<NavigationFlowField::Sample> NavigationFlowField::sample(WorldPosition pos, Cursor& cursor) const
+{
+	const auto nodeIdx = findNode(pos, cursor);
+	if (nodeIdx == noNode || nodeIdx >= current.cells.size()) {
+		return {};
+	}
+	const auto& cell = current.cells[nodeIdx];
+	if (std::isinf(cell.distance)) {
+		return {};
+	}
+
+	const auto& navmesh = navmeshSet.getNavmeshes()[cursor.navmeshId];
+	auto direction = [] (Vector2f delta)
+	{
+		return delta.squaredLength() > 0.000001f ? delta.unit() : Vector2f();
+	};
+
+	if (nodeIdx == current.destinationNode) {
+		return Sample{ direction(current.destination.pos - pos.pos), current.destination, 0.0f };
+	}
+
+	// Head for the closest point of the exit edge, but keep away from its ends so agents don't hug the corners
+	constexpr float edgeMargin = 0.1f;
+	const auto edge = navmesh.getPolygons()[cursor.nodeId].getEdge(cell.exitEdge);
+	const float t = clamp(edge.getClosestPointParametric(pos.pos), edgeMargin, 1.0f - edgeMargin);
+	const auto target = edge.getPoint(t);
+
+	// Sitting on the edge already, so go straight through it
+	auto delta = target - pos.pos;
+	if (delta.squaredLength() < 1.0f) {
+		const auto normal = (edge.b - edge.a).orthoLeft();
+		delta = normal.dot(target - navmesh.getNodes()[cursor.nodeId].pos) >= 0 ? normal : -normal;
+	}
+
+	return Sample{ direction(delta), WorldPosition(target, navmesh.getSubWorld()), cell.distance };
+}
+
+void NavigationFlowField::buildGraph()
+{
+	const auto navmeshes = navmeshSet.getNavmeshes();
+
+	firstNode.resize(navmeshes.size() + 1);
+	uint32_t nNodes = 0;
+	for (size_t i = 0; i < navmeshes.size(); ++i) {
+		firstNode[i] = nNodes;
+		nNodes += static_cast<uint32_t>(navmeshes[i].getNumNodes());
+	}
+	firstNode[navmeshes.size()] = nNodes;
+
+	nodeNavmesh.resize(nNodes);
+	for (size_t i = 0; i < navmeshes.size(); ++i) {
+		std::fill(nodeNavmesh.begin() + firstNode[i], nodeNavmesh.begin() + firstNode[i + 1], static_cast<uint16_t>(i));
+	}
+
+	// Each polygon along a portal crosses into the polygon on the other side whose edge is closest to its own
+	Vector<std::pair<uint32_t, PortalLink>> links;
+	for (uint16_t navmeshIdx = 0; navmeshIdx < static_cast<uint16_t>(navmeshes.size()); ++navmeshIdx) {
+		const auto& navmesh = navmeshes[navmeshIdx];
+		const auto& portals = navmesh.getPortals();
+		for (uint16_t portalIdx = 0; portalIdx < static_cast<uint16_t>(portals.size()); ++portalIdx) {
+			const auto& portal = portals[portalIdx];
+			if (!portal.connected) {
+				continue;
+			}
+			const auto [otherNavmeshIdx, otherPortalIdx] = navmeshSet.getPortalDestination(navmeshIdx, portalIdx);
+			if (otherNavmeshIdx >= navmeshes.size()) {
+				continue;
+			}
+			const auto& otherNavmesh = navmeshes[otherNavmeshIdx];
+			const auto& otherPortal = otherNavmesh.getPortals()[otherPortalIdx];
+
+			for (const auto& conn: portal.connections) {
+				const auto edge = navmesh.getPolygons()[conn.node].getEdge(conn.connectionIdx);
+				const auto edgeMid = (edge.a + edge.b) * 0.5f;
+
+				float bestDist = std::numeric_limits<float>::infinity();
+				std::optional<Navmesh::NodeId> best;
+				for (const auto& otherConn: otherPortal.connections) {
+					const auto otherEdge = otherNavmesh.getPolygons()[otherConn.node].getEdge(otherConn.connectionIdx);
+					const float dist = ((otherEdge.a + otherEdge.b) * 0.5f - edgeMid).squaredLength();
+					if (dist < bestDist) {
+						bestDist = dist;
+						best = otherConn.node;
+					}
+				}
+
+				if (best) {
+					const float cost = (otherNavmesh.getNodes()[*best].pos - navmesh.getNodes()[conn.node].pos).length() * otherNavmesh.getWeights()[*best];
+					links.emplace_back(firstNode[otherNavmeshIdx] + *best, PortalLink{ firstNode[navmeshIdx] + conn.node, conn.connectionIdx, cost });
+				}
+			}
+		}
+	}
+
+	// Group them by the polygon they lead into
+	portalLinkStart.clear();
+	portalLinkStart.resize(nNodes + 1, 0);
+	for (const auto& [to, link]: links) {
+		++portalLinkStart[to + 1];
+	}
+	for (uint32_t i = 0; i < nNodes; ++i) {
+		portalLinkStart[i + 1] += portalLinkStart[i];
+	}
+	portalLinks.resize(links.size());
+	auto next = portalLinkStart;
+	for (const auto& [to, link]: links) {
+		portalLinks[next[to]++] = link;
+	}
+}
+
+void NavigationFlowField::startField(WorldPosition destination)
+{
+	pending = Field();
+	pending.destination = destination;
+	pending.destinationNode = findNode(destination);
+	pending.cells.resize(nodeNavmesh.size());
+	openSet = {};
+
+	if (pending.destinationNode != noNode) {
+		pending.cells[pending.destinationNode].distance = 0;
+		openSet.emplace(0.0f, pending.destinationNode);
+	}
+	updating = true;
+}
+
+uint32_t NavigationFlowField::findNode(WorldPosition pos) const
+{
+	Cursor cursor;
+	return findNode(pos, cursor);
+}
+
+uint32_t NavigationFlowField::findNode(WorldPosition pos, Cursor& cursor) const
+{
+	const auto navmeshes = navmeshSet.getNavmeshes();
+
+	// Usually the agent is still in the same polygon as last time, or in one next to it
+	if (cursor.navmeshId < navmeshes.size() && navmeshes[cursor.navmeshId].getSubWorld() == pos.subWorld) {
+		const auto& navmesh = navmeshes[cursor.navmeshId];
+		if (cursor.nodeId < navmesh.getNumNodes()) {
+			if (navmesh.getPolygons()[cursor.nodeId].isPointInside(pos.pos)) {
+				return firstNode[cursor.navmeshId] + cursor.nodeId;
+			}
+
+			const auto& node = navmesh.getNodes()[cursor.nodeId];
+			for (size_t i = 0; i < node.nConnections; ++i) {
+				if (node.connections[i] && navmesh.getPolygons()[node.connections[i].value()].isPointInside(pos.pos)) {
+					cursor.nodeId = node.connections[i].value();
+					return firstNode[cursor.navmeshId] + cursor.nodeId;
+				}
+			}
+		}
+	}
+
+	const auto navmeshIdx = navmeshSet.getNavMeshIdxAt(pos);
+	if (!navmeshIdx || *navmeshIdx + size_t(1) >= firstNode.size()) {
+		cursor = Cursor();
+		return noNode;
+	}
+	const auto nodeId = navmeshes[*navmeshIdx].getNodeAt(pos.pos);
+	if (!nodeId) {
+		cursor = Cursor();
+		return noNode;
+	}
+
+	cursor.navmeshId = *navmeshIdx;
+	cursor.nodeId = *nodeId;
+	return firstNode[cursor.navmeshId] + cursor.nodeId;
+}
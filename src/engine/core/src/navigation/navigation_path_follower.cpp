@@ -44,11 +44,26 @@ void NavigationPathFollower::setComputingPath()
 void NavigationPathFollower::setPath(std::optional<NavigationPath> p, ConfigNode params)
 {
 	computingPath = false;
+	flowField.reset();
+	flowSample.reset();
 	doSetPath(std::move(p));
 	this->params = std::move(params);
 	this->params.ensureType(ConfigNodeType::Map);
 }
 
+void NavigationPathFollower::setFlowField(std::shared_ptr<const NavigationFlowField> field)
+{
+	computingPath = false;
+	doSetPath({});
+	flowField = std::move(field);
+	flowSample.reset();
+}
+
+const std::shared_ptr<const NavigationFlowField>& NavigationPathFollower::getFlowField() const
+{
+	return flowField;
+}
+
 void NavigationPathFollower::doSetPath(std::optional<NavigationPath> p)
 {
 	path = std::move(p);
@@ -73,6 +88,11 @@ void NavigationPathFollower::update(WorldPosition curPos, const NavmeshSet& navm
 {
 	this->curPos = curPos;
 
+	if (flowField) {
+		updateFlowField(threshold);
+		return;
+	}
+
 	if (!path) {
 		return;
 	}
@@ -117,11 +137,36 @@ void NavigationPathFollower::reEvaluatePath(const NavmeshSet& navmeshSet)
 	doSetPath(navmeshSet.pathfind(query));
 }
 
+void NavigationPathFollower::updateFlowField(float threshold)
+{
+	const auto destination = flowField->getDestination();
+	if (destination.subWorld == curPos.subWorld && (destination.pos - curPos.pos).squaredLength() < threshold * threshold) {
+		flowField.reset();
+		flowSample.reset();
+		return;
+	}
+
+	flowSample = flowField->sample(curPos, flowCursor);
+}
+
 WorldPosition NavigationPathFollower::getNextPosition() const
 {
+	if (flowField) {
+		return flowSample ? flowSample->target : curPos;
+	}
 	return getPointAtIdx(nextPathIdx);
 }
 
+Vector2f NavigationPathFollower::getSteeringDirection() const
+{
+	if (flowField) {
+		return flowSample ? flowSample->direction : Vector2f();
+	}
+
+	const auto delta = getNextPosition().pos - curPos.pos;
+	return delta.squaredLength() > 0.000001f ? delta.unit() : Vector2f();
+}
+
 WorldPosition NavigationPathFollower::getPointAtIdx(size_t idx) const
 {
 	if (!path || path->path.empty()) {
@@ -140,16 +185,17 @@ size_t NavigationPathFollower::getNextPathIdx() const
 
 bool NavigationPathFollower::isFollowingPath() const
 {
-	return !!path;
+	return path || flowField;
 }
 
 bool NavigationPathFollower::isDone() const
 {
-	return !path;
+	return !path && !flowField;
 }
 
 void NavigationPathFollower::detachFromNavmesh()
 {
+	flowCursor = NavigationFlowField::Cursor();
 	if (path) {
 		for (auto& p: path->path) {
 			p.navmeshId = std::numeric_limits<uint16_t>::max();
@@ -0,0 +1,153 @@
+#include "halley/navigation/navigation_service.h"
+
+#include "halley/concurrency/concurrent.h"
+#include "halley/navigation/navmesh_set.h"
+#include "halley/navigation/navmesh_search_state.h"
+#include "halley/time/stopwatch.h"
+#include "halley/utils/algorithm.h"
+using namespace Halley;
+
+NavigationService::NavigationService(const NavmeshSet& navmeshSet, size_t nWorkers)
+	: NavigationService(navmeshSet, Executors::getCPU(), nWorkers)
+{
+}
+
+NavigationService::NavigationService(const NavmeshSet& navmeshSet, ExecutionQueue& queue, size_t nWorkers)
+	: navmeshSet(navmeshSet)
+	, executionQueue(queue)
+	, nextInBatch(0)
+	, batchTimeSpent(0)
+{
+	if (nWorkers == 0) {
+		nWorkers = std::max(queue.threadCount(), static_cast<size_t>(1));
+	}
+	for (size_t i = 0; i < nWorkers; ++i) {
+		scratch.push_back(std::make_unique<NavmeshSearchScratch>());
+	}
+}
+
+NavigationService::~NavigationService()
+{
+	for (auto& worker: workers) {
+		worker.wait();
+	}
+}
+
+Future<NavigationService::Result> NavigationService::pathfind(NavigationQuery query, float anisotropy, float nudge)
+{
+	auto& request = queued.emplace_back();
+	request.query = std::move(query);
+	request.anisotropy = anisotropy;
+	request.nudge = nudge;
+	request.promise.emplace();
+	return request.promise->getFuture();
+}
+
+void NavigationService::pathfind(NavigationQuery query, Callback callback, float anisotropy, float nudge)
+{
+	auto& request = queued.emplace_back();
+	request.query = std::move(query);
+	request.anisotropy = anisotropy;
+	request.nudge = nudge;
+	request.callback = std::move(callback);
+}
+
+void NavigationService::update(Time budget)
+{
+	if (!isIdle()) {
+		return;
+	}
+
+	finishBatch();
+	startBatch(budget);
+}
+
+void NavigationService::waitForIdle()
+{
+	for (auto& worker: workers) {
+		worker.wait();
+	}
+	finishBatch();
+}
+
+bool NavigationService::isIdle() const
+{
+	return std::all_of(workers.begin(), workers.end(), [] (const Future<void>& f) { return f.isReady(); });
+}
+
+NavigationService::Stats NavigationService::getStats() const
+{
+	auto result = stats;
+	result.queued = queued.size() + batch.size();
+	return result;
+}
+
+void NavigationService::startBatch(Time budget)
+{
+	// Drop anything whose future was cancelled before it gets to a worker
+	std_ex::erase_if(queued, [] (const Request& r) { return r.promise && r.promise->isCancelled(); });
+	if (queued.empty()) {
+		return;
+	}
+
+	batch = std::move(queued);
+	queued.clear();
+	nextInBatch = 0;
+	batchTimeSpent = 0;
+	batchBudget = static_cast<int64_t>(budget * 1'000'000'000.0);
+
+	const size_t nWorkers = std::min(scratch.size(), batch.size());
+	for (size_t i = 0; i < nWorkers; ++i) {
+		workers.push_back(Concurrent::execute(executionQueue, [this, workerScratch = scratch[i].get()] ()
+		{
+			runWorker(*workerScratch);
+		}));
+	}
+}
+
+void NavigationService::finishBatch()
+{
+	workers.clear();
+	if (batch.empty()) {
+		return;
+	}
+
+	// Anything the workers didn't get to goes back to the front of the queue, ahead of newer requests
+	const size_t nDone = std::min(nextInBatch.load(), batch.size());
+	stats.lastBatchSize = nDone;
+	stats.lastBatchSearchTime = static_cast<Time>(batchTimeSpent.load()) / 1'000'000'000.0;
+
+	auto done = std::move(batch);
+	batch.clear();
+	queued.insert(queued.begin(), std::make_move_iterator(done.begin() + nDone), std::make_move_iterator(done.end()));
+	done.resize(nDone);
+
+	// Callbacks might queue more requests, so run them after the queue is back in a consistent state
+	for (auto& request: done) {
+		if (request.promise) {
+			request.promise->setValue(std::move(request.result));
+		} else if (request.callback) {
+			request.callback(std::move(request.result));
+		}
+	}
+}
+
+void NavigationService::runWorker(NavmeshSearchScratch& workerScratch)
+{
+	// Every worker runs at least one query, so the queue always makes progress however small the budget
+	bool first = true;
+	while (first || batchTimeSpent.load(std::memory_order_relaxed) < batchBudget) {
+		first = false;
+
+		const size_t idx = nextInBatch.fetch_add(1);
+		if (idx >= batch.size()) {
+			break;
+		}
+
+		Stopwatch timer;
+		auto& request = batch[idx];
+		request.result = navmeshSet.pathfind(request.query, workerScratch, nullptr, request.anisotropy, request.nudge);
+		timer.pause();
+		batchTimeSpent += timer.elapsedNanoseconds();
+	}
+}
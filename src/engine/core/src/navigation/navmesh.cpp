@@ -2,12 +2,12 @@
 
 #include <cassert>
 
-#include "halley/data_structures/priority_queue.h"
 #include "halley/maths/random.h"
 #include "halley/maths/ray.h"
 #include "halley/support/logger.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/navigation/navmesh_set.h"
+#include "halley/navigation/navmesh_search_state.h"
 using namespace Halley;
 
 Navmesh::Navmesh()
@@ -368,7 +368,18 @@ void Navmesh::NodeAndConn::deserialize(Deserializer& s)
 	s >> connectionIdx;
 }
 
+NavmeshSearchScratch& NavmeshSearchScratch::getThreadLocal()
+{
+	static thread_local NavmeshSearchScratch scratch;
+	return scratch;
+}
+
 std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfindNodes(const NavigationQuery& query) const
+{
+	return pathfindNodes(query, NavmeshSearchScratch::getThreadLocal());
+}
+
+std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfindNodes(const NavigationQuery& query, NavmeshSearchScratch& scratch) const
 {
 	if (query.from.subWorld != subWorld || query.to.subWorld != subWorld) {
 		return {};
@@ -381,12 +392,17 @@ std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfindNodes(const Navigat
 		return {};
 	}
 
-	return pathfind(fromId.value(), toId.value());
+	return pathfind(fromId.value(), toId.value(), scratch);
 }
 
 std::optional<NavigationPath> Navmesh::pathfind(const NavigationQuery& query) const
 {
-	auto nodePath = pathfindNodes(query);
+	return pathfind(query, NavmeshSearchScratch::getThreadLocal());
+}
+
+std::optional<NavigationPath> Navmesh::pathfind(const NavigationQuery& query, NavmeshSearchScratch& scratch) const
+{
+	auto nodePath = pathfindNodes(query, scratch);
 	if (!nodePath) {
 		return {};
 	}
@@ -394,20 +410,7 @@ std::optional<NavigationPath> Navmesh::pathfind(const NavigationQuery& query) co
 	return makePath(query, nodePath.value());
 }
 
-Vector<Navmesh::NodeAndConn> Navmesh::makeResult(const Vector<State>& state, int startId, int endId) const
-{
-	Vector<NodeAndConn> result;
-	for (NodeAndConn curNode(endId); true; curNode = state[curNode.node].cameFrom) {
-		result.push_back(curNode);
-		if (curNode.node == startId) {
-			break;
-		}
-	}
-	std::reverse(result.begin(), result.end());
-	return result;
-}
-
-std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, int toId) const
+std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, int toId, NavmeshSearchScratch& scratch) const
 {
 	// Ensure the query is valid
 	if (fromId < 0 || fromId >= static_cast<int>(nodes.size()) || toId < 0 || toId >= static_cast<int>(nodes.size())) {
@@ -415,13 +418,10 @@ std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, int to
 		return {};
 	}
 
-	// State map. Using vector for perf, trading space for CPU.
-	// TODO: measure this vs unordered_map or some other hashtable, it's not impossible that it'd perform better (compact memory)
-	Vector<State> state(nodes.size(), State{});
-
-	// Open set
-	auto openSet = PriorityQueue<NodeId, NodeComparator>(NodeComparator(state));
-	openSet.reserve(std::min(static_cast<size_t>(100), nodes.size()));
+	// Reused between queries, so this doesn't cost anything proportional to the size of the navmesh
+	auto& state = scratch.polygons;
+	state.begin(nodes.size());
+	auto& openSet = state.getOpenSet();
 
 	// Define heuristic function
 	const Vector2f endPos = nodes[toId].pos;
@@ -438,7 +438,7 @@ std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, int to
 		firstNodeState.gScore = 0;
 		firstNodeState.fScore = h(nodes[fromId].pos);
 		firstNodeState.inOpenSet = true;
-		openSet.push(fromId);
+		openSet.push(static_cast<NodeId>(fromId));
 	}
 
 	// Run A*
@@ -446,7 +446,15 @@ std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, int to
 		const auto curId = openSet.top();
 		if (curId == toId) {
 			// Done!
-			return makeResult(state, fromId, toId);
+			Vector<NodeAndConn> result;
+			for (NodeAndConn curNode(static_cast<NodeId>(toId)); true; curNode = state[curNode.node].cameFrom) {
+				result.push_back(curNode);
+				if (curNode.node == fromId) {
+					break;
+				}
+			}
+			std::reverse(result.begin(), result.end());
+			return result;
 		}
 
 		state[curId].inOpenSet = false;
@@ -458,8 +466,8 @@ std::optional<Vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, int to
 		for (size_t i = 0; i < curNode.nConnections; ++i) {
 			if (curNode.connections[i]) {
 				const auto nodeId = curNode.connections[i].value();
-				if (!state[nodeId].inClosedSet) {
-					auto& neighState = state[nodeId];
+				auto& neighState = state[nodeId];
+				if (!neighState.inClosedSet) {
 					const float neighScore = gScore + curNode.costs[i];
 
 					if (neighScore < neighState.gScore) {
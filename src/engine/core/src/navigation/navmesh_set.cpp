@@ -1,7 +1,7 @@
 #include "halley/navigation/navmesh_set.h"
 
+#include <queue>
 #include "halley/bytes/byte_serializer.h"
-#include "halley/data_structures/priority_queue.h"
 #include "halley/maths/ray.h"
 #include "halley/support/logger.h"
 using namespace Halley;
@@ -77,15 +77,22 @@ void NavmeshSet::addRaw(NavmeshSet navmeshSet)
 void NavmeshSet::clear()
 {
 	navmeshes.clear();
+	invalidateRegionCaches();
 }
 
 void NavmeshSet::clearSubWorld(int subWorld)
 {
 	navmeshes.erase(std::remove_if(navmeshes.begin(), navmeshes.end(), [&] (const Navmesh& nav) { return nav.getSubWorld() == subWorld; }), navmeshes.end());
 	assignNavmeshIds();
+	invalidateRegionCaches();
 }
 
-std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& origQuery, String* errorOut, float anisotropy, float nudge) const
+std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& query, String* errorOut, float anisotropy, float nudge) const
+{
+	return pathfind(query, NavmeshSearchScratch::getThreadLocal(), errorOut, anisotropy, nudge);
+}
+
+std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& origQuery, NavmeshSearchScratch& scratch, String* errorOut, float anisotropy, float nudge) const
 {
 	const auto [fromRegion, fromPos] = getNavMeshIdxAtWithTolerance(origQuery.from, maxStartDistanceToNavMesh, anisotropy, nudge);
 	const auto [toRegion, toPos] = getNavMeshIdxAtWithTolerance(origQuery.to, maxEndDistanceToNavMesh, anisotropy, nudge);
@@ -110,14 +117,14 @@ std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& origQu
 
 	if (fromRegion == toRegion) {
 		// Just path in that mesh
-		auto path = pathfindInRegion(query, *fromRegion);
+		auto path = pathfindInRegion(query, *fromRegion, scratch);
 		if (path) {
 			postProcessPath(*path);
 		}
 		return path;
 	} else {
 		// Gotta path between regions first
-		auto regionPath = findRegionPath(fromPos.pos, toPos.pos, *fromRegion, *toRegion);
+		auto regionPath = findRegionPath(fromPos.pos, toPos.pos, *fromRegion, *toRegion, scratch);
 		if (regionPath.size() <= 1) {
 			// Failed
 			if (errorOut) {
@@ -125,7 +132,7 @@ std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& origQu
 			}
 			return {};
 		} else {
-			auto path = extendToFullPath(query, regionPath);
+			auto path = extendToFullPath(query, regionPath, scratch);
 			postProcessPath(path);
 			return path;
 		}
@@ -134,10 +141,15 @@ std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& origQu
 
 std::optional<NavigationPath> NavmeshSet::pathfindInRegion(const NavigationQuery& query, uint16_t regionId) const
 {
-	return navmeshes[regionId].pathfind(query);
+	return pathfindInRegion(query, regionId, NavmeshSearchScratch::getThreadLocal());
+}
+
+std::optional<NavigationPath> NavmeshSet::pathfindInRegion(const NavigationQuery& query, uint16_t regionId, NavmeshSearchScratch& scratch) const
+{
+	return navmeshes[regionId].pathfind(query, scratch);
 }
 
-NavigationPath NavmeshSet::extendToFullPath(const NavigationQuery& query, const Vector<NodeAndConn>& regions) const
+NavigationPath NavmeshSet::extendToFullPath(const NavigationQuery& query, const Vector<NodeAndConn>& regions, NavmeshSearchScratch& scratch) const
 {
 	auto result = Vector<NavigationPath::Point>();
 
@@ -156,7 +168,7 @@ NavigationPath NavmeshSet::extendToFullPath(const NavigationQuery& query, const
 		const auto p1 = WorldPosition(endPos, subWorld);
 		const auto subQuery = NavigationQuery(p0, p1, query.postProcessingType, query.quantizationType);
 
-		auto newPath = pathfindInRegion(subQuery, region.regionNodeId);
+		auto newPath = pathfindInRegion(subQuery, region.regionNodeId, scratch);
 		if (!newPath) {
 			Logger::logError("Unable to find path within region from " + toString(p0) + " to " + p1, true);
 			return {};
@@ -259,6 +271,7 @@ std::optional<WorldPosition> NavmeshSet::getClosestPointTo(WorldPosition pos, fl
 
 void NavmeshSet::linkNavmeshes()
 {
+	invalidateRegionCaches();
 	regionNodes.clear();
 	regionNodes.resize(navmeshes.size());
 	portalNodes.clear();
@@ -296,6 +309,8 @@ void NavmeshSet::linkNavmeshes()
 			}
 		}
 	}
+
+	buildRegionHeuristics();
 }
 
 void NavmeshSet::reportUnlinkedPortals(std::function<String(Vector2i)> getChunkName) const
@@ -337,6 +352,18 @@ void NavmeshSet::setMaxDistancesToNavmesh(float startDistance, float endDistance
 	maxEndDistanceToNavMesh = endDistance;
 }
 
+void NavmeshSet::setRegionLandmarks(size_t count)
+{
+	nRegionLandmarks = count;
+	regionRouteCache.clear();
+	buildRegionHeuristics();
+}
+
+void NavmeshSet::setRegionRouteCacheSize(size_t size)
+{
+	regionRouteCache.setCapacity(size);
+}
+
 void NavmeshSet::tryLinkNavMeshes(uint16_t idxA, uint16_t idxB)
 {
 	constexpr float epsilon = 5.0f;
@@ -392,7 +419,22 @@ void NavmeshSet::tryLinkNavMeshes(uint16_t idxA, uint16_t idxB)
 	}
 }
 
-Vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPos, Vector2f endPos, NodeId fromRegionId, NodeId toRegionId) const
+Vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPos, Vector2f endPos, NodeId fromRegionId, NodeId toRegionId, NavmeshSearchScratch& scratch) const
+{
+	if (!regionRouteCache.isEnabled()) {
+		return searchRegionPath(startPos, endPos, fromRegionId, toRegionId, scratch);
+	}
+
+	if (auto cached = regionRouteCache.get(fromRegionId, toRegionId)) {
+		return std::move(*cached);
+	}
+
+	auto result = searchRegionPath(startPos, endPos, fromRegionId, toRegionId, scratch);
+	regionRouteCache.put(fromRegionId, toRegionId, result);
+	return result;
+}
+
+Vector<NavmeshSet::NodeAndConn> NavmeshSet::searchRegionPath(Vector2f startPos, Vector2f endPos, NodeId fromRegionId, NodeId toRegionId, NavmeshSearchScratch& scratch) const
 {
 	// Ensure the query is valid
 	if (fromRegionId >= static_cast<int>(regionNodes.size()) || toRegionId >= static_cast<int>(regionNodes.size())) {
@@ -400,29 +442,34 @@ Vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPos, Ve
 		return {};
 	}
 
-	// State map. Using vector for perf, trading space for CPU.
-	// TODO: measure this vs unordered_map or some other hashtable, it's not impossible that it'd perform better (compact memory)
-	Vector<State> state(portalNodes.size(), State{});
-
-	// Open set
-	auto openSet = PriorityQueue<NodeId, NodeComparator>(NodeComparator(state));
-	openSet.reserve(std::min(static_cast<size_t>(100), portalNodes.size()));
+	// Reused between queries, so this doesn't cost anything proportional to the number of portals
+	auto& state = scratch.portals;
+	state.begin(portalNodes.size());
+	auto& openSet = state.getOpenSet();
 
 	// Define heuristic function
-	auto h = [&] (Vector2f pos) -> float
+	const bool hasLandmarks = regionHeuristics.nLandmarks > 0;
+	auto h = [&] (NodeId portalId) -> float
 	{
-		return (pos - endPos).length();
+		const float distance = (portalNodes[portalId].pos - endPos).length();
+		return hasLandmarks ? std::max(distance, getLandmarkHeuristic(portalId, toRegionId)) : distance;
 	};
 
 	// Initialize the query
 	{
 		const auto& startRegion = regionNodes[fromRegionId];
 		for (const auto portalId : startRegion.portals) {
+			const float portalH = h(portalId);
+			if (std::isinf(portalH)) {
+				// Landmarks prove the destination can't be reached from here
+				continue;
+			}
+
 			auto& nodeState = state[portalId];
 			const auto pos = portalNodes[portalId].pos;
 			nodeState.cameFrom = std::numeric_limits<uint16_t>::max();
 			nodeState.gScore = (pos - startPos).length();
-			nodeState.fScore = h(pos);
+			nodeState.fScore = portalH;
 			nodeState.inOpenSet = true;
 			openSet.push(portalId);
 		}
@@ -460,15 +507,19 @@ Vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPos, Ve
 		const float gScore = state[curId].gScore;
 		for (size_t i = 0; i < curNode.connections.size(); ++i) {
 			const auto nodeId = curNode.connections[i].portalId;
-			if (!state[nodeId].inClosedSet) {
-				auto& neighState = state[nodeId];
+			auto& neighState = state[nodeId];
+			if (!neighState.inClosedSet) {
 				const float neighScore = gScore + curNode.connections[i].cost;
 
 				// This neighbour needs updating
 				if (neighScore < neighState.gScore) {
+					const float neighH = h(nodeId);
+					if (std::isinf(neighH)) {
+						continue;
+					}
 					neighState.cameFrom = curId;
 					neighState.gScore = neighScore;
-					neighState.fScore = neighScore + h(portalNodes[nodeId].pos);
+					neighState.fScore = neighScore + neighH;
 					if (!neighState.inOpenSet) {
 						neighState.inOpenSet = true;
 						openSet.push(nodeId);
@@ -483,6 +534,115 @@ Vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPos, Ve
 	return {};
 }
 
+float NavmeshSet::getLandmarkHeuristic(NodeId portalId, NodeId toRegionId) const
+{
+	// Triangle inequality against each landmark, taking the most pessimistic of the portals leading into the destination
+	// If a term comes out infinite, there's no way to get from this portal to the destination
+	const auto& lm = regionHeuristics;
+	const size_t nPortals = portalNodes.size();
+	const size_t nRegions = regionNodes.size();
+	float result = 0;
+	for (size_t i = 0; i < lm.nLandmarks; ++i) {
+		const float fromLandmark = lm.distFromLandmark[i * nPortals + portalId];
+		if (!std::isinf(fromLandmark)) {
+			result = std::max(result, lm.regionMinDistFromLandmark[i * nRegions + toRegionId] - fromLandmark);
+		}
+		const float regionToLandmark = lm.regionMaxDistToLandmark[i * nRegions + toRegionId];
+		if (!std::isinf(regionToLandmark)) {
+			result = std::max(result, lm.distToLandmark[i * nPortals + portalId] - regionToLandmark);
+		}
+	}
+	return result;
+}
+
+void NavmeshSet::buildRegionHeuristics()
+{
+	regionHeuristics = RegionHeuristics();
+	const size_t nPortals = portalNodes.size();
+	const size_t nRegions = regionNodes.size();
+	const size_t nLandmarks = std::min(nRegionLandmarks, nPortals);
+	if (nLandmarks == 0) {
+		return;
+	}
+
+	using Edge = std::pair<NodeId, float>;
+	Vector<Vector<Edge>> forward(nPortals);
+	Vector<Vector<Edge>> backward(nPortals);
+	for (size_t i = 0; i < nPortals; ++i) {
+		for (const auto& conn: portalNodes[i].connections) {
+			forward[i].emplace_back(conn.portalId, conn.cost);
+			backward[conn.portalId].emplace_back(static_cast<NodeId>(i), conn.cost);
+		}
+	}
+
+	constexpr float inf = std::numeric_limits<float>::infinity();
+	auto dijkstra = [&] (NodeId source, const Vector<Vector<Edge>>& edges, gsl::span<float> dist)
+	{
+		using Entry = std::pair<float, NodeId>;
+		std::priority_queue<Entry, Vector<Entry>, std::greater<>> queue;
+		std::fill(dist.begin(), dist.end(), inf);
+		dist[source] = 0;
+		queue.emplace(0.0f, source);
+		while (!queue.empty()) {
+			const auto [d, cur] = queue.top();
+			queue.pop();
+			if (d > dist[cur]) {
+				continue;
+			}
+			for (const auto& [next, cost]: edges[cur]) {
+				if (d + cost < dist[next]) {
+					dist[next] = d + cost;
+					queue.emplace(d + cost, next);
+				}
+			}
+		}
+	};
+
+	auto& lm = regionHeuristics;
+	lm.distFromLandmark.resize(nLandmarks * nPortals);
+	lm.distToLandmark.resize(nLandmarks * nPortals);
+
+	// Pick landmarks greedily, each as far as possible from the ones before it, preferring portals none of them can reach yet
+	Vector<float> closestLandmark(nPortals, inf);
+	NodeId landmark = 0;
+	for (size_t i = 0; i < nLandmarks; ++i) {
+		const auto from = gsl::span<float>(lm.distFromLandmark).subspan(i * nPortals, nPortals);
+		dijkstra(landmark, forward, from);
+		dijkstra(landmark, backward, gsl::span<float>(lm.distToLandmark).subspan(i * nPortals, nPortals));
+
+		float best = -1.0f;
+		for (size_t j = 0; j < nPortals; ++j) {
+			closestLandmark[j] = std::min(closestLandmark[j], from[j]);
+			if (closestLandmark[j] > best) {
+				best = closestLandmark[j];
+				landmark = static_cast<NodeId>(j);
+			}
+		}
+		lm.nLandmarks = i + 1;
+		if (best <= 0) {
+			// Every portal is a landmark already
+			break;
+		}
+	}
+
+	// Collapse distances to/from each region's entrances, since queries target a region rather than a portal
+	lm.regionMinDistFromLandmark.resize(lm.nLandmarks * nRegions, inf);
+	lm.regionMaxDistToLandmark.resize(lm.nLandmarks * nRegions, -inf);
+	for (size_t i = 0; i < lm.nLandmarks; ++i) {
+		for (size_t j = 0; j < nPortals; ++j) {
+			const auto region = i * nRegions + portalNodes[j].toRegion;
+			lm.regionMinDistFromLandmark[region] = std::min(lm.regionMinDistFromLandmark[region], lm.distFromLandmark[i * nPortals + j]);
+			lm.regionMaxDistToLandmark[region] = std::max(lm.regionMaxDistToLandmark[region], lm.distToLandmark[i * nPortals + j]);
+		}
+	}
+}
+
+void NavmeshSet::invalidateRegionCaches()
+{
+	regionHeuristics = RegionHeuristics();
+	regionRouteCache.clear();
+}
+
 void NavmeshSet::postProcessPath(NavigationPath& path) const
 {
 	if (path.query.postProcessingType != NavigationQuery::PostProcessingType::None) {
@@ -769,3 +929,50 @@ std::pair<uint16_t, uint16_t> NavmeshSet::getPortalDestination(uint16_t region,
 	
 	return { maxVal, maxVal };
 }
+
+NavmeshSet::RegionRouteCache::RegionRouteCache(const RegionRouteCache& other)
+{
+	setCapacity(other.routes.getCapacity());
+}
+
+NavmeshSet::RegionRouteCache& NavmeshSet::RegionRouteCache::operator=(const RegionRouteCache& other)
+{
+	if (this != &other) {
+		setCapacity(other.routes.getCapacity());
+		clear();
+	}
+	return *this;
+}
+
+void NavmeshSet::RegionRouteCache::setCapacity(size_t capacity)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	routes.setCapacity(capacity);
+	enabled = capacity > 0;
+}
+
+bool NavmeshSet::RegionRouteCache::isEnabled() const
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void NavmeshSet::RegionRouteCache::clear()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	routes.clear();
+}
+
+std::optional<Vector<NavmeshSet::NodeAndConn>> NavmeshSet::RegionRouteCache::get(uint16_t fromRegion, uint16_t toRegion) const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (const auto* route = routes.tryGet((static_cast<uint32_t>(fromRegion) << 16) | toRegion)) {
+		return *route;
+	}
+	return std::nullopt;
+}
+
+void NavmeshSet::RegionRouteCache::put(uint16_t fromRegion, uint16_t toRegion, Vector<NodeAndConn> route) const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	routes.put((static_cast<uint32_t>(fromRegion) << 16) | toRegion, std::move(route));
+}
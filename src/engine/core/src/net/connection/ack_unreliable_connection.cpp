@@ -35,6 +35,8 @@ void AckUnreliableHeader::deserialize(Deserializer& s)
 }
 
 constexpr size_t BUFFER_SIZE = 1024;
+constexpr size_t MAX_PACKET_SIZE = 16 * 1024;
+constexpr size_t MAX_SUB_PACKET_HEADER_SIZE = 6; // Two variable-length uint16s
 
 AckUnreliableConnection::AckUnreliableConnection(std::shared_ptr<IConnection> parent)
 	: parent(std::move(parent))
@@ -61,10 +63,7 @@ bool AckUnreliableConnection::isSupported(TransmissionType type) const
 
 void AckUnreliableConnection::send(TransmissionType type, OutboundNetworkPacket packet)
 {
-	AckUnreliableSubPacket subPacket;
-	subPacket.data.resize(packet.getSize());
-	packet.copyTo(subPacket.data);
-	subPacket.resends = false;
+	AckUnreliableSubPacket subPacket(packet.getBytes());
 	subPacket.tag = -1;
 
 	sendTagged(gsl::span<AckUnreliableSubPacket>(&subPacket, 1));
@@ -100,9 +99,18 @@ Vector<uint16_t> AckUnreliableConnection::sendTagged(gsl::span<const AckUnreliab
 	auto subPacketsLeft = subPackets;
 
 	while (!subPacketsLeft.empty()) {
-		std::array<gsl::byte, 16 * 1024> buffer;
-		const auto dst = gsl::span<gsl::byte>(buffer);
+		// Assemble the datagram straight into the packet that goes to the parent connection, sized for the sub-packets that fit
+		size_t sizeBound = sizeof(AckUnreliableHeader);
+		for (const auto& subPacket: subPacketsLeft) {
+			const size_t sizeNeeded = MAX_SUB_PACKET_HEADER_SIZE + subPacket.data.size();
+			if (sizeBound + sizeNeeded > MAX_PACKET_SIZE) {
+				break;
+			}
+			sizeBound += sizeNeeded;
+		}
 
+		auto packet = OutboundNetworkPacket(sizeBound);
+		const auto dst = packet.getWritableBytes();
 		auto s = Serializer(dst, SerializerOptions(SerializerOptions::maxVersion));
 
 		// Add header
@@ -113,16 +121,18 @@ Vector<uint16_t> AckUnreliableConnection::sendTagged(gsl::span<const AckUnreliab
 		header.ackBits = generateAckBits();
 		s << header;
 
+		// Reuse the tag list's storage
 		auto& sent = sentPackets[seq % BUFFER_SIZE];
-		sent = SentPacketData{};
+		sent.tags.clear();
+		sent.waiting = false;
 
 		// Add subpackets
 		bool first = true;
 		while (!subPacketsLeft.empty()) {
 			const auto& subPacket = subPacketsLeft.front();
 
-			const size_t sizeNeeded = 2 + (subPacket.resends ? 2 : 0) + subPacket.data.size();
-			const size_t sizeLeft = buffer.size() - s.getPosition();
+			const size_t sizeNeeded = MAX_SUB_PACKET_HEADER_SIZE + subPacket.data.size();
+			const size_t sizeLeft = dst.size() - s.getPosition();
 			if (sizeNeeded > sizeLeft) {
 				if (first) {
 					throw Exception("Attempting to send packet that's too large for the network: " + String::prettySize(sizeNeeded), HalleyExceptions::Network);
@@ -136,7 +146,7 @@ Vector<uint16_t> AckUnreliableConnection::sendTagged(gsl::span<const AckUnreliab
 			if (subPacket.resends) {
 				s << subPacket.resendSeq;
 			}
-			s << gsl::span<const gsl::byte>(subPacket.data);
+			s << subPacket.data;
 
 			sent.tags.push_back(subPacket.tag);
 
@@ -154,8 +164,10 @@ Vector<uint16_t> AckUnreliableConnection::sendTagged(gsl::span<const AckUnreliab
 		lastSend = sent.timestamp = Clock::now();
 
 		// Send
-		parent->send(TransmissionType::Unreliable, OutboundNetworkPacket(dst.subspan(0, s.getSize())));
-		notifySend(header.sequence, s.getSize());
+		const size_t size = s.getSize();
+		packet.resize(size);
+		parent->send(TransmissionType::Unreliable, std::move(packet));
+		notifySend(header.sequence, size);
 		earliestUnackedMsg = {};
 	}
 
@@ -202,12 +214,11 @@ void AckUnreliableConnection::processReceivedPacket(InboundNetworkPacket& packet
 			}
 
 			// Extract data
-			std::array<char, 16 * 1024> buffer;
-			if (size > buffer.size() || size > s.getBytesLeft()) {
+			if (size > MAX_PACKET_SIZE || size > s.getBytesLeft()) {
 				throw Exception("Unexpected sub-packet size: " + toString(size) + " bytes, " + toString(s.getBytesLeft()) + " bytes remaining.", HalleyExceptions::Network);
 			}
-			auto subPacketData = gsl::as_writable_bytes(gsl::span<char>(buffer).subspan(0, size));
-			s >> subPacketData;
+			const auto subPacketData = packet.getBytes().subspan(s.getPosition(), size);
+			s.skipBytes(size);
 			
 			if (!resend || onSeqReceived(resendOf, true)) {
 				pendingPackets.emplace_back(subPacketData);
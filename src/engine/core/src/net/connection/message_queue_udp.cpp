@@ -85,10 +85,13 @@ void MessageQueueUDP::setChannel(uint8_t channel, ChannelSettings settings)
 	c.initialized = true;
 }
 
-Vector<gsl::byte> MessageQueueUDP::serializeMessages(const Vector<Outbound>& msgs, size_t size) const
+MessageQueueUDP::PendingPacket::PendingPacket(OutboundNetworkPacket data)
+	: data(std::move(data))
+{}
+
+size_t MessageQueueUDP::serializeMessages(const std::list<Outbound>& msgs, gsl::span<gsl::byte> dst) const
 {
-	Vector<gsl::byte> result(size);
-	auto s = Serializer(result, SerializerOptions(SerializerOptions::maxVersion));
+	auto s = Serializer(dst, SerializerOptions(SerializerOptions::maxVersion));
 	
 	for (auto& msg: msgs) {
 		const uint8_t channelN = msg.channel;
@@ -104,8 +107,7 @@ Vector<gsl::byte> MessageQueueUDP::serializeMessages(const Vector<Outbound>& msg
 		s << msg.packet.getBytes();
 	}
 
-	result.resize(s.getSize());
-	return result;
+	return s.getSize();
 }
 
 void MessageQueueUDP::receiveMessages()
@@ -125,11 +127,17 @@ void MessageQueueUDP::receiveMessages()
 					s >> sequence;
 				}
 
-				Bytes msgData;
-				s >> msgData;
+				// Serialized as a vector, read it straight out of the packet
+				uint32_t msgSize = 0;
+				s >> msgSize;
+				if (msgSize > s.getBytesLeft()) {
+					throw Exception("Unexpected message size: " + toString(msgSize) + " bytes, " + toString(s.getBytesLeft()) + " bytes remaining.", HalleyExceptions::Network);
+				}
+				const auto msgData = packet.getBytes().subspan(s.getPosition(), msgSize);
+				s.skipBytes(msgSize);
 
 				// Read message
-				channel.receiveQueue.emplace_back(Inbound{ InboundNetworkPacket(gsl::as_bytes(gsl::span<const Byte>(msgData))), sequence, channelN });
+				channel.receiveQueue.emplace_back(Inbound{ InboundNetworkPacket(msgData), sequence, channelN });
 			}
 		}
 	} catch (std::exception& e) {
@@ -183,7 +191,10 @@ void MessageQueueUDP::sendAll()
             for (size_t i = 0; i < toSend.size(); ++i) {
                 auto &packet = toSend[i];
                 if (packet.tag != -1) {
-                    pendingPackets[packet.tag].seq = seqs[i];
+                    const auto iter = pendingPackets.find(packet.tag);
+                    if (iter != pendingPackets.end()) {
+                        iter->second.seq = seqs[i];
+                    }
                 }
             }
         }
@@ -252,7 +263,8 @@ void MessageQueueUDP::checkReSend(Vector<AckUnreliableSubPacket>& collect)
 			// Re-send if it's reliable
 			if (pending.reliable) {
 				//Logger::logDev("Resending " + toString(pending.seq));
-				collect.push_back(makeTaggedPacket(pending.msgs, pending.size, true, pending.seq));
+				const auto resendSeq = pending.seq;
+				collect.push_back(makeTaggedPacket(std::move(pending), true, resendSeq));
 			}
 			pendingPackets.erase(iter);
 		}
@@ -261,7 +273,6 @@ void MessageQueueUDP::checkReSend(Vector<AckUnreliableSubPacket>& collect)
 
 AckUnreliableSubPacket MessageQueueUDP::createPacket()
 {
-	Vector<Outbound> sentMsgs;
 	const size_t maxSize = 16 * 1024;
 	size_t totalSize = 0;
 	bool first = true;
@@ -277,11 +288,10 @@ AckUnreliableSubPacket MessageQueueUDP::createPacket()
 		// Check if this message is compatible
 		const auto& channel = channels[msg.channel];
 		const bool isReliable = channel.settings.reliable;
-		const bool isOrdered = channel.settings.ordered;
 		if (first || isReliable == packetReliable) {
 			// Check if the message fits
 			const size_t msgPayloadSize = (*iter).packet.getSize();
-			const size_t headerSize = 8; // Max header size
+			const size_t headerSize = 10; // Max header size, with every field at its longest variable-length encoding
 			const size_t msgSize = msgPayloadSize + headerSize;
 
 			if (totalSize + msgSize <= maxSize || first) {
@@ -294,9 +304,7 @@ AckUnreliableSubPacket MessageQueueUDP::createPacket()
 
 				// It fits, so add it
 				totalSize += msgSize;
-
-				sentMsgs.push_back(std::move(*iter));
-				outboundQueued.erase(iter);
+				outboundPacking.splice(outboundPacking.end(), outboundQueued, iter);
 
 				first = false;
 				packetReliable = isReliable;
@@ -304,30 +312,35 @@ AckUnreliableSubPacket MessageQueueUDP::createPacket()
 		}
 	}
 
-	if (sentMsgs.empty()) {
+	if (outboundPacking.empty()) {
 		throw Exception("Was not able to fit any messages into packet!", HalleyExceptions::Network);
 	}
 
-	return makeTaggedPacket(sentMsgs, totalSize);
+	// Write the messages once, into the buffer that will be sent and kept for re-sending
+	auto pending = PendingPacket(OutboundNetworkPacket(totalSize));
+	pending.data.resize(serializeMessages(outboundPacking, pending.data.getWritableBytes()));
+	pending.reliable = packetReliable;
+	pending.msgs.reserve(outboundPacking.size());
+	for (const auto& msg: outboundPacking) {
+		pending.msgs.push_back(SentMessage{ msg.seq, msg.channel });
+	}
+	outboundPacking.clear();
+
+	return makeTaggedPacket(std::move(pending));
 }
 
-AckUnreliableSubPacket MessageQueueUDP::makeTaggedPacket(Vector<Outbound>& msgs, size_t size, bool resends, uint16_t resendSeq)
+AckUnreliableSubPacket MessageQueueUDP::makeTaggedPacket(PendingPacket pending, bool resends, uint16_t resendSeq)
 {
-	const bool reliable = !msgs.empty() && channels[msgs[0].channel].settings.reliable;
-
-	auto data = serializeMessages(msgs, size);
-	if (data.size() > 16 * 1024) {
+	if (pending.data.getSize() > 16 * 1024) {
 		Logger::logError("Tagged packet is too big");
 	}
 
 	const int tag = nextPacketId++;
-	auto& pendingData = pendingPackets[tag];
-	pendingData.msgs = std::move(msgs);
-	pendingData.size = size;
-	pendingData.reliable = reliable;
+	auto& pendingData = pendingPackets.emplace(tag, std::move(pending)).first->second;
 	pendingData.timeSent = std::chrono::steady_clock::now();
 
-	auto result = AckUnreliableSubPacket(std::move(data));
+	// Map nodes don't move, so this stays valid until the packet is acked or given up on
+	auto result = AckUnreliableSubPacket(pendingData.data.getBytes());
 	result.tag = tag;
 	result.resends = resends;
 	result.resendSeq = resendSeq;
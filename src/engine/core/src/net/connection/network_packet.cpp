@@ -6,15 +6,88 @@
 
 using namespace Halley;
 
+namespace {
+	constexpr size_t outboundPrePadding = 128;
+
+	// Large enough to never use the small buffer optimisation, and to fit most packets without growing
+	constexpr size_t minPooledCapacity = 256;
+	constexpr size_t maxPooledCapacity = 32 * 1024;
+	constexpr size_t maxPooledBuffers = 256;
+
+	enum class PoolState : uint8_t {
+		Uninitialised,
+		Alive,
+		Destroyed
+	};
+
+	thread_local PoolState poolState = PoolState::Uninitialised;
+
+	class PacketStoragePool {
+	public:
+		PacketStoragePool()
+		{
+			poolState = PoolState::Alive;
+		}
+
+		~PacketStoragePool()
+		{
+			// Packets destroyed during thread exit just free their memory
+			poolState = PoolState::Destroyed;
+		}
+
+		Vector<Vector<gsl::byte>> buffers;
+	};
+
+	PacketStoragePool& getPacketStoragePool()
+	{
+		thread_local PacketStoragePool pool;
+		return pool;
+	}
+}
+
+Vector<gsl::byte> NetworkPacketPool::acquire(size_t size)
+{
+	Vector<gsl::byte> result;
+	if (poolState != PoolState::Destroyed) {
+		auto& buffers = getPacketStoragePool().buffers;
+		if (!buffers.empty()) {
+			result = std::move(buffers.back());
+			buffers.pop_back();
+		}
+	}
+
+	result.reserve(std::max(size, minPooledCapacity));
+	result.resize_no_init(size);
+	return result;
+}
+
+void NetworkPacketPool::release(Vector<gsl::byte>& buffer)
+{
+	if (poolState == PoolState::Alive && buffer.capacity() >= minPooledCapacity && buffer.capacity() <= maxPooledCapacity) {
+		auto& buffers = getPacketStoragePool().buffers;
+		if (buffers.size() < maxPooledBuffers) {
+			buffer.clear();
+			buffers.push_back(std::move(buffer));
+		}
+	}
+}
+
 NetworkPacketBase::NetworkPacketBase()
 	: dataStart(0)
 {}
 
 NetworkPacketBase::NetworkPacketBase(gsl::span<const gsl::byte> src, size_t prePadding)
 	: dataStart(prePadding)
+	, data(NetworkPacketPool::acquire(src.size_bytes() + prePadding))
 {
-	data.resize(src.size_bytes() + prePadding);
-	memcpy(data.data() + prePadding, src.data(), src.size_bytes());
+	if (!src.empty()) {
+		memcpy(data.data() + prePadding, src.data(), src.size_bytes());
+	}
+}
+
+NetworkPacketBase::~NetworkPacketBase()
+{
+	NetworkPacketPool::release(data);
 }
 
 size_t NetworkPacketBase::copyTo(gsl::span<gsl::byte> dst) const
@@ -42,27 +115,41 @@ gsl::span<const gsl::byte> NetworkPacketBase::getBytes() const
 }
 
 OutboundNetworkPacket::OutboundNetworkPacket(const OutboundNetworkPacket& other)
-	: NetworkPacketBase()
+	: NetworkPacketBase(other.getBytes(), other.dataStart)
 {
-	data = other.data;
-	dataStart = other.dataStart;
 }
 
 OutboundNetworkPacket::OutboundNetworkPacket(OutboundNetworkPacket&& other) noexcept
 {
-	data = other.data;
+	data = std::move(other.data);
 	dataStart = other.dataStart;
 	other.dataStart = 0;
 }
 
 OutboundNetworkPacket::OutboundNetworkPacket(gsl::span<const gsl::byte> data)
-	: NetworkPacketBase(data, 128)
+	: NetworkPacketBase(data, outboundPrePadding)
 {
 }
 
 OutboundNetworkPacket::OutboundNetworkPacket(const Bytes& data)
-	: NetworkPacketBase(gsl::as_bytes(gsl::span<const Byte>(data)), 128)
+	: NetworkPacketBase(gsl::as_bytes(gsl::span<const Byte>(data)), outboundPrePadding)
+{
+}
+
+OutboundNetworkPacket::OutboundNetworkPacket(size_t size)
 {
+	data = NetworkPacketPool::acquire(size + outboundPrePadding);
+	dataStart = outboundPrePadding;
+}
+
+gsl::span<gsl::byte> OutboundNetworkPacket::getWritableBytes()
+{
+	return gsl::span<gsl::byte>(data).subspan(dataStart, getSize());
+}
+
+void OutboundNetworkPacket::resize(size_t size)
+{
+	data.resize_no_init(dataStart + size);
 }
 
 void OutboundNetworkPacket::addHeader(gsl::span<const gsl::byte> src)
@@ -75,6 +162,7 @@ void OutboundNetworkPacket::addHeader(gsl::span<const gsl::byte> src)
 
 OutboundNetworkPacket& OutboundNetworkPacket::operator=(OutboundNetworkPacket&& other) noexcept
 {
+	NetworkPacketPool::release(data);
 	data = std::move(other.data);
 	dataStart = other.dataStart;
 	other.dataStart = 0;
@@ -107,7 +195,8 @@ void InboundNetworkPacket::extractHeader(gsl::span<gsl::byte> dst)
 
 InboundNetworkPacket& InboundNetworkPacket::operator=(InboundNetworkPacket&& other) noexcept
 {
-	data = other.data;
+	NetworkPacketPool::release(data);
+	data = std::move(other.data);
 	dataStart = other.dataStart;
 	other.dataStart = 0;
 	return *this;
@@ -0,0 +1,100 @@
+#include "halley/net/entity/entity_network_relevancy.h"
+
+#include "halley/entity/world.h"
+#include "halley/net/entity/entity_network_remote_peer.h"
+#include "halley/net/entity/entity_network_session.h"
+#include "halley/utils/algorithm.h"
+#include "halley/utils/utils.h"
+
+using namespace Halley;
+
+void EntityNetworkViewRelevancyFilter::getRelevantEntities(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityNetworkRemotePeer& peer, const EntityClientSharedData& clientData, Vector<EntityNetworkRelevancy>& result)
+{
+	const auto minSendInterval = session.getMinSendInterval();
+	for (size_t i = 0; i < entityIds.size(); ++i) {
+		const auto entity = session.getWorld().getEntity(entityIds[i].entityId);
+		if (session.isEntityInView(entity, clientData, peer.getPeerId())) {
+			result.push_back(EntityNetworkRelevancy{ static_cast<uint32_t>(i), 1.0f, minSendInterval });
+		}
+	}
+}
+
+EntityNetworkGridRelevancyFilter::EntityNetworkGridRelevancyFilter(PositionGetter getPosition, Config config)
+	: getPosition(std::move(getPosition))
+	, config(config)
+{
+	Expects(this->getPosition);
+	Expects(config.cellSize > 0);
+	Expects(config.keepMargin >= config.createMargin);
+}
+
+void EntityNetworkGridRelevancyFilter::update(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds)
+{
+	for (auto& [k, v]: cells) {
+		v.clear();
+	}
+	unpositioned.clear();
+	positions.resize(entityIds.size());
+
+	for (size_t i = 0; i < entityIds.size(); ++i) {
+		const auto idx = static_cast<uint32_t>(i);
+		const auto pos = getPosition(session.getWorld().getEntity(entityIds[i].entityId));
+		if (pos) {
+			positions[i] = *pos;
+			cells[getCell(*pos)].push_back(idx);
+		} else {
+			unpositioned.push_back(idx);
+		}
+	}
+
+	std_ex::erase_if_value(cells, [] (const Vector<uint32_t>& v) { return v.empty(); });
+}
+
+void EntityNetworkGridRelevancyFilter::getRelevantEntities(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityNetworkRemotePeer& peer, const EntityClientSharedData& clientData, Vector<EntityNetworkRelevancy>& result)
+{
+	const auto minSendInterval = session.getMinSendInterval();
+
+	for (const auto idx: unpositioned) {
+		result.push_back(EntityNetworkRelevancy{ idx, 1.0f, minSendInterval });
+	}
+
+	if (clientData.viewRect) {
+		const auto view = Rect4f(*clientData.viewRect);
+		const auto keepRect = view.grow(config.keepMargin);
+		const auto createRect = view.grow(config.createMargin);
+		const auto c0 = getCell(keepRect.getTopLeft());
+		const auto c1 = getCell(keepRect.getBottomRight());
+
+		for (int y = c0.y; y <= c1.y; ++y) {
+			for (int x = c0.x; x <= c1.x; ++x) {
+				const auto iter = cells.find(Vector2i(x, y));
+				if (iter == cells.end()) {
+					continue;
+				}
+
+				for (const auto idx: iter->second) {
+					const auto pos = positions[idx];
+					if (!keepRect.contains(pos) || (!createRect.contains(pos) && !peer.hasSentEntity(entityIds[idx].entityId))) {
+						continue;
+					}
+
+					// 0 inside the view, 1 at the edge of the keep area
+					const float t = clamp((view.getClosestPoint(pos) - pos).length() / std::max(config.keepMargin, 1.0f), 0.0f, 1.0f);
+					const auto sendInterval = lerp(minSendInterval, std::max(minSendInterval, config.maxSendInterval), t);
+					const auto priority = lerp(1.0f, config.minPriority, t);
+					result.push_back(EntityNetworkRelevancy{ idx, priority, sendInterval });
+				}
+			}
+		}
+	}
+
+	std::sort(result.begin(), result.end(), [] (const EntityNetworkRelevancy& a, const EntityNetworkRelevancy& b)
+	{
+		return a.idx < b.idx;
+	});
+}
+
+Vector2i EntityNetworkGridRelevancyFilter::getCell(Vector2f pos) const
+{
+	return Vector2i((pos / config.cellSize).floor());
+}
@@ -5,10 +5,88 @@
 #include "halley/support/logger.h"
 #include "halley/utils/algorithm.h"
 #include "halley/entity/data_interpolator.h"
+#include "halley/concurrency/executor.h"
+#include "halley/concurrency/parallel_for.h"
 #include "components/network_component.h"
 
 using namespace Halley;
 
+void EntityNetworkUpdateCache::reset(size_t n)
+{
+	for (size_t i = 0; i < nEntries; ++i) {
+		auto& entry = *entries[i];
+		entry.requested = false;
+		entry.data.reset();
+		entry.deltas.clear();
+	}
+
+	while (entries.size() < n) {
+		entries.push_back(std::make_unique<Entry>());
+	}
+	nEntries = n;
+}
+
+void EntityNetworkUpdateCache::request(size_t idx)
+{
+	entries.at(idx)->requested = true;
+}
+
+void EntityNetworkUpdateCache::serialize(EntityNetworkSession& session, gsl::span<const EntityNetworkUpdateInfo> entityIds)
+{
+	Expects(entityIds.size() == nEntries);
+
+	Vector<uint32_t> toSerialize;
+	for (size_t i = 0; i < nEntries; ++i) {
+		if (entries[i]->requested) {
+			toSerialize.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	Concurrent::parallelFor(Executors::getCPU(), toSerialize.size(), 0, [&] (size_t i)
+	{
+		const auto idx = toSerialize[i];
+		const auto entity = session.getWorld().getEntity(entityIds[idx].entityId);
+		entries[idx]->data = std::make_shared<EntityData>(session.getFactory().serializeEntity(entity, session.getEntitySerializationOptions()));
+	});
+}
+
+const std::shared_ptr<const EntityData>& EntityNetworkUpdateCache::getData(size_t idx) const
+{
+	Expects(idx < nEntries);
+	auto& data = entries[idx]->data;
+	Expects(data);
+	return data;
+}
+
+const Bytes* EntityNetworkUpdateCache::getDelta(size_t idx, const std::shared_ptr<const EntityData>& from, EntityRef entity, EntityNetworkSession& session)
+{
+	Expects(idx < nEntries);
+	auto& entry = *entries[idx];
+
+	// Other peers asking for the same delta wait for it instead of computing their own
+	std::unique_lock<std::mutex> lock(entry.mutex);
+	for (const auto& delta: entry.deltas) {
+		if (delta->from == from) {
+			return delta->hasChange ? &delta->bytes : nullptr;
+		}
+	}
+
+	// Encode delta using interpolators
+	auto retriever = DataInterpolatorSetRetriever(entity, true);
+	auto options = session.getEntityDeltaOptions();
+	options.interpolatorSet = &retriever;
+	const auto deltaData = EntityDataDelta(*from, *entry.data, options);
+
+	auto& delta = *entry.deltas.emplace_back(std::make_unique<Delta>());
+	delta.from = from;
+	delta.hasChange = deltaData.hasChange();
+	if (delta.hasChange) {
+		delta.bytes = Serializer::toBytes(deltaData, session.getByteSerializationOptions());
+	}
+	return delta.hasChange ? &delta.bytes : nullptr;
+}
+
+
 EntityNetworkRemotePeer::EntityNetworkRemotePeer(EntityNetworkSession& parent, NetworkSession::PeerId peerId)
 	: parent(&parent)
 	, peerId(peerId)
@@ -19,10 +97,19 @@ NetworkSession::PeerId EntityNetworkRemotePeer::getPeerId() const
 	return peerId;
 }
 
-void EntityNetworkRemotePeer::sendEntities(Time t, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityClientSharedData& clientData)
+bool EntityNetworkRemotePeer::hasSentEntity(EntityId id) const
+{
+	return outboundEntities.contains(id);
+}
+
+void EntityNetworkRemotePeer::prepareEntities(Time t, gsl::span<const EntityNetworkUpdateInfo> entityIds, const EntityClientSharedData& clientData)
 {
 	Expects(isAlive());
 
+	pendingSend = false;
+	pendingCreate.clear();
+	pendingUpdate.clear();
+
 	if (!isRemoteReady()) {
 		if (timeSinceSend > maxSendInterval) {
 			sendKeepAlive();
@@ -37,27 +124,63 @@ void EntityNetworkRemotePeer::sendEntities(Time t, gsl::span<const EntityNetwork
 		e.second.alive = false;
 	}
 
-	Vector<EntityRef> toCreate;
-	Vector<std::pair<EntityRef, OutboundEntity*>> toUpdate;
+	relevantEntities.clear();
+	parent->getRelevancyFilter().getRelevantEntities(*parent, entityIds, *this, clientData, relevantEntities);
 
-	for (auto entry: entityIds) {
+	for (const auto& relevant: relevantEntities) {
+		const auto& entry = entityIds[relevant.idx];
 		if (entry.ownerId == peerId) {
 			// Don't send updates back to the owner
 			continue;
 		}
 
-		const auto entity = parent->getWorld().getEntity(entry.entityId);
-		if (parent->isEntityInView(entity, clientData, peerId)) {
-			if (const auto iter = outboundEntities.find(entry.entityId); iter == outboundEntities.end()) {
-				parent->setupOutboundInterpolators(entity);
-				toCreate.push_back(entity);
-			} else {
-				iter->second.alive = true;
-				toUpdate.emplace_back(entity, &iter->second);
+		if (const auto iter = outboundEntities.find(entry.entityId); iter == outboundEntities.end()) {
+			parent->setupOutboundInterpolators(parent->getWorld().getEntity(entry.entityId));
+			pendingCreate.push_back(relevant.idx);
+		} else {
+			auto& remote = iter->second;
+			remote.alive = true;
+			remote.timeSinceSend += t;
+			remote.priority += relevant.priority * static_cast<float>(t);
+			if (remote.timeSinceSend >= relevant.minSendInterval) {
+				pendingUpdate.emplace_back(relevant.idx, &remote);
 			}
 		}
 	}
 
+	// With a bandwidth limit, the entities that have waited the longest, weighted by priority, go first
+	if (const auto bandwidth = parent->getPeerBandwidthLimit()) {
+		sendBudget = std::min(sendBudget + static_cast<float>(bandwidth * t), static_cast<float>(bandwidth) * maxBurstTime);
+		std::stable_sort(pendingUpdate.begin(), pendingUpdate.end(), [] (const auto& a, const auto& b)
+		{
+			return a.second->priority > b.second->priority;
+		});
+	} else {
+		sendBudget = 0;
+	}
+
+	pendingSend = true;
+}
+
+void EntityNetworkRemotePeer::requestEntities(EntityNetworkUpdateCache& cache) const
+{
+	for (const auto idx: pendingCreate) {
+		cache.request(idx);
+	}
+	for (const auto& [idx, remote]: pendingUpdate) {
+		cache.request(idx);
+	}
+}
+
+void EntityNetworkRemotePeer::sendEntities(gsl::span<const EntityNetworkUpdateInfo> entityIds, EntityNetworkUpdateCache& cache)
+{
+	Expects(isAlive());
+
+	if (!pendingSend) {
+		return;
+	}
+	pendingSend = false;
+
 	// Order is important here, we need to first destroy, then update, then create
 	// This is so we don't run into an issue where an entity is moved inside another and we attempt to create/update the new one while the old one is still present
 
@@ -69,15 +192,23 @@ void EntityNetworkRemotePeer::sendEntities(Time t, gsl::span<const EntityNetwork
 	}
 
 	// Update existing entities
-	for (auto& [e, oe] : toUpdate) {
-		sendUpdateEntity(t, *oe, e);
+	const bool limitBandwidth = parent->getPeerBandwidthLimit() > 0;
+	for (auto& [idx, remote]: pendingUpdate) {
+		if (limitBandwidth && sendBudget <= 0) {
+			// Out of budget, these will have higher priority next tick
+			break;
+		}
+		sendUpdateEntity(*remote, parent->getWorld().getEntity(entityIds[idx].entityId), idx, cache);
 	}
 
 	// Create new entities
-	for (auto& e: toCreate) {
-		sendCreateEntity(e);
+	for (const auto idx: pendingCreate) {
+		sendCreateEntity(parent->getWorld().getEntity(entityIds[idx].entityId), cache.getData(idx));
 	}
 
+	pendingCreate.clear();
+	pendingUpdate.clear();
+
 	std_ex::erase_if_value(outboundEntities, [](const OutboundEntity& e) { return !e.alive; });
 
 	if (timeSinceSend > maxSendInterval) {
@@ -166,46 +297,35 @@ uint16_t EntityNetworkRemotePeer::assignId()
 	throw Exception("Unable to allocate network id for entity.", HalleyExceptions::Network);
 }
 
-void EntityNetworkRemotePeer::sendCreateEntity(EntityRef entity)
+void EntityNetworkRemotePeer::sendCreateEntity(EntityRef entity, std::shared_ptr<const EntityData> data)
 {
 	OutboundEntity result;
 
 	result.networkId = assignId();
-	result.data = parent->getFactory().serializeEntity(entity, parent->getEntitySerializationOptions());
+	result.data = std::move(data);
 
-	auto deltaData = parent->getFactory().entityDataToPrefabDelta(result.data, entity.getPrefab(), parent->getEntityDeltaOptions());
+	auto deltaData = parent->getFactory().entityDataToPrefabDelta(*result.data, entity.getPrefab(), parent->getEntityDeltaOptions());
 	auto bytes = Serializer::toBytes(deltaData, parent->getByteSerializationOptions());
 	//Logger::logDev("Send Create: " + entity.getName() + " (" + entity.getInstanceUUID() + ") to peer " + toString(static_cast<int>(peerId)) + " (" + toString(bytes.size()) + " B):\n" + deltaData.toYAML() + "\n");
 	Logger::logDev("Send Create: " + entity.getName() + " (" + entity.getInstanceUUID() + ") to peer " + toString(static_cast<int>(peerId)) + " (" + toString(bytes.size()) + " B)");
 
+	sendBudget -= static_cast<float>(bytes.size());
 	send(EntityNetworkMessageCreate(result.networkId, std::move(bytes)));
 	
 	outboundEntities[entity.getEntityId()] = std::move(result);
 }
 
-void EntityNetworkRemotePeer::sendUpdateEntity(Time t, OutboundEntity& remote, EntityRef entity)
+void EntityNetworkRemotePeer::sendUpdateEntity(OutboundEntity& remote, EntityRef entity, size_t idx, EntityNetworkUpdateCache& cache)
 {
-	remote.timeSinceSend += t;
-	if (remote.timeSinceSend < parent->getMinSendInterval()) {
-		return;
-	}
-
-	// Encode delta using interpolators
-	auto newData = parent->getFactory().serializeEntity(entity, parent->getEntitySerializationOptions());
-	auto retriever = DataInterpolatorSetRetriever(entity, true);
-	auto options = parent->getEntityDeltaOptions();
-	options.interpolatorSet = &retriever;
-	auto deltaData = EntityDataDelta(remote.data, newData, options);
-	
-	if (deltaData.hasChange()) {
-		remote.data = std::move(newData);
+	if (const auto* bytes = cache.getDelta(idx, remote.data, entity, *parent)) {
+		remote.data = cache.getData(idx);
 		remote.timeSinceSend = 0;
+		remote.priority = 0;
+		sendBudget -= static_cast<float>(bytes->size());
 
-		auto bytes = Serializer::toBytes(deltaData, parent->getByteSerializationOptions());
-		//Logger::logDev("Send Update " + entity.getName() + " to peer " + toString(static_cast<int>(peerId)) + " (" + toString(bytes.size()) + " B):\n" + deltaData.toYAML() + "\n");
-		//Logger::logDev("Send Update " + entity.getName() + " to peer " + toString(static_cast<int>(peerId)) + " (" + toString(bytes.size()) + " B)");
+		//Logger::logDev("Send Update " + entity.getName() + " to peer " + toString(static_cast<int>(peerId)) + " (" + toString(bytes->size()) + " B)");
 		
-		send(EntityNetworkMessageUpdate(remote.networkId, std::move(bytes)));
+		send(EntityNetworkMessageUpdate(remote.networkId, *bytes));
 	}
 }
 
@@ -3,6 +3,8 @@
 #include <cassert>
 
 #include "halley/bytes/compression.h"
+#include "halley/concurrency/executor.h"
+#include "halley/concurrency/parallel_for.h"
 #include "halley/entity/data_interpolator.h"
 #include "halley/entity/entity_factory.h"
 #include "halley/entity/system.h"
@@ -36,6 +38,8 @@ EntityNetworkSession::EntityNetworkSession(std::shared_ptr<NetworkSession> sessi
 	setupDictionary();
 	byteSerializationOptions.version = SerializerOptions::maxVersion;
 	byteSerializationOptions.dictionary = &serializationDictionary;
+
+	relevancyFilter = std::make_unique<EntityNetworkViewRelevancyFilter>();
 }
 
 EntityNetworkSession::~EntityNetworkSession()
@@ -80,16 +84,32 @@ void EntityNetworkSession::sendEntityUpdates(Time t, Rect4i viewRect, gsl::span<
 		}
 	}
 
+	// Make sure every peer has an outbox, so they can queue messages in parallel
+	for (auto& peer: peers) {
+		outbox[peer.getPeerId()];
+	}
+
+	relevancyFilter->update(*this, entityIds);
+
 	// Update entities
-    Vector<Future<void>> tasks;
+	// Every peer first works out what it needs, then each of those entities is serialized once, and finally each peer sends its deltas
+	auto& queue = Executors::getCPU();
+	Concurrent::parallelFor(queue, peers.size(), 1, [&] (size_t i)
+	{
+		auto& peer = peers[i];
+		peer.prepareEntities(t, entityIds, session->getClientSharedData<EntityClientSharedData>(peer.getPeerId()));
+	});
 
-    for (auto& peer : peers) {
-        tasks += Concurrent::execute([&]() {
-            peer.sendEntities(t, entityIds, session->getClientSharedData<EntityClientSharedData>(peer.getPeerId()));
-        });
-    }
+	updateCache.reset(entityIds.size());
+	for (const auto& peer: peers) {
+		peer.requestEntities(updateCache);
+	}
+	updateCache.serialize(*this, entityIds);
 
-    Concurrent::whenAll(tasks.begin(), tasks.end()).wait();
+	Concurrent::parallelFor(queue, peers.size(), 1, [&] (size_t i)
+	{
+		peers[i].sendEntities(entityIds, updateCache);
+	});
 }
 
 void EntityNetworkSession::sendToAll(EntityNetworkMessage msg)
@@ -440,6 +460,27 @@ Time EntityNetworkSession::getMinSendInterval() const
 	return 0.05;
 }
 
+void EntityNetworkSession::setRelevancyFilter(std::unique_ptr<IEntityNetworkRelevancyFilter> filter)
+{
+	Expects(filter);
+	relevancyFilter = std::move(filter);
+}
+
+IEntityNetworkRelevancyFilter& EntityNetworkSession::getRelevancyFilter() const
+{
+	return *relevancyFilter;
+}
+
+void EntityNetworkSession::setPeerBandwidthLimit(size_t bytesPerSecond)
+{
+	peerBandwidthLimit = bytesPerSecond;
+}
+
+size_t EntityNetworkSession::getPeerBandwidthLimit() const
+{
+	return peerBandwidthLimit;
+}
+
 void EntityNetworkSession::onRemoteEntityCreated(EntityRef entity, NetworkSession::PeerId peerId)
 {
 	if (listener) {
@@ -114,6 +114,7 @@ AudioBusProperties::AudioBusProperties(const ConfigNode& node)
 {
 	id = node["id"].asString();
 	children = node["children"].asVector<AudioBusProperties>();
+	maxVoices = node["maxVoices"].asInt(0);
 }
 
 ConfigNode AudioBusProperties::toConfigNode() const
@@ -121,6 +122,9 @@ ConfigNode AudioBusProperties::toConfigNode() const
 	ConfigNode::MapType result;
 	result["id"] = id;
 	result["children"] = children;
+	if (maxVoices) {
+		result["maxVoices"] = maxVoices;
+	}
 	return result;
 }
 
@@ -128,12 +132,14 @@ void AudioBusProperties::serialize(Serializer& s) const
 {
 	s << id;
 	s << children;
+	s << maxVoices;
 }
 
 void AudioBusProperties::deserialize(Deserializer& s)
 {
 	s >> id;
 	s >> children;
+	s >> maxVoices;
 }
 
 const String& AudioBusProperties::getId() const
@@ -156,6 +162,16 @@ gsl::span<AudioBusProperties> AudioBusProperties::getChildren()
 	return children;
 }
 
+int AudioBusProperties::getMaxVoices() const
+{
+	return maxVoices;
+}
+
+void AudioBusProperties::setMaxVoices(int value)
+{
+	maxVoices = value;
+}
+
 void AudioBusProperties::collectBusIds(Vector<String>& output) const
 {
 	output.push_back(id);
@@ -170,6 +186,7 @@ AudioProperties::AudioProperties(const ConfigNode& node)
 		variables = node["variables"].asVector<AudioVariableProperties>({});
 		switches = node["switches"].asVector<AudioSwitchProperties>({});
 		buses = node["buses"].asVector<AudioBusProperties>({});
+		maxVoices = node["maxVoices"].asInt(0);
 	}
 }
 
@@ -179,6 +196,9 @@ ConfigNode AudioProperties::toConfigNode() const
 	result["variables"] = variables;
 	result["switches"] = switches;
 	result["buses"] = buses;
+	if (maxVoices) {
+		result["maxVoices"] = maxVoices;
+	}
 	return result;
 }
 
@@ -187,6 +207,7 @@ void AudioProperties::serialize(Serializer& s) const
 	s << switches;
 	s << variables;
 	s << buses;
+	s << maxVoices;
 }
 
 void AudioProperties::deserialize(Deserializer& s)
@@ -194,6 +215,7 @@ void AudioProperties::deserialize(Deserializer& s)
 	s >> switches;
 	s >> variables;
 	s >> buses;
+	s >> maxVoices;
 }
 
 gsl::span<const AudioSwitchProperties> AudioProperties::getSwitches() const
@@ -226,6 +248,16 @@ gsl::span<AudioBusProperties> AudioProperties::getBuses()
 	return buses;
 }
 
+int AudioProperties::getMaxVoices() const
+{
+	return maxVoices;
+}
+
+void AudioProperties::setMaxVoices(int value)
+{
+	maxVoices = value;
+}
+
 Vector<String> AudioProperties::getSwitchIds() const
 {
 	Vector<String> result;
@@ -13,16 +13,40 @@ AssetDatabase::Entry::Entry(const String& path, const Metadata& meta)
 	, meta(meta)
 {}
 
+void AssetDatabase::PackLocation::serialize(Serializer& s) const
+{
+	s << offset;
+	s << storedSize;
+	s << size;
+	s << nonce;
+	s << flags;
+}
+
+void AssetDatabase::PackLocation::deserialize(Deserializer& s)
+{
+	s >> offset;
+	s >> storedSize;
+	s >> size;
+	s >> nonce;
+	s >> flags;
+}
+
 void AssetDatabase::Entry::serialize(Serializer& s) const
 {
 	s << path;
 	s << meta;
+	if (s.getOptions().version >= 1) {
+		s << packLocation;
+	}
 }
 
 void AssetDatabase::Entry::deserialize(Deserializer& s)
 {
 	s >> path;
 	s >> meta;
+	if (s.getOptions().version >= 1) {
+		s >> packLocation;
+	}
 }
 
 size_t AssetDatabase::Entry::getMemoryUsage() const
@@ -117,6 +141,20 @@ const AssetDatabase::TypedDB& AssetDatabase::getDatabase(AssetType type) const
 	return iter->second;
 }
 
+const AssetDatabase::Entry* AssetDatabase::tryGet(const String& name, AssetType type) const
+{
+	const auto iter = dbs.find(static_cast<int>(type));
+	if (iter == dbs.end()) {
+		return nullptr;
+	}
+	return iter->second.tryGet(name);
+}
+
+const TreeMap<int, AssetDatabase::TypedDB>& AssetDatabase::getDatabases() const
+{
+	return dbs;
+}
+
 bool AssetDatabase::hasDatabase(AssetType type) const
 {
 	return dbs.find(static_cast<int>(type)) != dbs.end();
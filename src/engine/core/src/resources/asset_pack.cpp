@@ -1,21 +1,44 @@
 #include "halley/resources/asset_pack.h"
 #include "halley/resources/asset_database.h"
+#include "halley/resources/asset_pack_index.h"
+#include "halley/resources/resource.h"
 #include "halley/resources/resource_data.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/bytes/compression.h"
 #include "halley/maths/random.h"
 #include "halley/utils/encrypt.h"
+#include "halley/file/memory_mapped_file.h"
 
 using namespace Halley;
 
-void AssetPackHeader::init(size_t assetDbSize)
+namespace {
+	constexpr std::array<const char*, 3> packIdentifiers = { "HALLEYPK", "HALLEYP2", "HALLEYP3" };
+
+	SerializerOptions getAssetDbSerializerOptions(int version)
+	{
+		return SerializerOptions(version >= 2 ? SerializerOptions::maxVersion : 0);
+	}
+}
+
+void AssetPackHeader::init(size_t assetDbSize, int version)
 {
-	memcpy(identifier.data(), "HALLEYPK", 8);
+	Expects(version >= 1 && version <= latestVersion);
+	memcpy(identifier.data(), packIdentifiers[version - 1], 8);
 	assetDbStartPos = sizeof(AssetPackHeader);
 	dataStartPos = assetDbStartPos + assetDbSize;
 	memset(iv.data(), 0, iv.size());
 }
 
+std::optional<int> AssetPackHeader::getVersion() const
+{
+	for (size_t i = 0; i < packIdentifiers.size(); ++i) {
+		if (memcmp(identifier.data(), packIdentifiers[i], 8) == 0) {
+			return int(i + 1);
+		}
+	}
+	return {};
+}
+
 AssetPack::AssetPack()
 	: assetDb(std::make_unique<AssetDatabase>())
 	, hasReader(false)
@@ -42,11 +65,8 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, std::optional<
 	if (nRead != int(sizeof(header))) {
 		throw Exception("Unable to read header", HalleyExceptions::Resources);
 	}
-	if (memcmp(header.identifier.data(), "HALLEYPK", 8) != 0) {
-		throw Exception("Asset pack is invalid (invalid identifier)", HalleyExceptions::Resources);
-	}
-	iv = header.iv;
-	dataOffset = size_t(header.dataStartPos);
+	readHeader(header, totalSize);
+	setEncryptionKey(encryptionKey);
 
 	// Read asset database
 	{
@@ -56,13 +76,16 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, std::optional<
 		if (nRead != int(assetDbBytes.size())) {
 			throw Exception("Unable to read header", HalleyExceptions::Resources);
 		}
-		assetDb = std::make_unique<AssetDatabase>();
-		Deserializer::fromBytes<AssetDatabase>(*assetDb, Compression::decompress(assetDbBytes));
+		if (version >= 3) {
+			// The index is used in place, so keep it around
+			indexData = std::move(assetDbBytes);
+			readAssetDatabase(indexData.byte_span());
+		} else {
+			readAssetDatabase(gsl::as_bytes(gsl::span<const Byte>(assetDbBytes)));
+		}
 	}
 
-	std::array<char, 16> ivEmpty;
-	memset(ivEmpty.data(), 0, ivEmpty.size());
-	const bool hasCrypt = memcmp(iv.data(), ivEmpty.data(), iv.size()) != 0 && encryptionKey.has_value();
+	const bool hasCrypt = needsDecrypting(encryptionKey);
 
 	if (preLoad || hasCrypt) {
 		readToMemory();
@@ -73,6 +96,66 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, std::optional<
 	}
 }
 
+AssetPack::AssetPack(std::shared_ptr<MemoryMappedFile> file, std::optional<Encrypt::AESKey> encryptionKey)
+	: mappedFile(std::move(file))
+	, hasReader(false)
+{
+	Expects(mappedFile && mappedFile->isOpen());
+
+	const auto bytes = mappedFile->getSpan();
+	if (bytes.size() < sizeof(AssetPackHeader)) {
+		throw Exception("Asset pack is invalid (too small)", HalleyExceptions::Resources);
+	}
+	AssetPackHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	readHeader(header, bytes.size());
+	setEncryptionKey(encryptionKey);
+	readAssetDatabase(bytes.subspan(size_t(header.assetDbStartPos), size_t(header.dataStartPos - header.assetDbStartPos)));
+
+	if (needsDecrypting(encryptionKey)) {
+		readToMemory();
+		decrypt(*encryptionKey);
+	}
+}
+
+void AssetPack::readHeader(const AssetPackHeader& header, size_t totalSize)
+{
+	const auto headerVersion = header.getVersion();
+	if (!headerVersion) {
+		throw Exception("Asset pack is invalid (invalid identifier)", HalleyExceptions::Resources);
+	}
+	if (header.assetDbStartPos < sizeof(AssetPackHeader) || header.dataStartPos < header.assetDbStartPos || header.dataStartPos > totalSize) {
+		throw Exception("Asset pack is invalid (bad header)", HalleyExceptions::Resources);
+	}
+	version = *headerVersion;
+	iv = header.iv;
+	dataOffset = size_t(header.dataStartPos);
+}
+
+void AssetPack::readAssetDatabase(gsl::span<const gsl::byte> assetDbBytes)
+{
+	if (version >= 3) {
+		index = AssetPackIndex(assetDbBytes);
+		hasIndex = true;
+		assetDb.reset();
+		return;
+	}
+
+	assetDb = std::make_unique<AssetDatabase>();
+	Deserializer::fromBytes<AssetDatabase>(*assetDb, Compression::decompress(assetDbBytes), getAssetDbSerializerOptions(version));
+}
+
+bool AssetPack::needsDecrypting(const std::optional<Encrypt::AESKey>& encryptionKey) const
+{
+	if (version >= 2) {
+		// Entries are decrypted as they're read
+		return false;
+	}
+	std::array<char, 16> ivEmpty;
+	memset(ivEmpty.data(), 0, ivEmpty.size());
+	return memcmp(iv.data(), ivEmpty.data(), iv.size()) != 0 && encryptionKey.has_value();
+}
+
 AssetPack::~AssetPack()
 {
 	if (aliveToken) {
@@ -85,9 +168,17 @@ AssetPack& AssetPack::operator=(AssetPack&& other) noexcept
 	std::unique_lock<std::mutex> lock(other.readerMutex);
 
 	assetDb = std::move(other.assetDb);
+	index = other.index;
+	indexData = std::move(other.indexData);
+	hasIndex = other.hasIndex;
+	metadataCache = std::move(other.metadataCache);
 	dataOffset = other.dataOffset;
+	mappedFile = std::move(other.mappedFile);
 	reader = std::move(other.reader);
 	data = std::move(other.data);
+	version = other.version;
+	iv = other.iv;
+	key = other.key;
 	hasReader = !!reader;
 
 	other.hasReader = false;
@@ -96,14 +187,88 @@ AssetPack& AssetPack::operator=(AssetPack&& other) noexcept
 	return *this;
 }
 
-AssetDatabase& AssetPack::getAssetDatabase()
+const AssetDatabase& AssetPack::getAssetDatabase() const
 {
+	std::unique_lock<std::mutex> lock(assetDbMutex);
+	if (!assetDb) {
+		assetDb = index.makeDatabase();
+	}
 	return *assetDb;
 }
 
-const AssetDatabase& AssetPack::getAssetDatabase() const
+Vector<String> AssetPack::getAssetIds() const
 {
-	return *assetDb;
+	return collectAssetIds(false);
+}
+
+Vector<String> AssetPack::getDeletedAssetIds() const
+{
+	return collectAssetIds(true);
+}
+
+Vector<String> AssetPack::collectAssetIds(bool deleted) const
+{
+	Vector<String> result;
+	if (hasIndex) {
+		for (const auto type: index.getTypes()) {
+			const String prefix = toString(type) + ":";
+			for (const auto& entry: index.getEntries(type)) {
+				if (((entry.flags & AssetDatabase::PackLocation::Deleted) != 0) == deleted) {
+					result.push_back(prefix + index.getName(entry));
+				}
+			}
+		}
+	} else {
+		for (const auto& [typeId, db]: assetDb->getDatabases()) {
+			const String prefix = toString(db.getType()) + ":";
+			for (const auto& [name, entry]: db.getAssets()) {
+				if (entry.packLocation.hasFlag(AssetDatabase::PackLocation::Deleted) == deleted) {
+					result.push_back(prefix + name);
+				}
+			}
+		}
+	}
+	return result;
+}
+
+Vector<String> AssetPack::enumerate(AssetType type) const
+{
+	Vector<String> result;
+	if (hasIndex) {
+		for (const auto& entry: index.getEntries(type)) {
+			if ((entry.flags & AssetDatabase::PackLocation::Deleted) == 0) {
+				result.push_back(String(index.getName(entry)));
+			}
+		}
+	} else if (assetDb->hasDatabase(type)) {
+		for (const auto& [name, entry]: assetDb->getDatabase(type).getAssets()) {
+			if (!entry.packLocation.hasFlag(AssetDatabase::PackLocation::Deleted)) {
+				result.push_back(name);
+			}
+		}
+	}
+	return result;
+}
+
+const Metadata* AssetPack::getMetadata(const String& asset, AssetType type)
+{
+	if (!hasIndex) {
+		const auto* entry = assetDb->tryGet(asset, type);
+		return entry && !entry->packLocation.hasFlag(AssetDatabase::PackLocation::Deleted) ? &entry->meta : nullptr;
+	}
+
+	const auto* entry = index.tryGet(type, asset);
+	if (!entry || (entry->flags & AssetDatabase::PackLocation::Deleted) != 0) {
+		return nullptr;
+	}
+
+	// Deserialized on demand, and kept so the pointer stays valid
+	std::unique_lock<std::mutex> lock(metadataMutex);
+	auto& meta = metadataCache[entry];
+	if (!meta) {
+		meta = std::make_unique<Metadata>(index.getMetadata(*entry));
+	}
+	return meta.get();
 }
 
 Bytes& AssetPack::getData()
@@ -116,37 +281,85 @@ const Bytes& AssetPack::getData() const
 	return data;
 }
 
-Bytes AssetPack::writeOut() const
+int AssetPack::getVersion() const
 {
-	auto assetDbBytes = Compression::compress(Serializer::toBytes(*assetDb));
-	AssetPackHeader header;
-	header.init(assetDbBytes.size());
-	header.iv = iv;
+	return version;
+}
+
+void AssetPack::setEncryptionKey(std::optional<Encrypt::AESKey> encryptionKey)
+{
+	if (encryptionKey) {
+		key.emplace();
+		std::copy(encryptionKey->begin(), encryptionKey->end(), key->begin());
+	} else {
+		key.reset();
+	}
+}
+
+Bytes AssetPack::encodeEntry(gsl::span<const gsl::byte> assetData, std::optional<Encrypt::AESKey> encryptionKey, bool compress, AssetDatabase::PackLocation& location)
+{
+	location = {};
+	location.size = assetData.size();
+
+	Bytes result;
+	if (compress && !assetData.empty()) {
+		// Chunks are compressed independently, so streams can seek without decompressing everything before them
+		// Layout: the compressed size of each chunk as uint32, then the chunks
+		const size_t nChunks = (assetData.size() + lz4ChunkSize - 1) / lz4ChunkSize;
+		result.resize(nChunks * sizeof(uint32_t));
+		for (size_t i = 0; i < nChunks; ++i) {
+			const auto chunk = Compression::lz4Compress(assetData.subspan(i * lz4ChunkSize, std::min(lz4ChunkSize, assetData.size() - i * lz4ChunkSize)));
+			const auto chunkSize = static_cast<uint32_t>(chunk.size());
+			memcpy(result.data() + i * sizeof(uint32_t), &chunkSize, sizeof(chunkSize));
+			result.insert(result.end(), chunk.begin(), chunk.end());
+		}
+
+		// Not worth decompressing for a small saving
+		if (result.size() < assetData.size() - assetData.size() / 20) {
+			location.flags |= AssetDatabase::PackLocation::LZ4Compressed;
+		}
+	}
+	if (!location.hasFlag(AssetDatabase::PackLocation::LZ4Compressed)) {
+		result = Bytes(reinterpret_cast<const Byte*>(assetData.data()), reinterpret_cast<const Byte*>(assetData.data()) + assetData.size());
+	}
+	location.storedSize = result.size();
+
+	if (encryptionKey) {
+		Random::getGlobal().getBytes(gsl::as_writable_bytes(gsl::span<uint64_t>(&location.nonce, 1)));
+		location.flags |= AssetDatabase::PackLocation::Encrypted;
+		Encrypt::xcryptAESCTR(*encryptionKey, location.nonce, 0, result.byte_span());
+	}
 
-	auto result = Bytes(size_t(header.dataStartPos + data.size()));
-	memcpy(result.data(), &header, sizeof(AssetPackHeader));
-	memcpy(result.data() + header.assetDbStartPos, assetDbBytes.data(), assetDbBytes.size());
-	memcpy(result.data() + header.dataStartPos, data.data(), data.size());
 	return result;
 }
 
 std::unique_ptr<ResourceData> AssetPack::getData(const String& asset, AssetType type, bool stream)
 {
 	auto path = asset;
-	const auto* assetInfo = assetDb->getDatabase(type).tryGet(asset);
-	if (!assetInfo) {
+	const auto maybeLocation = tryGetLocation(asset, type);
+	if (!maybeLocation || maybeLocation->hasFlag(AssetDatabase::PackLocation::Deleted)) {
 		return {};
 	}
-	auto ps = assetInfo->path.split(':');
-	size_t pos = size_t(ps.at(0).toInteger());
-	size_t size = size_t(ps.at(1).toInteger());
+	const auto location = *maybeLocation;
+	const size_t pos = size_t(location.offset);
+	const size_t size = size_t(location.size);
 
 	if (stream) {
 		return std::make_unique<ResourceDataStream>(path, [=] () -> std::unique_ptr<ResourceDataReader> {
-			return std::make_unique<PackDataReader>(*this, pos, size);
+			return std::make_unique<PackDataReader>(*this, location);
 		});
+	} else if (location.flags != 0) {
+		return decodeEntry(asset, location);
 	} else {
-		if (hasReader) {
+		if (mappedFile) {
+			if (dataOffset + pos + size > mappedFile->size()) {
+				throw Exception("Asset \"" + asset + "\" is out of pack bounds.", HalleyExceptions::Resources);
+			}
+
+			// Points straight into the mapping, and keeps it alive for as long as the data is around
+			const auto* start = reinterpret_cast<const char*>(mappedFile->getSpan().data()) + dataOffset + pos;
+			return std::make_unique<ResourceDataStatic>(std::shared_ptr<const char>(mappedFile, start), size, path);
+		} else if (hasReader) {
 			auto result = new char[size];
 			try {
 				readData(pos, gsl::as_writable_bytes(gsl::span<char>(result, size)));
@@ -166,9 +379,76 @@ std::unique_ptr<ResourceData> AssetPack::getData(const String& asset, AssetType
 	}
 }
 
+std::optional<AssetDatabase::PackLocation> AssetPack::tryGetLocation(const String& asset, AssetType type) const
+{
+	if (hasIndex) {
+		const auto* entry = index.tryGet(type, asset);
+		if (!entry) {
+			return {};
+		}
+		return AssetPackIndex::getLocation(*entry);
+	}
+
+	const auto* assetInfo = assetDb->tryGet(asset, type);
+	if (!assetInfo) {
+		return {};
+	}
+	if (version >= 2) {
+		return assetInfo->packLocation;
+	}
+
+	auto ps = assetInfo->path.split(':');
+	AssetDatabase::PackLocation location;
+	location.offset = uint64_t(ps.at(0).toInteger64());
+	location.size = location.storedSize = uint64_t(ps.at(1).toInteger64());
+	return location;
+}
+
+std::unique_ptr<ResourceDataStatic> AssetPack::decodeEntry(const String& asset, const AssetDatabase::PackLocation& location)
+{
+	const size_t size = size_t(location.size);
+	auto result = new char[size];
+	try {
+		auto dst = gsl::as_writable_bytes(gsl::span<char>(result, size));
+		if (location.hasFlag(AssetDatabase::PackLocation::LZ4Compressed)) {
+			Bytes stored(size_t(location.storedSize));
+			readEntryData(location, 0, stored.byte_span());
+
+			const size_t nChunks = (size + lz4ChunkSize - 1) / lz4ChunkSize;
+			size_t srcPos = nChunks * sizeof(uint32_t);
+			if (srcPos > stored.size()) {
+				throw Exception("Asset \"" + asset + "\" is corrupted.", HalleyExceptions::Resources);
+			}
+			for (size_t i = 0; i < nChunks; ++i) {
+				uint32_t chunkSize;
+				memcpy(&chunkSize, stored.data() + i * sizeof(uint32_t), sizeof(chunkSize));
+				const size_t expected = std::min(lz4ChunkSize, size - i * lz4ChunkSize);
+				if (srcPos + chunkSize > stored.size() || Compression::lz4Decompress(stored.byte_span().subspan(srcPos, chunkSize), dst.subspan(i * lz4ChunkSize, expected)) != expected) {
+					throw Exception("Asset \"" + asset + "\" is corrupted.", HalleyExceptions::Resources);
+				}
+				srcPos += chunkSize;
+			}
+		} else {
+			readEntryData(location, 0, dst);
+		}
+		return std::make_unique<ResourceDataStatic>(result, size, asset, true);
+	} catch (...) {
+		delete[] result;
+		throw;
+	}
+}
+
 void AssetPack::readToMemory()
 {
 	std::unique_lock<std::mutex> lock(readerMutex);
+	if (mappedFile) {
+		const auto bytes = mappedFile->getSpan().subspan(dataOffset);
+		data = Bytes(bytes.size());
+		memcpy(data.data(), bytes.data(), bytes.size());
+		mappedFile.reset();
+		return;
+	}
+
 	reader->seek(dataOffset, SEEK_SET);
 	data = reader->readAll();
 	hasReader = false;
@@ -177,6 +457,10 @@ void AssetPack::readToMemory()
 
 void AssetPack::encrypt(Encrypt::AESKey key)
 {
+	if (version >= 2) {
+		throw Exception("Packs from format 2 onwards are encrypted per entry, see AssetPackBuilder", HalleyExceptions::Resources);
+	}
+
 	// Generate IV
 	Random::getGlobal().getBytes(gsl::as_writable_bytes(gsl::span<uint8_t>(iv)));
 
@@ -190,6 +474,15 @@ void AssetPack::decrypt(Encrypt::AESKey key)
 
 void AssetPack::readData(size_t pos, gsl::span<gsl::byte> dst)
 {
+	if (mappedFile) {
+		// No shared seek position, so no need to lock
+		if (dataOffset + pos + size_t(dst.size()) > mappedFile->size()) {
+			throw Exception("Asset data is out of pack bounds.", HalleyExceptions::Resources);
+		}
+		mappedFile->readAt(dataOffset + pos, dst);
+		return;
+	}
+
 	if (hasReader) {
 		std::unique_lock<std::mutex> lock(readerMutex);
 		if (reader) {
@@ -206,6 +499,21 @@ void AssetPack::readData(size_t pos, gsl::span<gsl::byte> dst)
 	memcpy(dst.data(), data.data() + pos, dst.size());
 }
 
+void AssetPack::readEntryData(const AssetDatabase::PackLocation& location, size_t pos, gsl::span<gsl::byte> dst)
+{
+	if (pos + size_t(dst.size()) > location.storedSize) {
+		throw Exception("Asset data is out of entry bounds.", HalleyExceptions::Resources);
+	}
+	readData(size_t(location.offset) + pos, dst);
+
+	if (location.hasFlag(AssetDatabase::PackLocation::Encrypted)) {
+		if (!key) {
+			throw Exception("Asset is encrypted, but no key was provided.", HalleyExceptions::Resources);
+		}
+		Encrypt::xcryptAESCTR(*key, location.nonce, pos, dst);
+	}
+}
+
 std::unique_ptr<ResourceDataReader> AssetPack::extractReader()
 {
 	std::unique_lock<std::mutex> lock(readerMutex);
@@ -223,20 +531,36 @@ std::shared_ptr<bool> AssetPack::getAliveToken() const
 
 size_t AssetPack::getMemoryUsage() const
 {
-	return sizeof(*this) + data.size() + assetDb->getMemoryUsage();
+	// A mapping is paged in by the OS, so it's not counted here
+	std::unique_lock<std::mutex> lock(assetDbMutex);
+	return sizeof(*this) + data.size() + indexData.size() + (assetDb ? assetDb->getMemoryUsage() : 0);
+}
+
+bool AssetPack::isMemoryMapped() const
+{
+	return !!mappedFile;
 }
 
 PackDataReader::PackDataReader(AssetPack& pack, size_t startPos, size_t fileSize)
+	: PackDataReader(pack, [&] {
+		AssetDatabase::PackLocation location;
+		location.offset = startPos;
+		location.size = location.storedSize = fileSize;
+		return location;
+	}())
+{
+}
+
+PackDataReader::PackDataReader(AssetPack& pack, const AssetDatabase::PackLocation& location)
 	: pack(pack)
-	, startPos(startPos)
-	, fileSize(fileSize)
+	, location(location)
 	, aliveToken(pack.getAliveToken())
 {
 }
 
 size_t PackDataReader::size() const
 {
-	return fileSize;
+	return size_t(location.size);
 }
 
 int PackDataReader::read(gsl::span<gsl::byte> dst)
@@ -246,15 +570,59 @@ int PackDataReader::read(gsl::span<gsl::byte> dst)
 	}
 
 	std::unique_lock<std::mutex> lock(mutex);
-	size_t available = fileSize - curPos;
+	size_t available = curPos < location.size ? size_t(location.size) - curPos : 0;
 	size_t toRead = std::min(available, size_t(dst.size()));
 
-	pack.readData(startPos + curPos, dst.subspan(0, toRead));
+	if (location.hasFlag(AssetDatabase::PackLocation::LZ4Compressed)) {
+		readCompressed(dst.subspan(0, toRead));
+	} else {
+		pack.readEntryData(location, curPos, dst.subspan(0, toRead));
+	}
 	curPos += toRead;
 
 	return int(toRead);
 }
 
+void PackDataReader::readCompressed(gsl::span<gsl::byte> dst)
+{
+	const size_t size = size_t(location.size);
+	const size_t nChunks = (size + AssetPack::lz4ChunkSize - 1) / AssetPack::lz4ChunkSize;
+
+	if (chunkOffsets.empty()) {
+		Vector<uint32_t> chunkSizes(nChunks);
+		pack.readEntryData(location, 0, gsl::as_writable_bytes(gsl::span<uint32_t>(chunkSizes)));
+
+		chunkOffsets.resize(nChunks + 1);
+		chunkOffsets[0] = nChunks * sizeof(uint32_t);
+		for (size_t i = 0; i < nChunks; ++i) {
+			chunkOffsets[i + 1] = chunkOffsets[i] + chunkSizes[i];
+		}
+	}
+
+	size_t pos = curPos;
+	while (!dst.empty()) {
+		const size_t chunkIdx = pos / AssetPack::lz4ChunkSize;
+		const size_t chunkStart = chunkIdx * AssetPack::lz4ChunkSize;
+		const size_t chunkSize = std::min(AssetPack::lz4ChunkSize, size - chunkStart);
+
+		if (chunkIdx != curChunk) {
+			curChunk = std::numeric_limits<size_t>::max();
+			compressedChunk.resize(size_t(chunkOffsets[chunkIdx + 1] - chunkOffsets[chunkIdx]));
+			pack.readEntryData(location, size_t(chunkOffsets[chunkIdx]), compressedChunk.byte_span());
+			chunk.resize(chunkSize);
+			if (Compression::lz4Decompress(compressedChunk.byte_span(), chunk.byte_span()) != chunkSize) {
+				throw Exception("Asset data is corrupted.", HalleyExceptions::Resources);
+			}
+			curChunk = chunkIdx;
+		}
+
+		const size_t n = std::min(size_t(dst.size()), chunkStart + chunkSize - pos);
+		memcpy(dst.data(), chunk.data() + (pos - chunkStart), n);
+		dst = dst.subspan(n);
+		pos += n;
+	}
+}
+
 void PackDataReader::seek(int64_t pos, int whence)
 {
 	if (!*aliveToken) {
@@ -270,7 +638,7 @@ void PackDataReader::seek(int64_t pos, int whence)
 		curPos = size_t(curPos + pos);
 		break;
 	case SEEK_END:
-		curPos = size_t(fileSize + pos);
+		curPos = size_t(location.size + pos);
 		break;
 	}
 }
@@ -294,3 +662,54 @@ bool PackDataReader::isAvailable() const
 	return *aliveToken;
 }
 
+
+AssetPackBuilder::AssetPackBuilder(std::optional<Encrypt::AESKey> encryptionKey)
+{
+	if (encryptionKey) {
+		key.emplace();
+		std::copy(encryptionKey->begin(), encryptionKey->end(), key->begin());
+	}
+}
+
+void AssetPackBuilder::addAsset(const String& name, AssetType type, gsl::span<const gsl::byte> assetData, const Metadata& meta, bool compress)
+{
+	AssetDatabase::PackLocation location;
+	const auto stored = AssetPack::encodeEntry(assetData, key ? std::optional<Encrypt::AESKey>(*key) : std::nullopt, compress, location);
+	location.offset = data.size();
+	data.reserve(nextPowerOf2(data.size() + stored.size()));
+	data.insert(data.end(), stored.begin(), stored.end());
+
+	AssetDatabase::Entry entry("", meta);
+	entry.packLocation = location;
+	assetDb.addAsset(name, type, std::move(entry));
+}
+
+void AssetPackBuilder::addTombstone(const String& name, AssetType type)
+{
+	AssetDatabase::Entry entry;
+	entry.packLocation.flags = AssetDatabase::PackLocation::Deleted;
+	assetDb.addAsset(name, type, std::move(entry));
+}
+
+const AssetDatabase& AssetPackBuilder::getAssetDatabase() const
+{
+	return assetDb;
+}
+
+size_t AssetPackBuilder::getDataSize() const
+{
+	return data.size();
+}
+
+Bytes AssetPackBuilder::writeOut() const
+{
+	const auto assetDbBytes = AssetPackIndex::build(assetDb);
+	AssetPackHeader header;
+	header.init(assetDbBytes.size());
+
+	auto result = Bytes(size_t(header.dataStartPos + data.size()));
+	memcpy(result.data(), &header, sizeof(AssetPackHeader));
+	memcpy(result.data() + header.assetDbStartPos, assetDbBytes.data(), assetDbBytes.size());
+	memcpy(result.data() + header.dataStartPos, data.data(), data.size());
+	return result;
+}
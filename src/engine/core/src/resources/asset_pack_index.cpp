@@ -0,0 +1,213 @@
+#include "halley/resources/asset_pack_index.h"
+#include "halley/bytes/byte_serializer.h"
+#include "halley/support/exception.h"
+#include "halley/utils/hash.h"
+
+using namespace Halley;
+
+namespace {
+	constexpr std::array<char, 4> indexIdentifier = { 'H', 'I', 'D', 'X' };
+
+	static_assert(sizeof(AssetPackIndex::Header) == 32);
+	static_assert(sizeof(AssetPackIndex::TypeRange) == 16);
+	static_assert(sizeof(AssetPackIndex::Entry) == 64);
+}
+
+uint64_t AssetPackIndex::hashName(std::string_view name)
+{
+	return Hash::hash(gsl::as_bytes(gsl::span<const char>(name.data(), name.size())));
+}
+
+Bytes AssetPackIndex::build(const AssetDatabase& db)
+{
+	Vector<TypeRange> typeRanges;
+	Vector<Entry> indexEntries;
+	String namesData;
+	Bytes metadataData;
+
+	for (const auto& [typeId, typeDb]: db.getDatabases()) {
+		TypeRange range = {};
+		range.type = static_cast<int32_t>(typeDb.getType());
+		range.firstEntry = static_cast<uint32_t>(indexEntries.size());
+
+		Vector<std::pair<uint64_t, const String*>> sorted;
+		sorted.reserve(typeDb.getAssets().size());
+		for (const auto& [name, entry]: typeDb.getAssets()) {
+			sorted.emplace_back(hashName(name), &name);
+		}
+		std::sort(sorted.begin(), sorted.end(), [] (const auto& a, const auto& b) { return a.first != b.first ? a.first < b.first : *a.second < *b.second; });
+
+		for (const auto& [hash, name]: sorted) {
+			const auto& assetEntry = typeDb.get(*name);
+			const auto& location = assetEntry.packLocation;
+
+			Entry entry = {};
+			entry.nameHash = hash;
+			entry.offset = location.offset;
+			entry.storedSize = location.storedSize;
+			entry.size = location.size;
+			entry.nonce = location.nonce;
+			entry.flags = location.flags;
+			entry.namePos = static_cast<uint32_t>(namesData.size());
+			entry.nameLength = static_cast<uint32_t>(name->size());
+			namesData += *name;
+
+			if (assetEntry.meta != Metadata()) {
+				const auto metaBytes = Serializer::toBytes(assetEntry.meta, SerializerOptions(SerializerOptions::maxVersion));
+				entry.metadataPos = metadataData.size();
+				entry.metadataSize = static_cast<uint32_t>(metaBytes.size());
+				metadataData.insert(metadataData.end(), metaBytes.begin(), metaBytes.end());
+			}
+
+			indexEntries.push_back(entry);
+		}
+
+		range.nEntries = static_cast<uint32_t>(indexEntries.size() - range.firstEntry);
+		if (range.nEntries > 0) {
+			typeRanges.push_back(range);
+		}
+	}
+
+	Header header = {};
+	header.identifier = indexIdentifier;
+	header.nTypes = static_cast<uint32_t>(typeRanges.size());
+	header.nEntries = static_cast<uint32_t>(indexEntries.size());
+	header.namesSize = static_cast<uint32_t>(namesData.size());
+	header.namesPos = sizeof(Header) + typeRanges.size() * sizeof(TypeRange) + indexEntries.size() * sizeof(Entry);
+	header.metadataPos = alignUp<uint64_t>(header.namesPos + namesData.size(), 8);
+
+	// Metadata positions are relative to the start of the index from here on
+	for (auto& entry: indexEntries) {
+		if (entry.metadataSize > 0) {
+			entry.metadataPos += header.metadataPos;
+		}
+	}
+
+	Bytes result(alignUp<size_t>(size_t(header.metadataPos) + metadataData.size(), 8));
+	memcpy(result.data(), &header, sizeof(header));
+	memcpy(result.data() + sizeof(Header), typeRanges.data(), typeRanges.size() * sizeof(TypeRange));
+	memcpy(result.data() + sizeof(Header) + typeRanges.size() * sizeof(TypeRange), indexEntries.data(), indexEntries.size() * sizeof(Entry));
+	memcpy(result.data() + header.namesPos, namesData.c_str(), namesData.size());
+	memcpy(result.data() + header.metadataPos, metadataData.data(), metadataData.size());
+	return result;
+}
+
+AssetPackIndex::AssetPackIndex(gsl::span<const gsl::byte> data)
+	: data(data)
+{
+	if (data.size() < sizeof(Header)) {
+		throw Exception("Asset pack index is invalid (too small)", HalleyExceptions::Resources);
+	}
+	if (reinterpret_cast<uintptr_t>(data.data()) % alignof(Entry) != 0) {
+		throw Exception("Asset pack index is misaligned", HalleyExceptions::Resources);
+	}
+
+	const auto& header = *reinterpret_cast<const Header*>(data.data());
+	if (header.identifier != indexIdentifier) {
+		throw Exception("Asset pack index is invalid (invalid identifier)", HalleyExceptions::Resources);
+	}
+
+	const size_t tablesEnd = sizeof(Header) + size_t(header.nTypes) * sizeof(TypeRange) + size_t(header.nEntries) * sizeof(Entry);
+	if (tablesEnd > header.namesPos || header.namesPos + header.namesSize > header.metadataPos || header.metadataPos > data.size()) {
+		throw Exception("Asset pack index is invalid (bad header)", HalleyExceptions::Resources);
+	}
+
+	types = gsl::span<const TypeRange>(reinterpret_cast<const TypeRange*>(data.data() + sizeof(Header)), header.nTypes);
+	entries = gsl::span<const Entry>(reinterpret_cast<const Entry*>(data.data() + sizeof(Header) + types.size_bytes()), header.nEntries);
+	names = std::string_view(reinterpret_cast<const char*>(data.data() + header.namesPos), header.namesSize);
+
+	for (const auto& type: types) {
+		if (size_t(type.firstEntry) + type.nEntries > entries.size()) {
+			throw Exception("Asset pack index is invalid (bad type range)", HalleyExceptions::Resources);
+		}
+	}
+	for (const auto& entry: entries) {
+		if (size_t(entry.namePos) + entry.nameLength > names.size() || (entry.metadataSize > 0 && (entry.metadataPos < header.metadataPos || entry.metadataPos + entry.metadataSize > data.size()))) {
+			throw Exception("Asset pack index is invalid (bad entry)", HalleyExceptions::Resources);
+		}
+	}
+}
+
+bool AssetPackIndex::isEmpty() const
+{
+	return entries.empty();
+}
+
+size_t AssetPackIndex::getEntryCount() const
+{
+	return entries.size();
+}
+
+const AssetPackIndex::Entry* AssetPackIndex::tryGet(AssetType type, std::string_view name) const
+{
+	const auto typeEntries = getEntries(type);
+	if (typeEntries.empty()) {
+		return nullptr;
+	}
+
+	const auto hash = hashName(name);
+	auto iter = std::lower_bound(typeEntries.begin(), typeEntries.end(), hash, [] (const Entry& e, uint64_t h) { return e.nameHash < h; });
+	for (; iter != typeEntries.end() && iter->nameHash == hash; ++iter) {
+		if (getName(*iter) == name) {
+			return &*iter;
+		}
+	}
+	return nullptr;
+}
+
+gsl::span<const AssetPackIndex::Entry> AssetPackIndex::getEntries(AssetType type) const
+{
+	const auto iter = std::lower_bound(types.begin(), types.end(), static_cast<int32_t>(type), [] (const TypeRange& r, int32_t t) { return r.type < t; });
+	if (iter == types.end() || iter->type != static_cast<int32_t>(type)) {
+		return {};
+	}
+	return entries.subspan(iter->firstEntry, iter->nEntries);
+}
+
+Vector<AssetType> AssetPackIndex::getTypes() const
+{
+	Vector<AssetType> result;
+	result.reserve(types.size());
+	for (const auto& type: types) {
+		result.push_back(static_cast<AssetType>(type.type));
+	}
+	return result;
+}
+
+std::string_view AssetPackIndex::getName(const Entry& entry) const
+{
+	return names.substr(entry.namePos, entry.nameLength);
+}
+
+Metadata AssetPackIndex::getMetadata(const Entry& entry) const
+{
+	Metadata result;
+	if (entry.metadataSize > 0) {
+		Deserializer::fromBytes(result, data.subspan(size_t(entry.metadataPos), entry.metadataSize), SerializerOptions(SerializerOptions::maxVersion));
+	}
+	return result;
+}
+
+AssetDatabase::PackLocation AssetPackIndex::getLocation(const Entry& entry)
+{
+	AssetDatabase::PackLocation location;
+	location.offset = entry.offset;
+	location.storedSize = entry.storedSize;
+	location.size = entry.size;
+	location.nonce = entry.nonce;
+	location.flags = entry.flags;
+	return location;
+}
+
+std::unique_ptr<AssetDatabase> AssetPackIndex::makeDatabase() const
+{
+	auto db = std::make_unique<AssetDatabase>();
+	for (const auto& type: types) {
+		for (const auto& entry: entries.subspan(type.firstEntry, type.nEntries)) {
+			AssetDatabase::Entry dbEntry("", getMetadata(entry));
+			dbEntry.packLocation = getLocation(entry);
+			db->addAsset(String(getName(entry)), static_cast<AssetType>(type.type), std::move(dbEntry));
+		}
+	}
+	return db;
+}
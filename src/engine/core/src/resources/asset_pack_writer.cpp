@@ -0,0 +1,151 @@
+#include "halley/resources/asset_pack_writer.h"
+#include "halley/resources/asset_pack.h"
+#include "halley/resources/asset_pack_index.h"
+#include "halley/resources/resource.h"
+#include "halley/support/exception.h"
+#include "halley/utils/hash.h"
+
+using namespace Halley;
+
+namespace {
+	// Smaller entries are packed together instead, as they're read in one go anyway
+	constexpr size_t smallEntryAlignment = 8;
+}
+
+AssetPackWriter::AssetPackWriter(Path path, std::optional<Encrypt::AESKey> encryptionKey, size_t alignment)
+	: path(std::move(path))
+	, alignment(alignment)
+{
+	Expects(alignment >= smallEntryAlignment && (alignment & (alignment - 1)) == 0);
+
+	if (encryptionKey) {
+		key.emplace();
+		std::copy(encryptionKey->begin(), encryptionKey->end(), key->begin());
+	}
+}
+
+AssetPackWriter::~AssetPackWriter()
+{
+}
+
+void AssetPackWriter::declare(const String& name, AssetType type, const Metadata& meta)
+{
+	Expects(!file.is_open());
+	declared.addAsset(name, type, AssetDatabase::Entry("", meta));
+}
+
+void AssetPackWriter::begin()
+{
+	// Locations are fixed size, so this is as large as the index can get
+	const size_t maxIndexSize = AssetPackIndex::build(declared).size();
+	dataStartPos = alignUp(sizeof(AssetPackHeader) + maxIndexSize, alignment);
+
+#ifdef _WIN32
+	file.open(path.getString().getUTF16().c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+#else
+	file.open(path.string(), std::ios::binary | std::ios::out | std::ios::trunc);
+#endif
+	if (!file.is_open()) {
+		throw Exception("Unable to open \"" + path.getString() + "\" for writing", HalleyExceptions::Resources);
+	}
+	writePadding(dataStartPos);
+}
+
+AssetPackWriter::EncodedAsset AssetPackWriter::encode(gsl::span<const gsl::byte> data, bool compress) const
+{
+	EncodedAsset result;
+	result.contentHash = Hash::hash(data);
+	result.data = AssetPack::encodeEntry(data, key ? std::optional<Encrypt::AESKey>(*key) : std::nullopt, compress, result.location);
+	return result;
+}
+
+void AssetPackWriter::write(const String& name, AssetType type, EncodedAsset asset)
+{
+	Expects(file.is_open());
+
+	AssetDatabase::Entry entry("", getDeclared(name, type).meta);
+
+	const auto contentKey = std::make_pair(asset.contentHash, asset.location.size);
+	const auto iter = contents.find(contentKey);
+	if (iter != contents.end()) {
+		entry.packLocation = iter->second;
+		++nDeduplicated;
+	} else {
+		const size_t entryAlignment = asset.data.size() >= alignment ? alignment : smallEntryAlignment;
+		const size_t offset = alignUp(dataSize, entryAlignment);
+		writePadding(offset - dataSize);
+		writeBytes(asset.data.const_byte_span());
+		dataSize = offset + asset.data.size();
+
+		entry.packLocation = asset.location;
+		entry.packLocation.offset = offset;
+		contents[contentKey] = entry.packLocation;
+	}
+
+	written.addAsset(name, type, std::move(entry));
+}
+
+void AssetPackWriter::writeTombstone(const String& name, AssetType type)
+{
+	Expects(file.is_open());
+
+	getDeclared(name, type);
+	AssetDatabase::Entry entry;
+	entry.packLocation.flags = AssetDatabase::PackLocation::Deleted;
+	written.addAsset(name, type, std::move(entry));
+}
+
+void AssetPackWriter::finish()
+{
+	Expects(file.is_open());
+
+	// Leaving out entries that weren't written only makes the index smaller
+	const auto index = AssetPackIndex::build(written);
+	Ensures(sizeof(AssetPackHeader) + index.size() <= dataStartPos);
+
+	AssetPackHeader header;
+	header.init(dataStartPos - sizeof(AssetPackHeader));
+	file.seekp(0);
+	writeBytes(gsl::as_bytes(gsl::span<const AssetPackHeader>(&header, 1)));
+	writeBytes(index.const_byte_span());
+
+	file.close();
+	if (file.fail()) {
+		throw Exception("Unable to write pack \"" + path.getString() + "\"", HalleyExceptions::Resources);
+	}
+}
+
+size_t AssetPackWriter::getDataSize() const
+{
+	return dataSize;
+}
+
+size_t AssetPackWriter::getDeduplicatedCount() const
+{
+	return nDeduplicated;
+}
+
+const AssetDatabase::Entry& AssetPackWriter::getDeclared(const String& name, AssetType type) const
+{
+	const auto* entry = declared.getDatabase(type).tryGet(name);
+	if (!entry) {
+		throw Exception("Asset " + toString(type) + ":" + name + " was not declared before the pack was started", HalleyExceptions::Resources);
+	}
+	return *entry;
+}
+
+void AssetPackWriter::writeBytes(gsl::span<const gsl::byte> bytes)
+{
+	file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	if (file.fail()) {
+		throw Exception("Unable to write pack \"" + path.getString() + "\"", HalleyExceptions::Resources);
+	}
+}
+
+void AssetPackWriter::writePadding(size_t size)
+{
+	constexpr std::array<char, 64> zeros = {};
+	for (size_t i = 0; i < size; i += zeros.size()) {
+		writeBytes(gsl::as_bytes(gsl::span<const char>(zeros.data(), std::min(zeros.size(), size - i))));
+	}
+}
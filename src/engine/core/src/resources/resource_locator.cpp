@@ -7,9 +7,26 @@
 #include "halley/text/string_converter.h"
 #include "halley/resources/resource.h"
 #include "halley/utils/algorithm.h"
+#include "halley/file/memory_mapped_file.h"
 
 using namespace Halley;
 
+Vector<String> IResourceLocatorProvider::getAssetIds()
+{
+	return getAssetDatabase().getAssets();
+}
+
+Vector<String> IResourceLocatorProvider::enumerate(AssetType type)
+{
+	return getAssetDatabase().enumerate(type);
+}
+
+const Metadata* IResourceLocatorProvider::getMetadata(const String& asset, AssetType type)
+{
+	const auto* entry = getAssetDatabase().getDatabase(type).tryGet(asset);
+	return entry ? &entry->meta : nullptr;
+}
+
 ResourceLocator::ResourceLocator(SystemAPI& system)
 	: system(system)
 {
@@ -24,15 +41,43 @@ void ResourceLocator::add(std::unique_ptr<IResourceLocatorProvider> locator, con
 
 void ResourceLocator::loadLocatorData(IResourceLocatorProvider& locator)
 {
-	auto& db = locator.getAssetDatabase();
-	for (auto& asset: db.getAssets()) {
+	const int priority = locator.getPriority();
+
+	// Deleted assets are hidden in every provider of lower priority, regardless of the order they're added in
+	for (auto& asset: locator.getDeletedAssetIds()) {
+		const auto deleted = deletedAssets.find(asset);
+		if (deleted == deletedAssets.end() || deleted->second < priority) {
+			deletedAssets[asset] = priority;
+		}
+
+		const auto result = assetToLocator.find(asset);
+		if (result != assetToLocator.end() && result->second->getPriority() < priority) {
+			assetToLocator.erase(result);
+		}
+	}
+
+	for (auto& asset: locator.getAssetIds()) {
+		const auto deleted = deletedAssets.find(asset);
+		if (deleted != deletedAssets.end() && deleted->second > priority) {
+			continue;
+		}
+
 		auto result = assetToLocator.find(asset);
-		if (result == assetToLocator.end() || result->second->getPriority() < locator.getPriority()) {
+		if (result == assetToLocator.end() || result->second->getPriority() < priority) {
 			assetToLocator[asset] = &locator;
 		}
 	}
 }
 
+void ResourceLocator::reloadAllLocatorData()
+{
+	assetToLocator.clear();
+	deletedAssets.clear();
+	for (auto& locator: locators) {
+		loadLocatorData(*locator);
+	}
+}
+
 void ResourceLocator::purge(const String& asset, AssetType type)
 {
 	auto result = assetToLocator.find(toString(type) + ":" + asset);
@@ -48,6 +93,7 @@ void ResourceLocator::purge(const String& asset, AssetType type)
 void ResourceLocator::purgeAll()
 {
 	assetToLocator.clear();
+	deletedAssets.clear();
 	for (auto& locator: locators) {
 		locator->purgeAll(system);
 		loadLocatorData(*locator);
@@ -118,9 +164,13 @@ std::unique_ptr<ResourceDataStream> ResourceLocator::getStream(const String& ass
 Vector<String> ResourceLocator::enumerate(const AssetType type)
 {
 	Vector<String> result;
+	const String prefix = toString(type) + ":";
 	for (auto& l: locators) {
-		for (auto& r: l->getAssetDatabase().enumerate(type)) {
-			result.push_back(std::move(r));
+		for (auto& r: l->enumerate(type)) {
+			const auto deleted = deletedAssets.find(prefix + r);
+			if (deleted == deletedAssets.end() || deleted->second <= l->getPriority()) {
+				result.push_back(std::move(r));
+			}
 		}
 	}
 	return result;
@@ -146,29 +196,27 @@ void ResourceLocator::addPack(const Path& path, std::optional<Encrypt::AESKey> e
 	}
 }
 
-void ResourceLocator::removePack(const Path& path)
+void ResourceLocator::addMappedPack(const Path& path, std::optional<Encrypt::AESKey> encryptionKey, bool allowFailure, std::optional<int> priority)
 {
-	auto* locatorToRemove = locatorPaths.find(path.getString())->second;
-	auto& dbToRemove = locatorToRemove->getAssetDatabase();
-	for (auto& asset : dbToRemove.getAssets()) {
-		auto result = assetToLocator.find(asset);
-		if (result != assetToLocator.end()) {
-			assetToLocator.erase(asset);
+	if (MemoryMappedFile::isSupported()) {
+		auto file = std::make_shared<MemoryMappedFile>(path);
+		if (file->isOpen()) {
+			add(std::make_unique<PackResourceLocator>(std::move(file), path, encryptionKey, priority), path);
+			return;
 		}
 	}
+	addPack(path, encryptionKey, false, allowFailure, priority);
+}
+
+void ResourceLocator::removePack(const Path& path)
+{
+	auto* locatorToRemove = locatorPaths.find(path.getString())->second;
 	auto locaterIter = std::find_if(locators.begin(), locators.end(), [&](std::unique_ptr<IResourceLocatorProvider>& locator) { return locator.get() == locatorToRemove; });
 	locators.erase(locaterIter);
-	
-	for (const auto& locator : locators)
-	{
-		auto& db = locator->getAssetDatabase();
-		for (auto& asset : db.getAssets()) {
-			auto result = assetToLocator.find(asset);
-			if (result == assetToLocator.end() || result->second->getPriority() < locator->getPriority()) {
-				assetToLocator[asset] = locator.get();
-			}
-		}
-	}
+	locatorPaths.erase(path.getString());
+
+	// Assets it deleted might be visible again
+	reloadAllLocatorData();
 }
 
 Vector<String> ResourceLocator::getAssetsFromPack(const Path& path, std::optional<Encrypt::AESKey> encryptionKey) const
@@ -176,8 +224,7 @@ Vector<String> ResourceLocator::getAssetsFromPack(const Path& path, std::optiona
 	auto dataReader = system.getDataReader(path.string());
 	if (dataReader) {
 		std::unique_ptr<IResourceLocatorProvider> resourceLocator = std::make_unique<PackResourceLocator>(std::move(dataReader), path, encryptionKey, true);
-		auto& db = resourceLocator->getAssetDatabase();
-		return db.getAssets();
+		return resourceLocator->getAssetIds();
 	}
 	else {
 		throw Exception("Unable to load resource pack \"" + path.string() + "\"", HalleyExceptions::Resources);
@@ -188,7 +235,11 @@ const Metadata* ResourceLocator::getMetaData(const String& asset, AssetType type
 {
 	auto result = assetToLocator.find(toString(type) + ":" + asset);
 	if (result != assetToLocator.end()) {
-		return &result->second->getAssetDatabase().getDatabase(type).get(asset).meta;
+		const auto* meta = result->second->getMetadata(asset, type);
+		if (!meta) {
+			throw Exception("Asset not found: " + toString(type) + ":" + asset, HalleyExceptions::Resources);
+		}
+		return meta;
 	} else {
 		return &dummyMetadata;
 	}
@@ -3,6 +3,7 @@
 #include "halley/resources/asset_pack.h"
 #include "halley/api/system_api.h"
 #include "halley/utils/algorithm.h"
+#include "halley/file/memory_mapped_file.h"
 using namespace Halley;
 
 PackResourceLocator::PackResourceLocator(std::unique_ptr<ResourceDataReader> reader, Path path, std::optional<Encrypt::AESKey> key, bool preLoad, std::optional<int> priority)
@@ -14,6 +15,15 @@ PackResourceLocator::PackResourceLocator(std::unique_ptr<ResourceDataReader> rea
 	assetPack = std::make_unique<AssetPack>(std::move(reader), key, preLoad);
 }
 
+PackResourceLocator::PackResourceLocator(std::shared_ptr<MemoryMappedFile> file, Path path, std::optional<Encrypt::AESKey> key, std::optional<int> priority)
+	: path(std::move(path))
+	, wasEncrypted(key.has_value())
+	, memoryMapped(true)
+	, priority(priority)
+{
+	assetPack = std::make_unique<AssetPack>(std::move(file), key);
+}
+
 PackResourceLocator::~PackResourceLocator()
 {
 }
@@ -34,6 +44,38 @@ const AssetDatabase& PackResourceLocator::getAssetDatabase()
 	return assetPack->getAssetDatabase();
 }
 
+Vector<String> PackResourceLocator::getAssetIds()
+{
+	if (!assetPack) {
+		loadAfterPurge();
+	}
+	return assetPack->getAssetIds();
+}
+
+Vector<String> PackResourceLocator::getDeletedAssetIds()
+{
+	if (!assetPack) {
+		loadAfterPurge();
+	}
+	return assetPack->getDeletedAssetIds();
+}
+
+Vector<String> PackResourceLocator::enumerate(AssetType type)
+{
+	if (!assetPack) {
+		loadAfterPurge();
+	}
+	return assetPack->enumerate(type);
+}
+
+const Metadata* PackResourceLocator::getMetadata(const String& asset, AssetType type)
+{
+	if (!assetPack) {
+		loadAfterPurge();
+	}
+	return assetPack->getMetadata(asset, type);
+}
+
 void PackResourceLocator::purgeAll(SystemAPI& sys)
 {
 	assetPack.reset();
@@ -57,6 +99,13 @@ void PackResourceLocator::loadAfterPurge()
 	if (wasEncrypted) {
 		throw Exception("Attempting to hot reload a pack, but key has been lost.", HalleyExceptions::Resources);
 	}
+	if (memoryMapped) {
+		auto file = std::make_shared<MemoryMappedFile>(path);
+		if (file->isOpen()) {
+			assetPack = std::make_unique<AssetPack>(std::move(file), std::nullopt);
+			return;
+		}
+	}
 	assetPack = std::make_unique<AssetPack>(system->getDataReader(path.string()), std::nullopt, preLoad);
 }
 
@@ -7,15 +7,21 @@
 namespace Halley {
 	class SystemAPI;
 	class AssetPack;
+	class MemoryMappedFile;
 
 	class PackResourceLocator final : public IResourceLocatorProvider {
 	public:
 		explicit PackResourceLocator(std::unique_ptr<ResourceDataReader> reader, Path path, std::optional<Encrypt::AESKey> encryptionKey = std::nullopt, bool preLoad = false, std::optional<int> priority = {});
+		explicit PackResourceLocator(std::shared_ptr<MemoryMappedFile> file, Path path, std::optional<Encrypt::AESKey> encryptionKey = std::nullopt, std::optional<int> priority = {});
 		~PackResourceLocator();
 
 	protected:
 		std::unique_ptr<ResourceData> getData(const String& asset, AssetType type, bool stream) override;
 		const AssetDatabase& getAssetDatabase() override;
+		Vector<String> getAssetIds() override;
+		Vector<String> getDeletedAssetIds() override;
+		Vector<String> enumerate(AssetType type) override;
+		const Metadata* getMetadata(const String& asset, AssetType type) override;
 		void purgeAll(SystemAPI& system) override;
 		bool purgeIfAffected(SystemAPI& system, gsl::span<const String> assetIds, gsl::span<const String> packIds) override;
 		int getPriority() const override;
@@ -30,6 +36,7 @@ namespace Halley {
 		Path path;
 		bool wasEncrypted = false;
 		bool preLoad = false;
+		bool memoryMapped = false;
 		std::optional<int> priority;
 		SystemAPI* system = nullptr;
 	};
@@ -1,9 +1,101 @@
 #include "halley/support/profiler.h"
 
 #include "halley/utils/algorithm.h"
+#include "halley/utils/utils.h"
 
 using namespace Halley;
 
+namespace Halley {
+	class ProfilerThreadBuffer {
+	public:
+		// All fields are atomic so captures can read them while the owner thread is still writing; relaxed accesses
+		// compile down to plain loads and stores. seq is cleared while the record is being written, seqlock-style.
+		struct Record {
+			std::atomic<uint64_t> seq; // Sequence number + 1, 0 if empty or being written
+			std::atomic<int64_t> startTime;
+			std::atomic<int64_t> endTime;
+			std::atomic<uint32_t> nameId;
+			std::atomic<ProfilerEventType> type;
+		};
+
+		ProfilerThreadBuffer(size_t capacity, size_t index)
+			: index(index)
+			, mask(capacity - 1)
+			, records(std::make_unique<Record[]>(capacity))
+			, writePos(0)
+			, inUse(true)
+		{
+			for (size_t i = 0; i < capacity; ++i) {
+				records[i].seq.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		const size_t index;
+		const size_t mask;
+		std::unique_ptr<Record[]> records;
+		std::atomic<uint64_t> writePos;
+		std::atomic<bool> inUse;
+
+		// Buffers are reused once their thread exits, so keep track of which records belong to which thread
+		struct Owner {
+			uint64_t firstSeq;
+			std::thread::id threadId;
+			String threadName;
+		};
+		Vector<Owner> owners;
+	};
+}
+
+namespace {
+	struct ProfilerThreadState {
+		ProfilerCapture* owner = nullptr;
+		ProfilerThreadBuffer* buffer = nullptr;
+		HashMap<std::string_view, ProfilerCapture::NameId> nameCache; // Keys point to strings owned by the capture
+
+		~ProfilerThreadState()
+		{
+			if (buffer) {
+				buffer->inUse.store(false, std::memory_order_release);
+			}
+		}
+	};
+
+	thread_local ProfilerThreadState profilerThreadState;
+
+	constexpr uint64_t eventSeqBits = 48;
+	constexpr uint64_t eventSeqMask = (uint64_t(1) << eventSeqBits) - 1;
+
+	void appendJSONString(std::string& dst, std::string_view str)
+	{
+		dst += '"';
+		for (const char c: str) {
+			switch (c) {
+			case '"':
+				dst += "\\\"";
+				break;
+			case '\\':
+				dst += "\\\\";
+				break;
+			case '\n':
+				dst += "\\n";
+				break;
+			case '\t':
+				dst += "\\t";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					char buffer[8];
+					snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+					dst += buffer;
+				} else {
+					dst += c;
+				}
+			}
+		}
+		dst += '"';
+	}
+}
+
 
 bool ProfilerData::ThreadInfo::operator<(const ThreadInfo& other) const
 {
@@ -13,10 +105,12 @@ bool ProfilerData::ThreadInfo::operator<(const ThreadInfo& other) const
 	return totalTime > other.totalTime;
 }
 
-ProfilerData::ProfilerData(TimePoint frameStartTime, TimePoint frameEndTime, Vector<Event> events)
+ProfilerData::ProfilerData(TimePoint frameStartTime, TimePoint frameEndTime, Vector<Event> events, HashMap<std::thread::id, String> threadNames, Vector<TimePoint> frameStartTimes)
 	: frameStartTime(frameStartTime)
 	, frameEndTime(frameEndTime)
 	, events(std::move(events))
+	, threadNames(std::move(threadNames))
+	, frameStartTimes(std::move(frameStartTimes))
 {
 	processEvents();
 }
@@ -131,19 +225,92 @@ void ProfilerData::processEvents()
 
 	// Generate the thread list
 	for (const auto& [k, v]: threadInfo) {
-		const String name; // TODO
+		const auto iter = threadNames.find(k);
+		const String name = k == std::thread::id() ? String("GPU") : (iter != threadNames.end() ? iter->second : String());
 		threads.emplace_back(ThreadInfo{ k, static_cast<int>(v.maxDepth), name, v.start, v.end, v.totalTime, v.type });
 	}
 	std::sort(threads.begin(), threads.end());
 }
 
-ProfilerCapture::ProfilerCapture(size_t maxEvents)
-	: recording(false)
-	, curId(0)
+String ProfilerData::toChromeTrace() const
+{
+	// Chrome trace timestamps are in microseconds, relative to any origin
+	const auto toMicros = [&] (TimePoint t)
+	{
+		return std::chrono::duration<double, std::micro>(t - frameStartTime).count();
+	};
+
+	HashMap<std::thread::id, size_t> tids;
+	for (size_t i = 0; i < threads.size(); ++i) {
+		tids[threads[i].id] = i + 1;
+	}
+
+	std::string result;
+	result.reserve(128 * (events.size() + threads.size() + frameStartTimes.size()) + 64);
+	result += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	char buffer[128];
+
+	const auto startEntry = [&] ()
+	{
+		if (!first) {
+			result += ",\n";
+		}
+		first = false;
+	};
+
+	for (size_t i = 0; i < threads.size(); ++i) {
+		const auto& thread = threads[i];
+		const auto name = thread.name.isEmpty() ? "Thread " + toString(i + 1) : thread.name;
+
+		startEntry();
+		snprintf(buffer, sizeof(buffer), "{\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"name\":\"thread_name\",\"args\":{\"name\":", i + 1);
+		result += buffer;
+		appendJSONString(result, name.cppStr());
+		result += "}}";
+
+		startEntry();
+		snprintf(buffer, sizeof(buffer), "{\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%zu}}", i + 1, i + 1);
+		result += buffer;
+	}
+
+	for (const auto& frameStart: frameStartTimes) {
+		startEntry();
+		snprintf(buffer, sizeof(buffer), "{\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"name\":\"Frame\",\"ts\":%.3f}", toMicros(frameStart));
+		result += buffer;
+	}
+
+	for (const auto& e: events) {
+		const auto typeName = toString(e.type);
+
+		startEntry();
+		result += "{\"ph\":\"X\",\"pid\":1,\"name\":";
+		appendJSONString(result, e.name.isEmpty() ? typeName.cppStr() : e.name.cppStr());
+		result += ",\"cat\":";
+		appendJSONString(result, typeName.cppStr());
+		snprintf(buffer, sizeof(buffer), ",\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}", tids[e.threadId], toMicros(e.startTime), std::chrono::duration<double, std::micro>(e.endTime - e.startTime).count());
+		result += buffer;
+	}
+
+	result += "]}\n";
+	return String(std::move(result));
+}
+
+ProfilerCapture::ProfilerCapture(size_t maxEventsPerThread)
+	: bufferSize(nextPowerOf2(std::max(maxEventsPerThread, size_t(64))))
+	, recording(false)
 {
-	events.resize(maxEvents);
+	for (auto& buffer: buffers) {
+		buffer.store(nullptr);
+	}
+
+	// Name 0 is always the empty string
+	names.push_back(std::make_unique<String>());
+	nameIds[std::string_view(names.back()->c_str(), 0)] = 0;
 }
 
+ProfilerCapture::~ProfilerCapture() = default;
+
 ProfilerCapture& ProfilerCapture::get()
 {
 	// TODO: move to HalleyStatics?
@@ -153,37 +320,60 @@ ProfilerCapture& ProfilerCapture::get()
 
 ProfilerCapture::EventId ProfilerCapture::recordEventStart(ProfilerEventType type, std::string_view name)
 {
+	if (!recording.load(std::memory_order_relaxed)) {
+		return 0;
+	}
 	return recordEventStart(type, name, std::chrono::steady_clock::now());
 }
 
 void ProfilerCapture::recordEventEnd(EventId id)
 {
-	recordEventEnd(id, std::chrono::steady_clock::now());
+	if (id != 0) {
+		recordEventEnd(id, std::chrono::steady_clock::now());
+	}
 }
 
 ProfilerCapture::EventId ProfilerCapture::recordEventStart(ProfilerEventType type, std::string_view name, std::chrono::steady_clock::time_point time)
 {
-	if (recording) {
-		const auto id = curId++; // I think this is thread-safe?
-		if (id < endId) {
-			const auto pos = id % events.size();
-			const auto threadId = type == ProfilerEventType::GPU ? std::thread::id() : std::this_thread::get_id();
-			events[pos] = ProfilerData::Event{ name, threadId, type, 0, id, time, {} };
-			return id;
-		} else {
-			--curId;
-		}
+	if (!recording.load(std::memory_order_relaxed)) {
+		return 0;
+	}
+
+	auto* buffer = getThreadBuffer();
+	if (!buffer) {
+		return 0;
 	}
-	return 0;
+
+	const auto nameId = getNameId(name);
+	const uint64_t seq = buffer->writePos.load(std::memory_order_relaxed);
+	auto& record = buffer->records[seq & buffer->mask];
+	record.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	record.startTime.store(time.time_since_epoch().count(), std::memory_order_relaxed);
+	record.endTime.store(0, std::memory_order_relaxed);
+	record.nameId.store(nameId, std::memory_order_relaxed);
+	record.type.store(type, std::memory_order_relaxed);
+	record.seq.store(seq + 1, std::memory_order_release);
+	buffer->writePos.store(seq + 1, std::memory_order_release);
+
+	return (static_cast<uint64_t>(buffer->index) << eventSeqBits) | ((seq + 1) & eventSeqMask);
 }
 
 void ProfilerCapture::recordEventEnd(EventId id, std::chrono::steady_clock::time_point time)
 {
-	if (recording && id != 0) {
-		const auto pos = id % events.size();
-		if (events[pos].id == id) { // Dodgy, potential race condition here
-			events[pos].endTime = time;
-		}
+	if (id == 0) {
+		return;
+	}
+
+	auto* buffer = getBuffer(id);
+	if (!buffer) {
+		return;
+	}
+
+	const uint64_t seqPlusOne = id & eventSeqMask;
+	auto& record = buffer->records[(seqPlusOne - 1) & buffer->mask];
+	if ((record.seq.load(std::memory_order_relaxed) & eventSeqMask) == seqPlusOne) {
+		record.endTime.store(time.time_since_epoch().count(), std::memory_order_release);
 	}
 }
 
@@ -203,10 +393,7 @@ void ProfilerCapture::startFrame(bool rec)
 	}
 	frameEndTime = {};
 
-	startId = curId.fetch_add(events.size()) + events.size();
-	endId = startId + events.size();
-
-	recording = rec;
+	recording = rec || continuousFrames > 0;
 	state = State::FrameStarted;
 }
 
@@ -216,24 +403,20 @@ void ProfilerCapture::endFrame()
 	
 	frameEndTime = std::chrono::steady_clock::now();
 	state = State::FrameEnded;
+
+	if (continuousFrames > 0) {
+		if (frameHistory.size() >= continuousFrames) {
+			frameHistory.erase(frameHistory.begin(), frameHistory.begin() + (frameHistory.size() - continuousFrames + 1));
+		}
+		frameHistory.emplace_back(frameStartTime, frameEndTime);
+	}
 }
 
 ProfilerData ProfilerCapture::getCapture()
 {
 	Expects(state == State::FrameEnded);
 
-	const auto startIdx = startId % events.size();
-	const auto endIdx = curId % events.size();
-
-	Vector<ProfilerData::Event> eventsCopy;
-	if (startIdx < endIdx) {
-		eventsCopy.insert(eventsCopy.end(), events.begin() + startIdx, events.begin() + endIdx);
-	} else {
-		eventsCopy.insert(eventsCopy.end(), events.begin() + startIdx, events.end());
-		eventsCopy.insert(eventsCopy.end(), events.begin(), events.begin() + endIdx);
-	}
-	
-	return ProfilerData(frameStartTime, frameEndTime, std::move(eventsCopy));
+	return makeCapture(frameStartTime, frameEndTime, { frameStartTime });
 }
 
 Time ProfilerCapture::getFrameTime() const
@@ -243,6 +426,209 @@ Time ProfilerCapture::getFrameTime() const
 	return std::chrono::duration<Time>(frameEndTime - frameStartTime).count();
 }
 
+void ProfilerCapture::setContinuousCapture(size_t nFrames)
+{
+	continuousFrames = nFrames;
+	if (frameHistory.size() > nFrames) {
+		frameHistory.erase(frameHistory.begin(), frameHistory.begin() + (frameHistory.size() - nFrames));
+	}
+}
+
+size_t ProfilerCapture::getContinuousCaptureFrames() const
+{
+	return continuousFrames;
+}
+
+ProfilerData ProfilerCapture::getContinuousCapture()
+{
+	if (frameHistory.empty()) {
+		return {};
+	}
+
+	Vector<ProfilerData::TimePoint> frameStarts;
+	frameStarts.reserve(frameHistory.size());
+	for (const auto& frame: frameHistory) {
+		frameStarts.push_back(frame.first);
+	}
+	return makeCapture(frameHistory.front().first, frameHistory.back().second, std::move(frameStarts));
+}
+
+void ProfilerCapture::setThreadName(const String& name)
+{
+	// Always grab a buffer, even if not recording, so the name is known once it starts
+	if (auto* buffer = getThreadBuffer()) {
+		std::unique_lock<std::mutex> lock(buffersMutex);
+		buffer->owners.back().threadName = name;
+	}
+}
+
+ProfilerCapture::NameId ProfilerCapture::getNameId(std::string_view name)
+{
+	auto& state = profilerThreadState;
+	if (state.owner == this) {
+		const auto iter = state.nameCache.find(name);
+		if (iter != state.nameCache.end()) {
+			return iter->second;
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(namesMutex);
+	NameId id;
+	std::string_view key;
+	const auto iter = nameIds.find(name);
+	if (iter != nameIds.end()) {
+		key = iter->first;
+		id = iter->second;
+	} else {
+		id = static_cast<NameId>(names.size());
+		names.push_back(std::make_unique<String>(name));
+		key = std::string_view(names.back()->c_str(), names.back()->size());
+		nameIds[key] = id;
+	}
+	lock.unlock();
+
+	if (state.owner == this) {
+		state.nameCache[key] = id;
+	}
+	return id;
+}
+
+const String& ProfilerCapture::getName(NameId id) const
+{
+	std::unique_lock<std::mutex> lock(namesMutex);
+	return *names.at(id);
+}
+
+ProfilerThreadBuffer* ProfilerCapture::getThreadBuffer()
+{
+	auto& state = profilerThreadState;
+	if (state.owner == this) {
+		return state.buffer;
+	}
+	if (state.owner) {
+		// Another capture owns this thread's state, only ProfilerCapture::get() gets the fast path
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(buffersMutex);
+
+	ProfilerThreadBuffer* result = nullptr;
+	for (auto& buffer: ownedBuffers) {
+		if (!buffer->inUse.load(std::memory_order_acquire)) {
+			result = buffer.get();
+			result->inUse = true;
+			break;
+		}
+	}
+	if (!result && ownedBuffers.size() < maxThreads) {
+		ownedBuffers.push_back(std::make_unique<ProfilerThreadBuffer>(bufferSize, ownedBuffers.size()));
+		result = ownedBuffers.back().get();
+		buffers[result->index].store(result, std::memory_order_release);
+	}
+
+	if (result) {
+		// Drop owners whose records have all been overwritten
+		const uint64_t writePos = result->writePos.load(std::memory_order_relaxed);
+		const uint64_t oldestPos = writePos > bufferSize ? writePos - bufferSize : 0;
+		auto& owners = result->owners;
+		while (owners.size() >= 2 && owners[1].firstSeq <= oldestPos) {
+			owners.erase(owners.begin());
+		}
+		owners.push_back({ writePos, std::this_thread::get_id(), String() });
+	}
+	state.owner = this;
+	state.buffer = result;
+	return result;
+}
+
+ProfilerThreadBuffer* ProfilerCapture::getBuffer(EventId id) const
+{
+	const auto idx = static_cast<size_t>(id >> eventSeqBits);
+	auto& state = profilerThreadState;
+	if (state.owner == this && state.buffer && state.buffer->index == idx) {
+		return state.buffer;
+	}
+	return idx < maxThreads ? buffers[idx].load(std::memory_order_acquire) : nullptr;
+}
+
+ProfilerData ProfilerCapture::makeCapture(ProfilerData::TimePoint start, ProfilerData::TimePoint end, Vector<ProfilerData::TimePoint> frameStartTimes)
+{
+	using Duration = ProfilerData::TimePoint::duration;
+
+	// Events are mostly recorded in order, but GPU events are recorded late, so keep scanning back for a bit
+	const auto startTicks = start.time_since_epoch().count();
+	const auto endTicks = end.time_since_epoch().count();
+	const auto scanLimit = startTicks - std::chrono::duration_cast<Duration>(std::chrono::seconds(1)).count();
+
+	Vector<ProfilerData::Event> events;
+	HashMap<std::thread::id, String> threadNames;
+	Vector<NameId> eventNames;
+
+	std::unique_lock<std::mutex> lock(buffersMutex);
+	for (const auto& buffer: ownedBuffers) {
+		for (const auto& owner: buffer->owners) {
+			if (!owner.threadName.isEmpty()) {
+				threadNames[owner.threadId] = owner.threadName;
+			}
+		}
+
+		const uint64_t writePos = buffer->writePos.load(std::memory_order_acquire);
+		const uint64_t capacity = buffer->mask + 1;
+		const uint64_t firstPos = writePos > capacity ? writePos - capacity : 0;
+		const size_t firstEvent = events.size();
+		size_t ownerIdx = buffer->owners.size() - 1;
+
+		for (uint64_t pos = writePos; pos > firstPos; --pos) {
+			const uint64_t seq = pos - 1;
+			const auto& record = buffer->records[seq & buffer->mask];
+
+			const auto recordSeq = record.seq.load(std::memory_order_acquire);
+			const auto startTime = record.startTime.load(std::memory_order_relaxed);
+			const auto endTime = record.endTime.load(std::memory_order_acquire);
+			const auto nameId = record.nameId.load(std::memory_order_relaxed);
+			const auto type = record.type.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (recordSeq != seq + 1 || record.seq.load(std::memory_order_relaxed) != recordSeq) {
+				// Overwritten while we were reading it
+				continue;
+			}
+
+			if (startTime < scanLimit) {
+				break;
+			}
+			if (startTime < startTicks || startTime >= endTicks) {
+				continue;
+			}
+
+			while (ownerIdx > 0 && buffer->owners[ownerIdx].firstSeq > seq) {
+				--ownerIdx;
+			}
+			const auto threadId = type == ProfilerEventType::GPU ? std::thread::id() : buffer->owners[ownerIdx].threadId;
+			const auto id = (static_cast<uint64_t>(buffer->index) << eventSeqBits) | ((seq + 1) & eventSeqMask);
+			eventNames.push_back(nameId);
+			events.push_back(ProfilerData::Event{ {}, threadId, type, 0, id, ProfilerData::TimePoint(Duration(startTime)), endTime != 0 ? ProfilerData::TimePoint(Duration(endTime)) : ProfilerData::TimePoint() });
+		}
+
+		std::reverse(events.begin() + firstEvent, events.end());
+		std::reverse(eventNames.begin() + firstEvent, eventNames.end());
+	}
+	lock.unlock();
+
+	{
+		std::unique_lock<std::mutex> namesLock(namesMutex);
+		for (size_t i = 0; i < events.size(); ++i) {
+			events[i].name = *names[eventNames[i]];
+		}
+	}
+
+	std::stable_sort(events.begin(), events.end(), [] (const ProfilerData::Event& a, const ProfilerData::Event& b)
+	{
+		return a.startTime < b.startTime;
+	});
+
+	return ProfilerData(start, end, std::move(events), std::move(threadNames), std::move(frameStartTimes));
+}
+
 constexpr static bool isDevMode()
 {
 #ifdef DEV_BUILD
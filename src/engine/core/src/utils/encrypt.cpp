@@ -60,3 +60,40 @@ Bytes Encrypt::decryptAES(AESIV iv, AESKey key, const Bytes& data)
 
 	return result;
 }
+
+void Encrypt::xcryptAESCTR(AESKey key, uint64_t nonce, uint64_t offset, gsl::span<gsl::byte> data)
+{
+	if (data.empty()) {
+		return;
+	}
+
+	// Big endian, as that's how tiny-aes increments the counter
+	std::array<uint8_t, AES_BLOCKLEN> iv;
+	const uint64_t block = offset / AES_BLOCKLEN;
+	for (size_t i = 0; i < 8; ++i) {
+		iv[i] = static_cast<uint8_t>(nonce >> (56 - 8 * i));
+		iv[8 + i] = static_cast<uint8_t>(block >> (56 - 8 * i));
+	}
+
+	AES_ctx ctx;
+	AES_init_ctx_iv(&ctx, key.data(), iv.data());
+
+	// Starting in the middle of a block, so process that block on its own first
+	const size_t skip = offset % AES_BLOCKLEN;
+	if (skip != 0) {
+		std::array<uint8_t, AES_BLOCKLEN> partial = {};
+		const size_t n = std::min(AES_BLOCKLEN - skip, size_t(data.size()));
+		memcpy(partial.data() + skip, data.data(), n);
+		AES_CTR_xcrypt_buffer(&ctx, partial.data(), AES_BLOCKLEN);
+		memcpy(data.data(), partial.data() + skip, n);
+		data = data.subspan(n);
+	}
+
+	// tiny-aes takes 32-bit lengths
+	constexpr size_t maxLength = size_t(1) << 30;
+	while (!data.empty()) {
+		const size_t n = std::min(size_t(data.size()), maxLength);
+		AES_CTR_xcrypt_buffer(&ctx, reinterpret_cast<uint8_t*>(data.data()), uint32_t(n));
+		data = data.subspan(n);
+	}
+}
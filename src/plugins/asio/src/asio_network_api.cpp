@@ -4,12 +4,12 @@
 
 using namespace Halley;
 
-std::unique_ptr<NetworkService> AsioNetworkAPI::createService(NetworkProtocol protocol, int port)
+std::unique_ptr<NetworkService> AsioNetworkAPI::createService(NetworkProtocol protocol, int port, bool batchedIO)
 {
 	if (protocol == NetworkProtocol::TCP) {
 		return std::make_unique<AsioTCPNetworkService>(port);
 	} else if (protocol == NetworkProtocol::UDP) {
-		return std::make_unique<AsioUDPNetworkService>(port);
+		return std::make_unique<AsioUDPNetworkService>(port, IPVersion::IPv4, batchedIO);
 	} else {
 		return {};
 	}
@@ -62,5 +62,5 @@ Future<AuthTokenResult> AsioPlatformAPI::getAuthToken(const Halley::AuthTokenPar
 
 std::shared_ptr<NetworkService> AsioPlatformAPI::createNetworkService(uint16_t port)
 {
-    return AsioNetworkAPI().createService(NetworkProtocol::TCP, port);
+    return AsioNetworkAPI().createService(NetworkProtocol::TCP, port, false);
 }
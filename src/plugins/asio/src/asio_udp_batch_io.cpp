@@ -0,0 +1,162 @@
+#include "asio_udp_batch_io.h"
+#include <iostream>
+#include <halley/support/exception.h>
+#include <halley/utils/utils.h>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace Halley;
+
+bool UDPBatchIO::isSupported()
+{
+#if defined(__linux__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+UDPBatchIO::UDPBatchIO(UDPSocket& socket, UDPIOStats& stats, ErrorCallback onSendError, size_t batchSize)
+	: socket(socket)
+	, stats(stats)
+	, onSendError(std::move(onSendError))
+	, batchSize(clamp(batchSize, size_t(1), maxBatchSize))
+{
+	if (!isSupported()) {
+		throw Exception("Batched UDP I/O is not supported on this platform", HalleyExceptions::NetworkPlugin);
+	}
+
+	receiveBuffers.resize(this->batchSize * maxPacketSize);
+	receiveEndpoints.resize(this->batchSize);
+	sendBuffers.resize(this->batchSize * maxPacketSize);
+	sendEndpoints.resize(this->batchSize);
+	sendSizes.resize(this->batchSize);
+}
+
+#if defined(__linux__)
+
+void UDPBatchIO::receiveAll(const ReceiveCallback& callback)
+{
+	std::array<mmsghdr, maxBatchSize> headers;
+	std::array<iovec, maxBatchSize> iovecs;
+
+	while (true) {
+		for (size_t i = 0; i < batchSize; ++i) {
+			iovecs[i].iov_base = receiveBuffers.data() + i * maxPacketSize;
+			iovecs[i].iov_len = maxPacketSize;
+			headers[i] = {};
+			headers[i].msg_hdr.msg_name = receiveEndpoints[i].data();
+			headers[i].msg_hdr.msg_namelen = static_cast<socklen_t>(receiveEndpoints[i].capacity());
+			headers[i].msg_hdr.msg_iov = &iovecs[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		const int n = recvmmsg(socket.native_handle(), headers.data(), static_cast<unsigned int>(batchSize), MSG_DONTWAIT, nullptr);
+		++stats.receiveCalls;
+		if (n < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				std::cout << "Error receiving packets: " << std::strerror(errno) << std::endl;
+			}
+			return;
+		}
+
+		for (int i = 0; i < n; ++i) {
+			const auto& header = headers[i];
+			if (header.msg_hdr.msg_flags & MSG_TRUNC) {
+				// Larger than any packet we'd send, so it's not ours
+				continue;
+			}
+			auto& endpoint = receiveEndpoints[i];
+			endpoint.resize(header.msg_hdr.msg_namelen);
+			++stats.packetsReceived;
+
+			try {
+				callback(gsl::span<gsl::byte>(receiveBuffers.data() + i * maxPacketSize, header.msg_len), endpoint);
+			} catch (...) {
+				std::cout << "Exception while receiving a packet." << std::endl;
+			}
+		}
+
+		if (static_cast<size_t>(n) < batchSize) {
+			// Drained
+			return;
+		}
+	}
+}
+
+void UDPBatchIO::flush()
+{
+	std::array<mmsghdr, maxBatchSize> headers;
+	std::array<iovec, maxBatchSize> iovecs;
+
+	for (size_t i = 0; i < nQueued; ++i) {
+		iovecs[i].iov_base = sendBuffers.data() + i * maxPacketSize;
+		iovecs[i].iov_len = sendSizes[i];
+		headers[i] = {};
+		headers[i].msg_hdr.msg_name = sendEndpoints[i].data();
+		headers[i].msg_hdr.msg_namelen = static_cast<socklen_t>(sendEndpoints[i].size());
+		headers[i].msg_hdr.msg_iov = &iovecs[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	size_t sent = 0;
+	while (sent < nQueued) {
+		const int n = sendmmsg(socket.native_handle(), headers.data() + sent, static_cast<unsigned int>(nQueued - sent), 0);
+		++stats.sendCalls;
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+				// Send buffer is full: drop the rest, like the network would, and leave it to the reliability layer
+				stats.packetsDropped += nQueued - sent;
+				break;
+			}
+			// sendmmsg only fails outright if the very first message does, so report that one and carry on with the rest
+			if (onSendError) {
+				onSendError(sendEndpoints[sent], std::strerror(errno));
+			}
+			++sent;
+		} else {
+			sent += static_cast<size_t>(n);
+			stats.packetsSent += static_cast<size_t>(n);
+		}
+	}
+
+	nQueued = 0;
+}
+
+#else
+
+void UDPBatchIO::receiveAll(const ReceiveCallback& callback)
+{
+}
+
+void UDPBatchIO::flush()
+{
+	nQueued = 0;
+}
+
+#endif
+
+gsl::span<gsl::byte> UDPBatchIO::getSendBuffer()
+{
+	if (nQueued == batchSize) {
+		flush();
+	}
+	return gsl::span<gsl::byte>(sendBuffers.data() + nQueued * maxPacketSize, maxPacketSize);
+}
+
+void UDPBatchIO::queueSend(size_t size, const UDPEndpoint& remote)
+{
+	Expects(nQueued < batchSize);
+	Expects(size <= maxPacketSize);
+
+	sendSizes[nQueued] = size;
+	sendEndpoints[nQueued] = remote;
+	++nQueued;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "asio_udp_connection.h"
+#include "halley/data_structures/vector.h"
+#include <functional>
+
+namespace Halley
+{
+	struct UDPIOStats {
+		size_t packetsReceived = 0;
+		size_t packetsSent = 0;
+		size_t receiveCalls = 0;
+		size_t sendCalls = 0;
+		size_t packetsDropped = 0;
+	};
+
+	// Moves datagrams in and out of a non-blocking UDP socket up to maxBatchSize at a time (recvmmsg/sendmmsg), instead of one syscall each.
+	// Only available on Linux; check isSupported() before constructing one.
+	class UDPBatchIO
+	{
+	public:
+		constexpr static size_t maxBatchSize = 64;
+		constexpr static size_t maxPacketSize = 2048;
+
+		using ReceiveCallback = std::function<void(gsl::span<gsl::byte> data, const UDPEndpoint& remote)>;
+		using ErrorCallback = std::function<void(const UDPEndpoint& remote, const std::string& error)>;
+
+		static bool isSupported();
+
+		UDPBatchIO(UDPSocket& socket, UDPIOStats& stats, ErrorCallback onSendError, size_t batchSize = maxBatchSize);
+
+		// Keeps reading until the socket has nothing left
+		void receiveAll(const ReceiveCallback& callback);
+
+		// Write the packet to the returned buffer, then queue it. Sends whatever was queued before, if the batch is full.
+		gsl::span<gsl::byte> getSendBuffer();
+		void queueSend(size_t size, const UDPEndpoint& remote);
+		// Datagrams that don't fit in the socket's send buffer are dropped (and counted in packetsDropped) rather than treated as errors
+		void flush();
+
+	private:
+		UDPSocket& socket;
+		UDPIOStats& stats;
+		ErrorCallback onSendError;
+		size_t batchSize;
+
+		Vector<gsl::byte> receiveBuffers;
+		Vector<UDPEndpoint> receiveEndpoints;
+
+		Vector<gsl::byte> sendBuffers;
+		Vector<UDPEndpoint> sendEndpoints;
+		Vector<size_t> sendSizes;
+		size_t nQueued = 0;
+	};
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "asio_udp_connection.h"
+#include "asio_udp_batch_io.h"
 #include "halley/net/connection/network_packet.h"
 
 using namespace Halley;
@@ -20,9 +21,11 @@ struct HandshakeAccept
 
 
 
-AsioUDPConnection::AsioUDPConnection(UDPSocket& socket, UDPEndpoint remote)
+AsioUDPConnection::AsioUDPConnection(UDPSocket& socket, UDPEndpoint remote, UDPIOStats& stats, UDPBatchIO* batchIO)
 	: socket(socket)
 	, remote(remote)
+	, stats(stats)
+	, batchIO(batchIO)
 	, status(ConnectionStatus::Connecting)
 	, connectionId(0)
 {
@@ -54,7 +57,7 @@ void AsioUDPConnection::send(TransmissionType type, OutboundNetworkPacket packet
 		std::array<unsigned char, 2> id = { 0, 0 };
 		size_t len = 0;
 		if (connectionId >= 128) {
-			id[0] = (connectionId >> 8) & 0x7F;
+			id[0] = 0x80 | ((connectionId >> 8) & 0x7F);
 			id[1] = connectionId & 0xFF;
 			len = 2;
 		} else {
@@ -63,6 +66,13 @@ void AsioUDPConnection::send(TransmissionType type, OutboundNetworkPacket packet
 		}
 		packet.addHeader(gsl::as_bytes(gsl::span<unsigned char>(id).subspan(0, len)));
 
+		if (batchIO) {
+			// Goes out with everything else on the next flush
+			const size_t size = packet.copyTo(batchIO->getSendBuffer());
+			batchIO->queueSend(size, remote);
+			return;
+		}
+
 		bool needsSend = pendingSend.empty();
 		pendingSend.emplace_back(std::move(packet));
 		if (needsSend) {
@@ -140,6 +150,8 @@ void AsioUDPConnection::sendNext()
 	auto& packet = pendingSend.front();
 	size_t size = packet.copyTo(sendBuffer);
 	pendingSend.pop_front();
+	++stats.sendCalls;
+	++stats.packetsSent;
 
 	socket.async_send_to(boost::asio::buffer(sendBuffer, size), remote, [this] (const boost::system::error_code& error, std::size_t)
 	{
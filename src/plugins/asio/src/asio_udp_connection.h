@@ -18,13 +18,15 @@
 namespace Halley
 {
 	class NetworkService;
+	class UDPBatchIO;
+	struct UDPIOStats;
 	using UDPEndpoint = boost::asio::ip::udp::endpoint;
 	using UDPSocket = boost::asio::ip::udp::socket;
 
 	class AsioUDPConnection : public IConnection
 	{
 	public:
-		AsioUDPConnection(UDPSocket& socket, UDPEndpoint remote);
+		AsioUDPConnection(UDPSocket& socket, UDPEndpoint remote, UDPIOStats& stats, UDPBatchIO* batchIO = nullptr);
 
 		void close() override;
 		ConnectionStatus getStatus() const override { return status; }
@@ -44,6 +46,8 @@ namespace Halley
 	private:
 		UDPSocket& socket;
 		UDPEndpoint remote;
+		UDPIOStats& stats;
+		UDPBatchIO* batchIO;
 		ConnectionStatus status;
 		short connectionId;
 
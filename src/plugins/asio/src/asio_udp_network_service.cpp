@@ -23,12 +23,20 @@ struct HandshakeOpen
 
 
 
-AsioUDPNetworkService::AsioUDPNetworkService(int port, IPVersion version)
+AsioUDPNetworkService::AsioUDPNetworkService(int port, IPVersion version, bool batchedIO)
 	: localEndpoint(version == IPVersion::IPv4 ? asio::ip::udp::v4() : asio::ip::udp::v6(), static_cast<unsigned short>(port))
 	, socket(service, localEndpoint)
 {
 	Expects(port == 0 || port > 1024);
 	Expects(port < 65536);
+
+	if (batchedIO && UDPBatchIO::isSupported()) {
+		socket.non_blocking(true);
+		batchIO = std::make_unique<UDPBatchIO>(socket, ioStats, [this] (const UDPEndpoint& remote, const std::string& error)
+		{
+			onSendError(remote, error);
+		});
+	}
 }
 
 
@@ -43,7 +51,11 @@ AsioUDPNetworkService::~AsioUDPNetworkService()
 	}
 	try {
 		service.poll();
-		socket.shutdown(UDPSocket::shutdown_both);
+		if (batchIO) {
+			batchIO->flush();
+		}
+		boost::system::error_code error;
+		socket.shutdown(UDPSocket::shutdown_both, error); // Fails with "not connected" on a socket that was only used with send_to, which is fine
 	} catch (...) {
 		std::cout << "Error polling service on ~NetworkService()" << std::endl;
 	}
@@ -67,8 +79,30 @@ void AsioUDPNetworkService::update(Time t)
 		active.erase(i);
 	}
 
+	if (batchIO && startedListening) {
+		batchIO->receiveAll([this] (gsl::span<gsl::byte> data, const UDPEndpoint& remote)
+		{
+			receivePacket(data, remote, nullptr);
+		});
+	}
+
 	// Update service
 	service.poll();
+
+	// Send everything the connections queued since the last update
+	if (batchIO) {
+		batchIO->flush();
+	}
+}
+
+bool AsioUDPNetworkService::isUsingBatchedIO() const
+{
+	return !!batchIO;
+}
+
+const UDPIOStats& AsioUDPNetworkService::getIOStats() const
+{
+	return ioStats;
 }
 
 std::shared_ptr<IConnection> AsioUDPNetworkService::connect(const String& address)
@@ -81,7 +115,7 @@ std::shared_ptr<IConnection> AsioUDPNetworkService::connect(const String& addres
 	assert(port < 65536);
 	auto remoteAddr = asio::ip::address::from_string(addr.cppStr());
 	auto remote = UDPEndpoint(remoteAddr, static_cast<unsigned short>(port)); 
-	auto conn = std::make_shared<AsioUDPConnection>(socket, remote);
+	auto conn = std::make_shared<AsioUDPConnection>(socket, remote, ioStats, batchIO.get());
 	activeConnections[0] = conn;
 
 	// Handshake
@@ -98,7 +132,9 @@ String AsioUDPNetworkService::startListening(AcceptCallback callback)
 	acceptCallback = std::move(callback);
 	if (!startedListening) {
 		startedListening = true;
-		receiveNext();
+		if (!batchIO) {
+			receiveNext();
+		}
 	}
 	return "";
 }
@@ -123,7 +159,9 @@ void AsioUDPNetworkService::receiveNext()
 				errorMsgPtr = &errorMsg;
 			}
 
-			receivePacket(gsl::span<gsl::byte>(receiveBuffer.data(), size), errorMsgPtr);
+			++ioStats.receiveCalls;
+			++ioStats.packetsReceived;
+			receivePacket(gsl::span<gsl::byte>(receiveBuffer.data(), size), remoteEndpoint, errorMsgPtr);
 		} catch (...) {
 			std::cout << "Exception while receiving a packet." << std::endl;
 		}
@@ -132,13 +170,13 @@ void AsioUDPNetworkService::receiveNext()
 	});
 }
 
-void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, std::string* error)
+void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, const UDPEndpoint& from, std::string* error)
 {
 	if (error) {
 		std::cout << "Error receiving packet: " << (*error) << std::endl;
 		// Find the owner of this remote endpoint
 		for (auto& conn : activeConnections) {
-			if (conn.second->matchesEndpoint(remoteEndpoint)) {
+			if (conn.second->matchesEndpoint(from)) {
 				conn.second->setError(*error);
 				conn.second->close();
 			}
@@ -163,7 +201,7 @@ void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, std::st
 		}
 		dst[1] = received[1];
 		received = received.subspan(2);
-		id = short(bytes[0] & 0x7F) | short(bytes[1]);
+		id = short((bytes[0] & 0x7F) << 8) | short(bytes[1]);
 	} else {
 		received = received.subspan(1);
 		id = short(bytes[0]);
@@ -171,7 +209,7 @@ void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, std::st
 
 	// No connection id, check if it's a connection request
 	if (id == 0 && isValidConnectionRequest(received)) {
-		auto a = UDPAcceptor(*this, remoteEndpoint);
+		auto a = UDPAcceptor(*this, from);
 		if (acceptCallback) {
 			acceptCallback(a);
 		}
@@ -191,7 +229,7 @@ void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, std::st
 	}
 
 	// Validate that this connection is who it claims to be
-	if (conn->second->matchesEndpoint(remoteEndpoint)) {
+	if (conn->second->matchesEndpoint(from)) {
 		auto connection = conn->second;
 
 		if (error) {
@@ -221,6 +259,17 @@ void AsioUDPNetworkService::receivePacket(gsl::span<gsl::byte> received, std::st
 	}
 }
 
+void AsioUDPNetworkService::onSendError(const UDPEndpoint& remote, const std::string& error)
+{
+	std::cout << "Error sending packet: " << error << std::endl;
+	for (auto& conn : activeConnections) {
+		if (conn.second->matchesEndpoint(remote)) {
+			conn.second->setError(error);
+			conn.second->close();
+		}
+	}
+}
+
 bool AsioUDPNetworkService::isValidConnectionRequest(gsl::span<const gsl::byte> data)
 {
 	HandshakeOpen open;
@@ -239,7 +288,7 @@ short AsioUDPNetworkService::getFreeId() const
 
 std::shared_ptr<AsioUDPConnection> AsioUDPNetworkService::acceptConnection(UDPEndpoint endPoint)
 {
-	auto conn = std::make_shared<AsioUDPConnection>(socket, endPoint);
+	auto conn = std::make_shared<AsioUDPConnection>(socket, endPoint, ioStats, batchIO.get());
 	short id = getFreeId();
 	conn->open(id);
 
@@ -12,13 +12,16 @@
 namespace asio = boost::asio;
 
 #include "asio_udp_connection.h"
+#include "asio_udp_batch_io.h"
 
 namespace Halley
 {
 	class AsioUDPNetworkService : public NetworkServiceWithStats
 	{
 	public:
-		AsioUDPNetworkService(int port, IPVersion version = IPVersion::IPv4);
+		// With batchedIO, and where it's supported, packets are read and written in batches during update() instead of one syscall each.
+		// This adds up to one update of latency to every packet, so it's meant for servers with many peers, which should opt in.
+		AsioUDPNetworkService(int port, IPVersion version = IPVersion::IPv4, bool batchedIO = false);
 		~AsioUDPNetworkService();
 
 		void update(Time t) override;
@@ -27,6 +30,9 @@ namespace Halley
 		void stopListening() override;
 		std::shared_ptr<IConnection> connect(const String& address) override;
 
+		bool isUsingBatchedIO() const;
+		const UDPIOStats& getIOStats() const;
+
 	private:
 		class UDPAcceptor : public Acceptor {
 		public:
@@ -49,9 +55,12 @@ namespace Halley
 		HashMap<short, std::shared_ptr<AsioUDPConnection>> activeConnections;
 
 		std::array<gsl::byte, 2048> receiveBuffer;
+		UDPIOStats ioStats;
+		std::unique_ptr<UDPBatchIO> batchIO;
 
 		void receiveNext();
-		void receivePacket(gsl::span<gsl::byte> data, std::string* error);
+		void receivePacket(gsl::span<gsl::byte> data, const UDPEndpoint& remote, std::string* error);
+		void onSendError(const UDPEndpoint& remote, const std::string& error);
 		bool isValidConnectionRequest(gsl::span<const gsl::byte> data);
 		short getFreeId() const;
 
@@ -0,0 +1,351 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include "halley/resources/asset_pack.h"
+#include "halley/resources/asset_database.h"
+#include "halley/resources/asset_pack_index.h"
+#include "halley/resources/asset_pack_writer.h"
+#include "halley/file/memory_mapped_file.h"
+using namespace Halley;
+
+namespace {
+	struct TestAsset {
+		String name;
+		Bytes data;
+		Metadata meta;
+	};
+
+	Vector<TestAsset> makeTestAssets()
+	{
+		Vector<TestAsset> result;
+		for (size_t i = 0; i < 8; ++i) {
+			Bytes data(1 + i * 1000 + (i % 3) * 4096);
+			for (size_t j = 0; j < data.size(); ++j) {
+				data[j] = static_cast<Byte>((i * 31 + j * 7) & 0xFF);
+			}
+			Metadata meta;
+			if (i % 2 == 1) {
+				meta.set("index", int(i));
+			}
+			result.push_back(TestAsset{ "asset" + toString(i), std::move(data), std::move(meta) });
+		}
+		return result;
+	}
+
+	Path writePack(const String& name, const Bytes& bytes)
+	{
+		const auto path = std::filesystem::temp_directory_path() / (name + ".dat").cppStr();
+		std::ofstream file(path, std::ios::binary);
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return Path(path.string());
+	}
+
+	Path writeTestPack(const String& name, const Vector<TestAsset>& assets, std::optional<Encrypt::AESKey> key = {}, bool compress = false)
+	{
+		AssetPackBuilder builder(key);
+		for (const auto& asset: assets) {
+			builder.addAsset(asset.name, AssetType::BinaryFile, asset.data.byte_span(), asset.meta, compress);
+		}
+		return writePack(name, builder.writeOut());
+	}
+
+	std::array<uint8_t, 16> makeKey()
+	{
+		std::array<uint8_t, 16> keyBytes;
+		for (size_t i = 0; i < keyBytes.size(); ++i) {
+			keyBytes[i] = static_cast<uint8_t>(i * 13 + 5);
+		}
+		return keyBytes;
+	}
+
+	bool equals(gsl::span<const gsl::byte> a, const Bytes& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), b.size()) == 0;
+	}
+
+	void checkAssets(AssetPack& pack, const Vector<TestAsset>& assets, bool checkMetadata = true)
+	{
+		for (const auto& asset: assets) {
+			if (checkMetadata) {
+				const auto* meta = pack.getMetadata(asset.name, AssetType::BinaryFile);
+				ASSERT_NE(meta, nullptr);
+				EXPECT_EQ(*meta, asset.meta) << asset.name;
+			}
+
+			auto staticData = pack.getData(asset.name, AssetType::BinaryFile, false);
+			ASSERT_NE(staticData, nullptr);
+			const auto span = dynamic_cast<ResourceDataStatic&>(*staticData).getSpan();
+			EXPECT_TRUE(equals(span, asset.data)) << asset.name;
+
+			auto streamData = pack.getData(asset.name, AssetType::BinaryFile, true);
+			ASSERT_NE(streamData, nullptr);
+			auto reader = dynamic_cast<ResourceDataStream&>(*streamData).getReader();
+			reader->seek(1, SEEK_SET);
+			const auto streamed = reader->readAll();
+			EXPECT_TRUE(std::equal(streamed.begin(), streamed.end(), asset.data.begin() + 1, asset.data.end())) << asset.name;
+		}
+
+		EXPECT_EQ(pack.getData("missing", AssetType::BinaryFile, false), nullptr);
+		EXPECT_EQ(pack.getMetadata("missing", AssetType::BinaryFile), nullptr);
+	}
+}
+
+TEST(HalleyAssetPack, MemoryMapped)
+{
+	if (!MemoryMappedFile::isSupported()) {
+		GTEST_SKIP();
+	}
+
+	const auto assets = makeTestAssets();
+	const auto path = writeTestPack("halley_asset_pack_test", assets);
+
+	auto file = std::make_shared<MemoryMappedFile>(path);
+	ASSERT_TRUE(file->isOpen());
+	auto pack = std::make_unique<AssetPack>(file, std::nullopt);
+	EXPECT_TRUE(pack->isMemoryMapped());
+	checkAssets(*pack, assets);
+
+	// Static data keeps the mapping alive after the pack is gone
+	auto staticData = pack->getData(assets[1].name, AssetType::BinaryFile, false);
+	pack.reset();
+	file.reset();
+	const auto span = dynamic_cast<ResourceDataStatic&>(*staticData).getSpan();
+	EXPECT_TRUE(equals(span, assets[1].data));
+
+	// Same contents when read through a reader
+	auto readPack = AssetPack(std::make_unique<ResourceDataReaderFileSystem>(path), std::nullopt);
+	EXPECT_FALSE(readPack.isMemoryMapped());
+	checkAssets(readPack, assets);
+
+	std::filesystem::remove(path.string());
+}
+
+TEST(HalleyAssetPack, MemoryMappedEncrypted)
+{
+	if (!MemoryMappedFile::isSupported()) {
+		GTEST_SKIP();
+	}
+
+	const auto keyBytes = makeKey();
+	const auto key = Encrypt::AESKey(keyBytes);
+	const auto assets = makeTestAssets();
+
+	for (const bool compress: { false, true }) {
+		const auto path = writeTestPack("halley_asset_pack_encrypted_test", assets, key, compress);
+
+		// Entries are decrypted (and decompressed) as they're read, so the pack stays mapped
+		auto pack = AssetPack(std::make_shared<MemoryMappedFile>(path), key);
+		EXPECT_TRUE(pack.isMemoryMapped());
+		checkAssets(pack, assets);
+
+		auto readPack = AssetPack(std::make_unique<ResourceDataReaderFileSystem>(path), key);
+		checkAssets(readPack, assets);
+
+		std::filesystem::remove(path.string());
+	}
+}
+
+TEST(HalleyAssetPack, CompressedStreamSeek)
+{
+	// Large and compressible enough to span several chunks
+	Bytes data(AssetPack::lz4ChunkSize * 3 + 1234);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<Byte>((i / 100) & 0xFF);
+	}
+
+	const auto keyBytes = makeKey();
+	AssetPackBuilder builder{ Encrypt::AESKey(keyBytes) };
+	builder.addAsset("big", AssetType::BinaryFile, data.byte_span(), Metadata());
+	EXPECT_TRUE(builder.getAssetDatabase().getDatabase(AssetType::BinaryFile).get("big").packLocation.hasFlag(AssetDatabase::PackLocation::LZ4Compressed));
+	EXPECT_LT(builder.getDataSize(), data.size());
+
+	const auto path = writePack("halley_asset_pack_seek_test", builder.writeOut());
+	auto pack = AssetPack(std::make_unique<ResourceDataReaderFileSystem>(path), Encrypt::AESKey(keyBytes));
+	auto stream = pack.getData("big", AssetType::BinaryFile, true);
+	auto reader = dynamic_cast<ResourceDataStream&>(*stream).getReader();
+	for (const size_t pos: { AssetPack::lz4ChunkSize * 2 + 7, size_t(3), AssetPack::lz4ChunkSize - 5 }) {
+		reader->seek(int64_t(pos), SEEK_SET);
+		Bytes read(20000);
+		const auto n = reader->read(read.byte_span());
+		ASSERT_EQ(n, 20000);
+		EXPECT_EQ(0, memcmp(read.data(), data.data() + pos, read.size())) << pos;
+	}
+
+	std::filesystem::remove(path.string());
+}
+
+TEST(HalleyAssetPack, Format1)
+{
+	const auto assets = makeTestAssets();
+
+	// The old format stores "pos:size" in the entry path, and is encrypted as a whole
+	AssetDatabase db;
+	Bytes data;
+	for (const auto& asset: assets) {
+		const size_t pos = data.size();
+		data.insert(data.end(), asset.data.begin(), asset.data.end());
+		db.addAsset(asset.name, AssetType::BinaryFile, AssetDatabase::Entry(toString(pos) + ":" + toString(asset.data.size()), Metadata()));
+	}
+	const auto dbBytes = Compression::compress(Serializer::toBytes(db));
+	AssetPackHeader header;
+	header.init(dbBytes.size(), 1);
+
+	Bytes bytes(sizeof(header));
+	memcpy(bytes.data(), &header, sizeof(header));
+	bytes.insert(bytes.end(), dbBytes.begin(), dbBytes.end());
+	bytes.insert(bytes.end(), data.begin(), data.end());
+
+	const auto path = writePack("halley_asset_pack_v1_test", bytes);
+	auto pack = AssetPack(std::make_unique<ResourceDataReaderFileSystem>(path), std::nullopt);
+	EXPECT_EQ(pack.getVersion(), 1);
+	checkAssets(pack, assets, false);
+
+	// Looking up a type the pack doesn't have must not modify it, as lookups can happen concurrently
+	EXPECT_EQ(pack.getData("asset0", AssetType::Sprite, false), nullptr);
+	EXPECT_EQ(pack.getMetadata("asset0", AssetType::Sprite), nullptr);
+	EXPECT_FALSE(pack.getAssetDatabase().hasDatabase(AssetType::Sprite));
+
+	std::filesystem::remove(path.string());
+}
+
+TEST(HalleyAssetPack, Index)
+{
+	AssetDatabase db;
+	for (int i = 0; i < 1000; ++i) {
+		AssetDatabase::Entry entry("", Metadata());
+		entry.packLocation.offset = uint64_t(i) * 100;
+		entry.packLocation.size = entry.packLocation.storedSize = uint64_t(i) + 1;
+		if (i % 10 == 0) {
+			entry.meta.set("value", i);
+		}
+		db.addAsset("sprite" + toString(i), AssetType::Sprite, AssetDatabase::Entry(entry));
+		db.addAsset("sprite" + toString(i), i % 2 == 0 ? AssetType::Texture : AssetType::Animation, std::move(entry));
+	}
+	const auto bytes = AssetPackIndex::build(db);
+	const auto index = AssetPackIndex(bytes.byte_span());
+
+	EXPECT_EQ(index.getEntryCount(), 2000);
+	EXPECT_EQ(index.getTypes().size(), 3);
+	EXPECT_EQ(index.getEntries(AssetType::Texture).size(), 500);
+	EXPECT_TRUE(index.getEntries(AssetType::Shader).empty());
+
+	for (int i = 0; i < 1000; ++i) {
+		const auto name = "sprite" + toString(i);
+		const auto* entry = index.tryGet(AssetType::Sprite, name);
+		ASSERT_NE(entry, nullptr);
+		EXPECT_EQ(index.getName(*entry), std::string_view(name));
+		EXPECT_EQ(entry->offset, uint64_t(i) * 100);
+		EXPECT_EQ(entry->size, uint64_t(i) + 1);
+		EXPECT_EQ(index.getMetadata(*entry).getInt("value", -1), i % 10 == 0 ? i : -1);
+
+		EXPECT_EQ(index.tryGet(AssetType::Texture, name) != nullptr, i % 2 == 0);
+		EXPECT_EQ(index.tryGet(AssetType::Animation, name) != nullptr, i % 2 == 1);
+	}
+	EXPECT_EQ(index.tryGet(AssetType::Sprite, "sprite1000"), nullptr);
+	EXPECT_EQ(index.tryGet(AssetType::Shader, "sprite0"), nullptr);
+
+	// Same contents when fully deserialized
+	const auto roundTrip = index.makeDatabase();
+	EXPECT_EQ(roundTrip->getAssets().size(), db.getAssets().size());
+	EXPECT_EQ(roundTrip->getDatabase(AssetType::Sprite).get("sprite20").meta, db.getDatabase(AssetType::Sprite).get("sprite20").meta);
+}
+
+TEST(HalleyAssetPack, ConcurrentAssetDatabase)
+{
+	const auto assets = makeTestAssets();
+	const auto path = writeTestPack("halley_asset_pack_db_test", assets);
+	const auto pack = AssetPack(std::make_unique<ResourceDataReaderFileSystem>(path), std::nullopt);
+
+	// Built from the index on first use, which any number of threads can race to do
+	Vector<const AssetDatabase*> dbs(8);
+	Vector<std::thread> threads;
+	for (size_t i = 0; i < dbs.size(); ++i) {
+		threads.emplace_back([&, i] ()
+		{
+			dbs[i] = &pack.getAssetDatabase();
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+
+	for (const auto* db: dbs) {
+		EXPECT_EQ(db, dbs[0]);
+	}
+	EXPECT_EQ(dbs[0]->getDatabase(AssetType::BinaryFile).getAssets().size(), assets.size());
+
+	std::filesystem::remove(path.string());
+}
+
+TEST(HalleyAssetPack, Writer)
+{
+	const auto assets = makeTestAssets();
+	const auto keyBytes = makeKey();
+	const auto path = Path((std::filesystem::temp_directory_path() / "halley_asset_pack_writer_test.dat").string());
+
+	AssetPackWriter writer(path, Encrypt::AESKey(keyBytes));
+	for (const auto& asset: assets) {
+		writer.declare(asset.name, AssetType::BinaryFile, asset.meta);
+		writer.declare(asset.name + "_copy", AssetType::BinaryFile, asset.meta);
+	}
+	writer.declare("never_written", AssetType::BinaryFile, Metadata());
+	writer.begin();
+	for (const auto& asset: assets) {
+		writer.write(asset.name, AssetType::BinaryFile, writer.encode(asset.data.byte_span()));
+	}
+	for (const auto& asset: assets) {
+		writer.write(asset.name + "_copy", AssetType::BinaryFile, writer.encode(asset.data.byte_span()));
+	}
+	writer.finish();
+	EXPECT_EQ(writer.getDeduplicatedCount(), assets.size());
+
+	auto copies = assets;
+	for (auto& copy: copies) {
+		copy.name += "_copy";
+	}
+
+	auto pack = AssetPack(std::make_unique<ResourceDataReaderFileSystem>(path), Encrypt::AESKey(keyBytes));
+	checkAssets(pack, assets);
+	checkAssets(pack, copies);
+	EXPECT_EQ(pack.getData("never_written", AssetType::BinaryFile, false), nullptr);
+
+	// Copies share the data, and large entries are aligned
+	for (const auto& asset: assets) {
+		const auto* entry = pack.getAssetDatabase().getDatabase(AssetType::BinaryFile).tryGet(asset.name);
+		const auto* copy = pack.getAssetDatabase().getDatabase(AssetType::BinaryFile).tryGet(asset.name + "_copy");
+		ASSERT_NE(entry, nullptr);
+		ASSERT_NE(copy, nullptr);
+		EXPECT_EQ(entry->packLocation.offset, copy->packLocation.offset);
+		if (entry->packLocation.storedSize >= AssetPackWriter::defaultAlignment) {
+			EXPECT_EQ(entry->packLocation.offset % AssetPackWriter::defaultAlignment, 0);
+		}
+	}
+
+	std::filesystem::remove(path.string());
+}
+
+TEST(HalleyAssetPack, Tombstones)
+{
+	const auto assets = makeTestAssets();
+	const auto path = Path((std::filesystem::temp_directory_path() / "halley_asset_pack_tombstone_test.dat").string());
+
+	AssetPackWriter writer(path, std::nullopt);
+	writer.declare(assets[0].name, AssetType::BinaryFile, assets[0].meta);
+	writer.declare("deleted", AssetType::BinaryFile, Metadata());
+	writer.begin();
+	writer.writeTombstone("deleted", AssetType::BinaryFile);
+	writer.write(assets[0].name, AssetType::BinaryFile, writer.encode(assets[0].data.byte_span()));
+	writer.finish();
+
+	auto pack = AssetPack(std::make_unique<ResourceDataReaderFileSystem>(path), std::nullopt);
+	checkAssets(pack, { assets[0] });
+	EXPECT_EQ(pack.getAssetIds(), Vector<String>{ "binaryFile:" + assets[0].name });
+	EXPECT_EQ(pack.getDeletedAssetIds(), Vector<String>{ "binaryFile:deleted" });
+	EXPECT_EQ(pack.enumerate(AssetType::BinaryFile), Vector<String>{ assets[0].name });
+	EXPECT_EQ(pack.getData("deleted", AssetType::BinaryFile, false), nullptr);
+	EXPECT_EQ(pack.getMetadata("deleted", AssetType::BinaryFile), nullptr);
+
+	std::filesystem::remove(path.string());
+}
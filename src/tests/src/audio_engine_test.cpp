@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <halley.hpp>
+#include "halley/properties/audio_properties.h"
+#include "audio/audio_engine.h"
+#include "audio/audio_mixer.h"
+#include "audio/audio_offline_renderer.h"
+#include "audio/audio_voice.h"
+using namespace Halley;
+
+namespace {
+	class ToneClip final : public IAudioClip {
+	public:
+		explicit ToneClip(size_t length)
+		{
+			samples.resize(length);
+			for (size_t i = 0; i < length; ++i) {
+				samples[i] = std::sin(static_cast<float>(i) * 0.05f) * 0.2f;
+			}
+		}
+
+		size_t copyChannelData(size_t channelN, size_t pos, size_t len, float gain0, float gain1, AudioSamples dst) const override
+		{
+			AudioMixer::copy(dst, AudioSamples(samples).subspan(pos, len), gain0, gain1);
+			return len;
+		}
+
+		uint8_t getNumberOfChannels() const override { return 1; }
+		size_t getLength() const override { return samples.size(); }
+
+	private:
+		mutable Vector<AudioSample> samples;
+	};
+
+	// Pretends to be a streamed clip, and records whether two threads ever read from it at once
+	class SharedToneClip final : public IAudioClip {
+	public:
+		explicit SharedToneClip(std::atomic<bool>& overlapped)
+			: tone(4800)
+			, overlapped(overlapped)
+		{}
+
+		size_t copyChannelData(size_t channelN, size_t pos, size_t len, float gain0, float gain1, AudioSamples dst) const override
+		{
+			if (reading.exchange(true)) {
+				overlapped = true;
+			}
+			std::this_thread::yield();
+			const auto result = tone.copyChannelData(channelN, pos, len, gain0, gain1, dst);
+			reading = false;
+			return result;
+		}
+
+		uint8_t getNumberOfChannels() const override { return 1; }
+		size_t getLength() const override { return tone.getLength(); }
+		bool hasSharedPlaybackState() const override { return true; }
+
+	private:
+		ToneClip tone;
+		std::atomic<bool>& overlapped;
+		mutable std::atomic<bool> reading = false;
+	};
+
+	AudioProperties makeAudioProperties(int maxVoices, int busMaxVoices = 0)
+	{
+		ConfigNode::MapType bus;
+		bus["id"] = "master";
+		bus["maxVoices"] = busMaxVoices;
+		ConfigNode::MapType props;
+		props["buses"] = ConfigNode::SequenceType{ ConfigNode(std::move(bus)) };
+		props["maxVoices"] = maxVoices;
+		return AudioProperties(ConfigNode(std::move(props)));
+	}
+
+	// Plays one looping tone per gain, with event ids starting at 1
+	AudioRenderScript makeScript(gsl::span<const float> gains)
+	{
+		AudioRenderScript script;
+		script.setListener(0, AudioListenerData(Vector3f()));
+		const auto clip = std::make_shared<ToneClip>(4800);
+		for (size_t i = 0; i < gains.size(); ++i) {
+			script.play(0, static_cast<AudioEventId>(i + 1), clip, 0, gains[i], true);
+		}
+		return script;
+	}
+
+	Vector<AudioEventId> getRealVoices(AudioEngine& engine)
+	{
+		Vector<AudioEventId> result;
+		engine.forVoicesOnBus(engine.getBusId("master"), [&] (AudioVoice& voice)
+		{
+			if (voice.isPlaying() && !voice.isVirtual()) {
+				result.push_back(voice.getEventId());
+			}
+		});
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+}
+
+TEST(HalleyAudioEngine, VoiceBudgetKeepsLoudestVoicesReal)
+{
+	const auto properties = makeAudioProperties(3);
+	AudioOfflineRenderer renderer(properties);
+
+	const std::array<float, 8> gains = { 0.1f, 0.8f, 0.2f, 0.7f, 0.3f, 0.6f, 0.4f, 0.5f };
+	const auto stats = renderer.render(makeScript(gains), 0.1);
+
+	EXPECT_EQ(stats.peakVoices, 8u);
+	EXPECT_EQ(stats.peakRealVoices, 3u);
+	const auto counts = renderer.getEngine().getVoiceCounts();
+	EXPECT_EQ(counts.playing, 8u);
+	EXPECT_EQ(counts.virtualised, 5u);
+	EXPECT_EQ(getRealVoices(renderer.getEngine()), (Vector<AudioEventId>{ 2, 4, 6 }));
+}
+
+TEST(HalleyAudioEngine, BusVoiceBudget)
+{
+	const auto properties = makeAudioProperties(0, 2);
+	AudioOfflineRenderer renderer(properties);
+
+	const std::array<float, 5> gains = { 0.5f, 0.5f, 0.9f, 0.5f, 0.8f };
+	renderer.render(makeScript(gains), 0.1);
+
+	const auto counts = renderer.getEngine().getVoiceCounts();
+	EXPECT_EQ(counts.playing, 5u);
+	EXPECT_EQ(counts.virtualised, 3u);
+	EXPECT_EQ(getRealVoices(renderer.getEngine()), (Vector<AudioEventId>{ 3, 5 }));
+}
+
+TEST(HalleyAudioEngine, InaudibleVoicesAreVirtual)
+{
+	const auto properties = makeAudioProperties(0);
+	AudioOfflineRenderer renderer(properties);
+	const auto attenuation = AudioAttenuation(50.0f, 500.0f);
+
+	AudioRenderScript script;
+	script.setListener(0, AudioListenerData(Vector3f()));
+	script.createEmitter(0, 1, AudioPosition::makePositional(Vector2f(10000.0f, 0.0f), attenuation));
+	script.play(0, 1, std::make_shared<ToneClip>(4800), 1, 1.0f, true);
+	renderer.render(script, 0.1);
+	EXPECT_EQ(renderer.getEngine().getVoiceCounts().virtualised, 1u);
+
+	AudioRenderScript moveCloser;
+	moveCloser.setEmitterPosition(0, 1, AudioPosition::makePositional(Vector2f(10.0f, 0.0f), attenuation));
+	renderer.render(moveCloser, 0.1);
+	const auto counts = renderer.getEngine().getVoiceCounts();
+	EXPECT_EQ(counts.playing, 1u);
+	EXPECT_EQ(counts.virtualised, 0u);
+}
+
+TEST(HalleyAudioEngine, VirtualVoicesKeepPlaying)
+{
+	// The quiet one-shot is never rendered, but must still finish on time
+	const auto properties = makeAudioProperties(1);
+	AudioOfflineRenderer renderer(properties);
+
+	AudioRenderScript script;
+	script.setListener(0, AudioListenerData(Vector3f()));
+	script.play(0, 1, std::make_shared<ToneClip>(48000), 0, 1.0f, true);
+	script.play(0, 2, std::make_shared<ToneClip>(4800), 0, 0.1f, false);
+
+	renderer.render(script, 0.05);
+	EXPECT_EQ(renderer.getEngine().getVoiceCounts().playing, 2u);
+	EXPECT_EQ(renderer.getEngine().getVoiceCounts().virtualised, 1u);
+
+	renderer.render(AudioRenderScript(), 0.1);
+	EXPECT_EQ(renderer.getEngine().getVoiceCounts().playing, 1u);
+	EXPECT_EQ(getRealVoices(renderer.getEngine()), (Vector<AudioEventId>{ 1 }));
+}
+
+TEST(HalleyAudioEngine, VoicesSharingAStreamedClipRenderOnOneThread)
+{
+	const auto properties = makeAudioProperties(0);
+	std::atomic<bool> overlapped = false;
+	Vector<std::shared_ptr<const IAudioClip>> clips;
+	for (int i = 0; i < 3; ++i) {
+		clips.push_back(std::make_shared<SharedToneClip>(overlapped));
+	}
+
+	AudioRenderScript script;
+	script.setListener(0, AudioListenerData(Vector3f()));
+	for (int i = 0; i < 12; ++i) {
+		script.play(0, static_cast<AudioEventId>(i + 1), clips[i % clips.size()], 0, 0.1f, true);
+	}
+
+	auto renderWith = [&] (size_t nThreads)
+	{
+		AudioOfflineRenderer renderer(properties);
+		renderer.setRenderThreads(nThreads);
+		renderer.setCaptureOutput(true);
+		renderer.render(script, 0.5);
+		return renderer.getOutput();
+	};
+
+	const auto singleThreaded = renderWith(0);
+	const auto multiThreaded = renderWith(4);
+	EXPECT_FALSE(overlapped);
+	EXPECT_EQ(singleThreaded, multiThreaded);
+}
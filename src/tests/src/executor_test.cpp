@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <future>
+using namespace Halley;
+
+namespace {
+	std::thread makeThread(String name, std::function<void()> f)
+	{
+		return std::thread(std::move(f));
+	}
+
+	// Queues n tasks from within a task running on the queue, and returns the order they ran in
+	Vector<int> runChain(ExecutionQueue& queue, int n)
+	{
+		Vector<int> order;
+		std::promise<void> done;
+		queue.addToQueue([&] ()
+		{
+			for (int i = 0; i < n; ++i) {
+				queue.addToQueue([&, i] ()
+				{
+					order.push_back(i);
+					if (i == n - 1) {
+						done.set_value();
+					}
+				});
+			}
+		});
+		done.get_future().wait();
+		return order;
+	}
+}
+
+TEST(HalleyExecutor, SingleThreadExecutorIsFIFO)
+{
+	SingleThreadExecutor executor("test", makeThread);
+	const auto order = runChain(executor.getQueue(), 100);
+	ASSERT_EQ(order.size(), 100u);
+	EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST(HalleyExecutor, SingleWorkerPoolIsFIFO)
+{
+	ExecutionQueue queue;
+	ThreadPool pool("test", queue, 1, makeThread);
+	const auto order = runChain(queue, 100);
+	ASSERT_EQ(order.size(), 100u);
+	EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST(HalleyExecutor, WorkerRunsItsOwnTasksInOrder)
+{
+	// With other workers busy, the one that queued the tasks runs them all, and in order
+	ExecutionQueue queue;
+	ThreadPool pool("test", queue, 3, makeThread);
+
+	std::promise<void> release;
+	auto released = release.get_future().share();
+	std::atomic<int> blocked = 0;
+	for (int i = 0; i < 2; ++i) {
+		queue.addToQueue([&, released] ()
+		{
+			++blocked;
+			released.wait();
+		});
+	}
+	while (blocked < 2) {
+		std::this_thread::yield();
+	}
+
+	const auto order = runChain(queue, 100);
+	release.set_value();
+	ASSERT_EQ(order.size(), 100u);
+	EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+using namespace Halley;
+
+namespace {
+	// A grid of 10x10 squares, leaving out the ones where isOpen is false
+	// If edgePortals is set, the sides of the grid become portals to neighbouring chunks
+	template <typename F>
+	Navmesh makeGridNavmesh(int w, int h, F isOpen, bool edgePortals = false, int subWorld = 0)
+	{
+		Vector<int> ids(w * h, -1);
+		int nextId = 0;
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				if (isOpen(x, y)) {
+					ids[y * w + x] = nextId++;
+				}
+			}
+		}
+		auto getId = [&] (int x, int y, int portalId) -> int
+		{
+			if (x < 0 || y < 0 || x >= w || y >= h) {
+				return edgePortals ? -portalId - 2 : -1;
+			}
+			return ids[y * w + x];
+		};
+
+		Vector<Navmesh::PolygonData> polygons;
+		for (int y = 0; y < h; ++y) {
+			for (int x = 0; x < w; ++x) {
+				if (ids[y * w + x] < 0) {
+					continue;
+				}
+				const auto p = Vector2f(static_cast<float>(x), static_cast<float>(y)) * 10.0f;
+				Navmesh::PolygonData data;
+				data.polygon = Polygon(VertexList{ p, p + Vector2f(10, 0), p + Vector2f(10, 10), p + Vector2f(0, 10) });
+				data.connections = { getId(x, y - 1, 0), getId(x + 1, y, 1), getId(x, y + 1, 2), getId(x - 1, y, 3) };
+				data.weight = 1.0f;
+				EXPECT_EQ(ids[y * w + x], static_cast<int>(polygons.size()));
+				polygons.push_back(std::move(data));
+			}
+		}
+
+		const auto size = Vector2f(static_cast<float>(w), static_cast<float>(h)) * 10.0f;
+		return Navmesh(std::move(polygons), NavmeshBounds(Vector2f(), Vector2f(size.x, 0), Vector2f(0, size.y), 1, 1, Vector2f(1, 1)), subWorld);
+	}
+
+	// A wall at x == wallX that can only be crossed at y == 0
+	Navmesh makeGridNavmesh(int w, int h, int wallX)
+	{
+		return makeGridNavmesh(w, h, [=] (int x, int y) { return x != wallX || y == 0; });
+	}
+
+	// A world of chunks x chunks regions, with two walls of missing chunks that force long detours
+	constexpr int chunkCells = 4;
+	constexpr float chunkSize = chunkCells * 10.0f;
+
+	bool isChunkOpen(int x, int y, int chunks)
+	{
+		return !(x == 2 && y != 0) && !(x == 4 && y != chunks - 1);
+	}
+
+	void addChunkWorld(NavmeshSet& navmeshSet, int chunks, int subWorld, bool reverseOrder = false)
+	{
+		for (int i = 0; i < chunks * chunks; ++i) {
+			const int idx = reverseOrder ? chunks * chunks - 1 - i : i;
+			const int x = idx % chunks;
+			const int y = idx / chunks;
+			if (isChunkOpen(x, y, chunks)) {
+				NavmeshSet chunk;
+				chunk.add(makeGridNavmesh(chunkCells, chunkCells, [] (int, int) { return true; }, true, subWorld));
+				navmeshSet.addChunk(std::move(chunk), Vector2f(static_cast<float>(x), static_cast<float>(y)) * chunkSize, Vector2i(x, y));
+			}
+		}
+	}
+
+	NavigationQuery makeChunkWorldQuery(Random& rng, int chunks, int subWorld)
+	{
+		auto randomPoint = [&] ()
+		{
+			while (true) {
+				const auto chunk = Vector2i(rng.getInt(0, chunks - 1), rng.getInt(0, chunks - 1));
+				if (isChunkOpen(chunk.x, chunk.y, chunks)) {
+					const auto cell = Vector2f(static_cast<float>(rng.getInt(0, chunkCells - 1)), static_cast<float>(rng.getInt(0, chunkCells - 1)));
+					return WorldPosition(Vector2f(chunk) * chunkSize + cell * 10.0f + Vector2f(5, 5), subWorld);
+				}
+			}
+		};
+		return NavigationQuery(randomPoint(), randomPoint(), NavigationQuery::PostProcessingType::None, NavigationQuery::QuantizationType::None);
+	}
+
+	void checkPath(const NavmeshSet& navmeshSet, const NavigationQuery& query, const std::optional<NavigationPath>& path)
+	{
+		ASSERT_TRUE(path.has_value());
+		ASSERT_FALSE(path->path.empty());
+		EXPECT_EQ(query.from.pos, path->path.front().pos.pos);
+		EXPECT_EQ(query.to.pos, path->path.back().pos.pos);
+		for (const auto& point: path->path) {
+			ASSERT_LT(point.navmeshId, navmeshSet.getNavmeshes().size());
+			EXPECT_EQ(point.pos.subWorld, navmeshSet.getNavmeshes()[point.navmeshId].getSubWorld());
+		}
+	}
+
+	NavigationQuery makeQuery(Random& rng, int w, int h, int wallX)
+	{
+		auto randomPoint = [&] ()
+		{
+			while (true) {
+				const int x = rng.getInt(0, w - 1);
+				const int y = rng.getInt(0, h - 1);
+				if (x != wallX || y == 0) {
+					return WorldPosition(Vector2f(x * 10.0f + 5.0f, y * 10.0f + 5.0f), 0);
+				}
+			}
+		};
+		return NavigationQuery(randomPoint(), randomPoint(), NavigationQuery::PostProcessingType::None, NavigationQuery::QuantizationType::None);
+	}
+}
+
+TEST(HalleyNavmesh, ReusedScratchMatchesFresh)
+{
+	const auto big = makeGridNavmesh(30, 30, 10);
+	const auto small = makeGridNavmesh(8, 5, 3);
+	Random rng(42u);
+
+	NavmeshSearchScratch reused;
+	for (int i = 0; i < 200; ++i) {
+		const bool useBig = i % 3 != 0;
+		const auto& navmesh = useBig ? big : small;
+		const auto query = useBig ? makeQuery(rng, 30, 30, 10) : makeQuery(rng, 8, 5, 3);
+
+		NavmeshSearchScratch fresh;
+		const auto expected = navmesh.pathfindNodes(query, fresh);
+		const auto actual = navmesh.pathfindNodes(query, reused);
+		ASSERT_TRUE(expected.has_value());
+		ASSERT_TRUE(actual.has_value());
+		EXPECT_EQ(expected.value(), actual.value());
+	}
+}
+
+TEST(HalleyNavmesh, NavigationServiceBatches)
+{
+	NavmeshSet navmeshSet;
+	navmeshSet.add(makeGridNavmesh(30, 30, 10));
+	navmeshSet.linkNavmeshes();
+
+	ExecutionQueue queue;
+	ThreadPool pool("nav", queue, 2, [] (String name, std::function<void()> f) { return std::thread(std::move(f)); });
+	NavigationService service(navmeshSet, queue, 2);
+
+	Random rng(7u);
+	Vector<NavigationQuery> queries;
+	Vector<Future<NavigationService::Result>> futures;
+	Vector<std::optional<NavigationService::Result>> callbackResults(100);
+	for (size_t i = 0; i < 200; ++i) {
+		queries.push_back(makeQuery(rng, 30, 30, 10));
+		if (i % 2 == 0) {
+			futures.push_back(service.pathfind(queries.back()));
+		} else {
+			service.pathfind(queries.back(), [&, idx = i / 2] (NavigationService::Result result) { callbackResults[idx] = std::move(result); });
+		}
+	}
+
+	// With no budget to speak of, each batch only gets one query per worker
+	size_t nUpdates = 0;
+	while (service.getStats().queued > 0 || !service.isIdle()) {
+		service.update(0.0);
+		service.waitForIdle();
+		EXPECT_LE(service.getStats().lastBatchSize, 2u);
+		++nUpdates;
+	}
+	EXPECT_GE(nUpdates, 100u);
+
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const auto expected = navmeshSet.pathfind(queries[i]);
+		ASSERT_TRUE(expected.has_value());
+		const auto actual = i % 2 == 0 ? futures[i / 2].get() : callbackResults[i / 2].value();
+		ASSERT_TRUE(actual.has_value());
+		EXPECT_EQ(expected->path.size(), actual->path.size());
+		for (size_t j = 0; j < expected->path.size(); ++j) {
+			EXPECT_EQ(expected->path[j].pos, actual->path[j].pos);
+		}
+	}
+}
+
+TEST(HalleyNavmesh, RegionLandmarksAndRouteCache)
+{
+	constexpr int chunks = 7;
+
+	NavmeshSet plain;
+	addChunkWorld(plain, chunks, 0);
+	plain.linkNavmeshes();
+
+	NavmeshSet accelerated;
+	addChunkWorld(accelerated, chunks, 0);
+	accelerated.setRegionLandmarks(4);
+	accelerated.setRegionRouteCacheSize(16);
+	accelerated.linkNavmeshes();
+
+	Random rng(99u);
+	for (int i = 0; i < 100; ++i) {
+		const auto query = makeChunkWorldQuery(rng, chunks, 0);
+		const auto expected = plain.pathfind(query);
+		const auto actual = accelerated.pathfind(query);
+		checkPath(plain, query, expected);
+		checkPath(accelerated, query, actual);
+
+		// Routes from the cache were found for other points in the same regions, so allow for some slack
+		EXPECT_LE(actual->getLength(), expected->getLength() * 1.5f);
+	}
+}
+
+TEST(HalleyNavmesh, RegionRouteCacheIsInvalidated)
+{
+	constexpr int chunks = 7;
+
+	// Sub-world 1 goes first, so once it's removed, sub-world 0 reuses its region ids for different chunks
+	NavmeshSet navmeshSet;
+	addChunkWorld(navmeshSet, chunks, 1, true);
+	addChunkWorld(navmeshSet, chunks, 0);
+	navmeshSet.setRegionLandmarks(2);
+	navmeshSet.setRegionRouteCacheSize(64);
+	navmeshSet.linkNavmeshes();
+
+	Random rng(5u);
+	Vector<NavigationQuery> queries;
+	for (int i = 0; i < 40; ++i) {
+		queries.push_back(makeChunkWorldQuery(rng, chunks, 1));
+		checkPath(navmeshSet, queries.back(), navmeshSet.pathfind(queries.back()));
+	}
+
+	navmeshSet.clearSubWorld(1);
+	navmeshSet.linkNavmeshes();
+	for (auto query: queries) {
+		query.from.subWorld = 0;
+		query.to.subWorld = 0;
+		checkPath(navmeshSet, query, navmeshSet.pathfind(query));
+	}
+}
+
+TEST(HalleyNavmesh, FlowFieldLeadsToDestination)
+{
+	constexpr int chunks = 7;
+	NavmeshSet navmeshSet;
+	addChunkWorld(navmeshSet, chunks, 0);
+	navmeshSet.linkNavmeshes();
+
+	// Everyone starts from the same corner, past both walls, so they all have to take the long way round
+	auto walk = [&] (const NavigationFlowField& field, WorldPosition pos) -> size_t
+	{
+		NavigationFlowField::Cursor cursor;
+		for (size_t steps = 0; steps < 2000; ++steps) {
+			if ((field.getDestination().pos - pos.pos).length() < 1.0f) {
+				return steps;
+			}
+			const auto sample = field.sample(pos, cursor);
+			if (!sample) {
+				return std::numeric_limits<size_t>::max();
+			}
+			pos.pos += sample->direction * std::min(2.0f, (field.getDestination().pos - pos.pos).length());
+		}
+		return std::numeric_limits<size_t>::max();
+	};
+
+	const auto destination = WorldPosition(Vector2f(6, 6) * chunkSize + Vector2f(15, 25), 0);
+	NavigationFlowField field(navmeshSet, destination);
+	ASSERT_TRUE(field.isUpToDate());
+
+	Random rng(3u);
+	for (int i = 0; i < 20; ++i) {
+		const auto start = makeChunkWorldQuery(rng, chunks, 0).from;
+		EXPECT_LT(walk(field, start), 2000u);
+	}
+
+	// Moving the destination elsewhere only takes effect once the new field is done; until then agents keep using the old one
+	const auto newDestination = WorldPosition(Vector2f(0, 6) * chunkSize + Vector2f(5, 5), 0);
+	field.setDestination(newDestination);
+	EXPECT_FALSE(field.isUpToDate());
+	size_t nUpdates = 1;
+	while (!field.update(50)) {
+		EXPECT_TRUE(field.sample(WorldPosition(Vector2f(5, 5), 0)).has_value());
+		++nUpdates;
+	}
+	EXPECT_GT(nUpdates, 1u);
+	EXPECT_EQ(newDestination, field.getDestination());
+
+	auto sharedField = std::make_shared<NavigationFlowField>(navmeshSet, newDestination);
+	Vector<NavigationPathFollower> followers(10);
+	Vector<WorldPosition> positions;
+	for (auto& follower: followers) {
+		follower.setFlowField(sharedField);
+		positions.push_back(makeChunkWorldQuery(rng, chunks, 0).from);
+	}
+	for (size_t step = 0; step < 2000; ++step) {
+		for (size_t i = 0; i < followers.size(); ++i) {
+			followers[i].update(positions[i], navmeshSet, 1.0f);
+			positions[i].pos += followers[i].getSteeringDirection() * std::min(2.0f, (newDestination.pos - positions[i].pos).length());
+		}
+	}
+	for (const auto& follower: followers) {
+		EXPECT_TRUE(follower.isDone());
+	}
+}
@@ -73,3 +73,59 @@ TEST(Serializer, UInt64Conversion)
 		EXPECT_EQ(n, convertBackAndForth(n));
 	}
 }
+
+TEST(Serializer, GrowableBuffer)
+{
+	Vector<String> strings;
+	for (int i = 0; i < 200; ++i) {
+		strings.push_back("string" + toString(i));
+	}
+
+	for (int version = 0; version <= SerializerOptions::maxVersion; ++version) {
+		const auto options = SerializerOptions(version);
+		const auto bytes = Serializer::toBytes(strings, options);
+		EXPECT_EQ(Serializer::getSize(strings, options), bytes.size());
+		EXPECT_EQ(strings, Deserializer::fromBytes<Vector<String>>(bytes, options));
+	}
+}
+
+TEST(Serializer, BulkVectors)
+{
+	Vector<int32_t> ints;
+	Vector<float> floats;
+	Vector<Vector2f> points;
+	for (int i = 0; i < 100; ++i) {
+		ints.push_back(i * 1000 - 50000);
+		floats.push_back(static_cast<float>(i) * 0.5f);
+		points.push_back(Vector2f(static_cast<float>(i), static_cast<float>(-i)));
+	}
+
+	for (int version = 0; version <= SerializerOptions::maxVersion; ++version) {
+		const auto options = SerializerOptions(version);
+		const auto bytes = Serializer::toBytes([&] (Serializer& s)
+		{
+			s << ints << floats << points;
+		}, options);
+
+		Vector<int32_t> ints2;
+		Vector<float> floats2;
+		Vector<Vector2f> points2;
+		auto ds = Deserializer(bytes, options);
+		ds >> ints2 >> floats2 >> points2;
+		EXPECT_EQ(ints, ints2);
+		EXPECT_EQ(floats, floats2);
+		EXPECT_EQ(points, points2);
+		EXPECT_EQ(size_t(0), ds.getBytesLeft());
+	}
+
+	// Bulk copying must not change the format
+	Vector<gsl::byte> expected(4 + 100 * 8);
+	auto s = Serializer(gsl::span<gsl::byte>(expected), SerializerOptions(0));
+	s << static_cast<uint32_t>(points.size());
+	for (auto& p: points) {
+		s << p.x << p.y;
+	}
+	const auto bytes = Serializer::toBytes(points, SerializerOptions(0));
+	ASSERT_EQ(expected.size(), bytes.size());
+	EXPECT_EQ(0, memcmp(expected.data(), bytes.data(), bytes.size()));
+}
@@ -6,6 +6,8 @@
 #include "halley/resources/asset_database.h"
 
 namespace Halley {
+	class AssetPackIndex;
+
     class AssetPackInspector {
     public:
 	    explicit AssetPackInspector(String name);
@@ -18,6 +20,7 @@ namespace Halley {
 		size_t tableSize;
 		uint64_t totalHash;
 	    uint64_t dataStartPos;
+		int version = 0;
 
 	    struct Entry
 		{
@@ -33,6 +36,8 @@ namespace Halley {
 
 		void parseTable(Deserializer s, const Bytes& packBytes);
 	    void parseTypedDB(Deserializer& s, const Bytes& packBytes);
+		void parseIndex(const AssetPackIndex& index, const Bytes& packBytes);
+		AssetDatabase::PackLocation getLocation(const AssetDatabase::Entry& entry) const;
 		void computeHash();
     };
 
@@ -11,6 +11,7 @@
 namespace Halley {
 	class Project;
 	class AssetPackManifest;
+	class AssetPack;
 	class Path;
 		
 	class AssetPackListing {
@@ -52,9 +53,16 @@ namespace Halley {
 		static Vector<String> pack(Project& project, std::optional<std::set<String>> assetsToPack, const Vector<String>& deletedAssets, ProgressCallback progress);
 		static void packPlatform(Project& project, std::optional<std::set<String>> assetsToPack, const Vector<String>& deletedAssets, const String& platform, ProgressCallback progress, Vector<String>& packed);
 
+		// Writes overlay packs to dst with only the assets that were modified or added since the packs in releasePath, plus tombstones
+		// for the ones that were deleted. Packs with no changes are skipped. Returns the names of the packs written.
+		static Vector<String> generatePatch(Project& project, const String& platform, const Path& releasePath, const Path& dst, ProgressCallback progress);
+
 	private:
 		static std::map<String, AssetPackListing> sortIntoPacks(const AssetPackManifest& manifest, const AssetDatabase& srcAssetDb, std::optional<std::set<String>> assetsToPack, const Vector<String>& deletedAssets);
 		static void generatePacks(Project& project, std::map<String, AssetPackListing> packs, const Path& src, const Path& dst, ProgressCallback progress, Vector<String>& packed);
 		static void generatePack(Project& project, const String& packId, const AssetPackListing& pack, const Path& src, const Path& dst, ProgressCallback progress);
+		static bool generatePatchPack(Project& project, const String& packId, const AssetPackListing& pack, const Path& src, const Path& releasePack, const Path& dst, ProgressCallback progress);
+		static std::unique_ptr<AssetPack> tryOpenPack(const Path& path, std::optional<Encrypt::AESKey> key);
+		static void writePack(Project& project, const String& packId, gsl::span<const AssetPackListing::Entry* const> entries, gsl::span<const std::pair<AssetType, String>> deleted, std::optional<Encrypt::AESKey> key, const Path& src, const Path& dst, std::unique_ptr<AssetPack> oldPack, ProgressCallback progress);
 	};
 }
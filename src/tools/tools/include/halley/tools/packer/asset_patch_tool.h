@@ -0,0 +1,12 @@
+#pragma once
+
+#include "halley/tools/cli_tool.h"
+
+namespace Halley
+{
+	class AssetPatchTool : public CommandLineTool
+	{
+	public:
+		int run(Vector<std::string> args) override;
+	};
+}
@@ -601,6 +601,53 @@ Vector<String> CodegenCPP::generateSystemHeader(SystemSchema& system, const Hash
 		}
 	}
 
+	// Access info, used to schedule systems concurrently
+	{
+		std::set<String> componentsRead;
+		std::set<String> componentsWritten;
+		for (const auto& fam: system.families) {
+			for (const auto& comp: fam.components) {
+				(comp.write ? componentsWritten : componentsRead).insert(comp.name + "Component::componentIndex");
+			}
+		}
+		Vector<String> servicesUsed;
+		for (const auto& service: system.services) {
+			servicesUsed.push_back("typeid(" + service.name + ").name()");
+		}
+		Vector<String> msgsSent;
+		Vector<String> msgsReceived;
+		for (const auto& msg: system.messages) {
+			if (msg.send) {
+				msgsSent.push_back(msg.name + "Message::messageIndex");
+			}
+			if (msg.receive) {
+				msgsReceived.push_back(msg.name + "Message::messageIndex");
+			}
+		}
+
+		// Systems that can reach into the world or send system messages can touch anything, so they have to run on their own
+		const bool sendsSystemMessages = std_ex::contains_if(system.systemMessages, [] (const MessageReferenceSchema& msg) { return msg.send; });
+		const bool exclusive = (int(system.access) & (int(SystemAccess::World) | int(SystemAccess::MessageBridge))) != 0 || sendsSystemMessages;
+		const bool usesAPI = (int(system.access) & int(SystemAccess::API)) != 0;
+
+		Vector<String> accessInfoBody;
+		accessInfoBody.push_back("Halley::SystemAccessInfo info;");
+		accessInfoBody.push_back("info.componentsRead = { " + String::concatList(Vector<String>(componentsRead.begin(), componentsRead.end()), ", ") + " };");
+		accessInfoBody.push_back("info.componentsWritten = { " + String::concatList(Vector<String>(componentsWritten.begin(), componentsWritten.end()), ", ") + " };");
+		accessInfoBody.push_back("info.services = { " + String::concatList(servicesUsed, ", ") + " };");
+		accessInfoBody.push_back("info.messagesSent = { " + String::concatList(msgsSent, ", ") + " };");
+		accessInfoBody.push_back("info.messagesReceived = { " + String::concatList(msgsReceived, ", ") + " };");
+		accessInfoBody.push_back(String("info.usesAPI = ") + (usesAPI ? "true" : "false") + ";");
+		accessInfoBody.push_back(String("info.exclusive = ") + (exclusive ? "true" : "false") + ";");
+		accessInfoBody.push_back("return info;");
+
+		sysClassGen
+			.addBlankLine()
+			.setAccessLevel(MemberAccess::Public)
+			.addMethodDefinition(MethodSchema(TypeSchema("Halley::SystemAccessInfo"), {}, "getAccessInfo", true, false, true, true), accessInfoBody)
+			.setAccessLevel(MemberAccess::Protected);
+	}
+
 	// Construct initBase();
 	Vector<String> initBaseMethodBody;
 	for (auto& service: system.services) {
@@ -6,6 +6,7 @@
 #include "halley/bytes/compression.h"
 #include "halley/support/console.h"
 #include "halley/resources/asset_database.h"
+#include "halley/resources/asset_pack_index.h"
 #include "halley/utils/hash.h"
 
 using namespace Halley;
@@ -23,15 +24,24 @@ void AssetPackInspector::parse(const Bytes& bytes)
 	auto headerSpan = gsl::as_writable_bytes(gsl::span<AssetPackHeader>(&header, 1));
 	s >> headerSpan;
 	dataStartPos = header.dataStartPos;
+	version = header.getVersion().value_or(0);
+	if (version == 0) {
+		throw Exception("Not an asset pack", HalleyExceptions::Tools);
+	}
 
 	Bytes tableData(header.dataStartPos - header.assetDbStartPos);
 	auto tableSpan = gsl::as_writable_bytes(gsl::span<Byte>(tableData.data(), tableData.size()));
 	s >> tableSpan;
 
 	rawTableSize = tableData.size();
-	auto rawTableData = Compression::decompress(tableData);
-	tableSize = rawTableData.size();
-	parseTable(Deserializer(rawTableData), bytes);
+	if (version >= 3) {
+		tableSize = tableData.size();
+		parseIndex(AssetPackIndex(tableData.byte_span()), bytes);
+	} else {
+		auto rawTableData = Compression::decompress(tableData);
+		tableSize = rawTableData.size();
+		parseTable(Deserializer(rawTableData, SerializerOptions(version >= 2 ? SerializerOptions::maxVersion : 0)), bytes);
+	}
 
 	// Generated sorted entries
 	sortedEntries.resize(entries.size());
@@ -71,15 +81,40 @@ void AssetPackInspector::parseTypedDB(Deserializer& s, const Bytes& packBytes)
 		AssetDatabase::Entry entry;
 		s >> key >> entry;
 
-		auto splitPath = entry.path.split(':');
-		size_t pos = splitPath.at(0).toInteger64();
-		size_t size = splitPath.at(1).toInteger64();
-		auto hash = Hash::hash(gsl::as_bytes(gsl::span<const Byte>(packBytes.data() + pos + dataStartPos, size)));
+		const auto location = getLocation(entry);
+		auto hash = Hash::hash(gsl::as_bytes(gsl::span<const Byte>(packBytes.data() + location.offset + dataStartPos, location.storedSize)));
 
 		entries.emplace_back(curAssetType, hash, std::move(key), std::move(entry));
 	}
 }
 
+void AssetPackInspector::parseIndex(const AssetPackIndex& index, const Bytes& packBytes)
+{
+	entries.reserve(index.getEntryCount());
+	for (const auto type: index.getTypes()) {
+		for (const auto& indexEntry: index.getEntries(type)) {
+			AssetDatabase::Entry entry("", index.getMetadata(indexEntry));
+			entry.packLocation = AssetPackIndex::getLocation(indexEntry);
+			auto hash = Hash::hash(gsl::as_bytes(gsl::span<const Byte>(packBytes.data() + entry.packLocation.offset + dataStartPos, entry.packLocation.storedSize)));
+
+			entries.emplace_back(int(type), hash, String(index.getName(indexEntry)), std::move(entry));
+		}
+	}
+}
+
+AssetDatabase::PackLocation AssetPackInspector::getLocation(const AssetDatabase::Entry& entry) const
+{
+	if (version >= 2) {
+		return entry.packLocation;
+	}
+
+	auto splitPath = entry.path.split(':');
+	AssetDatabase::PackLocation location;
+	location.offset = splitPath.at(0).toInteger64();
+	location.size = location.storedSize = splitPath.at(1).toInteger64();
+	return location;
+}
+
 void AssetPackInspector::computeHash()
 {
 	Hash::Hasher hasher;
@@ -97,7 +132,7 @@ void AssetPackInspector::printData() const
 	auto stdCol = ConsoleColour();
 	auto infoCol = ConsoleColour(Console::MAGENTA);
 	auto strCol = ConsoleColour(Console::DARK_GREY);
-	std::cout << "Pack " << strCol << name << stdCol << "\n";
+	std::cout << "Pack " << strCol << name << stdCol << " (format " << infoCol << version << stdCol << ")\n";
 	std::cout << "  Table size: " << infoCol << rawTableSize << stdCol << " -> " << infoCol << tableSize << stdCol << "\n";
 
 	int lastType = -1;
@@ -110,8 +145,15 @@ void AssetPackInspector::printData() const
 			std::cout << "  Assets of type " << infoCol << lastType << stdCol << ":\n";
 		}
 
-		auto splitPath = entry.entry.path.split(':');
-		std::cout << "    [" << i << "] " << strCol << entry.key << stdCol << " [" << infoCol << toString(entry.hash, 16) << stdCol << "]: at " << infoCol << splitPath.at(0) << stdCol << ", " << infoCol << splitPath.at(1) << stdCol << " bytes, " << strCol << toString(entry.entry.meta) <<  stdCol << "\n";
+		const auto location = getLocation(entry.entry);
+		String flags;
+		if (location.hasFlag(AssetDatabase::PackLocation::LZ4Compressed)) {
+			flags += " (" + toString(location.storedSize) + " stored, lz4)";
+		}
+		if (location.hasFlag(AssetDatabase::PackLocation::Encrypted)) {
+			flags += " (encrypted)";
+		}
+		std::cout << "    [" << i << "] " << strCol << entry.key << stdCol << " [" << infoCol << toString(entry.hash, 16) << stdCol << "]: at " << infoCol << location.offset << stdCol << ", " << infoCol << location.size << stdCol << " bytes" << flags << ", " << strCol << toString(entry.entry.meta) <<  stdCol << "\n";
 
 		++i;
 	}
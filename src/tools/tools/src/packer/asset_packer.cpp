@@ -6,10 +6,14 @@
 #include "halley/tools/packer/asset_pack_manifest.h"
 #include "halley/resources/resource.h"
 #include "halley/resources/asset_pack.h"
+#include "halley/resources/asset_pack_writer.h"
+#include "halley/file/memory_mapped_file.h"
+#include "halley/concurrency/concurrent.h"
 #include "halley/tools/project/project.h"
 #include "halley/tools/assets/import_assets_database.h"
 #include "halley/tools/file/filesystem_cache.h"
 #include "halley/utils/algorithm.h"
+#include <numeric>
 using namespace Halley;
 
 
@@ -185,100 +189,241 @@ void AssetPacker::generatePacks(Project& project, std::map<String, AssetPackList
 		}
 	}
 
-	size_t n = toPack.size();
-	for (size_t i = 0; i < n; ++i) {
-		if (!std_ex::contains(packed, toPack[i].name)) {
-			packed.push_back(toPack[i].name);
+	for (const auto& entry: toPack) {
+		if (!std_ex::contains(packed, entry.name)) {
+			packed.push_back(entry.name);
 		}
-		generatePack(project, toPack[i].name, *toPack[i].listing, src, toPack[i].dstPack, [=] (float p, const String& s)
+	}
+
+	// Packs are generated in parallel, so progress is reported as the sum of all of them
+	const size_t n = toPack.size();
+	Vector<float> packProgress(n, 0.0f);
+	std::mutex progressMutex;
+
+	Concurrent::parallelFor(Executors::getCPU(), n, 1, [&] (size_t i)
+	{
+		generatePack(project, toPack[i].name, *toPack[i].listing, src, toPack[i].dstPack, [&, i] (float p, const String& s)
 		{
-			progress((p + i) * (1.0f / n), s);
+			std::unique_lock<std::mutex> lock(progressMutex);
+			packProgress[i] = p;
+			progress(std::accumulate(packProgress.begin(), packProgress.end(), 0.0f) / float(n), s);
 		});
-	}
+	});
 }
 
 void AssetPacker::generatePack(Project& project, const String& packId, const AssetPackListing& packListing, const Path& src, const Path& dst, ProgressCallback progress)
 {
-	AssetPack pack;
-	AssetDatabase& db = pack.getAssetDatabase();
-	Bytes& data = pack.getData();
-	auto& fs = project.getFileSystemCache();
-
 	// Read old version of this pack, if available
-	std::unique_ptr<AssetPack> oldPack;
-	auto reader = std::make_unique<ResourceDataReaderFileSystem>(dst);
-	if (reader->size() > 0) {
-		try {
-			oldPack = std::make_unique<AssetPack>(std::move(reader), packListing.getEncryptionKey(), true);
-		} catch (...) {
-			// Just ignore it if it fails to load asset pack for whatever reason
+	auto oldPack = tryOpenPack(dst, packListing.getEncryptionKey());
+
+	Vector<const AssetPackListing::Entry*> entries;
+	entries.reserve(packListing.getEntries().size());
+	for (const auto& entry: packListing.getEntries()) {
+		entries.push_back(&entry);
+	}
+
+	writePack(project, packId, entries, {}, packListing.getEncryptionKey(), src, dst, std::move(oldPack), std::move(progress));
+}
+
+Vector<String> AssetPacker::generatePatch(Project& project, const String& platform, const Path& releasePath, const Path& dst, ProgressCallback progress)
+{
+	const auto src = project.getUnpackedAssetsPath();
+
+	Logger::logInfo("Generating patch for platform \"" + platform + "\" against \"" + releasePath.string() + "\" at \"" + dst.string() + "\".");
+	const auto db = project.getImportAssetsDatabase().makeAssetDatabase(platform);
+	const auto manifest = AssetPackManifest(FileSystem::readFile(project.getAssetPackManifestPath()));
+	auto packs = sortIntoPacks(manifest, *db, {}, {});
+
+	// Packs that are gone altogether still need their assets deleted
+	for (const auto& file: FileSystem::enumerateDirectory(releasePath)) {
+		if (file.getExtension() == ".dat") {
+			const auto packId = file.replaceExtension("").string();
+			if (packs.find(packId) == packs.end()) {
+				packs[packId] = AssetPackListing(packId, {});
+			}
 		}
 	}
-	reader = {};
 
-	const size_t n = packListing.getEntries().size();
+	Vector<String> patched;
+	const size_t n = packs.size();
 	size_t i = 0;
+	for (const auto& [packId, listing]: packs) {
+		if (!packId.isEmpty()) {
+			const bool changed = generatePatchPack(project, packId, listing, src, releasePath / packId + ".dat", dst / packId + ".dat", [=] (float p, const String& s)
+			{
+				progress((p + i) * (1.0f / n), s);
+			});
+			if (changed) {
+				patched.push_back(packId);
+			}
+		}
+		++i;
+	}
 
-	for (auto& entry: packListing.getEntries()) {
-		// Read original file
-		// Priority:
-		// 1. Cache
-		// 2. Old pack
-		// 3. Filesystem (via cache)
-		Bytes fileData;
-		if (entry.modified || fs.hasCached(src / entry.path) || !oldPack) {
-			// Read from cache or filesystem
-			fileData = fs.readFileCopy(src / entry.path);
-		} else {
-			// Read from pack
-			auto oldData = oldPack->getData(entry.name, entry.type, false);
-			if (oldData) {
-				auto data = dynamic_cast<ResourceDataStatic*>(oldData.get())->getSpan();
-				fileData = Bytes(reinterpret_cast<const Byte*>(data.data()), reinterpret_cast<const Byte*>(data.data()) + data.size());
-			} else {
-				// Read from cache after all...
-				fileData = fs.readFileCopy(src / entry.path);
+	Logger::logInfo("Patched " + toString(patched.size()) + " packs.");
+	return patched;
+}
+
+bool AssetPacker::generatePatchPack(Project& project, const String& packId, const AssetPackListing& packListing, const Path& src, const Path& releasePack, const Path& dst, ProgressCallback progress)
+{
+	auto& fs = project.getFileSystemCache();
+	const auto release = tryOpenPack(releasePack, packListing.getEncryptionKey());
+	const auto& listingEntries = packListing.getEntries();
+
+	// Find out which assets were modified or added since the release
+	Vector<char> modified(listingEntries.size(), 1);
+	if (release) {
+		Concurrent::parallelFor(Executors::getCPU(), listingEntries.size(), 0, [&] (size_t i)
+		{
+			const auto& entry = listingEntries[i];
+			const auto* releaseMeta = release->getMetadata(entry.name, entry.type);
+			if (!releaseMeta || *releaseMeta != entry.metadata) {
+				return;
 			}
+
+			const auto releaseData = release->getData(entry.name, entry.type, false);
+			const auto fileData = fs.readFileCopy(src / entry.path);
+			const auto releaseSpan = dynamic_cast<ResourceDataStatic&>(*releaseData).getSpan();
+			if (releaseSpan.size() == fileData.size() && memcmp(releaseSpan.data(), fileData.data(), fileData.size()) == 0) {
+				modified[i] = 0;
+			}
+		});
+	}
+
+	Vector<const AssetPackListing::Entry*> entries;
+	for (size_t i = 0; i < listingEntries.size(); ++i) {
+		if (modified[i]) {
+			entries.push_back(&listingEntries[i]);
 		}
+	}
 
-		const size_t size = fileData.size();
-		if (size == 0) {
-			Logger::logError("Unable to pack: \"" + (src / entry.path) + "\". File not found or empty.");
-			continue;
+	// And which ones were deleted
+	Vector<std::pair<AssetType, String>> deleted;
+	if (release) {
+		std::set<std::pair<AssetType, String>> current;
+		for (const auto& entry: listingEntries) {
+			current.insert(std::make_pair(entry.type, entry.name));
 		}
-		
-		// Read data into pack data
-		const size_t pos = data.size();
-		data.reserve(nextPowerOf2(pos + size));
-		data.resize(pos + size);
-		memcpy(data.data() + pos, fileData.data(), size);
+		for (const auto& assetId: release->getAssetIds()) {
+			const auto split = assetId.find(':');
+			auto asset = std::make_pair(fromString<AssetType>(assetId.substr(0, split)), assetId.substr(split + 1));
+			if (current.find(asset) == current.end()) {
+				deleted.push_back(std::move(asset));
+			}
+		}
+	}
 
-		db.addAsset(entry.name, entry.type, AssetDatabase::Entry(toString(pos) + ":" + toString(size), entry.metadata));
+	if (entries.empty() && deleted.empty()) {
+		return false;
+	}
+
+	Logger::logInfo("- Patching \"" + packId + "\": " + toString(entries.size()) + " modified or added, " + toString(deleted.size()) + " deleted.");
+	writePack(project, packId, entries, deleted, packListing.getEncryptionKey(), src, dst, {}, std::move(progress));
+	return true;
+}
 
-		progress(float(i) / float(n), packId);
-		i++;
+std::unique_ptr<AssetPack> AssetPacker::tryOpenPack(const Path& path, std::optional<Encrypt::AESKey> key)
+{
+	if (!FileSystem::exists(path)) {
+		return {};
 	}
 
-	oldPack = {}; // Release file handle!
+	try {
+		// Mapped (or read on demand) instead of loaded, as only some entries are usually needed
+		auto mappedFile = std::make_shared<MemoryMappedFile>(path);
+		if (mappedFile->isOpen()) {
+			return std::make_unique<AssetPack>(std::move(mappedFile), key);
+		} else {
+			return std::make_unique<AssetPack>(std::make_unique<ResourceDataReaderFileSystem>(path), key);
+		}
+	} catch (...) {
+		// Just ignore it if it fails to load asset pack for whatever reason
+		return {};
+	}
+}
+
+void AssetPacker::writePack(Project& project, const String& packId, gsl::span<const AssetPackListing::Entry* const> entries, gsl::span<const std::pair<AssetType, String>> deleted, std::optional<Encrypt::AESKey> key, const Path& src, const Path& dst, std::unique_ptr<AssetPack> oldPack, ProgressCallback progress)
+{
+	auto& fs = project.getFileSystemCache();
+
+	// Written next to the old pack, which is replaced once done
+	const auto tmpDst = Path(dst.string() + ".tmp");
+	FileSystem::createParentDir(tmpDst);
+	AssetPackWriter writer(tmpDst, key);
 
-	if (packListing.getEncryptionKey().has_value()) {
-		Logger::logInfo("- Encrypting \"" + packId + "\"...");
-		pack.encrypt(*packListing.getEncryptionKey());
+	for (const auto* entry: entries) {
+		writer.declare(entry->name, entry->type, entry->metadata);
 	}
+	for (const auto& [type, name]: deleted) {
+		writer.declare(name, type, Metadata());
+	}
+	writer.begin();
+
+	for (const auto& [type, name]: deleted) {
+		writer.writeTombstone(name, type);
+	}
+
+	// Entries are read and encoded in parallel, a batch at a time to bound memory usage, and then written in order
+	constexpr size_t batchSize = 64;
+	const size_t n = entries.size();
+	Vector<std::optional<AssetPackWriter::EncodedAsset>> batch;
+
+	for (size_t batchStart = 0; batchStart < n; batchStart += batchSize) {
+		const size_t batchEnd = std::min(n, batchStart + batchSize);
+		batch.clear();
+		batch.resize(batchEnd - batchStart);
+
+		Concurrent::parallelFor(Executors::getCPU(), batch.size(), 1, [&] (size_t i)
+		{
+			const auto& entry = *entries[batchStart + i];
+
+			// Read original file
+			// Priority:
+			// 1. Cache
+			// 2. Old pack
+			// 3. Filesystem (via cache)
+			std::unique_ptr<ResourceData> oldData;
+			if (!entry.modified && !fs.hasCached(src / entry.path) && oldPack) {
+				oldData = oldPack->getData(entry.name, entry.type, false);
+			}
+
+			if (oldData) {
+				batch[i] = writer.encode(dynamic_cast<ResourceDataStatic&>(*oldData).getSpan());
+			} else {
+				const auto fileData = fs.readFileCopy(src / entry.path);
+				if (!fileData.empty()) {
+					batch[i] = writer.encode(fileData.const_byte_span());
+				}
+			}
+		});
+
+		for (size_t i = 0; i < batch.size(); ++i) {
+			const auto& entry = *entries[batchStart + i];
+			if (batch[i]) {
+				writer.write(entry.name, entry.type, std::move(*batch[i]));
+			} else {
+				Logger::logError("Unable to pack: \"" + (src / entry.path) + "\". File not found or empty.");
+			}
+		}
+
+		progress(float(batchEnd) / float(n), packId);
+	}
+
+	writer.finish();
+	oldPack = {}; // Release file handle!
 
-	// Write pack
-	const auto packData = pack.writeOut();
-	bool packed = FileSystem::writeFile(dst, packData);
+	bool packed = FileSystem::rename(tmpDst, dst);
 	if (!packed) {
 		// Try again
 		using namespace std::chrono_literals;
 		std::this_thread::sleep_for(200ms);
-		packed = FileSystem::writeFile(dst, packData);
+		packed = FileSystem::rename(tmpDst, dst);
 	}
 
 	if (packed) {
-		Logger::logInfo("- Packed " + toString(packListing.getEntries().size()) + " entries on \"" + packId + "\" (" + String::prettySize(data.size()) + ").");
+		Logger::logInfo("- Packed " + toString(entries.size()) + " entries on \"" + packId + "\" (" + String::prettySize(writer.getDataSize()) + ", " + toString(writer.getDeduplicatedCount()) + " deduplicated).");
 	} else {
+		FileSystem::remove(tmpDst);
 		throw Exception("Unable to write pack file " + dst.getNativeString(), HalleyExceptions::Tools);
 	}
 }
@@ -0,0 +1,38 @@
+#include "halley/tools/packer/asset_patch_tool.h"
+#include "halley/file/path.h"
+#include "halley/tools/packer/asset_packer.h"
+#include "halley/support/logger.h"
+#include "halley/tools/project/project.h"
+#include "halley/tools/project/project_loader.h"
+
+using namespace Halley;
+
+int AssetPatchTool::run(Vector<std::string> args)
+{
+	try {
+		if (args.size() == 6) {
+			const auto manifestPath = Path(args[0]);
+			const auto projDir = Path(args[1]);
+			const auto halleyDir = Path(args[2]);
+			const auto platform = String(args[3]);
+			const auto releaseDir = Path(args[4]);
+			const auto patchDir = Path(args[5]);
+
+			ProjectLoader loader(*statics, halleyDir);
+			auto project = loader.loadProject(projDir);
+			project->setAssetPackManifest(manifestPath);
+
+			AssetPacker::generatePatch(*project, platform, releaseDir, patchDir, [=] (float p, const String& s) {});
+			return 0;
+		} else {
+			Logger::logError("Usage: halley-cmd pack-patch path/to/manifest.yaml projDir halleyDir platform releasePacksDir patchDir");
+			return 1;
+		}
+	} catch (std::exception& e) {
+		Logger::logException(e);
+		return 1;
+	} catch (...) {
+		Logger::logError("Unknown exception generating patch.");
+		return 1;
+	}
+}
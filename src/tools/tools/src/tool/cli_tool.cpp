@@ -5,6 +5,7 @@
 #include "halley/tools/make_font/make_font_tool.h"
 #include "halley/tools/assets/import_tool.h"
 #include "halley/tools/packer/asset_packer_tool.h"
+#include "halley/tools/packer/asset_patch_tool.h"
 #include "halley/support/logger.h"
 #include "halley/game/halley_statics.h"
 #include "halley/support/debug.h"
@@ -22,6 +23,7 @@ CommandLineTools::CommandLineTools()
 	factories["distField"] = []() { return std::make_unique<DistanceFieldTool>(); };
 	factories["makeFont"] = []() { return std::make_unique<MakeFontTool>(); };
 	factories["pack"] = []() { return std::make_unique<AssetPackerTool>(); };
+	factories["pack-patch"] = []() { return std::make_unique<AssetPatchTool>(); };
 	factories["pack-inspector"] = []() { return std::make_unique<AssetPackInspectorTool>(); };
 	factories["vs_project"] = []() { return std::make_unique<VSProjectTool>(); };
 	factories["run"] = []() { return std::make_unique<RunnerTool>(); };